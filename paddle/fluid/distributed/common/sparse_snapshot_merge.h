@@ -0,0 +1,259 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <fstream>
+#include <future>  // NOLINT
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <ThreadPool.h>
+#include "glog/logging.h"
+#include "paddle/fluid/distributed/table/depends/sparse_snapshot.h"
+#include "paddle/fluid/platform/enforce.h"
+#include "paddle/fluid/platform/port.h"
+#include "paddle/fluid/string/printf.h"
+#include "paddle/fluid/string/string_helper.h"
+
+namespace paddle {
+namespace distributed {
+
+// SnapshotMerge compacts a base binary snapshot of a sparse table and the
+// delta snapshots saved after it into a new base, offline. Rows of a later
+// delta replace the earlier ones and rows flagged as deleted are dropped.
+class SnapshotMerge {
+ public:
+  SnapshotMerge() {}
+  ~SnapshotMerge() {}
+
+  // inputs are the snapshot files of one shard, the base first and then the
+  // deltas in the order they were saved. returns the rows of the output.
+  // the deltas are kept in memory by key, and the base is streamed through
+  // them into the output.
+  int64_t Merge(const std::vector<std::string> &inputs,
+                const std::string &output) {
+    PADDLE_ENFORCE_GT(inputs.size(), 0,
+                      platform::errors::InvalidArgument(
+                          "SnapshotMerge needs at least a base snapshot."));
+
+    SparseSnapshotHeader header;
+    auto base = OpenSnapshot(inputs[0], &header);
+    PADDLE_ENFORCE_EQ(header.kind, static_cast<uint32_t>(kSnapshotBase),
+                      platform::errors::InvalidArgument(
+                          "%s should be a base snapshot.", inputs[0]));
+
+    // the latest record of each key in the deltas, deleted ones included
+    std::vector<char> rows;
+    std::unordered_map<uint64_t, size_t> index;
+    std::vector<char> record(header.record_size);
+    for (size_t x = 1; x < inputs.size(); ++x) {
+      SparseSnapshotHeader delta;
+      auto fp = OpenSnapshot(inputs[x], &delta);
+      PADDLE_ENFORCE_EQ(delta.kind, static_cast<uint32_t>(kSnapshotDelta),
+                        platform::errors::InvalidArgument(
+                            "%s should be a delta snapshot.", inputs[x]));
+      PADDLE_ENFORCE_EQ(
+          delta.value_length == header.value_length &&
+              delta.shard_id == header.shard_id &&
+              delta.shard_num == header.shard_num,
+          true,
+          platform::errors::InvalidArgument(
+              "%s has value length %d in shard %d of %d, but the base %s has "
+              "value length %d in shard %d of %d.",
+              inputs[x], delta.value_length, delta.shard_id, delta.shard_num,
+              inputs[0], header.value_length, header.shard_id,
+              header.shard_num));
+      for (uint64_t i = 0; i < delta.count; ++i) {
+        ReadRecord(fp.get(), inputs[x], &record);
+        auto iter = index.find(RecordKey(record.data()));
+        if (iter == index.end()) {
+          iter = index.emplace(RecordKey(record.data()), rows.size()).first;
+          rows.resize(rows.size() + record.size());
+        }
+        memcpy(rows.data() + iter->second, record.data(), record.size());
+      }
+    }
+
+    std::unique_ptr<FILE, int (*)(FILE *)> fp(fopen(output.c_str(), "wb"),
+                                              &fclose);
+    PADDLE_ENFORCE_NOT_NULL(
+        fp.get(),
+        platform::errors::Unavailable("Cannot open %s to write.", output));
+    // the count is written once known
+    fwrite(&header, sizeof(header), 1, fp.get());
+    uint64_t count = 0;
+    auto write = [&](const char *data) {
+      if (!(reinterpret_cast<const SparseSnapshotRecord *>(data)->flags &
+            SPARSE_SNAPSHOT_DELETED)) {
+        fwrite(data, header.record_size, 1, fp.get());
+        ++count;
+      }
+    };
+    for (uint64_t i = 0; i < header.count; ++i) {
+      ReadRecord(base.get(), inputs[0], &record);
+      auto iter = index.find(RecordKey(record.data()));
+      if (iter == index.end()) {
+        write(record.data());
+      } else {
+        write(rows.data() + iter->second);
+        index.erase(iter);
+      }
+    }
+    // then the rows added by the deltas, in the order they were added
+    for (size_t offset = 0; offset < rows.size(); offset += record.size()) {
+      if (index.count(RecordKey(rows.data() + offset))) {
+        write(rows.data() + offset);
+      }
+    }
+
+    header.count = count;
+    PADDLE_ENFORCE_EQ(
+        fseek(fp.get(), 0, SEEK_SET), 0,
+        platform::errors::Unavailable("Failed to write %s.", output));
+    fwrite(&header, sizeof(header), 1, fp.get());
+    PADDLE_ENFORCE_EQ(
+        ferror(fp.get()), 0,
+        platform::errors::Unavailable("Failed to write %s.", output));
+    PADDLE_ENFORCE_EQ(
+        fclose(fp.release()), 0,
+        platform::errors::Unavailable("Failed to write %s.", output));
+
+    VLOG(1) << "merge " << inputs.size() << " snapshots into " << output
+            << " with " << count << " rows";
+    return count;
+  }
+
+  // dirs are table directories (e.g. path/emb.shard) of the base and of the
+  // deltas in order. every shard file of the base is merged in parallel into
+  // output_dir, and the meta files are copied with the new row count.
+  int64_t MergeDirs(const std::vector<std::string> &dirs,
+                    const std::string &output_dir, const int thread_num) {
+    PADDLE_ENFORCE_GT(dirs.size(), 0,
+                      platform::errors::InvalidArgument(
+                          "SnapshotMerge needs at least a base directory."));
+
+    std::vector<std::string> files;
+    std::vector<std::string> metas;
+    DIR *dir = opendir(dirs[0].c_str());
+    PADDLE_ENFORCE_NOT_NULL(
+        dir, platform::errors::NotFound("Cannot open directory %s.", dirs[0]));
+    while (struct dirent *entry = readdir(dir)) {
+      std::string name = entry->d_name;
+      if (EndWith(name, ".bin")) {
+        files.push_back(name);
+      } else if (EndWith(name, ".meta")) {
+        metas.push_back(name);
+      }
+    }
+    closedir(dir);
+
+    MkDirRecursively(output_dir.c_str());
+    ::ThreadPool pool(thread_num);
+    std::vector<std::future<int64_t>> tasks(files.size());
+    for (size_t x = 0; x < files.size(); ++x) {
+      std::vector<std::string> inputs;
+      for (auto &d : dirs) {
+        inputs.push_back(string::Sprintf("%s/%s", d, files[x]));
+      }
+      std::string output = string::Sprintf("%s/%s", output_dir, files[x]);
+      tasks[x] = pool.enqueue([this, inputs, output]() -> int64_t {
+        return Merge(inputs, output);
+      });
+    }
+
+    // meta of <var>.block<n> counts the rows of all <var>.block<n>.shard*
+    std::map<std::string, int64_t> block_rows;
+    int64_t total = 0;
+    for (size_t x = 0; x < tasks.size(); ++x) {
+      auto rows = tasks[x].get();
+      auto prefix = files[x].substr(0, files[x].rfind(".shard"));
+      block_rows[prefix] += rows;
+      total += rows;
+    }
+
+    for (auto &meta : metas) {
+      auto prefix = meta.substr(0, meta.size() - strlen(".meta"));
+      std::ifstream in(string::Sprintf("%s/%s", dirs.back(), meta));
+      std::ofstream out(string::Sprintf("%s/%s", output_dir, meta));
+      std::string line;
+      while (std::getline(in, line)) {
+        if (line.compare(0, strlen("count="), "count=") == 0) {
+          line = string::Sprintf("count=%d", block_rows[prefix]);
+        }
+        out << line << "\n";
+      }
+    }
+    return total;
+  }
+
+ private:
+  using SnapshotFile = std::unique_ptr<FILE, int (*)(FILE *)>;
+
+  // opens a snapshot, and checks its header
+  static SnapshotFile OpenSnapshot(const std::string &path,
+                                   SparseSnapshotHeader *header) {
+    SnapshotFile fp(fopen(path.c_str(), "rb"), &fclose);
+    PADDLE_ENFORCE_NOT_NULL(
+        fp.get(), platform::errors::NotFound("Cannot open snapshot %s.", path));
+    PADDLE_ENFORCE_EQ(
+        fread(header, sizeof(*header), 1, fp.get()), 1,
+        platform::errors::InvalidArgument("%s is truncated.", path));
+    PADDLE_ENFORCE_EQ(
+        memcmp(header->magic, SPARSE_SNAPSHOT_MAGIC, sizeof(header->magic)), 0,
+        platform::errors::InvalidArgument(
+            "%s is not a sparse table snapshot.", path));
+    PADDLE_ENFORCE_EQ(header->version,
+                      static_cast<uint32_t>(SPARSE_SNAPSHOT_VERSION),
+                      platform::errors::InvalidArgument(
+                          "%s is of snapshot version %d, but %d is expected.",
+                          path, header->version, SPARSE_SNAPSHOT_VERSION));
+    PADDLE_ENFORCE_EQ(header->record_size,
+                      SparseSnapshotRecordSize(header->value_length),
+                      platform::errors::InvalidArgument(
+                          "The record size %d of %s does not match its value "
+                          "length %d.",
+                          header->record_size, path, header->value_length));
+    PADDLE_ENFORCE_LT(header->shard_id, header->shard_num,
+                      platform::errors::InvalidArgument(
+                          "%s is of shard %d, but has %d shards.", path,
+                          header->shard_id, header->shard_num));
+    return fp;
+  }
+
+  static void ReadRecord(FILE *fp, const std::string &path,
+                         std::vector<char> *record) {
+    PADDLE_ENFORCE_EQ(
+        fread(record->data(), record->size(), 1, fp), 1,
+        platform::errors::InvalidArgument("%s is truncated.", path));
+  }
+
+  static uint64_t RecordKey(const char *record) {
+    return reinterpret_cast<const SparseSnapshotRecord *>(record)->key;
+  }
+
+  static bool EndWith(const std::string &str, const std::string &suffix) {
+    return str.size() >= suffix.size() &&
+           str.compare(str.size() - suffix.size(), suffix.size(), suffix) ==
+               0;
+  }
+};
+
+}  // namespace distributed
+}  // namespace paddle
@@ -26,21 +26,23 @@ std::vector<std::vector<uint64_t>> LayerWiseSampler::sample(
       input_num * layer_counts_sum_,
       std::vector<uint64_t>(user_feature_num + 2));
 
-  auto max_layer = tree_->Height();
   size_t idx = 0;
   for (size_t i = 0; i < input_num; i++) {
-    auto travel_codes =
-        tree_->GetTravelCodes(target_ids[i], start_sample_layer_);
-    auto travel_path = tree_->GetNodes(travel_codes);
+    auto travel_path = tree_->GetNodeIds(
+        tree_->GetTravelCodes(target_ids[i], start_sample_layer_));
+    // the users climb the tree with the targets, one level per layer
+    std::vector<uint64_t> user_codes;
+    if (with_hierarchy) {
+      user_codes = tree_->GetAncestorCodes(user_inputs[i], -1);
+    }
     for (size_t j = 0; j < travel_path.size(); j++) {
       // user
       if (j > 0 && with_hierarchy) {
-        auto ancestor_codes =
-            tree_->GetAncestorCodes(user_inputs[i], max_layer - j - 1);
-        auto hierarchical_user = tree_->GetNodes(ancestor_codes);
+        user_codes = tree_->GetParentCodes(user_codes);
+        auto hierarchical_user = tree_->GetNodeIds(user_codes);
         for (int idx_offset = 0; idx_offset <= layer_counts_[j]; idx_offset++) {
           for (size_t k = 0; k < user_feature_num; k++) {
-            outputs[idx + idx_offset][k] = hierarchical_user[k].id();
+            outputs[idx + idx_offset][k] = hierarchical_user[k];
           }
         }
       } else {
@@ -52,16 +54,16 @@ std::vector<std::vector<uint64_t>> LayerWiseSampler::sample(
       }
 
       // sampler ++
-      outputs[idx][user_feature_num] = travel_path[j].id();
+      outputs[idx][user_feature_num] = travel_path[j];
       outputs[idx][user_feature_num + 1] = 1.0;
       idx += 1;
       for (int idx_offset = 0; idx_offset < layer_counts_[j]; idx_offset++) {
         int sample_res = 0;
         do {
           sample_res = sampler_vec_[j]->Sample();
-        } while (layer_ids_[j][sample_res].id() == travel_path[j].id());
+        } while (layer_ids_[j][sample_res] == travel_path[j]);
         outputs[idx + idx_offset][user_feature_num] =
-            layer_ids_[j][sample_res].id();
+            layer_ids_[j][sample_res];
         outputs[idx + idx_offset][user_feature_num + 1] = 0;
       }
       idx += layer_counts_[j];
@@ -93,7 +93,7 @@ class LayerWiseSampler : public IndexSampler {
     size_t idx = 0;
     while (layer_index >= start_sample_layer_) {
       auto layer_codes = tree_->GetLayerCodes(layer_index);
-      layer_ids_.push_back(tree_->GetNodes(layer_codes));
+      layer_ids_.push_back(tree_->GetNodeIds(layer_codes));
       auto sampler_temp =
           std::make_shared<paddle::operators::math::UniformSampler>(
               layer_ids_[idx].size() - 1, seed_);
@@ -113,7 +113,8 @@ class LayerWiseSampler : public IndexSampler {
   int seed_{0};
   int start_sample_layer_{1};
   std::vector<std::shared_ptr<paddle::operators::math::Sampler>> sampler_vec_;
-  std::vector<std::vector<IndexNode>> layer_ids_;
+  // ids of the nodes of every sampled layer, from the leaves up
+  std::vector<std::vector<uint64_t>> layer_ids_;
 };
 
 }  // end namespace distributed
@@ -9,6 +9,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License. */
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <thread>
@@ -39,6 +40,7 @@ int TreeIndex::Load(const std::string filename) {
   fake_node_.set_is_leaf(false);
   fake_node_.set_probability(0.0);
   max_code_ = 0;
+  std::vector<std::pair<uint64_t, IndexNode>> nodes;
   size_t ret = fread(&num, sizeof(num), 1, fp.get());
   while (ret == 1 && num > 0) {
     std::string content(num, '\0');
@@ -72,27 +74,53 @@ int TreeIndex::Load(const std::string filename) {
       if (node.is_leaf()) {
         id_codes_map_[node.id()] = code;
       }
-      data_[code] = node;
       if (node.id() > max_id_) {
         max_id_ = node.id();
       }
       if (code > max_code_) {
         max_code_ = code;
       }
+      nodes.emplace_back(code, node);
     }
     ret = fread(&num, sizeof(num), 1, fp.get());
   }
-  total_nodes_num_ = data_.size();
   max_code_ += 1;
+
+  node_valid_.assign(max_code_, false);
+  node_ids_.assign(max_code_, 0);
+  node_probs_.assign(max_code_, 0);
+  node_is_leaf_.assign(max_code_, 0);
+  total_nodes_num_ = 0;
+  for (auto& code_node : nodes) {
+    auto code = code_node.first;
+    total_nodes_num_ += !node_valid_[code];
+    node_valid_[code] = true;
+    node_ids_[code] = code_node.second.id();
+    node_probs_[code] = code_node.second.probability();
+    node_is_leaf_[code] = code_node.second.is_leaf();
+  }
+  level_starts_.assign(1, 0);
+  for (int level = 0; level < meta_.height(); level++) {
+    level_starts_.push_back(level_starts_.back() * meta_.branch() + 1);
+  }
   return 0;
 }
 
+int TreeIndex::GetLevel(uint64_t code) {
+  return std::upper_bound(level_starts_.begin(), level_starts_.end(), code) -
+         level_starts_.begin() - 1;
+}
+
 std::vector<IndexNode> TreeIndex::GetNodes(const std::vector<uint64_t>& codes) {
   std::vector<IndexNode> nodes;
   nodes.reserve(codes.size());
   for (size_t i = 0; i < codes.size(); i++) {
     if (CheckIsValid(codes[i])) {
-      nodes.push_back(data_.at(codes[i]));
+      IndexNode node;
+      node.set_id(node_ids_[codes[i]]);
+      node.set_is_leaf(node_is_leaf_[codes[i]]);
+      node.set_probability(node_probs_[codes[i]]);
+      nodes.push_back(node);
     } else {
       nodes.push_back(fake_node_);
     }
@@ -100,15 +128,23 @@ std::vector<IndexNode> TreeIndex::GetNodes(const std::vector<uint64_t>& codes) {
   return nodes;
 }
 
-std::vector<uint64_t> TreeIndex::GetLayerCodes(int level) {
-  uint64_t level_num = static_cast<uint64_t>(std::pow(meta_.branch(), level));
-  uint64_t level_offset = level_num - 1;
+std::vector<uint64_t> TreeIndex::GetNodeIds(
+    const std::vector<uint64_t>& codes) {
+  std::vector<uint64_t> ids(codes.size());
+  for (size_t i = 0; i < codes.size(); i++) {
+    ids[i] = CheckIsValid(codes[i]) ? node_ids_[codes[i]] : 0;
+  }
+  return ids;
+}
 
+std::vector<uint64_t> TreeIndex::GetLayerCodes(int level) {
   std::vector<uint64_t> res;
-  res.reserve(level_num);
-  for (uint64_t i = 0; i < level_num; i++) {
-    auto code = level_offset + i;
-    if (CheckIsValid(code)) {
+  if (level < 0 || level >= meta_.height()) {
+    return res;
+  }
+  auto code_end = std::min(level_starts_[level + 1], max_code_);
+  for (auto code = level_starts_[level]; code < code_end; code++) {
+    if (node_valid_[code]) {
       res.push_back(code);
     }
   }
@@ -122,10 +158,11 @@ std::vector<uint64_t> TreeIndex::GetAncestorCodes(
 
   int cur_level;
   for (size_t i = 0; i < ids.size(); i++) {
-    if (id_codes_map_.find(ids[i]) == id_codes_map_.end()) {
+    auto iter = id_codes_map_.find(ids[i]);
+    if (iter == id_codes_map_.end()) {
       res.push_back(max_code_);
     } else {
-      auto code = id_codes_map_.at(ids[i]);
+      auto code = iter->second;
       cur_level = meta_.height() - 1;
 
       while (level >= 0 && cur_level > level) {
@@ -138,40 +175,59 @@ std::vector<uint64_t> TreeIndex::GetAncestorCodes(
   return res;
 }
 
+std::vector<uint64_t> TreeIndex::GetParentCodes(
+    const std::vector<uint64_t>& codes) {
+  std::vector<uint64_t> res(codes.size());
+  for (size_t i = 0; i < codes.size(); i++) {
+    auto code = codes[i];
+    res[i] = (code == 0 || code >= max_code_) ? code
+                                              : (code - 1) / meta_.branch();
+  }
+  return res;
+}
+
 std::vector<uint64_t> TreeIndex::GetChildrenCodes(uint64_t ancestor,
                                                   int level) {
-  auto level_code_num = static_cast<uint64_t>(std::pow(meta_.branch(), level));
-  auto code_min = level_code_num - 1;
-  auto code_max = meta_.branch() * level_code_num - 1;
+  return GetChildrenCodes(std::vector<uint64_t>(1, ancestor), level);
+}
 
-  std::vector<uint64_t> parent;
-  parent.push_back(ancestor);
+std::vector<uint64_t> TreeIndex::GetChildrenCodes(
+    const std::vector<uint64_t>& ancestors, int level) {
   std::vector<uint64_t> res;
-  size_t p_idx = 0;
-  while (true) {
-    size_t p_size = parent.size();
-    for (; p_idx < p_size; p_idx++) {
-      for (int i = 0; i < meta_.branch(); i++) {
-        auto code = parent[p_idx] * meta_.branch() + i + 1;
-        if (data_.find(code) != data_.end()) parent.push_back(code);
-      }
+  for (auto ancestor : ancestors) {
+    if (!CheckIsValid(ancestor) || level >= meta_.height()) {
+      continue;
+    }
+    int cur_level = GetLevel(ancestor);
+    if (level < cur_level) {
+      continue;
     }
-    if ((code_min <= parent[p_idx]) && (parent[p_idx] < code_max)) {
-      break;
+    // the descendants at level are a range of codes
+    uint64_t code_begin = ancestor, code_end = ancestor + 1;
+    for (; cur_level < level; cur_level++) {
+      code_begin = code_begin * meta_.branch() + 1;
+      code_end = code_end * meta_.branch() + 1;
+    }
+    for (auto code = code_begin; code < std::min(code_end, max_code_);
+         code++) {
+      if (node_valid_[code]) {
+        res.push_back(code);
+      }
     }
   }
-
-  return std::vector<uint64_t>(parent.begin() + p_idx, parent.end());
+  return res;
 }
 
 std::vector<uint64_t> TreeIndex::GetTravelCodes(uint64_t id, int start_level) {
   std::vector<uint64_t> res;
-  PADDLE_ENFORCE_NE(id_codes_map_.find(id), id_codes_map_.end(),
+  auto iter = id_codes_map_.find(id);
+  PADDLE_ENFORCE_NE(iter, id_codes_map_.end(),
                     paddle::platform::errors::InvalidArgument(
                         "id = %d doesn't exist in Tree.", id));
-  auto code = id_codes_map_.at(id);
+  auto code = iter->second;
   int level = meta_.height() - 1;
 
+  res.reserve(level - start_level + 1);
   while (level >= start_level) {
     res.push_back(code);
     code = (code - 1) / meta_.branch();
@@ -181,13 +237,14 @@ std::vector<uint64_t> TreeIndex::GetTravelCodes(uint64_t id, int start_level) {
 }
 
 std::vector<IndexNode> TreeIndex::GetAllLeafs() {
-  std::vector<IndexNode> res;
-  res.reserve(id_codes_map_.size());
-  for (auto& ite : id_codes_map_) {
-    auto code = ite.second;
-    res.push_back(data_.at(code));
+  std::vector<uint64_t> codes;
+  codes.reserve(id_codes_map_.size());
+  for (uint64_t code = 0; code < max_code_; code++) {
+    if (node_is_leaf_[code]) {
+      codes.push_back(code);
+    }
   }
-  return res;
+  return GetNodes(codes);
 }
 
 }  // end namespace distributed
@@ -29,6 +29,10 @@ class Index {
   ~Index() {}
 };
 
+// The nodes are kept in arrays indexed by their codes, which number the
+// complete branch-ary tree level by level: the children of code c are
+// c * branch + 1 .. c * branch + branch and its parent is (c - 1) / branch.
+// So walking the tree is arithmetic, and only the leaf of an id is hashed.
 class TreeIndex : public Index {
  public:
   TreeIndex() {}
@@ -40,29 +44,41 @@ class TreeIndex : public Index {
   uint64_t EmbSize() { return max_id_ + 1; }
   int Load(const std::string path);
 
-  inline bool CheckIsValid(int code) {
-    if (data_.find(code) != data_.end()) {
-      return true;
-    } else {
-      return false;
-    }
+  inline bool CheckIsValid(uint64_t code) {
+    return code < max_code_ && node_valid_[code];
   }
 
   std::vector<IndexNode> GetNodes(const std::vector<uint64_t>& codes);
+  // ids of the nodes of codes, 0 for the codes without a node
+  std::vector<uint64_t> GetNodeIds(const std::vector<uint64_t>& codes);
   std::vector<uint64_t> GetLayerCodes(int level);
   std::vector<uint64_t> GetAncestorCodes(const std::vector<uint64_t>& ids,
                                          int level);
+  // parents of codes, the root and the invalid codes keep theirs
+  std::vector<uint64_t> GetParentCodes(const std::vector<uint64_t>& codes);
   std::vector<uint64_t> GetChildrenCodes(uint64_t ancestor, int level);
+  // the children at level of every ancestor, one ancestor after another
+  std::vector<uint64_t> GetChildrenCodes(
+      const std::vector<uint64_t>& ancestors, int level);
   std::vector<uint64_t> GetTravelCodes(uint64_t id, int start_level);
   std::vector<IndexNode> GetAllLeafs();
 
-  std::unordered_map<uint64_t, IndexNode> data_;
+  // whether a node has the code, the tree need not be complete
+  std::vector<bool> node_valid_;
+  std::vector<uint64_t> node_ids_;
+  std::vector<float> node_probs_;
+  std::vector<uint8_t> node_is_leaf_;
+  // code of the first node of every level
+  std::vector<uint64_t> level_starts_;
   std::unordered_map<uint64_t, uint64_t> id_codes_map_;
   uint64_t total_nodes_num_;
   TreeMeta meta_;
   uint64_t max_id_;
   uint64_t max_code_;
   IndexNode fake_node_;
+
+ private:
+  int GetLevel(uint64_t code);
 };
 
 using TreePtr = std::shared_ptr<TreeIndex>;
@@ -0,0 +1,108 @@
+/* Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/index_dataset/index_wrapper.h"
+
+namespace paddle {
+namespace distributed {
+
+static void WriteItem(FILE* fp, const std::string& key,
+                      const std::string& value) {
+  KVItem item;
+  item.set_key(key);
+  item.set_value(value);
+  std::string content;
+  item.SerializeToString(&content);
+  int num = content.size();
+  fwrite(&num, sizeof(num), 1, fp);
+  fwrite(content.data(), 1, content.size(), fp);
+}
+
+// A tree of height 3 and branch 3, the leaves 5 and 11 are missing:
+//                        0
+//         1              2              3
+//   4   (5)   6     7    8    9    10  (11)  12
+// the node of code c has id 100 + c.
+static TreePtr LoadBranch3Tree() {
+  std::string path = "./index_wrapper_test_tree.pb";
+  FILE* fp = fopen(path.c_str(), "wb");
+  TreeMeta meta;
+  meta.set_height(3);
+  meta.set_branch(3);
+  std::string meta_str;
+  meta.SerializeToString(&meta_str);
+  WriteItem(fp, ".tree_meta", meta_str);
+  for (uint64_t code = 0; code <= 12; ++code) {
+    if (code == 5 || code == 11) continue;
+    IndexNode node;
+    node.set_id(100 + code);
+    node.set_is_leaf(code >= 4);
+    node.set_probability(1.0);
+    std::string node_str;
+    node.SerializeToString(&node_str);
+    WriteItem(fp, std::to_string(code), node_str);
+  }
+  fclose(fp);
+
+  TreePtr tree = std::make_shared<TreeIndex>();
+  EXPECT_EQ(tree->Load(path), 0);
+  return tree;
+}
+
+TEST(TreeIndex, Branch3Codes) {
+  auto tree = LoadBranch3Tree();
+  EXPECT_EQ(tree->Height(), 3);
+  EXPECT_EQ(tree->Branch(), 3);
+  EXPECT_EQ(tree->TotalNodeNums(), 11UL);
+
+  EXPECT_TRUE(tree->CheckIsValid(0));
+  EXPECT_TRUE(tree->CheckIsValid(12));
+  EXPECT_FALSE(tree->CheckIsValid(5));
+  EXPECT_FALSE(tree->CheckIsValid(13));
+
+  EXPECT_EQ(tree->GetNodeIds({0, 4, 5, 12, 13}),
+            std::vector<uint64_t>({100, 104, 0, 112, 0}));
+
+  EXPECT_EQ(tree->GetLayerCodes(0), std::vector<uint64_t>({0}));
+  EXPECT_EQ(tree->GetLayerCodes(1), std::vector<uint64_t>({1, 2, 3}));
+  EXPECT_EQ(tree->GetLayerCodes(2),
+            std::vector<uint64_t>({4, 6, 7, 8, 9, 10, 12}));
+  EXPECT_TRUE(tree->GetLayerCodes(3).empty());
+
+  // the root and the codes out of the tree keep theirs
+  EXPECT_EQ(tree->GetParentCodes({0, 1, 3, 4, 6, 7, 12, 13}),
+            std::vector<uint64_t>({0, 0, 0, 1, 1, 2, 3, 13}));
+
+  EXPECT_EQ(tree->GetChildrenCodes(0, 1), std::vector<uint64_t>({1, 2, 3}));
+  EXPECT_EQ(tree->GetChildrenCodes(1, 2), std::vector<uint64_t>({4, 6}));
+  EXPECT_EQ(tree->GetChildrenCodes(0, 2),
+            std::vector<uint64_t>({4, 6, 7, 8, 9, 10, 12}));
+  // a level above the ancestor has none
+  EXPECT_TRUE(tree->GetChildrenCodes(4, 1).empty());
+  // the missing ancestor 5 has no children
+  EXPECT_EQ(tree->GetChildrenCodes({3, 5, 1}, 2),
+            std::vector<uint64_t>({10, 12, 4, 6}));
+  EXPECT_EQ(tree->GetChildrenCodes({2, 8}, 2),
+            std::vector<uint64_t>({7, 8, 9, 8}));
+
+  EXPECT_EQ(tree->GetAncestorCodes({112, 107, 105}, 1),
+            std::vector<uint64_t>({3, 2, 13}));
+  EXPECT_EQ(tree->GetTravelCodes(112, 0), std::vector<uint64_t>({12, 3, 0}));
+  EXPECT_EQ(tree->GetAllLeafs().size(), 7UL);
+}
+
+}  // end namespace distributed
+}  // end namespace paddle
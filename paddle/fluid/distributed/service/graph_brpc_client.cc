@@ -455,6 +455,75 @@ std::future<int32_t> GraphBrpcClient::batch_sample_neighboors(
 
   return fut;
 }
+std::future<int32_t> GraphBrpcClient::batch_sample_multi_hop_neighboors(
+    uint32_t table_id, std::vector<uint64_t> node_ids,
+    std::vector<int> fan_outs,
+    std::vector<std::vector<std::vector<std::pair<uint64_t, float>>>> &res,
+    int server_index) {
+  if (server_index == -1) {
+    std::vector<int> owned(server_size, 0);
+    server_index = 0;
+    for (auto node_id : node_ids) {
+      int index = get_server_index_by_id(node_id);
+      if (++owned[index] > owned[server_index]) server_index = index;
+    }
+  }
+  res.clear();
+  DownpourBrpcClosure *closure = new DownpourBrpcClosure(1, [&](void *done) {
+    int ret = 0;
+    auto *closure = (DownpourBrpcClosure *)done;
+    if (closure->check_response(0, PS_GRAPH_SAMPLE_MULTI_HOP_NEIGHBOORS) !=
+        0) {
+      ret = -1;
+    } else {
+      auto &res_io_buffer = closure->cntl(0)->response_attachment();
+      butil::IOBufBytesIterator io_buffer_itr(res_io_buffer);
+      size_t bytes_size = io_buffer_itr.bytes_left();
+      std::unique_ptr<char[]> buffer_wrapper(new char[bytes_size]);
+      char *buffer = buffer_wrapper.get();
+      io_buffer_itr.copy_and_forward((void *)(buffer), bytes_size);
+
+      char *end = buffer + bytes_size;
+      while (buffer < end) {
+        size_t node_num = *(size_t *)buffer;
+        int *actual_sizes = (int *)(buffer + sizeof(size_t));
+        char *node_buffer = buffer + sizeof(size_t) + sizeof(int) * node_num;
+        res.emplace_back(node_num);
+        auto &hop_res = res.back();
+        int offset = 0;
+        for (size_t node_idx = 0; node_idx < node_num; ++node_idx) {
+          int actual_size = actual_sizes[node_idx];
+          int start = 0;
+          while (start < actual_size) {
+            hop_res[node_idx].push_back(
+                {*(uint64_t *)(node_buffer + offset + start),
+                 *(float *)(node_buffer + offset + start +
+                            GraphNode::id_size)});
+            start += GraphNode::id_size + GraphNode::weight_size;
+          }
+          offset += actual_size;
+        }
+        buffer = node_buffer + offset;
+      }
+    }
+    closure->set_promise_value(ret);
+  });
+  auto promise = std::make_shared<std::promise<int32_t>>();
+  closure->add_promise(promise);
+  std::future<int> fut = promise->get_future();
+  closure->request(0)->set_cmd_id(PS_GRAPH_SAMPLE_MULTI_HOP_NEIGHBOORS);
+  closure->request(0)->set_table_id(table_id);
+  closure->request(0)->set_client_id(_client_id);
+  closure->request(0)->add_params((char *)node_ids.data(),
+                                  sizeof(uint64_t) * node_ids.size());
+  closure->request(0)->add_params((char *)fan_outs.data(),
+                                  sizeof(int) * fan_outs.size());
+  GraphPsService_Stub rpc_stub = getServiceStub(get_cmd_channel(server_index));
+  closure->cntl(0)->set_log_id(butil::gettimeofday_ms());
+  rpc_stub.service(closure->cntl(0), closure->request(0), closure->response(0),
+                   closure);
+  return fut;
+}
 std::future<int32_t> GraphBrpcClient::random_sample_nodes(
     uint32_t table_id, int server_index, int sample_size,
     std::vector<uint64_t> &ids) {
@@ -67,6 +67,16 @@ class GraphBrpcClient : public BrpcPsClient {
       std::vector<std::vector<std::pair<uint64_t, float>>>& res,
       int server_index = -1);
 
+  // Samples fan_outs[h] neighbors of every node of hop h on one server,
+  // which only asks the other servers for the nodes they own. The nodes of
+  // hop 0 are node_ids, the ones of hop h + 1 are the neighbors in res[h] in
+  // order. The server owning most of node_ids serves it by default.
+  virtual std::future<int32_t> batch_sample_multi_hop_neighboors(
+      uint32_t table_id, std::vector<uint64_t> node_ids,
+      std::vector<int> fan_outs,
+      std::vector<std::vector<std::vector<std::pair<uint64_t, float>>>>& res,
+      int server_index = -1);
+
   virtual std::future<int32_t> pull_graph_list(uint32_t table_id,
                                                int server_index, int start,
                                                int size, int step,
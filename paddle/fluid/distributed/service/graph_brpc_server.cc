@@ -202,6 +202,8 @@ int32_t GraphBrpcService::initialize() {
       &GraphBrpcService::graph_set_node_feat;
   _service_handler_map[PS_GRAPH_SAMPLE_NODES_FROM_ONE_SERVER] =
       &GraphBrpcService::sample_neighboors_across_multi_servers;
+  _service_handler_map[PS_GRAPH_SAMPLE_MULTI_HOP_NEIGHBOORS] =
+      &GraphBrpcService::sample_multi_hop_neighboors;
 
   // shard初始化,server启动后才可从env获取到server_list的shard信息
   initialize_shard_info();
@@ -386,17 +388,20 @@ int32_t GraphBrpcService::graph_random_sample_neighboors(
   size_t node_num = request.params(0).size() / sizeof(uint64_t);
   uint64_t *node_data = (uint64_t *)(request.params(0).c_str());
   int sample_size = *(uint64_t *)(request.params(1).c_str());
-  std::vector<std::unique_ptr<char[]>> buffers(node_num);
-  std::vector<int> actual_sizes(node_num, 0);
+  std::unique_ptr<char[]> buffer;
+  std::vector<int> actual_sizes;
   ((GraphTable *)table)
-      ->random_sample_neighboors(node_data, sample_size, buffers, actual_sizes);
+      ->random_sample_neighboors(node_data, node_num, sample_size, buffer,
+                                 actual_sizes);
 
+  size_t total_size = 0;
+  for (size_t idx = 0; idx < node_num; ++idx) {
+    total_size += actual_sizes[idx];
+  }
   cntl->response_attachment().append(&node_num, sizeof(size_t));
   cntl->response_attachment().append(actual_sizes.data(),
                                      sizeof(int) * node_num);
-  for (size_t idx = 0; idx < node_num; ++idx) {
-    cntl->response_attachment().append(buffers[idx].get(), actual_sizes[idx]);
-  }
+  cntl->response_attachment().append(buffer.get(), total_size);
   return 0;
 }
 int32_t GraphBrpcService::graph_random_sample_nodes(
@@ -487,7 +492,7 @@ int32_t GraphBrpcService::sample_neighboors_across_multi_servers(
         request2server.size() - 1;
   }
   size_t request_call_num = request2server.size();
-  std::vector<std::unique_ptr<char[]>> local_buffers;
+  std::unique_ptr<char[]> local_buffer;
   std::vector<int> local_actual_sizes;
   std::vector<size_t> seq;
   std::vector<std::vector<uint64_t>> node_id_buckets(request_call_num);
@@ -503,8 +508,6 @@ int32_t GraphBrpcService::sample_neighboors_across_multi_servers(
   size_t remote_call_num = request_call_num;
   if (request2server.size() != 0 && request2server.back() == rank) {
     remote_call_num--;
-    local_buffers.resize(node_id_buckets.back().size());
-    local_actual_sizes.resize(node_id_buckets.back().size());
   }
   cntl->response_attachment().append(&node_num, sizeof(size_t));
   auto local_promise = std::make_shared<std::promise<int32_t>>();
@@ -546,7 +549,7 @@ int32_t GraphBrpcService::sample_neighboors_across_multi_servers(
     cntl->response_attachment().append(actual_size.data(),
                                        actual_size.size() * sizeof(int));
 
-    local_index = 0;
+    size_t local_offset = 0;
     for (size_t i = 0; i < node_num; i++) {
       if (fail_num > 0 && failed[seq[i]]) {
         continue;
@@ -555,8 +558,9 @@ int32_t GraphBrpcService::sample_neighboors_across_multi_servers(
         res[seq[i]]->copy_and_forward(temp, actual_size[i]);
         cntl->response_attachment().append(temp, actual_size[i]);
       } else {
-        char *temp = local_buffers[local_index++].get();
-        cntl->response_attachment().append(temp, actual_size[i]);
+        cntl->response_attachment().append(local_buffer.get() + local_offset,
+                                           actual_size[i]);
+        local_offset += actual_size[i];
       }
     }
     closure->set_promise_value(0);
@@ -590,14 +594,164 @@ int32_t GraphBrpcService::sample_neighboors_across_multi_servers(
   }
   if (server2request[rank] != -1) {
     ((GraphTable *)table)
-        ->random_sample_neighboors(node_id_buckets.back().data(), sample_size,
-                                   local_buffers, local_actual_sizes);
+        ->random_sample_neighboors(node_id_buckets.back().data(),
+                                   node_id_buckets.back().size(), sample_size,
+                                   local_buffer, local_actual_sizes);
   }
   local_promise.get()->set_value(0);
   if (remote_call_num == 0) func(closure);
   fut.get();
   return 0;
 }
+int32_t GraphBrpcService::sample_neighboors_on_servers(
+    Table *table, uint32_t table_id, const std::vector<uint64_t> &nodes,
+    int sample_size, std::vector<int> &actual_sizes, std::string &buffer) {
+  size_t rank = get_rank();
+  std::vector<std::vector<uint64_t>> server_nodes(server_size);
+  std::vector<std::vector<size_t>> server_query_idx(server_size);
+  for (size_t query_idx = 0; query_idx < nodes.size(); ++query_idx) {
+    int server_index =
+        ((GraphTable *)table)->get_server_index_by_id(nodes[query_idx]);
+    server_nodes[server_index].push_back(nodes[query_idx]);
+    server_query_idx[server_index].push_back(query_idx);
+  }
+  std::vector<int> request2server;
+  for (size_t server_index = 0; server_index < server_size; ++server_index) {
+    if (server_index != rank && !server_nodes[server_index].empty()) {
+      request2server.push_back(server_index);
+    }
+  }
+  // the sampled sizes and neighbors of the nodes of every server
+  std::vector<std::vector<int>> server_sizes(server_size);
+  std::vector<std::string> server_buffers(server_size);
+
+  size_t remote_call_num = request2server.size();
+  std::future<int32_t> fut;
+  if (remote_call_num > 0) {
+    DownpourBrpcClosure *closure = new DownpourBrpcClosure(
+        remote_call_num, [&, remote_call_num](void *done) {
+          auto *closure = (DownpourBrpcClosure *)done;
+          for (size_t request_idx = 0; request_idx < remote_call_num;
+               ++request_idx) {
+            int server_index = request2server[request_idx];
+            if (closure->check_response(request_idx,
+                                        PS_GRAPH_SAMPLE_NEIGHBOORS) != 0) {
+              continue;
+            }
+            butil::IOBufBytesIterator io_buffer_itr(
+                closure->cntl(request_idx)->response_attachment());
+            size_t node_num = 0;
+            io_buffer_itr.copy_and_forward(&node_num, sizeof(size_t));
+            if (node_num != server_nodes[server_index].size()) {
+              continue;
+            }
+            std::vector<int> &sizes = server_sizes[server_index];
+            sizes.resize(node_num);
+            io_buffer_itr.copy_and_forward(sizes.data(),
+                                           sizeof(int) * node_num);
+            std::string &bytes = server_buffers[server_index];
+            bytes.resize(io_buffer_itr.bytes_left());
+            io_buffer_itr.copy_and_forward(&bytes[0], bytes.size());
+          }
+          closure->set_promise_value(0);
+        });
+    auto promise = std::make_shared<std::promise<int32_t>>();
+    closure->add_promise(promise);
+    fut = promise->get_future();
+    for (size_t request_idx = 0; request_idx < remote_call_num;
+         ++request_idx) {
+      int server_index = request2server[request_idx];
+      closure->request(request_idx)->set_cmd_id(PS_GRAPH_SAMPLE_NEIGHBOORS);
+      closure->request(request_idx)->set_table_id(table_id);
+      closure->request(request_idx)->set_client_id(rank);
+      closure->request(request_idx)
+          ->add_params((char *)server_nodes[server_index].data(),
+                       sizeof(uint64_t) * server_nodes[server_index].size());
+      closure->request(request_idx)
+          ->add_params((char *)&sample_size, sizeof(int));
+      PsService_Stub rpc_stub(
+          ((GraphBrpcServer *)get_server())->get_cmd_channel(server_index));
+      closure->cntl(request_idx)->set_log_id(butil::gettimeofday_ms());
+      rpc_stub.service(closure->cntl(request_idx),
+                       closure->request(request_idx),
+                       closure->response(request_idx), closure);
+    }
+  }
+  // the local nodes are sampled while the other servers work
+  if (!server_nodes[rank].empty()) {
+    std::unique_ptr<char[]> local_buffer;
+    ((GraphTable *)table)
+        ->random_sample_neighboors(server_nodes[rank].data(),
+                                   server_nodes[rank].size(), sample_size,
+                                   local_buffer, server_sizes[rank]);
+    size_t local_size = 0;
+    for (int size : server_sizes[rank]) local_size += size;
+    server_buffers[rank].assign(local_buffer.get(), local_size);
+  }
+  if (remote_call_num > 0) {
+    fut.get();
+  }
+
+  actual_sizes.assign(nodes.size(), 0);
+  std::vector<const char *> node_buffers(nodes.size(), nullptr);
+  size_t total_size = 0;
+  for (size_t server_index = 0; server_index < server_size; ++server_index) {
+    const std::vector<int> &sizes = server_sizes[server_index];
+    size_t offset = 0;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+      size_t query_idx = server_query_idx[server_index][i];
+      actual_sizes[query_idx] = sizes[i];
+      node_buffers[query_idx] = server_buffers[server_index].data() + offset;
+      offset += sizes[i];
+    }
+    total_size += offset;
+  }
+  buffer.clear();
+  buffer.reserve(total_size);
+  for (size_t query_idx = 0; query_idx < nodes.size(); ++query_idx) {
+    if (actual_sizes[query_idx] > 0) {
+      buffer.append(node_buffers[query_idx], actual_sizes[query_idx]);
+    }
+  }
+  return 0;
+}
+
+int32_t GraphBrpcService::sample_multi_hop_neighboors(
+    Table *table, const PsRequestMessage &request, PsResponseMessage &response,
+    brpc::Controller *cntl) {
+  CHECK_TABLE_EXIST(table, request, response)
+  if (request.params_size() < 2) {
+    set_response_code(
+        response, -1,
+        "graph_sample_multi_hop request requires at least 2 arguments");
+    return 0;
+  }
+  size_t node_num = request.params(0).size() / sizeof(uint64_t);
+  uint64_t *node_data = (uint64_t *)(request.params(0).c_str());
+  size_t hop_num = request.params(1).size() / sizeof(int);
+  int *fan_outs = (int *)(request.params(1).c_str());
+
+  std::vector<uint64_t> nodes(node_data, node_data + node_num);
+  std::vector<int> actual_sizes;
+  std::string buffer;
+  int pair_size = Node::id_size + Node::weight_size;
+  for (size_t hop = 0; hop < hop_num; ++hop) {
+    sample_neighboors_on_servers(table, request.table_id(), nodes,
+                                 fan_outs[hop], actual_sizes, buffer);
+    node_num = nodes.size();
+    cntl->response_attachment().append(&node_num, sizeof(size_t));
+    cntl->response_attachment().append(actual_sizes.data(),
+                                       sizeof(int) * node_num);
+    cntl->response_attachment().append(buffer.data(), buffer.size());
+    // the sampled neighbors are the nodes of the next hop
+    nodes.resize(buffer.size() / pair_size);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      memcpy(&nodes[i], buffer.data() + i * pair_size, Node::id_size);
+    }
+  }
+  return 0;
+}
+
 int32_t GraphBrpcService::graph_set_node_feat(Table *table,
                                               const PsRequestMessage &request,
                                               PsResponseMessage &response,
@@ -120,6 +120,25 @@ class GraphBrpcService : public PsBaseService {
       Table *table, const PsRequestMessage &request,
       PsResponseMessage &response, brpc::Controller *cntl);
 
+  // Samples params(1)[h] neighbors of every node of hop h, the nodes of
+  // params(0) at hop 0 and the neighbors sampled at hop h at hop h + 1. Only
+  // the nodes of the other servers are sent to them, and the response holds
+  // every hop in the layout of PS_GRAPH_SAMPLE_NEIGHBOORS one after another.
+  int32_t sample_multi_hop_neighboors(Table *table,
+                                      const PsRequestMessage &request,
+                                      PsResponseMessage &response,
+                                      brpc::Controller *cntl);
+
+  // Samples the neighbors of nodes on this server and, one request each, on
+  // the servers owning the rest of them. The neighbors of node i take
+  // actual_sizes[i] bytes of buffer after the ones of node i - 1, the nodes
+  // of a failed server get none.
+  int32_t sample_neighboors_on_servers(Table *table, uint32_t table_id,
+                                       const std::vector<uint64_t> &nodes,
+                                       int sample_size,
+                                       std::vector<int> &actual_sizes,
+                                       std::string &buffer);
+
  private:
   bool _is_initialize_shard_info;
   std::mutex _initialize_shard_mutex;
@@ -303,6 +303,19 @@ GraphPyClient::batch_sample_neighboors(std::string name,
   return v;
 }
 
+std::vector<std::vector<std::vector<std::pair<uint64_t, float>>>>
+GraphPyClient::batch_sample_multi_hop_neighboors(
+    std::string name, std::vector<uint64_t> node_ids,
+    std::vector<int> fan_outs) {
+  std::vector<std::vector<std::vector<std::pair<uint64_t, float>>>> v;
+  if (this->table_id_map.count(name)) {
+    uint32_t table_id = this->table_id_map[name];
+    auto status = worker_ptr->batch_sample_multi_hop_neighboors(
+        table_id, node_ids, fan_outs, v);
+    status.wait();
+  }
+  return v;
+}
 std::vector<uint64_t> GraphPyClient::random_sample_nodes(std::string name,
                                                          int server_index,
                                                          int sample_size) {
@@ -150,6 +150,10 @@ class GraphPyClient : public GraphPyService {
   void start_client();
   std::vector<std::vector<std::pair<uint64_t, float>>> batch_sample_neighboors(
       std::string name, std::vector<uint64_t> node_ids, int sample_size);
+  std::vector<std::vector<std::vector<std::pair<uint64_t, float>>>>
+  batch_sample_multi_hop_neighboors(std::string name,
+                                    std::vector<uint64_t> node_ids,
+                                    std::vector<int> fan_outs);
   std::vector<uint64_t> random_sample_nodes(std::string name, int server_index,
                                             int sample_size);
   std::vector<std::vector<std::string>> get_node_feat(
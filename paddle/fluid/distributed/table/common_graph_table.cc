@@ -94,6 +94,7 @@ void GraphShard::clear() {
   }
   bucket.clear();
   node_location.clear();
+  csr.clear();
 }
 
 GraphShard::~GraphShard() { clear(); }
@@ -134,6 +135,44 @@ Node *GraphShard::find_node(uint64_t id) {
   return iter == node_location.end() ? nullptr : bucket[iter->second];
 }
 
+void GraphShard::build_csr(bool is_weighted) {
+  GraphCSR packed(is_weighted || csr.weighted());
+  std::vector<uint64_t> ids;
+  std::vector<float> weights;
+  for (auto node : bucket) {
+    int row = node->get_csr_row();
+    size_t added = node->get_neighbor_size();
+    if (row < 0 && added == 0) {
+      continue;
+    }
+    ids.clear();
+    weights.clear();
+    if (row >= 0) {
+      for (size_t i = 0; i < csr.degree(row); i++) {
+        ids.push_back(csr.get_neighbor_id(row, i));
+        weights.push_back(csr.get_neighbor_weight(row, i));
+      }
+    }
+    for (size_t i = 0; i < added; i++) {
+      ids.push_back(node->get_neighbor_id(i));
+      weights.push_back(node->get_neighbor_weight(i));
+    }
+    node->set_csr_row(packed.add_row(ids.data(), weights.data(), ids.size()));
+  }
+  csr = std::move(packed);
+}
+
+size_t GraphShard::get_neighbor_size(Node *node) {
+  int row = node->get_csr_row();
+  return row < 0 ? 0 : csr.degree(row);
+}
+
+int GraphShard::sample_neighboors(Node *node, int k, std::mt19937_64 &rng,
+                                  char *buffer) {
+  int row = node->get_csr_row();
+  return row < 0 ? 0 : csr.sample_k(row, k, rng, buffer);
+}
+
 int32_t GraphTable::load(const std::string &path, const std::string &param) {
   bool load_edge = (param[0] == 'e');
   bool load_node = (param[0] == 'n');
@@ -241,7 +280,6 @@ int32_t GraphTable::load_nodes(const std::string &path, std::string node_type) {
 int32_t GraphTable::load_edges(const std::string &path, bool reverse_edge) {
   auto paths = paddle::string::split_string<std::string>(path, ";");
   int64_t count = 0;
-  std::string sample_type = "random";
   bool is_weighted = false;
   int valid_count = 0;
 
@@ -260,7 +298,6 @@ int32_t GraphTable::load_edges(const std::string &path, bool reverse_edge) {
       float weight = 1;
       if (values.size() == 3) {
         weight = std::stof(values[2]);
-        sample_type = "weighted";
         is_weighted = true;
       }
 
@@ -284,14 +321,17 @@ int32_t GraphTable::load_edges(const std::string &path, bool reverse_edge) {
   VLOG(0) << valid_count << "/" << count << " edges are loaded successfully in "
           << path;
 
-  // Build Sampler j
-
-  for (auto &shard : shards) {
-    auto bucket = shard.get_bucket();
-    for (size_t i = 0; i < bucket.size(); i++) {
-      bucket[i]->build_sampler(sample_type);
-    }
+  // Pack the neighbors for sampling
+  std::vector<std::future<int>> tasks;
+  for (size_t i = 0; i < shards.size(); i++) {
+    tasks.push_back(
+        _shards_task_pool[get_thread_pool_index_by_shard_index(i)]->enqueue(
+            [this, i, is_weighted]() -> int {
+              this->shards[i].build_csr(is_weighted);
+              return 0;
+            }));
   }
+  for (size_t i = 0; i < tasks.size(); i++) tasks[i].get();
   return 0;
 }
 
@@ -397,43 +437,71 @@ int32_t GraphTable::random_sample_neighboors(
     std::vector<std::unique_ptr<char[]>> &buffers,
     std::vector<int> &actual_sizes) {
   size_t node_num = buffers.size();
-  std::vector<std::future<int>> tasks;
+  std::unique_ptr<char[]> buffer;
+  random_sample_neighboors(node_ids, node_num, sample_size, buffer,
+                           actual_sizes);
+  size_t offset = 0;
   for (size_t idx = 0; idx < node_num; ++idx) {
-    uint64_t &node_id = node_ids[idx];
-    std::unique_ptr<char[]> &buffer = buffers[idx];
-    int &actual_size = actual_sizes[idx];
-
-    int thread_pool_index = get_thread_pool_index(node_id);
-    auto rng = _shards_task_rng_pool[thread_pool_index];
-
-    tasks.push_back(_shards_task_pool[thread_pool_index]->enqueue([&]() -> int {
-      Node *node = find_node(node_id);
+    buffers[idx].reset(new char[actual_sizes[idx]]);
+    memcpy(buffers[idx].get(), buffer.get() + offset, actual_sizes[idx]);
+    offset += actual_sizes[idx];
+  }
+  return 0;
+}
 
-      if (node == nullptr) {
-        actual_size = 0;
-        return 0;
-      }
-      std::vector<int> res = node->sample_k(sample_size, rng);
-      actual_size = res.size() * (Node::id_size + Node::weight_size);
-      int offset = 0;
-      uint64_t id;
-      float weight;
-      char *buffer_addr = new char[actual_size];
-      buffer.reset(buffer_addr);
-      for (int &x : res) {
-        id = node->get_neighbor_id(x);
-        weight = node->get_neighbor_weight(x);
-        memcpy(buffer_addr + offset, &id, Node::id_size);
-        offset += Node::id_size;
-        memcpy(buffer_addr + offset, &weight, Node::weight_size);
-        offset += Node::weight_size;
+int32_t GraphTable::random_sample_neighboors(uint64_t *node_ids, int node_num,
+                                             int sample_size,
+                                             std::unique_ptr<char[]> &buffer,
+                                             std::vector<int> &actual_sizes) {
+  // one task of every thread pool samples all its nodes, first to size the
+  // buffer and then to fill it
+  std::vector<std::vector<int>> batch(task_pool_size_);
+  for (int idx = 0; idx < node_num; ++idx) {
+    batch[get_thread_pool_index(node_ids[idx])].push_back(idx);
+  }
+  size_t max_sample_num = std::max(sample_size, 0);
+  int pair_size = Node::id_size + Node::weight_size;
+  std::vector<Node *> nodes(node_num, nullptr);
+  actual_sizes.assign(node_num, 0);
+  std::vector<std::future<int>> tasks;
+  for (size_t i = 0; i < batch.size(); ++i) {
+    if (batch[i].empty()) continue;
+    tasks.push_back(_shards_task_pool[i]->enqueue([&, i]() -> int {
+      for (int idx : batch[i]) {
+        uint64_t node_id = node_ids[idx];
+        Node *node = find_node(node_id);
+        if (node == nullptr) continue;
+        size_t index = node_id % shard_num - shard_start;
+        size_t sample_num =
+            std::min(shards[index].get_neighbor_size(node), max_sample_num);
+        nodes[idx] = node;
+        actual_sizes[idx] = sample_num * pair_size;
       }
       return 0;
     }));
   }
-  for (size_t idx = 0; idx < node_num; ++idx) {
-    tasks[idx].get();
+  for (size_t i = 0; i < tasks.size(); i++) tasks[i].get();
+
+  std::vector<size_t> offsets(node_num + 1, 0);
+  for (int idx = 0; idx < node_num; ++idx) {
+    offsets[idx + 1] = offsets[idx] + actual_sizes[idx];
+  }
+  buffer.reset(new char[offsets[node_num]]);
+  tasks.clear();
+  for (size_t i = 0; i < batch.size(); ++i) {
+    if (batch[i].empty()) continue;
+    tasks.push_back(_shards_task_pool[i]->enqueue([&, i]() -> int {
+      auto &rng = *_shards_task_rng_pool[i];
+      for (int idx : batch[i]) {
+        if (actual_sizes[idx] == 0) continue;
+        size_t index = node_ids[idx] % shard_num - shard_start;
+        shards[index].sample_neighboors(nodes[idx], sample_size, rng,
+                                        buffer.get() + offsets[idx]);
+      }
+      return 0;
+    }));
   }
+  for (size_t i = 0; i < tasks.size(); i++) tasks[i].get();
   return 0;
 }
 
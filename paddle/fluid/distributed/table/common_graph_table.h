@@ -38,6 +38,7 @@
 #include <vector>
 #include "paddle/fluid/distributed/table/accessor.h"
 #include "paddle/fluid/distributed/table/common_table.h"
+#include "paddle/fluid/distributed/table/graph/graph_csr.h"
 #include "paddle/fluid/distributed/table/graph/graph_node.h"
 #include "paddle/fluid/framework/rw_lock.h"
 #include "paddle/fluid/string/string_helper.h"
@@ -69,10 +70,22 @@ class GraphShard {
     return node_location;
   }
 
+  // Packs the neighbors of the graph nodes into csr, the ones added since the
+  // last build after the ones packed before, and drops the rows of the
+  // deleted nodes.
+  void build_csr(bool is_weighted);
+  // number of the packed neighbors of node
+  size_t get_neighbor_size(Node *node);
+  // Samples min(k, neighbor size) packed neighbors of node into buffer as
+  // (id, weight) pairs and returns the number of them.
+  int sample_neighboors(Node *node, int k, std::mt19937_64 &rng,
+                        char *buffer);
+
  private:
   std::unordered_map<uint64_t, int> node_location;
   int shard_num;
   std::vector<Node *> bucket;
+  GraphCSR csr;
 };
 
 enum LRUResponse { ok = 0, blocked = 1, err = 2 };
@@ -376,6 +389,13 @@ class GraphTable : public SparseTable {
       std::vector<std::unique_ptr<char[]>> &buffers,
       std::vector<int> &actual_sizes);
 
+  // Samples the neighbors of node_num nodes into one buffer, the ones of
+  // node i take actual_sizes[i] bytes right after the ones of node i - 1.
+  virtual int32_t random_sample_neighboors(uint64_t *node_ids, int node_num,
+                                           int sample_size,
+                                           std::unique_ptr<char[]> &buffer,
+                                           std::vector<int> &actual_sizes);
+
   int32_t random_sample_nodes(int sample_size, std::unique_ptr<char[]> &buffers,
                               int &actual_sizes);
 
@@ -13,7 +13,13 @@
 // limitations under the License.
 
 #include "paddle/fluid/distributed/table/common_sparse_table.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <functional>
 #include <sstream>
+#include <unordered_set>
 
 #include "glog/logging.h"
 #include "paddle/fluid/platform/enforce.h"
@@ -81,46 +87,80 @@ void CommonSparseTable::SaveMetaToText(std::ostream* os,
   os->write(stream.str().c_str(), sizeof(char) * stream.str().size());
 }
 
-int64_t CommonSparseTable::SaveValueToText(std::ostream* os,
-                                           std::shared_ptr<ValueBlock> block,
-                                           std::shared_ptr<::ThreadPool> pool,
-                                           const int mode, int shard_id) {
+// Calls visit(id, value) for every row to save in mode and returns how many
+// rows visit accepted. A delta visits only the dirty keys of the block, and
+// value is nullptr for a key erased since the last base/delta.
+template <typename Visitor>
+static int64_t VisitRowsToSave(ValueBlock* block, const int mode,
+                               Visitor visit) {
   int64_t save_num = 0;
-  for (auto& table : block->values_) {
-    for (auto& value : table) {
-      if (mode == SaveMode::delta && !value.second->need_save_) {
+  if (mode == SaveMode::delta) {
+    std::unordered_set<uint64_t> erased;
+    for (auto& id : block->dirty_keys_) {
+      auto iter = block->Find(id);
+      if (iter == block->end()) {
+        if (erased.insert(id).second && visit(id, nullptr)) {
+          ++save_num;
+        }
         continue;
       }
-
-      ++save_num;
-
-      std::stringstream ss;
-      auto* vs = value.second->data_.data();
-
-      auto id = value.first;
-
-      ss << id << "\t" << value.second->count_ << "\t"
-         << value.second->unseen_days_ << "\t" << value.second->is_entry_
-         << "\t";
-
-      for (int i = 0; i < block->value_length_ - 1; i++) {
-        ss << std::to_string(vs[i]) << ",";
+      if (!iter->second->need_save_) {
+        continue;
       }
+      if (visit(id, iter->second)) {
+        ++save_num;
+      }
+      iter->second->need_save_ = false;
+    }
+    block->dirty_keys_.clear();
+    return save_num;
+  }
 
-      ss << std::to_string(vs[block->value_length_ - 1]);
-      ss << "\n";
-
-      os->write(ss.str().c_str(), sizeof(char) * ss.str().size());
-
-      if (mode == SaveMode::base || mode == SaveMode::delta) {
+  for (auto& table : block->values_) {
+    for (auto& value : table) {
+      if (visit(value.first, value.second)) {
+        ++save_num;
+      }
+      if (mode == SaveMode::base) {
         value.second->need_save_ = false;
       }
     }
   }
-
+  if (mode == SaveMode::base) {
+    block->dirty_keys_.clear();
+  }
   return save_num;
 }
 
+int64_t CommonSparseTable::SaveValueToText(std::ostream* os,
+                                           std::shared_ptr<ValueBlock> block,
+                                           std::shared_ptr<::ThreadPool> pool,
+                                           const int mode, int shard_id) {
+  return VisitRowsToSave(
+      block.get(), mode, [os, &block](uint64_t id, VALUE* value) -> bool {
+        // the text format has no way to mark an erased row
+        if (value == nullptr) {
+          return false;
+        }
+
+        std::stringstream ss;
+        auto* vs = value->data_;
+
+        ss << id << "\t" << value->count_ << "\t" << value->unseen_days_
+           << "\t" << value->is_entry_ << "\t";
+
+        for (int i = 0; i < block->value_length_ - 1; i++) {
+          ss << std::to_string(vs[i]) << ",";
+        }
+
+        ss << std::to_string(vs[block->value_length_ - 1]);
+        ss << "\n";
+
+        os->write(ss.str().c_str(), sizeof(char) * ss.str().size());
+        return true;
+      });
+}
+
 int64_t CommonSparseTable::LoadFromText(
     const std::string& valuepath, const std::string& metapath,
     const int pserver_id, const int pserver_num, const int local_shard_num,
@@ -167,6 +207,159 @@ int64_t CommonSparseTable::LoadFromText(
   return 0;
 }
 
+int64_t CommonSparseTable::SaveValueToBinary(const std::string& path,
+                                             std::shared_ptr<ValueBlock> block,
+                                             const int mode, int shard_id) {
+  const size_t buffer_size = 4 * 1024 * 1024;
+  std::unique_ptr<char[]> buffer(new char[buffer_size]);
+  // closed when an enforce throws, before the buffer it writes through
+  std::unique_ptr<FILE, int (*)(FILE*)> file(fopen(path.c_str(), "wb"),
+                                             &fclose);
+  PADDLE_ENFORCE_NOT_NULL(
+      file.get(), paddle::platform::errors::Unavailable(
+                      "Cannot open %s to save sparse table snapshot.", path));
+  FILE* fp = file.get();
+  setvbuf(fp, buffer.get(), _IOFBF, buffer_size);
+
+  SparseSnapshotHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, SPARSE_SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.version = SPARSE_SNAPSHOT_VERSION;
+  header.value_length = block->value_length_;
+  header.record_size = SparseSnapshotRecordSize(block->value_length_);
+  header.shard_id = shard_id;
+  header.shard_num = task_pool_size_;
+  header.kind = mode == SaveMode::delta ? kSnapshotDelta : kSnapshotBase;
+  // the count is filled in when all records are written
+  fwrite(&header, sizeof(header), 1, fp);
+
+  std::vector<char> record(header.record_size, 0);
+  auto* meta = reinterpret_cast<SparseSnapshotRecord*>(record.data());
+  auto* payload = reinterpret_cast<float*>(record.data() +
+                                           sizeof(SparseSnapshotRecord));
+
+  int64_t save_num = VisitRowsToSave(
+      block.get(), mode,
+      [fp, &record, meta, payload, &block](uint64_t id, VALUE* value) -> bool {
+        if (value == nullptr) {
+          memset(record.data(), 0, record.size());
+          meta->key = id;
+          meta->flags = SPARSE_SNAPSHOT_DELETED;
+        } else {
+          meta->key = id;
+          meta->count = value->count_;
+          meta->unseen_days = value->unseen_days_;
+          meta->is_entry = value->is_entry_;
+          meta->flags = 0;
+          memcpy(payload, value->data_, sizeof(float) * block->value_length_);
+        }
+        fwrite(record.data(), record.size(), 1, fp);
+        return true;
+      });
+
+  header.count = save_num;
+  fseek(fp, 0, SEEK_SET);
+  fwrite(&header, sizeof(header), 1, fp);
+  PADDLE_ENFORCE_EQ(ferror(fp), 0,
+                    paddle::platform::errors::Unavailable(
+                        "Failed to write sparse table snapshot %s.", path));
+  // the buffered records are only flushed here, a full disk shows up now
+  PADDLE_ENFORCE_EQ(fclose(file.release()), 0,
+                    paddle::platform::errors::Unavailable(
+                        "Failed to write sparse table snapshot %s.", path));
+  return save_num;
+}
+
+int64_t CommonSparseTable::LoadFromBinary(const std::string& path,
+                                          const int pserver_id,
+                                          const int pserver_num,
+                                          std::shared_ptr<ValueBlock> block,
+                                          int shard_id) {
+  int fd = open(path.c_str(), O_RDONLY);
+  PADDLE_ENFORCE_GE(fd, 0, paddle::platform::errors::NotFound(
+                               "Cannot open sparse table snapshot %s.", path));
+  struct stat st;
+  int ret = fstat(fd, &st);
+  size_t file_size = static_cast<size_t>(st.st_size);
+  void* addr = ret != 0 || file_size < sizeof(SparseSnapshotHeader)
+                   ? nullptr
+                   : mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  PADDLE_ENFORCE_EQ(ret, 0,
+                    paddle::platform::errors::Unavailable(
+                        "Cannot get the size of sparse table snapshot %s.",
+                        path));
+  PADDLE_ENFORCE_GE(file_size, sizeof(SparseSnapshotHeader),
+                    paddle::platform::errors::InvalidArgument(
+                        "Sparse table snapshot %s is truncated.", path));
+  PADDLE_ENFORCE_NE(addr, MAP_FAILED,
+                    paddle::platform::errors::Unavailable(
+                        "Failed to mmap sparse table snapshot %s.", path));
+  // unmapped when an enforce below throws
+  std::unique_ptr<void, std::function<void(void*)>> mapping(
+      addr, [file_size](void* ptr) { munmap(ptr, file_size); });
+  madvise(addr, file_size, MADV_SEQUENTIAL);
+
+  const char* begin = reinterpret_cast<const char*>(addr);
+  const auto* header = reinterpret_cast<const SparseSnapshotHeader*>(begin);
+  PADDLE_ENFORCE_EQ(
+      memcmp(header->magic, SPARSE_SNAPSHOT_MAGIC, sizeof(header->magic)), 0,
+      paddle::platform::errors::InvalidArgument(
+          "%s is not a sparse table snapshot.", path));
+  PADDLE_ENFORCE_EQ(
+      static_cast<int>(header->version), SPARSE_SNAPSHOT_VERSION,
+      paddle::platform::errors::InvalidArgument(
+          "Unsupported sparse table snapshot version %d in %s.",
+          header->version, path));
+  PADDLE_ENFORCE_EQ(static_cast<size_t>(header->value_length),
+                    block->value_length_,
+                    paddle::platform::errors::InvalidArgument(
+                        "The value length of %s is %d, but the table expects "
+                        "%d.",
+                        path, header->value_length, block->value_length_));
+  PADDLE_ENFORCE_EQ(static_cast<int>(header->shard_num), task_pool_size_,
+                    paddle::platform::errors::InvalidArgument(
+                        "%s is saved with %d shards, but the table has %d.",
+                        path, header->shard_num, task_pool_size_));
+  PADDLE_ENFORCE_EQ(static_cast<size_t>(header->record_size),
+                    SparseSnapshotRecordSize(block->value_length_),
+                    paddle::platform::errors::InvalidArgument(
+                        "The record size of %s is %d, but the table expects "
+                        "%d.",
+                        path, header->record_size,
+                        SparseSnapshotRecordSize(block->value_length_)));
+  PADDLE_ENFORCE_LE(
+      header->count,
+      (file_size - sizeof(SparseSnapshotHeader)) / header->record_size,
+      paddle::platform::errors::InvalidArgument(
+          "Sparse table snapshot %s is truncated.", path));
+
+  const char* record = begin + sizeof(SparseSnapshotHeader);
+  int64_t load_num = 0;
+  for (uint64_t i = 0; i < header->count; ++i, record += header->record_size) {
+    const auto* meta = reinterpret_cast<const SparseSnapshotRecord*>(record);
+    if (meta->key % pserver_num != pserver_id) {
+      VLOG(3) << "will not load " << meta->key << " from " << path
+              << ", please check id distribution";
+      continue;
+    }
+
+    if (meta->flags & SPARSE_SNAPSHOT_DELETED) {
+      block->erase(meta->key, false);
+      continue;
+    }
+
+    VALUE* value = block->InitGet(meta->key);
+    memcpy(value->data_, record + sizeof(SparseSnapshotRecord),
+           sizeof(float) * block->value_length_);
+    value->count_ = meta->count;
+    value->unseen_days_ = meta->unseen_days;
+    value->is_entry_ = static_cast<bool>(meta->is_entry);
+    ++load_num;
+  }
+  return load_num;
+}
+
 int32_t CommonSparseTable::initialize() {
   _shards_task_pool.resize(task_pool_size_);
   for (int i = 0; i < _shards_task_pool.size(); ++i) {
@@ -215,7 +408,7 @@ int32_t CommonSparseTable::initialize_value() {
   for (int x = 0; x < task_pool_size_; ++x) {
     auto shard = std::make_shared<ValueBlock>(
         value_names_, value_dims_, value_offsets_, value_idx_,
-        initializer_attrs_, common.entry());
+        initializer_attrs_, common.entry(), common.storage());
 
     shard_values_.emplace_back(shard);
   }
@@ -291,8 +484,31 @@ int32_t CommonSparseTable::load(const std::string& dirname,
   std::string value_ = string::Sprintf("%s/%s.txt", var_store, shard_var_pre);
   std::string meta_ = string::Sprintf("%s/%s.meta", var_store, shard_var_pre);
 
-  LoadFromText(value_, meta_, _shard_idx, _shard_num, task_pool_size_,
-               &shard_values_);
+  // prefer the binary snapshot, text is kept for exported tables
+  std::string binary_ =
+      string::Sprintf("%s/%s.shard0.bin", var_store, shard_var_pre);
+  if (access(binary_.c_str(), F_OK) == 0) {
+    value_ = string::Sprintf("%s/%s.shard*.bin", var_store, shard_var_pre);
+    std::vector<std::future<int64_t>> tasks(task_pool_size_);
+    for (int shard_id = 0; shard_id < task_pool_size_; ++shard_id) {
+      std::string path = string::Sprintf("%s/%s.shard%d.bin", var_store,
+                                         shard_var_pre, shard_id);
+      tasks[shard_id] = _shards_task_pool[shard_id]->enqueue(
+          [this, path, shard_id]() -> int64_t {
+            return LoadFromBinary(path, _shard_idx, _shard_num,
+                                  shard_values_[shard_id], shard_id);
+          });
+    }
+    int64_t total_ins = 0;
+    for (size_t shard_id = 0; shard_id < tasks.size(); ++shard_id) {
+      // get() rethrows the failure of the shard
+      total_ins += tasks[shard_id].get();
+    }
+    VLOG(3) << "load " << total_ins << " rows from " << value_;
+  } else {
+    LoadFromText(value_, meta_, _shard_idx, _shard_num, task_pool_size_,
+                 &shard_values_);
+  }
   rwlock_->UNLock();
   auto end = GetCurrentUS();
 
@@ -322,19 +538,42 @@ int32_t CommonSparseTable::save(const std::string& dirname,
   std::string shard_var_pre =
       string::Sprintf("%s.block%d", varname, _shard_idx);
 
-  std::string value_ = string::Sprintf("%s/%s.txt", var_store, shard_var_pre);
-
-  std::unique_ptr<std::ofstream> vs(new std::ofstream(value_));
-
+  std::string value_;
   int64_t total_ins = 0;
-  for (int shard_id = 0; shard_id < task_pool_size_; ++shard_id) {
-    // save values
-    auto shard_save_num =
-        SaveValueToText(vs.get(), shard_values_[shard_id],
-                        _shards_task_pool[shard_id], mode, shard_id);
-    total_ins += shard_save_num;
+  if (_config.save_format() == "binary") {
+    value_ = string::Sprintf("%s/%s.shard*.bin", var_store, shard_var_pre);
+    std::vector<std::future<int64_t>> tasks(task_pool_size_);
+    for (int shard_id = 0; shard_id < task_pool_size_; ++shard_id) {
+      std::string path = string::Sprintf("%s/%s.shard%d.bin", var_store,
+                                         shard_var_pre, shard_id);
+      tasks[shard_id] = _shards_task_pool[shard_id]->enqueue(
+          [this, path, mode, shard_id]() -> int64_t {
+            return SaveValueToBinary(path, shard_values_[shard_id], mode,
+                                     shard_id);
+          });
+    }
+    for (size_t shard_id = 0; shard_id < tasks.size(); ++shard_id) {
+      total_ins += tasks[shard_id].get();
+    }
+  } else {
+    value_ = string::Sprintf("%s/%s.txt", var_store, shard_var_pre);
+    std::unique_ptr<std::ofstream> vs(new std::ofstream(value_));
+    // a stale binary snapshot would shadow this text one on load
+    for (int shard_id = 0; shard_id < task_pool_size_; ++shard_id) {
+      unlink(string::Sprintf("%s/%s.shard%d.bin", var_store, shard_var_pre,
+                             shard_id)
+                 .c_str());
+    }
+
+    for (int shard_id = 0; shard_id < task_pool_size_; ++shard_id) {
+      // save values
+      auto shard_save_num =
+          SaveValueToText(vs.get(), shard_values_[shard_id],
+                          _shards_task_pool[shard_id], mode, shard_id);
+      total_ins += shard_save_num;
+    }
+    vs->close();
   }
-  vs->close();
 
   std::string meta_ = string::Sprintf("%s/%s.meta", var_store, shard_var_pre);
   std::unique_ptr<std::ofstream> ms(new std::ofstream(meta_));
@@ -395,21 +634,12 @@ int32_t CommonSparseTable::pull_sparse(float* pull_values,
           std::vector<int> offsets;
           pull_value.Fission(shard_id, shard_num, &offsets);
 
-          if (pull_value.is_training_) {
-            for (auto& offset : offsets) {
-              auto feasign = pull_value.feasigns_[offset];
-              auto frequencie = pull_value.frequencies_[offset];
-              auto* value = block->Init(feasign, true, frequencie);
-              std::copy_n(value + param_offset_, param_dim_,
-                          pull_values + param_dim_ * offset);
-            }
-          } else {
-            for (auto& offset : offsets) {
-              auto feasign = pull_value.feasigns_[offset];
-              auto* value = block->Init(feasign, false);
-              std::copy_n(value + param_offset_, param_dim_,
-                          pull_values + param_dim_ * offset);
-            }
+          std::vector<float*> values;
+          block->InitBatch(pull_value.feasigns_, pull_value.frequencies_,
+                           offsets, pull_value.is_training_, &values);
+          for (size_t i = 0; i < offsets.size(); ++i) {
+            std::copy_n(values[i] + param_offset_, param_dim_,
+                        pull_values + param_dim_ * offsets[i]);
           }
 
           return 0;
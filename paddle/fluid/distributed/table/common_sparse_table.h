@@ -29,6 +29,7 @@
 #include "paddle/fluid/distributed/table/depends/initializers.h"
 #include "paddle/fluid/distributed/table/depends/large_scale_kv.h"
 #include "paddle/fluid/distributed/table/depends/sparse.h"
+#include "paddle/fluid/distributed/table/depends/sparse_snapshot.h"
 #include "paddle/fluid/framework/rw_lock.h"
 #include "paddle/fluid/string/string_helper.h"
 
@@ -134,9 +135,19 @@ class CommonSparseTable : public SparseTable {
   void SaveMetaToText(std::ostream* os, const CommonAccessorParameter& common,
                       const size_t shard_idx, const int64_t total);
 
-  int64_t SaveValueToText(std::ostream* os, std::shared_ptr<ValueBlock> block,
-                          std::shared_ptr<::ThreadPool> pool, const int mode,
-                          int shard_id);
+  virtual int64_t SaveValueToText(std::ostream* os,
+                                  std::shared_ptr<ValueBlock> block,
+                                  std::shared_ptr<::ThreadPool> pool,
+                                  const int mode, int shard_id);
+
+  virtual int64_t SaveValueToBinary(const std::string& path,
+                                    std::shared_ptr<ValueBlock> block,
+                                    const int mode, int shard_id);
+
+  virtual int64_t LoadFromBinary(const std::string& path,
+                                 const int pserver_id, const int pserver_num,
+                                 std::shared_ptr<ValueBlock> block,
+                                 int shard_id);
 
   virtual void ProcessALine(const std::vector<std::string>& columns,
                             const Meta& meta, const int64_t id,
@@ -0,0 +1,302 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace paddle {
+namespace distributed {
+
+// FlatHashMap is an open-addressing hash map in the style of Swiss tables,
+// used as the feasign index of a sparse table shard. Every slot has one
+// control byte, holding either a state (empty / deleted) or 7 bits of the
+// key hash. A lookup loads a group of 16 control bytes and matches the tag
+// of the key against all of them at once (SSE2 when available), so most
+// misses never touch the slot array and hits touch exactly one slot.
+//
+// Only trivially copyable keys and values are supported (uint64_t -> VALUE*
+// is the use case), and it is NOT thread safe.
+template <typename K, typename V>
+class FlatHashMap {
+  static_assert(std::is_trivially_copyable<K>::value &&
+                    std::is_trivially_copyable<V>::value,
+                "FlatHashMap only holds trivially copyable keys and values");
+
+ public:
+  typedef std::pair<K, V> value_type;
+
+  static const size_t kGroupWidth = 16;
+
+  class iterator {
+   public:
+    iterator() : map_(nullptr), index_(0) {}
+    iterator(const FlatHashMap *map, size_t index)
+        : map_(map), index_(index) {
+      SkipEmpty();
+    }
+
+    value_type &operator*() const { return map_->slots_[index_]; }
+    value_type *operator->() const { return &map_->slots_[index_]; }
+
+    iterator &operator++() {
+      ++index_;
+      SkipEmpty();
+      return *this;
+    }
+
+    bool operator==(const iterator &other) const {
+      return map_ == other.map_ && index_ == other.index_;
+    }
+    bool operator!=(const iterator &other) const { return !(*this == other); }
+
+   private:
+    friend class FlatHashMap;
+
+    void SkipEmpty() {
+      while (index_ < map_->capacity_ && !IsFull(map_->ctrl_[index_])) {
+        ++index_;
+      }
+    }
+
+    const FlatHashMap *map_;
+    size_t index_;
+  };
+
+  FlatHashMap() { Reset(kGroupWidth); }
+
+  FlatHashMap(const FlatHashMap &) = delete;
+  FlatHashMap &operator=(const FlatHashMap &) = delete;
+
+  iterator begin() const { return iterator(this, 0); }
+  iterator end() const { return iterator(this, capacity_); }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t capacity() const { return capacity_; }
+
+  static size_t Hash(const K &key) {
+    // fmix64 of murmur3, feasigns are often sequential or share low bits
+    uint64_t h = static_cast<uint64_t>(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+  }
+
+  // bring the control group of a key into cache ahead of find/insert
+  void Prefetch(size_t hash) const {
+#if defined(__GNUC__) || defined(__clang__)
+    size_t pos = H1(hash) & mask_;
+    __builtin_prefetch(ctrl_.get() + pos, 0, 1);
+    __builtin_prefetch(slots_.get() + pos, 0, 1);
+#endif
+  }
+
+  iterator find(const K &key) const { return find(key, Hash(key)); }
+
+  iterator find(const K &key, size_t hash) const {
+    size_t index = 0;
+    if (FindIndex(key, hash, &index)) {
+      return iterator(this, index);
+    }
+    return end();
+  }
+
+  size_t count(const K &key) const { return find(key) == end() ? 0 : 1; }
+
+  V &operator[](const K &key) { return Insert(key, Hash(key)).first->second; }
+
+  // returns the slot of key and whether it was just inserted, a new slot
+  // has its value zero initialized
+  std::pair<iterator, bool> Insert(const K &key, size_t hash) {
+    size_t index = 0;
+    if (FindIndex(key, hash, &index)) {
+      return {iterator(this, index), false};
+    }
+    if (growth_left_ == 0) {
+      // drop tombstones if they are at least half of the load, else grow
+      Rehash(size_ * 2 <= MaxLoad(capacity_) ? capacity_ : capacity_ * 2);
+    }
+    index = FindInsertSlot(hash);
+    if (ctrl_[index] == kEmpty) {
+      --growth_left_;
+    }
+    SetCtrl(index, H2(hash));
+    slots_[index].first = key;
+    slots_[index].second = V();
+    ++size_;
+    return {iterator(this, index), true};
+  }
+
+  iterator erase(iterator iter) {
+    SetCtrl(iter.index_, kDeleted);
+    --size_;
+    ++iter;
+    return iter;
+  }
+
+  size_t erase(const K &key) {
+    auto iter = find(key);
+    if (iter == end()) {
+      return 0;
+    }
+    erase(iter);
+    return 1;
+  }
+
+  void clear() { Reset(kGroupWidth); }
+
+  void reserve(size_t num) {
+    size_t capacity = capacity_;
+    while (MaxLoad(capacity) < num) {
+      capacity *= 2;
+    }
+    if (capacity != capacity_) {
+      Rehash(capacity);
+    }
+  }
+
+ private:
+  static const int8_t kEmpty = -128;  // 0b10000000
+  static const int8_t kDeleted = -2;  // 0b11111110
+
+  static bool IsFull(int8_t ctrl) { return ctrl >= 0; }
+  static size_t H1(size_t hash) { return hash >> 7; }
+  static int8_t H2(size_t hash) { return static_cast<int8_t>(hash & 0x7F); }
+  // keep the load factor under 7/8
+  static size_t MaxLoad(size_t capacity) { return capacity - capacity / 8; }
+
+  // bit i is set when ctrl byte i of the group equals tag
+  static uint32_t MatchGroup(const int8_t *group, int8_t tag) {
+#ifdef __SSE2__
+    __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+    return static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag))));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kGroupWidth; ++i) {
+      mask |= static_cast<uint32_t>(group[i] == tag) << i;
+    }
+    return mask;
+#endif
+  }
+
+  // bit i is set when ctrl byte i of the group is empty or deleted
+  static uint32_t MatchEmptyOrDeleted(const int8_t *group) {
+#ifdef __SSE2__
+    __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+    // full slots hold a tag >= 0, empty and deleted are both below -1
+    return static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl)));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kGroupWidth; ++i) {
+      mask |= static_cast<uint32_t>(group[i] < -1) << i;
+    }
+    return mask;
+#endif
+  }
+
+  static int TrailingZeros(uint32_t mask) { return __builtin_ctz(mask); }
+
+  bool FindIndex(const K &key, size_t hash, size_t *index) const {
+    const int8_t tag = H2(hash);
+    size_t pos = H1(hash) & mask_;
+    for (size_t step = kGroupWidth;; step += kGroupWidth) {
+      const int8_t *group = ctrl_.get() + pos;
+      for (uint32_t match = MatchGroup(group, tag); match != 0;
+           match &= match - 1) {
+        size_t i = (pos + TrailingZeros(match)) & mask_;
+        if (slots_[i].first == key) {
+          *index = i;
+          return true;
+        }
+      }
+      if (MatchGroup(group, kEmpty) != 0) {
+        return false;
+      }
+      pos = (pos + step) & mask_;
+    }
+  }
+
+  size_t FindInsertSlot(size_t hash) const {
+    size_t pos = H1(hash) & mask_;
+    for (size_t step = kGroupWidth;; step += kGroupWidth) {
+      uint32_t match = MatchEmptyOrDeleted(ctrl_.get() + pos);
+      if (match != 0) {
+        return (pos + TrailingZeros(match)) & mask_;
+      }
+      pos = (pos + step) & mask_;
+    }
+  }
+
+  // the first kGroupWidth - 1 control bytes are mirrored behind the table,
+  // so a group load starting anywhere never needs to wrap around
+  void SetCtrl(size_t index, int8_t ctrl) {
+    ctrl_[index] = ctrl;
+    if (index < kGroupWidth - 1) {
+      ctrl_[capacity_ + index] = ctrl;
+    }
+  }
+
+  void Reset(size_t capacity) {
+    capacity_ = capacity;
+    mask_ = capacity - 1;
+    ctrl_.reset(new int8_t[capacity + kGroupWidth]);
+    memset(ctrl_.get(), kEmpty, capacity + kGroupWidth);
+    slots_.reset(new value_type[capacity]);
+    size_ = 0;
+    growth_left_ = MaxLoad(capacity);
+  }
+
+  void Rehash(size_t capacity) {
+    std::unique_ptr<int8_t[]> old_ctrl(std::move(ctrl_));
+    std::unique_ptr<value_type[]> old_slots(std::move(slots_));
+    size_t old_capacity = capacity_;
+
+    Reset(capacity);
+    for (size_t i = 0; i < old_capacity; ++i) {
+      if (!IsFull(old_ctrl[i])) {
+        continue;
+      }
+      size_t hash = Hash(old_slots[i].first);
+      size_t index = FindInsertSlot(hash);
+      SetCtrl(index, H2(hash));
+      slots_[index] = old_slots[i];
+      ++size_;
+    }
+    growth_left_ = MaxLoad(capacity_) - size_;
+  }
+
+  std::unique_ptr<int8_t[]> ctrl_;
+  std::unique_ptr<value_type[]> slots_;
+  size_t capacity_ = 0;
+  size_t mask_ = 0;
+  size_t size_ = 0;
+  size_t growth_left_ = 0;
+};
+
+}  // namespace distributed
+}  // namespace paddle
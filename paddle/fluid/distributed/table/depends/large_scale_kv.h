@@ -28,8 +28,8 @@
 
 #include "butil/object_pool.h"
 #include "paddle/fluid/distributed/common/utils.h"
+#include "paddle/fluid/distributed/table/depends/flat_hash_map.h"
 #include "paddle/fluid/distributed/table/depends/initializers.h"
-#include "paddle/fluid/distributed/thirdparty/round_robin.h"
 #include "paddle/fluid/framework/generator.h"
 #include "paddle/fluid/framework/lod_tensor.h"
 #include "paddle/fluid/framework/rw_lock.h"
@@ -52,24 +52,118 @@ enum Mode { training, infer };
 static const int SPARSE_SHARD_BUCKET_NUM_BITS = 6;
 static const size_t SPARSE_SHARD_BUCKET_NUM = (size_t)1
                                               << SPARSE_SHARD_BUCKET_NUM_BITS;
+static const size_t SPARSE_SLAB_ROWS_PER_CHUNK = 4096;
+// how many keys ahead InitBatch prefetches the control group of
+static const size_t SPARSE_PREFETCH_DISTANCE = 8;
 
 struct VALUE {
+  // heap storage, the payload is owned by the VALUE itself
   explicit VALUE(size_t length)
-      : length_(length),
+      : data_(new float[length]),
+        length_(length),
         count_(0),
         unseen_days_(0),
         need_save_(false),
-        is_entry_(false) {
-    data_.resize(length);
-    memset(data_.data(), 0, sizeof(float) * length);
+        is_entry_(false),
+        is_inline_(false) {
+    memset(data_, 0, sizeof(float) * length);
   }
 
+  // slab storage, the payload lives right behind the VALUE in the same slot
+  VALUE(size_t length, float *data)
+      : data_(data),
+        length_(length),
+        count_(0),
+        unseen_days_(0),
+        need_save_(false),
+        is_entry_(false),
+        is_inline_(true) {
+    memset(data_, 0, sizeof(float) * length);
+  }
+
+  ~VALUE() {
+    if (!is_inline_) {
+      delete[] data_;
+    }
+  }
+
+  VALUE(const VALUE &) = delete;
+  VALUE &operator=(const VALUE &) = delete;
+
+  float *data_;
   size_t length_;
-  std::vector<float> data_;
   int count_;
   int unseen_days_;  // use to check knock-out
   bool need_save_;   // whether need to save
   bool is_entry_;    // whether knock-in
+  bool is_inline_;   // whether data_ is allocated in a ValueSlab
+};
+
+// ValueSlab is a fixed-stride arena used by one ValueBlock (one shard). Every
+// slot packs the VALUE header and its float payload together, and slots are
+// carved from large chunks, so a row costs no extra heap allocation and
+// neighbouring rows share cache lines and pages.
+// It is NOT thread safe, a shard is only touched by its own task pool.
+class ValueSlab {
+ public:
+  ValueSlab(size_t value_length, size_t rows_per_chunk)
+      : value_length_(value_length),
+        rows_per_chunk_(rows_per_chunk),
+        stride_(AlignUp(sizeof(VALUE) + sizeof(float) * value_length,
+                        alignof(VALUE))) {
+    PADDLE_ENFORCE_GT(rows_per_chunk_, 0,
+                      platform::errors::InvalidArgument(
+                          "rows per chunk of ValueSlab must be positive"));
+  }
+
+  // inline VALUEs own nothing, so the chunks can be dropped as a whole
+  ~ValueSlab() {}
+
+  VALUE *Acquire() {
+    char *slot = nullptr;
+    if (free_head_ != nullptr) {
+      slot = free_head_;
+      free_head_ = *reinterpret_cast<char **>(slot);
+    } else {
+      if (cursor_ == chunk_end_) {
+        chunks_.emplace_back(new char[stride_ * rows_per_chunk_]);
+        cursor_ = chunks_.back().get();
+        chunk_end_ = cursor_ + stride_ * rows_per_chunk_;
+      }
+      slot = cursor_;
+      cursor_ += stride_;
+    }
+    ++in_use_;
+    return new (slot) VALUE(value_length_,
+                            reinterpret_cast<float *>(slot + sizeof(VALUE)));
+  }
+
+  void Release(VALUE *value) {
+    char *slot = reinterpret_cast<char *>(value);
+    value->~VALUE();
+    *reinterpret_cast<char **>(slot) = free_head_;
+    free_head_ = slot;
+    --in_use_;
+  }
+
+  size_t stride() const { return stride_; }
+  size_t in_use() const { return in_use_; }
+  size_t capacity() const { return chunks_.size() * rows_per_chunk_; }
+
+ private:
+  static size_t AlignUp(size_t size, size_t align) {
+    return (size + align - 1) / align * align;
+  }
+
+  const size_t value_length_;
+  const size_t rows_per_chunk_;
+  const size_t stride_;
+
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  char *cursor_ = nullptr;
+  char *chunk_end_ = nullptr;
+  char *free_head_ = nullptr;
+  size_t in_use_ = 0;
 };
 
 inline bool count_entry(VALUE *value, int threshold) {
@@ -83,13 +177,14 @@ inline bool probility_entry(VALUE *value, float threshold) {
 
 class ValueBlock {
  public:
-  typedef typename robin_hood::unordered_map<uint64_t, VALUE *> map_type;
+  typedef FlatHashMap<uint64_t, VALUE *> map_type;
   explicit ValueBlock(const std::vector<std::string> &value_names,
                       const std::vector<int> &value_dims,
                       const std::vector<int> &value_offsets,
                       const std::unordered_map<std::string, int> &value_idx,
                       const std::vector<std::string> &init_attrs,
-                      const std::string &entry_attr)
+                      const std::string &entry_attr,
+                      const std::string &storage_attr = "heap")
       : value_names_(value_names),
         value_dims_(value_dims),
         value_offsets_(value_offsets),
@@ -120,6 +215,24 @@ class ValueBlock {
       }
     }
 
+    // for Storage
+    {
+      auto slices = string::split_string<std::string>(storage_attr, ":");
+      if (slices[0] == "heap") {
+        slab_.reset();
+      } else if (slices[0] == "slab") {
+        size_t rows_per_chunk = SPARSE_SLAB_ROWS_PER_CHUNK;
+        if (slices.size() > 1) {
+          rows_per_chunk = std::stoul(slices[1]);
+        }
+        slab_.reset(new ValueSlab(value_length_, rows_per_chunk));
+      } else {
+        PADDLE_THROW(platform::errors::InvalidArgument(
+            "Not supported Storage Type : %s, Only support [heap, slab]",
+            slices[0]));
+      }
+    }
+
     // for Initializer
     {
       for (auto &attr : init_attrs) {
@@ -157,7 +270,7 @@ class ValueBlock {
       PADDLE_ENFORCE_EQ(
           value_dims[i], value_dims_[i],
           platform::errors::InvalidArgument("value dims is not match"));
-      pts.push_back(values->data_.data() +
+      pts.push_back(values->data_ +
                     value_offsets_.at(value_idx_.at(value_names[i])));
     }
     return pts;
@@ -166,26 +279,11 @@ class ValueBlock {
   // pull
   float *Init(const uint64_t &id, const bool with_update = true,
               const int counter = 1) {
-    size_t hash = _hasher(id);
-    size_t bucket = compute_bucket(hash);
-
-    auto &table = values_[bucket];
-    auto res = table.find(id);
-
-    VALUE *value = nullptr;
-    if (res == table.end()) {
-      value = butil::get_object<VALUE>(value_length_);
-
-      table[id] = value;
-
-    } else {
-      value = res->second;
-    }
-
+    VALUE *value = InitGet(id);
     if (with_update) {
-      AttrUpdate(value, counter);
+      AttrUpdate(id, value, counter);
     }
-    return value->data_.data();
+    return value->data_;
   }
 
   VALUE *InitGet(const uint64_t &id, const bool with_update = true,
@@ -194,20 +292,54 @@ class ValueBlock {
     size_t bucket = compute_bucket(hash);
 
     auto &table = values_[bucket];
-    auto res = table.find(id);
+    auto res = table.Insert(id, map_type::Hash(id));
+    if (res.second) {
+      res.first->second = AllocValue();
+    }
+    return res.first->second;
+  }
 
-    VALUE *value = nullptr;
-    if (res == table.end()) {
-      value = butil::get_object<VALUE>(value_length_);
-      // value = _alloc.acquire(value_length_);
-      table[id] = value;
-    } else {
-      value = (VALUE *)(void *)(res->second);
+  // pull in batch, the rows of keys[offsets[i]] are looked up (and created
+  // when missing) in one pass and written to values[i]. The index hash of
+  // every key is computed up front, so the control group of a key can be
+  // prefetched SPARSE_PREFETCH_DISTANCE keys before it is probed.
+  void InitBatch(const uint64_t *keys, const uint32_t *counters,
+                 const std::vector<int> &offsets, const bool with_update,
+                 std::vector<float *> *values) {
+    const size_t num = offsets.size();
+    values->resize(num);
+
+    std::vector<size_t> hashes(num);
+    std::vector<map_type *> tables(num);
+    for (size_t i = 0; i < num; ++i) {
+      auto id = keys[offsets[i]];
+      hashes[i] = map_type::Hash(id);
+      tables[i] = &values_[compute_bucket(_hasher(id))];
+    }
+
+    for (size_t i = 0; i < num && i < SPARSE_PREFETCH_DISTANCE; ++i) {
+      tables[i]->Prefetch(hashes[i]);
+    }
+
+    for (size_t i = 0; i < num; ++i) {
+      if (i + SPARSE_PREFETCH_DISTANCE < num) {
+        tables[i + SPARSE_PREFETCH_DISTANCE]->Prefetch(
+            hashes[i + SPARSE_PREFETCH_DISTANCE]);
+      }
+      auto res = tables[i]->Insert(keys[offsets[i]], hashes[i]);
+      if (res.second) {
+        res.first->second = AllocValue();
+      }
+      VALUE *value = res.first->second;
+      if (with_update) {
+        AttrUpdate(keys[offsets[i]], value,
+                   counters == nullptr ? 1 : counters[offsets[i]]);
+      }
+      (*values)[i] = value->data_;
     }
-    return value;
   }
 
-  void AttrUpdate(VALUE *value, const int counter) {
+  void AttrUpdate(const uint64_t &id, VALUE *value, const int counter) {
     // update state
     value->unseen_days_ = 0;
     value->count_ += counter;
@@ -217,18 +349,27 @@ class ValueBlock {
       if (value->is_entry_) {
         // initialize
         for (size_t x = 0; x < value_names_.size(); ++x) {
-          initializers_[x]->GetValue(value->data_.data() + value_offsets_[x],
+          initializers_[x]->GetValue(value->data_ + value_offsets_[x],
                                      value_dims_[x]);
         }
-        value->need_save_ = true;
+        MarkSave(id, value);
       }
     } else {
-      value->need_save_ = true;
+      MarkSave(id, value);
     }
 
     return;
   }
 
+  // need_save_ is set on the first touch after a base/delta save, which is
+  // also when the key joins dirty_keys_, so every key is listed once
+  void MarkSave(const uint64_t &id, VALUE *value) {
+    if (!value->need_save_) {
+      value->need_save_ = true;
+      dirty_keys_.push_back(id);
+    }
+  }
+
   // dont jude if (has(id))
   float *Get(const uint64_t &id) {
     size_t hash = _hasher(id);
@@ -236,10 +377,10 @@ class ValueBlock {
     auto &table = values_[bucket];
 
     // auto &value = table.at(id);
-    // return value->data_.data();
+    // return value->data_;
     auto res = table.find(id);
     VALUE *value = res->second;
-    return value->data_.data();
+    return value->data_;
   }
 
   // for load, to reset count, unseen_days
@@ -262,15 +403,20 @@ class ValueBlock {
     value->is_entry_ = state;
   }
 
-  void erase(uint64_t feasign) {
+  // track is false when the row is not really gone (e.g. moved to SSD) or
+  // the erase is not a change since the last snapshot (e.g. on load)
+  void erase(uint64_t feasign, bool track = true) {
     size_t hash = _hasher(feasign);
     size_t bucket = compute_bucket(hash);
     auto &table = values_[bucket];
 
     auto iter = table.find(feasign);
     if (iter != table.end()) {
-      butil::return_object(iter->second);
+      FreeValue(iter->second);
       iter = table.erase(iter);
+      if (track) {
+        dirty_keys_.push_back(feasign);
+      }
     }
   }
 
@@ -281,9 +427,8 @@ class ValueBlock {
         VALUE *value = iter->second;
         value->unseen_days_++;
         if (value->unseen_days_ >= threshold) {
-          butil::return_object(iter->second);
-          //_alloc.release(iter->second);
-          //_alloc.release(value);
+          dirty_keys_.push_back(iter->first);
+          FreeValue(iter->second);
           iter = table.erase(iter);
         } else {
           ++iter;
@@ -293,6 +438,32 @@ class ValueBlock {
     return;
   }
 
+  // every VALUE of this block must be created and destroyed through these
+  VALUE *AllocValue() {
+    if (slab_) {
+      return slab_->Acquire();
+    }
+    return butil::get_object<VALUE>(value_length_);
+  }
+
+  void FreeValue(VALUE *value) {
+    if (slab_) {
+      slab_->Release(value);
+    } else {
+      butil::return_object(value);
+    }
+  }
+
+  bool IsSlab() const { return slab_ != nullptr; }
+
+  size_t Size() const {
+    size_t size = 0;
+    for (auto &table : values_) {
+      size += table.size();
+    }
+    return size;
+  }
+
   float GetThreshold() { return threshold_; }
   size_t compute_bucket(size_t hash) {
     if (SPARSE_SHARD_BUCKET_NUM == 1) {
@@ -336,6 +507,10 @@ class ValueBlock {
  public:
   map_type values_[SPARSE_SHARD_BUCKET_NUM];
   size_t value_length_ = 0;
+  // keys touched or erased since the last base/delta save, a delta save
+  // visits only these instead of the whole block. a key that is no longer
+  // in values_ has been erased.
+  std::vector<uint64_t> dirty_keys_;
   std::hash<uint64_t> _hasher;
 
  private:
@@ -347,6 +522,7 @@ class ValueBlock {
   std::function<bool(VALUE *)> entry_func_;
   std::vector<std::shared_ptr<Initializer>> initializers_;
   float threshold_;
+  std::unique_ptr<ValueSlab> slab_;
 };
 
 }  // namespace distributed
@@ -22,6 +22,7 @@
 #include <rocksdb/write_batch.h>
 #include <iostream>
 #include <string>
+#include <vector>
 
 namespace paddle {
 namespace distributed {
@@ -121,10 +122,38 @@ class RocksDBHandler {
     if (s.IsNotFound()) {
       return 1;
     }
-    assert(s.ok());
+    if (!s.ok()) {
+      LOG(ERROR) << "rocksdb get failed: " << s.ToString();
+      return -1;
+    }
     return 0;
   }
 
+  // look up keys in one MultiGet, found[i] is set when keys[i] exists and
+  // its value is stored in values[i]. returns the number of found keys, or
+  // -1 when any lookup fails for another reason than a missing key
+  int multi_get(int id, const std::vector<rocksdb::Slice>& keys,
+                std::vector<std::string>* values, std::vector<bool>* found) {
+    std::vector<rocksdb::ColumnFamilyHandle*> handles(keys.size(),
+                                                      _handles[id]);
+    std::vector<rocksdb::Status> status =
+        _db->MultiGet(rocksdb::ReadOptions(), handles, keys, values);
+    found->resize(keys.size());
+    int num = 0;
+    for (size_t i = 0; i < status.size(); ++i) {
+      (*found)[i] = status[i].ok();
+      if (status[i].IsNotFound()) {
+        continue;
+      }
+      if (!status[i].ok()) {
+        LOG(ERROR) << "rocksdb multi get failed: " << status[i].ToString();
+        return -1;
+      }
+      ++num;
+    }
+    return num;
+  }
+
   int del_data(int id, const char* key, int key_len) {
     rocksdb::WriteOptions options;
     options.disableWAL = true;
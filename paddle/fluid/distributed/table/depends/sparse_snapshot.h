@@ -0,0 +1,67 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SPARSE_SNAPSHOT_MAGIC "PDSPARSE"
+#define SPARSE_SNAPSHOT_VERSION 1
+
+namespace paddle {
+namespace distributed {
+
+enum SparseSnapshotKind { kSnapshotBase = 0, kSnapshotDelta = 1 };
+
+// the row of a delta record has been erased since the previous snapshot
+static const int32_t SPARSE_SNAPSHOT_DELETED = 1;
+
+// A binary snapshot keeps one file per local shard, a fixed size header
+// followed by records of the same size:
+// | key | count | unseen_days | is_entry | flags | float * value_length |
+// Loading copies the float payload of each row out of the mmaped file with
+// one memcpy and sets the few meta fields of its VALUE, with no parsing, and
+// the shards are read in parallel.
+// A delta snapshot only holds the rows touched since the previous base or
+// delta, plus records flagged SPARSE_SNAPSHOT_DELETED for erased rows.
+struct SparseSnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t value_length;
+  uint32_t record_size;
+  uint32_t shard_id;
+  uint32_t shard_num;
+  uint32_t kind;
+  uint64_t count;
+  char padding[24];
+};
+static_assert(sizeof(SparseSnapshotHeader) == 64,
+              "SparseSnapshotHeader should be 64 bytes");
+
+struct SparseSnapshotRecord {
+  uint64_t key;
+  int32_t count;
+  int32_t unseen_days;
+  int32_t is_entry;
+  int32_t flags;
+};
+
+inline size_t SparseSnapshotRecordSize(size_t value_length) {
+  size_t size = sizeof(SparseSnapshotRecord) + sizeof(float) * value_length;
+  return (size + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t);
+}
+
+}  // namespace distributed
+}  // namespace paddle
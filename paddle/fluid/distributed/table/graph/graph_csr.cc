@@ -0,0 +1,203 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/distributed/table/graph/graph_csr.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <utility>
+namespace paddle {
+namespace distributed {
+
+// Up to this many samples, and while they are a small part of the row, the
+// neighbors are drawn one by one and the repeated ones are drawn again.
+static const int kMaxRejectionSampleSize = 64;
+
+int GraphCSR::add_row(const uint64_t *neighbor_ids,
+                      const float *neighbor_weights, size_t degree) {
+  int row = get_row_num();
+  size_t start = ids.size();
+  ids.insert(ids.end(), neighbor_ids, neighbor_ids + degree);
+  if (is_weighted) {
+    if (neighbor_weights != nullptr) {
+      weights.insert(weights.end(), neighbor_weights,
+                     neighbor_weights + degree);
+    } else {
+      weights.resize(start + degree, 1);
+    }
+    build_alias(start, degree);
+  }
+  offsets.push_back(ids.size());
+  return row;
+}
+
+void GraphCSR::clear() {
+  offsets.assign(1, 0);
+  ids.clear();
+  weights.clear();
+  alias_prob.clear();
+  alias_idx.clear();
+}
+
+void GraphCSR::build_alias(size_t start, size_t degree) {
+  alias_prob.resize(start + degree, 1);
+  alias_idx.resize(start + degree);
+  for (size_t i = 0; i < degree; i++) {
+    alias_idx[start + i] = i;
+  }
+  double sum = 0;
+  for (size_t i = 0; i < degree; i++) {
+    sum += std::max(weights[start + i], 0.0f);
+  }
+  if (sum <= 0) {
+    return;
+  }
+  // Vose's method: every bucket is topped up to the mean by one of the
+  // neighbors above it
+  std::vector<double> scaled(degree);
+  std::vector<uint32_t> small, large;
+  for (size_t i = 0; i < degree; i++) {
+    scaled[i] = std::max(weights[start + i], 0.0f) * degree / sum;
+    if (scaled[i] < 1) {
+      small.push_back(i);
+    } else {
+      large.push_back(i);
+    }
+  }
+  while (!small.empty() && !large.empty()) {
+    uint32_t s = small.back(), l = large.back();
+    small.pop_back();
+    alias_prob[start + s] = scaled[s];
+    alias_idx[start + s] = l;
+    scaled[l] -= 1 - scaled[s];
+    if (scaled[l] < 1) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+}
+
+void GraphCSR::sample_k(int row, int k, std::mt19937_64 &rng,
+                        std::vector<int> *res) const {
+  res->clear();
+  size_t d = degree(row);
+  if (k <= 0 || d == 0) {
+    return;
+  }
+  if ((size_t)k >= d) {
+    res->resize(d);
+    std::iota(res->begin(), res->end(), 0);
+    return;
+  }
+  if (is_weighted) {
+    sample_weighted(offsets[row], d, k, rng, res);
+  } else {
+    sample_uniform(d, k, rng, res);
+  }
+}
+
+int GraphCSR::sample_k(int row, int k, std::mt19937_64 &rng,
+                       char *buffer) const {
+  thread_local std::vector<int> res;
+  sample_k(row, k, rng, &res);
+  size_t start = offsets[row];
+  for (int idx : res) {
+    uint64_t id = ids[start + idx];
+    float weight = is_weighted ? weights[start + idx] : 1;
+    memcpy(buffer, &id, sizeof(uint64_t));
+    buffer += sizeof(uint64_t);
+    memcpy(buffer, &weight, sizeof(float));
+    buffer += sizeof(float);
+  }
+  return res.size();
+}
+
+void GraphCSR::sample_uniform(size_t degree, int k, std::mt19937_64 &rng,
+                              std::vector<int> *res) const {
+  if (k <= kMaxRejectionSampleSize && (size_t)k * 4 <= degree) {
+    std::uniform_int_distribution<size_t> pick(0, degree - 1);
+    while ((int)res->size() < k) {
+      int idx = pick(rng);
+      if (std::find(res->begin(), res->end(), idx) == res->end()) {
+        res->push_back(idx);
+      }
+    }
+    return;
+  }
+  // partial Fisher-Yates shuffle
+  thread_local std::vector<int> perm;
+  perm.resize(degree);
+  std::iota(perm.begin(), perm.end(), 0);
+  for (int i = 0; i < k; i++) {
+    std::uniform_int_distribution<size_t> pick(i, degree - 1);
+    std::swap(perm[i], perm[pick(rng)]);
+  }
+  res->assign(perm.begin(), perm.begin() + k);
+}
+
+void GraphCSR::sample_weighted(size_t start, size_t degree, int k,
+                               std::mt19937_64 &rng,
+                               std::vector<int> *res) const {
+  if (k <= kMaxRejectionSampleSize && (size_t)k * 4 <= degree) {
+    // Drawing again on a repeat keeps every draw proportional to the weights
+    // of the neighbors left. Heavy neighbors make repeats likely, so the
+    // draws are bounded and the keys below finish the sample.
+    std::uniform_int_distribution<size_t> pick(0, degree - 1);
+    std::uniform_real_distribution<float> coin(0, 1);
+    int max_draws = 4 * k;
+    for (int draw = 0; draw < max_draws && (int)res->size() < k; draw++) {
+      size_t idx = pick(rng);
+      if (coin(rng) >= alias_prob[start + idx]) {
+        idx = alias_idx[start + idx];
+      }
+      if (std::find(res->begin(), res->end(), (int)idx) == res->end()) {
+        res->push_back(idx);
+      }
+    }
+    if ((int)res->size() == k) {
+      return;
+    }
+  }
+  // Efraimidis-Spirakis: the neighbors sorted by log(u) / weight come in the
+  // order weighted sampling without replacement draws them, so the top keys
+  // among the neighbors not drawn yet complete the sample.
+  thread_local std::vector<int> drawn;
+  thread_local std::vector<std::pair<double, int>> keys;
+  drawn.assign(res->begin(), res->end());
+  std::sort(drawn.begin(), drawn.end());
+  keys.clear();
+  std::uniform_real_distribution<double> uniform(0, 1);
+  auto next_drawn = drawn.begin();
+  for (size_t i = 0; i < degree; i++) {
+    if (next_drawn != drawn.end() && *next_drawn == (int)i) {
+      ++next_drawn;
+      continue;
+    }
+    float weight = weights[start + i];
+    double key = weight > 0 ? std::log(1 - uniform(rng)) / weight
+                            : -std::numeric_limits<double>::infinity();
+    keys.emplace_back(key, i);
+  }
+  size_t left = k - res->size();
+  std::partial_sort(keys.begin(), keys.begin() + left, keys.end(),
+                    std::greater<std::pair<double, int>>());
+  for (size_t i = 0; i < left; i++) {
+    res->push_back(keys[i].second);
+  }
+}
+}  // namespace distributed
+}  // namespace paddle
@@ -0,0 +1,76 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+namespace paddle {
+namespace distributed {
+
+// The neighbors of the nodes of a shard in compressed sparse row form: the
+// neighbors of row r are ids[offsets[r], offsets[r + 1]), their weights sit
+// at the same positions when the graph is weighted. Every weighted row also
+// keeps a Walker alias table, so one weighted draw costs O(1).
+class GraphCSR {
+ public:
+  GraphCSR(bool is_weighted = false) : is_weighted(is_weighted) {
+    offsets.push_back(0);
+  }
+  bool weighted() const { return is_weighted; }
+  size_t get_row_num() const { return offsets.size() - 1; }
+  size_t get_edge_num() const { return ids.size(); }
+
+  // Appends a row and returns its index, weights are ignored when the graph
+  // is not weighted and taken as 1 when it is and they are nullptr.
+  int add_row(const uint64_t *neighbor_ids, const float *neighbor_weights,
+              size_t degree);
+  void clear();
+
+  size_t degree(int row) const { return offsets[row + 1] - offsets[row]; }
+  uint64_t get_neighbor_id(int row, size_t idx) const {
+    return ids[offsets[row] + idx];
+  }
+  float get_neighbor_weight(int row, size_t idx) const {
+    return is_weighted ? weights[offsets[row] + idx] : 1;
+  }
+
+  // Samples min(k, degree) distinct neighbors of row, with the probability
+  // of a weighted neighbor to be drawn next proportional to its weight among
+  // the ones not drawn yet, as WeightedSampler does. All the neighbors are
+  // returned in order when k >= degree.
+  void sample_k(int row, int k, std::mt19937_64 &rng,
+                std::vector<int> *res) const;
+  // the same, written to buffer as (uint64 id, float weight) pairs, returns
+  // the number of neighbors written
+  int sample_k(int row, int k, std::mt19937_64 &rng, char *buffer) const;
+
+ private:
+  void build_alias(size_t start, size_t degree);
+  void sample_uniform(size_t degree, int k, std::mt19937_64 &rng,
+                      std::vector<int> *res) const;
+  void sample_weighted(size_t start, size_t degree, int k,
+                       std::mt19937_64 &rng, std::vector<int> *res) const;
+
+  bool is_weighted;
+  std::vector<size_t> offsets;
+  std::vector<uint64_t> ids;
+  std::vector<float> weights;
+  // alias table of the weighted rows, indexed as ids and local to the row
+  std::vector<float> alias_prob;
+  std::vector<uint32_t> alias_idx;
+};
+}  // namespace distributed
+}  // namespace paddle
@@ -64,6 +64,17 @@ void GraphNode::build_edges(bool is_weighted) {
     }
   }
 }
+void GraphNode::set_csr_row(int row) {
+  csr_row = row;
+  if (sampler != nullptr) {
+    delete sampler;
+    sampler = nullptr;
+  }
+  if (edges != nullptr) {
+    delete edges;
+    edges = nullptr;
+  }
+}
 void GraphNode::build_sampler(std::string sample_type) {
   if (sample_type == "random") {
     sampler = new RandomSampler();
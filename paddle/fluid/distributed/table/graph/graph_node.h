@@ -40,6 +40,12 @@ class Node {
   }
   virtual uint64_t get_neighbor_id(int idx) { return 0; }
   virtual float get_neighbor_weight(int idx) { return 1.; }
+  // number of the edges added and not packed yet
+  virtual size_t get_neighbor_size() { return 0; }
+  // row of the packed neighbors of the node in the GraphCSR of its shard,
+  // -1 when they are not packed
+  virtual int get_csr_row() { return -1; }
+  virtual void set_csr_row(int row) {}
 
   virtual int get_size(bool need_feature);
   virtual void to_buffer(char *buffer, bool need_feature);
@@ -55,8 +61,9 @@ class Node {
 
 class GraphNode : public Node {
  public:
-  GraphNode() : Node(), sampler(nullptr), edges(nullptr) {}
-  GraphNode(uint64_t id) : Node(id), sampler(nullptr), edges(nullptr) {}
+  GraphNode() : Node(), sampler(nullptr), edges(nullptr), csr_row(-1) {}
+  GraphNode(uint64_t id)
+      : Node(id), sampler(nullptr), edges(nullptr), csr_row(-1) {}
   virtual ~GraphNode();
   virtual void build_edges(bool is_weighted);
   virtual void build_sampler(std::string sample_type);
@@ -65,14 +72,24 @@ class GraphNode : public Node {
   }
   virtual std::vector<int> sample_k(
       int k, const std::shared_ptr<std::mt19937_64> rng) {
+    if (sampler == nullptr) {
+      return std::vector<int>();
+    }
     return sampler->sample_k(k, rng);
   }
   virtual uint64_t get_neighbor_id(int idx) { return edges->get_id(idx); }
   virtual float get_neighbor_weight(int idx) { return edges->get_weight(idx); }
+  virtual size_t get_neighbor_size() {
+    return edges == nullptr ? 0 : edges->size();
+  }
+  virtual int get_csr_row() { return csr_row; }
+  // the packed row holds the edges from now on, so the added ones are freed
+  virtual void set_csr_row(int row);
 
  protected:
   Sampler *sampler;
   GraphEdgeBlob *edges;
+  int csr_row;
 };
 
 class FeatureNode : public Node {
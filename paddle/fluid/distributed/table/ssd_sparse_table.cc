@@ -15,7 +15,17 @@
 #ifdef PADDLE_WITH_HETERPS
 #include "paddle/fluid/distributed/table/ssd_sparse_table.h"
 
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <limits>
+
 DEFINE_string(rocksdb_path, "database", "path of sparse table rocksdb file");
+DEFINE_int64(ssd_sparse_table_cache_rows, 0,
+             "max rows of each shard kept in memory by SSDSparseTable, the "
+             "rest live in rocksdb. 0 means no limit between update_table");
+DEFINE_double(ssd_sparse_table_evict_ratio, 0.1,
+              "fraction of the cache evicted at once when a shard of "
+              "SSDSparseTable is full");
 
 namespace paddle {
 namespace distributed {
@@ -31,6 +41,14 @@ int32_t SSDSparseTable::initialize() {
 
   _global_lr = new float(1.0);
 
+  // the binary snapshot only holds the rows in memory, not those in rocksdb
+  PADDLE_ENFORCE_NE(
+      _config.save_format(), "binary",
+      paddle::platform::errors::Unimplemented(
+          "The binary save format is not supported by SSDSparseTable %s, "
+          "please save it as text.",
+          _config.common().table_name()));
+
   auto common = _config.common();
   int size = static_cast<int>(common.params().size());
 
@@ -58,9 +76,203 @@ int32_t SSDSparseTable::initialize() {
   initialize_recorder();
   _db = paddle::distributed::RocksDBHandler::GetInstance();
   _db->initialize(FLAGS_rocksdb_path, task_pool_size_);
+
+  _cache_tk_size = FLAGS_ssd_sparse_table_cache_rows;
+  _write_back.resize(task_pool_size_);
+  _write_back_pool.resize(task_pool_size_);
+  for (int i = 0; i < _write_back_pool.size(); ++i) {
+    _write_back_pool[i].reset(new ::ThreadPool(1));
+  }
   return 0;
 }
 
+void SSDSparseTable::ToDBValue(const VALUE* value, std::string* db_value) {
+  // | data | count | unseen_days | is_entry |, all stored as float
+  size_t value_size = value->length_;
+  db_value->resize((value_size + 3) * sizeof(float));
+  float* db_floats = reinterpret_cast<float*>(&(*db_value)[0]);
+  memcpy(db_floats, value->data_, sizeof(float) * value_size);
+  db_floats[value_size] = value->count_;
+  db_floats[value_size + 1] = value->unseen_days_;
+  db_floats[value_size + 2] = value->is_entry_;
+}
+
+void SSDSparseTable::FromDBValue(const std::string& db_value, VALUE* value) {
+  size_t value_size = value->length_;
+  const float* db_floats = reinterpret_cast<const float*>(db_value.data());
+  memcpy(value->data_, db_floats, sizeof(float) * value_size);
+  value->count_ = db_floats[value_size];
+  value->unseen_days_ = db_floats[value_size + 1];
+  value->is_entry_ = db_floats[value_size + 2];
+}
+
+void SSDSparseTable::LoadMisses(int shard_id,
+                                const std::vector<uint64_t>& keys,
+                                std::vector<VALUE*>* values,
+                                std::vector<bool>* is_new) {
+  auto& block = shard_values_[shard_id];
+  auto& pending = _write_back[shard_id];
+  values->assign(keys.size(), nullptr);
+  is_new->assign(keys.size(), false);
+
+  std::vector<size_t> db_idx;
+  std::vector<rocksdb::Slice> db_keys;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    // the newest copy of an evicted row may still wait for write back
+    const std::string* buffered = nullptr;
+    for (auto it = pending.rbegin(); it != pending.rend(); ++it) {
+      auto got = (*it)->rows.find(keys[i]);
+      if (got != (*it)->rows.end()) {
+        buffered = &got->second;
+        break;
+      }
+    }
+    if (buffered == nullptr) {
+      db_idx.push_back(i);
+      db_keys.emplace_back(reinterpret_cast<const char*>(&keys[i]),
+                           sizeof(uint64_t));
+      continue;
+    }
+    auto iter = block->Find(keys[i]);
+    if (iter != block->end()) {
+      (*values)[i] = iter->second;
+      continue;
+    }
+    (*values)[i] = block->InitGet(keys[i]);
+    FromDBValue(*buffered, (*values)[i]);
+  }
+
+  if (db_keys.empty()) {
+    return;
+  }
+
+  std::vector<std::string> db_values;
+  std::vector<bool> found;
+  PADDLE_ENFORCE_GE(
+      _db->multi_get(shard_id, db_keys, &db_values, &found), 0,
+      paddle::platform::errors::Unavailable(
+          "Failed to read the evicted rows of shard %d from rocksdb.",
+          shard_id));
+
+  for (size_t x = 0; x < db_idx.size(); ++x) {
+    auto i = db_idx[x];
+    // the same key may appear more than once in a request
+    auto iter = block->Find(keys[i]);
+    if (iter != block->end()) {
+      (*values)[i] = iter->second;
+      continue;
+    }
+    (*values)[i] = block->InitGet(keys[i]);
+    if (found[x]) {
+      FromDBValue(db_values[x], (*values)[i]);
+    } else {
+      (*is_new)[i] = true;
+    }
+  }
+}
+
+void SSDSparseTable::ReloadEvicted(int shard_id, const uint64_t* keys,
+                                   const std::vector<uint64_t>& offsets) {
+  auto& block = shard_values_[shard_id];
+  std::vector<uint64_t> miss_keys;
+  for (auto& offset : offsets) {
+    if (block->Find(keys[offset]) == block->end()) {
+      miss_keys.push_back(keys[offset]);
+    }
+  }
+  if (!miss_keys.empty()) {
+    std::vector<VALUE*> loaded;
+    std::vector<bool> is_new;
+    LoadMisses(shard_id, miss_keys, &loaded, &is_new);
+  }
+}
+
+int64_t SSDSparseTable::Evict(int shard_id, size_t max_rows,
+                              bool evict_unseen) {
+  auto& block = shard_values_[shard_id];
+  auto& pending = _write_back[shard_id];
+  while (!pending.empty() &&
+         pending.front()->done.wait_for(std::chrono::seconds(0)) ==
+             std::future_status::ready) {
+    pending.pop_front();
+  }
+
+  std::vector<std::pair<uint64_t, VALUE*>> victims;
+  std::vector<std::pair<uint64_t, VALUE*>> candidates;
+  candidates.reserve(block->Size());
+  for (auto& table : block->values_) {
+    for (auto& row : table) {
+      if (evict_unseen && row.second->unseen_days_ >= 1) {
+        victims.emplace_back(row.first, row.second);
+      } else {
+        candidates.emplace_back(row.first, row.second);
+      }
+    }
+  }
+
+  if (candidates.size() > max_rows) {
+    auto num = candidates.size() - max_rows;
+    std::nth_element(candidates.begin(), candidates.begin() + num,
+                     candidates.end(),
+                     [](const std::pair<uint64_t, VALUE*>& a,
+                        const std::pair<uint64_t, VALUE*>& b) {
+                       if (a.second->unseen_days_ != b.second->unseen_days_) {
+                         return a.second->unseen_days_ > b.second->unseen_days_;
+                       }
+                       return a.second->count_ < b.second->count_;
+                     });
+    victims.insert(victims.end(), candidates.begin(),
+                   candidates.begin() + num);
+  }
+
+  if (victims.empty()) {
+    return 0;
+  }
+
+  auto batch = std::make_shared<WriteBackBatch>();
+  batch->rows.reserve(victims.size());
+  for (auto& victim : victims) {
+    ToDBValue(victim.second, &batch->rows[victim.first]);
+    block->erase(victim.first, false);
+  }
+
+  // the task must not own the batch, whose future refers back to the task.
+  // pending keeps the batch until the task is done.
+  auto* rows = &batch->rows;
+  batch->done =
+      _write_back_pool[shard_id]->enqueue([this, shard_id, rows]() -> int {
+        std::vector<std::pair<char*, int>> ssd_keys;
+        std::vector<std::pair<char*, int>> ssd_values;
+        ssd_keys.reserve(rows->size());
+        ssd_values.reserve(rows->size());
+        for (auto& row : *rows) {
+          ssd_keys.emplace_back(
+              reinterpret_cast<char*>(const_cast<uint64_t*>(&row.first)),
+              sizeof(uint64_t));
+          ssd_values.emplace_back(const_cast<char*>(row.second.data()),
+                                  row.second.size());
+        }
+        _db->put_batch(shard_id, ssd_keys, ssd_values, ssd_keys.size());
+        return 0;
+      });
+  pending.push_back(batch);
+  return victims.size();
+}
+
+SSDSparseTable::~SSDSparseTable() {
+  for (size_t shard_id = 0; shard_id < _write_back.size(); ++shard_id) {
+    WaitWriteBack(shard_id);
+  }
+}
+
+void SSDSparseTable::WaitWriteBack(int shard_id) {
+  auto& pending = _write_back[shard_id];
+  for (auto& batch : pending) {
+    batch->done.wait();
+  }
+  pending.clear();
+}
+
 int32_t SSDSparseTable::pull_sparse(float* pull_values,
                                     const PullSparseValue& pull_value) {
   auto shard_num = task_pool_size_;
@@ -71,49 +283,56 @@ int32_t SSDSparseTable::pull_sparse(float* pull_values,
         [this, shard_id, shard_num, &pull_value, &pull_values]() -> int {
           auto& block = shard_values_[shard_id];
 
+          // make room before this batch is admitted, keep some headroom so
+          // eviction runs once per many pulls
+          if (_cache_tk_size > 0 &&
+              block->Size() > static_cast<size_t>(_cache_tk_size)) {
+            Evict(shard_id, static_cast<size_t>(
+                                _cache_tk_size *
+                                (1.0 - FLAGS_ssd_sparse_table_evict_ratio)),
+                  false);
+          }
+
           std::vector<int> offsets;
           pull_value.Fission(shard_id, shard_num, &offsets);
 
-          for (auto& offset : offsets) {
-            auto feasign = pull_value.feasigns_[offset];
-            auto frequencie = pull_value.frequencies_[offset];
-            float* embedding = nullptr;
+          std::vector<float*> embeddings(offsets.size(), nullptr);
+          std::vector<size_t> miss_idx;
+          std::vector<uint64_t> miss_keys;
+          for (size_t i = 0; i < offsets.size(); ++i) {
+            auto feasign = pull_value.feasigns_[offsets[i]];
             auto iter = block->Find(feasign);
             // in mem
-            if (iter == block->end()) {
-              embedding = iter->second->data_.data();
+            if (iter != block->end()) {
+              embeddings[i] = iter->second->data_;
               if (pull_value.is_training_) {
-                block->AttrUpdate(iter->second, frequencie);
+                block->AttrUpdate(feasign, iter->second,
+                                  pull_value.frequencies_[offsets[i]]);
               }
             } else {
-              // need create
-              std::string tmp_str("");
-              if (_db->get(shard_id, (char*)&feasign, sizeof(uint64_t),
-                           tmp_str) > 0) {
-                embedding = block->Init(feasign, true, frequencie);
-              } else {
-                // in db
-                int data_size = tmp_str.size() / sizeof(float);
-                int value_size = block->value_length_;
-                float* db_value = (float*)const_cast<char*>(tmp_str.c_str());
-                VALUE* value = block->InitGet(feasign);
-
-                // copy to mem
-                memcpy(value->data_.data(), db_value,
-                       value_size * sizeof(float));
-                embedding = db_value;
-
-                // param, count, unseen_day
-                value->count_ = db_value[value_size];
-                value->unseen_days_ = db_value[value_size + 1];
-                value->is_entry_ = db_value[value_size + 2];
-                if (pull_value.is_training_) {
-                  block->AttrUpdate(value, frequencie);
-                }
+              miss_idx.push_back(i);
+              miss_keys.push_back(feasign);
+            }
+          }
+
+          if (!miss_keys.empty()) {
+            std::vector<VALUE*> values;
+            std::vector<bool> is_new;
+            LoadMisses(shard_id, miss_keys, &values, &is_new);
+            for (size_t x = 0; x < miss_idx.size(); ++x) {
+              auto i = miss_idx[x];
+              // new rows need to be initialized even in infer mode
+              if (is_new[x] || pull_value.is_training_) {
+                block->AttrUpdate(miss_keys[x], values[x],
+                                  pull_value.frequencies_[offsets[i]]);
               }
+              embeddings[i] = values[x]->data_;
             }
-            std::copy_n(embedding + param_offset_, param_dim_,
-                        pull_values + param_dim_ * offset);
+          }
+
+          for (size_t i = 0; i < offsets.size(); ++i) {
+            std::copy_n(embeddings[i] + param_offset_, param_dim_,
+                        pull_values + param_dim_ * offsets[i]);
           }
           return 0;
         });
@@ -144,37 +363,28 @@ int32_t SSDSparseTable::pull_sparse_ptr(char** pull_values,
           auto& block = shard_values_[shard_id];
           auto& offsets = offset_bucket[shard_id];
 
+          std::vector<size_t> miss_offsets;
+          std::vector<uint64_t> miss_keys;
           for (auto& offset : offsets) {
             auto feasign = keys[offset];
             auto iter = block->Find(feasign);
-            VALUE* value = nullptr;
             // in mem
             if (iter != block->end()) {
-              value = iter->second;
+              pull_values[offset] = reinterpret_cast<char*>(iter->second);
             } else {
-              // need create
-              std::string tmp_str("");
-              if (_db->get(shard_id, (char*)&feasign, sizeof(uint64_t),
-                           tmp_str) > 0) {
-                value = block->InitGet(feasign);
-              } else {
-                // in db
-                int data_size = tmp_str.size() / sizeof(float);
-                int value_size = block->value_length_;
-                float* db_value = (float*)const_cast<char*>(tmp_str.c_str());
-                value = block->InitGet(feasign);
-
-                // copy to mem
-                memcpy(value->data_.data(), db_value,
-                       value_size * sizeof(float));
-
-                // param, count, unseen_day
-                value->count_ = db_value[value_size];
-                value->unseen_days_ = db_value[value_size + 1];
-                value->is_entry_ = db_value[value_size + 2];
-              }
+              miss_offsets.push_back(offset);
+              miss_keys.push_back(feasign);
+            }
+          }
+
+          if (!miss_keys.empty()) {
+            std::vector<VALUE*> values;
+            std::vector<bool> is_new;
+            LoadMisses(shard_id, miss_keys, &values, &is_new);
+            for (size_t x = 0; x < miss_offsets.size(); ++x) {
+              pull_values[miss_offsets[x]] =
+                  reinterpret_cast<char*>(values[x]);
             }
-            pull_values[offset] = (char*)value;
           }
           return 0;
         });
@@ -186,36 +396,85 @@ int32_t SSDSparseTable::pull_sparse_ptr(char** pull_values,
   return 0;
 }
 
+int32_t SSDSparseTable::_push_sparse(const uint64_t* keys,
+                                     const float* values, size_t num) {
+  std::vector<std::vector<uint64_t>> offset_bucket;
+  offset_bucket.resize(task_pool_size_);
+
+  for (int x = 0; x < num; ++x) {
+    auto y = keys[x] % task_pool_size_;
+    offset_bucket[y].push_back(x);
+  }
+
+  std::vector<std::future<int>> tasks(task_pool_size_);
+
+  for (int shard_id = 0; shard_id < task_pool_size_; ++shard_id) {
+    tasks[shard_id] = _shards_task_pool[shard_id]->enqueue(
+        [this, shard_id, &keys, &values, num, &offset_bucket]() -> int {
+          auto& offsets = offset_bucket[shard_id];
+          ReloadEvicted(shard_id, keys, offsets);
+          optimizer_->update(keys, values, num, offsets,
+                             shard_values_[shard_id].get());
+          return 0;
+        });
+  }
+
+  for (size_t shard_id = 0; shard_id < tasks.size(); ++shard_id) {
+    tasks[shard_id].wait();
+  }
+  return 0;
+}
+
+int32_t SSDSparseTable::_push_sparse(const uint64_t* keys,
+                                     const float** values, size_t num) {
+  std::vector<std::vector<uint64_t>> offset_bucket;
+  offset_bucket.resize(task_pool_size_);
+
+  for (int x = 0; x < num; ++x) {
+    auto y = keys[x] % task_pool_size_;
+    offset_bucket[y].push_back(x);
+  }
+
+  std::vector<std::future<int>> tasks(task_pool_size_);
+
+  for (int shard_id = 0; shard_id < task_pool_size_; ++shard_id) {
+    tasks[shard_id] = _shards_task_pool[shard_id]->enqueue(
+        [this, shard_id, &keys, &values, num, &offset_bucket]() -> int {
+          auto& offsets = offset_bucket[shard_id];
+          ReloadEvicted(shard_id, keys, offsets);
+          for (size_t i = 0; i < offsets.size(); ++i) {
+            std::vector<uint64_t> tmp_off = {0};
+            optimizer_->update(keys + offsets[i], values[offsets[i]], num,
+                               tmp_off, shard_values_[shard_id].get());
+          }
+          return 0;
+        });
+  }
+
+  for (size_t shard_id = 0; shard_id < tasks.size(); ++shard_id) {
+    tasks[shard_id].wait();
+  }
+  return 0;
+}
+
+int32_t SSDSparseTable::flush() {
+  for (int shard_id = 0; shard_id < task_pool_size_; ++shard_id) {
+    WaitWriteBack(shard_id);
+    _db->flush(shard_id);
+  }
+  return 0;
+}
+
 int32_t SSDSparseTable::shrink(const std::string& param) { return 0; }
 
 int32_t SSDSparseTable::update_table() {
-  int count = 0;
-  int value_size = shard_values_[0]->value_length_;
-  int db_size = 3 + value_size;
-  float tmp_value[db_size];
+  int64_t count = 0;
+  size_t max_rows = _cache_tk_size > 0 ? static_cast<size_t>(_cache_tk_size)
+                                       : std::numeric_limits<size_t>::max();
 
   for (size_t i = 0; i < task_pool_size_; ++i) {
-    auto& block = shard_values_[i];
-
-    for (auto& table : block->values_) {
-      for (auto iter = table.begin(); iter != table.end();) {
-        VALUE* value = iter->second;
-        if (value->unseen_days_ >= 1) {
-          tmp_value[value_size] = value->count_;
-          tmp_value[value_size + 1] = value->unseen_days_;
-          tmp_value[value_size + 2] = value->is_entry_;
-          memcpy(tmp_value, value->data_.data(), sizeof(float) * value_size);
-          _db->put(i, (char*)&(iter->first), sizeof(uint64_t), (char*)tmp_value,
-                   db_size * sizeof(float));
-          count++;
-
-          butil::return_object(iter->second);
-          iter = table.erase(iter);
-        } else {
-          ++iter;
-        }
-      }
-    }
+    count += Evict(i, max_rows, true);
+    WaitWriteBack(i);
     _db->flush(i);
   }
   VLOG(1) << "Table>> update count: " << count;
@@ -237,7 +496,7 @@ int64_t SSDSparseTable::SaveValueToText(std::ostream* os,
       ++save_num;
 
       std::stringstream ss;
-      auto* vs = value.second->data_.data();
+      auto* vs = value.second->data_;
 
       auto id = value.first;
 
@@ -259,12 +518,21 @@ int64_t SSDSparseTable::SaveValueToText(std::ostream* os,
       }
     }
   }
+  if (mode == SaveMode::base || mode == SaveMode::delta) {
+    block->dirty_keys_.clear();
+  }
 
   if (mode != 1) {
+    WaitWriteBack(shard_id);
     int value_size = block->value_length_;
     auto* it = _db->get_iterator(shard_id);
 
     for (it->SeekToFirst(); it->Valid(); it->Next()) {
+      // rows admitted back into memory are already saved above
+      auto key = *reinterpret_cast<const uint64_t*>(it->key().data());
+      if (block->Find(key) != block->end()) {
+        continue;
+      }
       float* value = (float*)const_cast<char*>(it->value().data());
       std::stringstream ss;
       ss << *((uint64_t*)const_cast<char*>(it->key().data())) << "\t"
@@ -304,9 +572,7 @@ int64_t SSDSparseTable::LoadFromText(
   std::ifstream file(valuepath);
   std::string line;
 
-  int value_size = shard_values_[0]->value_length_;
-  int db_size = 3 + value_size;
-  float tmp_value[db_size];
+  std::string db_value;
 
   while (std::getline(file, line)) {
     auto values = paddle::string::split_string<std::string>(line, "\t");
@@ -342,14 +608,10 @@ int64_t SSDSparseTable::LoadFromText(
     VLOG(3) << "loading: " << id
             << "unseen day: " << value_instant->unseen_days_;
     if (value_instant->unseen_days_ >= 1) {
-      tmp_value[value_size] = value_instant->count_;
-      tmp_value[value_size + 1] = value_instant->unseen_days_;
-      tmp_value[value_size + 2] = value_instant->is_entry_;
-      memcpy(tmp_value, value_instant->data_.data(),
-             sizeof(float) * value_size);
-      _db->put(shard_id, (char*)&(id), sizeof(uint64_t), (char*)tmp_value,
-               db_size * sizeof(float));
-      block->erase(id);
+      ToDBValue(value_instant, &db_value);
+      _db->put(shard_id, (char*)&(id), sizeof(uint64_t), db_value.data(),
+               db_value.size());
+      block->erase(id, false);
     }
   }
 
@@ -13,15 +13,22 @@
 // limitations under the License.
 
 #pragma once
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "paddle/fluid/distributed/table/common_sparse_table.h"
 #include "paddle/fluid/distributed/table/depends/rocksdb_warpper.h"
+
+#include <gtest/gtest_prod.h>
 #ifdef PADDLE_WITH_HETERPS
 namespace paddle {
 namespace distributed {
 class SSDSparseTable : public CommonSparseTable {
  public:
   SSDSparseTable() {}
-  virtual ~SSDSparseTable() {}
+  virtual ~SSDSparseTable();
 
   virtual int32_t initialize() override;
 
@@ -30,7 +37,7 @@ class SSDSparseTable : public CommonSparseTable {
 
   int64_t SaveValueToText(std::ostream* os, std::shared_ptr<ValueBlock> block,
                           std::shared_ptr<::ThreadPool> pool, const int mode,
-                          int shard_id);
+                          int shard_id) override;
 
   virtual int64_t LoadFromText(
       const std::string& valuepath, const std::string& metapath,
@@ -47,13 +54,50 @@ class SSDSparseTable : public CommonSparseTable {
   virtual int32_t pull_sparse_ptr(char** pull_values, const uint64_t* keys,
                                   size_t num);
 
-  virtual int32_t flush() override { return 0; }
+  virtual int32_t flush() override;
   virtual int32_t shrink(const std::string& param) override;
   virtual void clear() override {}
 
+ protected:
+  virtual int32_t _push_sparse(const uint64_t* keys, const float* values,
+                               size_t num) override;
+  virtual int32_t _push_sparse(const uint64_t* keys, const float** values,
+                               size_t num) override;
+
  private:
+  // rows evicted from memory, kept readable until rocksdb has them
+  struct WriteBackBatch {
+    std::unordered_map<uint64_t, std::string> rows;
+    std::future<int> done;
+  };
+
+  // the rows of keys that are not in memory are looked up in the write back
+  // buffer, then in rocksdb with one MultiGet, and admitted into the block.
+  // keys absent from both are created. is_new[i] tells which ones.
+  void LoadMisses(int shard_id, const std::vector<uint64_t>& keys,
+                  std::vector<VALUE*>* values, std::vector<bool>* is_new);
+
+  // brings back the rows of keys[offsets] evicted since they were pulled,
+  // before they are pushed.
+  void ReloadEvicted(int shard_id, const uint64_t* keys,
+                     const std::vector<uint64_t>& offsets);
+
+  // evicts rows of the shard until at most max_rows are left, rows unseen
+  // for days go first (all of them when evict_unseen), then the least
+  // frequent ones. evicted rows are written back to rocksdb asynchronously.
+  int64_t Evict(int shard_id, size_t max_rows, bool evict_unseen);
+
+  void WaitWriteBack(int shard_id);
+  FRIEND_TEST(SSDSparseTable, WriteBackFreed);
+
+  void ToDBValue(const VALUE* value, std::string* db_value);
+  void FromDBValue(const std::string& db_value, VALUE* value);
+
   RocksDBHandler* _db;
+  // max rows per shard in memory, 0 means unlimited
   int64_t _cache_tk_size;
+  std::vector<std::deque<std::shared_ptr<WriteBackBatch>>> _write_back;
+  std::vector<std::shared_ptr<::ThreadPool>> _write_back_pool;
 };
 
 }  // namespace ps
@@ -0,0 +1,72 @@
+/* Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <random>
+#include <unordered_map>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/table/depends/flat_hash_map.h"
+
+namespace paddle {
+namespace distributed {
+
+TEST(FlatHashMap, InsertFindErase) {
+  FlatHashMap<uint64_t, uint64_t> map;
+  std::unordered_map<uint64_t, uint64_t> expect;
+  std::mt19937_64 rng(0);
+
+  for (int i = 0; i < 200000; ++i) {
+    uint64_t key = rng() % 20000;
+    if (rng() % 3 != 0) {
+      map[key] = key * 2;
+      expect[key] = key * 2;
+    } else {
+      auto iter = map.find(key);
+      ASSERT_EQ(iter != map.end(), expect.count(key) == 1);
+      if (iter != map.end()) {
+        map.erase(iter);
+        expect.erase(key);
+      }
+    }
+  }
+
+  ASSERT_EQ(map.size(), expect.size());
+  size_t visited = 0;
+  for (auto &pair : map) {
+    ASSERT_EQ(expect.at(pair.first), pair.second);
+    ++visited;
+  }
+  ASSERT_EQ(visited, expect.size());
+}
+
+TEST(FlatHashMap, EraseWhileIterating) {
+  FlatHashMap<uint64_t, uint64_t> map;
+  for (uint64_t key = 0; key < 1000; ++key) {
+    map[key] = key;
+  }
+  for (auto iter = map.begin(); iter != map.end();) {
+    if (iter->first % 2 == 1) {
+      iter = map.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+  ASSERT_EQ(map.size(), 500);
+  for (uint64_t key = 0; key < 1000; ++key) {
+    ASSERT_EQ(map.count(key), key % 2 == 0 ? 1 : 0);
+  }
+}
+
+}  // namespace distributed
+}  // namespace paddle
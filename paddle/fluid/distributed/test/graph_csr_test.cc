@@ -0,0 +1,177 @@
+/* Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/table/graph/graph_csr.h"
+#include "paddle/fluid/distributed/table/graph/graph_edge.h"
+#include "paddle/fluid/distributed/table/graph/graph_weighted_sampler.h"
+
+namespace paddle {
+namespace distributed {
+
+static void CheckSample(const std::vector<int> &res, int k, size_t degree) {
+  ASSERT_EQ(res.size(), std::min((size_t)k, degree));
+  std::set<int> distinct(res.begin(), res.end());
+  ASSERT_EQ(distinct.size(), res.size());
+  for (int idx : res) {
+    ASSERT_GE(idx, 0);
+    ASSERT_LT((size_t)idx, degree);
+  }
+}
+
+TEST(GraphCSR, rows) {
+  GraphCSR csr(true);
+  std::vector<uint64_t> ids = {7, 8, 9};
+  std::vector<float> weights = {1, 2, 3};
+  ASSERT_EQ(csr.add_row(ids.data(), weights.data(), 3), 0);
+  ASSERT_EQ(csr.add_row(nullptr, nullptr, 0), 1);
+  ASSERT_EQ(csr.add_row(ids.data(), nullptr, 2), 2);
+  ASSERT_EQ(csr.get_row_num(), 3UL);
+  ASSERT_EQ(csr.get_edge_num(), 5UL);
+  ASSERT_EQ(csr.degree(0), 3UL);
+  ASSERT_EQ(csr.degree(1), 0UL);
+  ASSERT_EQ(csr.get_neighbor_id(0, 2), 9UL);
+  ASSERT_EQ(csr.get_neighbor_weight(0, 1), 2);
+  ASSERT_EQ(csr.get_neighbor_id(2, 1), 8UL);
+  ASSERT_EQ(csr.get_neighbor_weight(2, 1), 1);
+
+  std::mt19937_64 rng(0);
+  std::vector<int> res;
+  csr.sample_k(0, 5, rng, &res);
+  ASSERT_EQ(res, std::vector<int>({0, 1, 2}));
+  csr.sample_k(1, 5, rng, &res);
+  ASSERT_TRUE(res.empty());
+
+  char buffer[3 * (sizeof(uint64_t) + sizeof(float))];
+  ASSERT_EQ(csr.sample_k(0, 3, rng, buffer), 3);
+  for (int i = 0; i < 3; i++) {
+    uint64_t id;
+    float weight;
+    memcpy(&id, buffer + i * 12, sizeof(uint64_t));
+    memcpy(&weight, buffer + i * 12 + 8, sizeof(float));
+    ASSERT_EQ(id, ids[i]);
+    ASSERT_EQ(weight, weights[i]);
+  }
+
+  csr.clear();
+  ASSERT_EQ(csr.get_row_num(), 0UL);
+}
+
+TEST(GraphCSR, sample_uniform) {
+  const size_t degree = 100;
+  std::vector<uint64_t> ids(degree);
+  for (size_t i = 0; i < degree; i++) ids[i] = i;
+  GraphCSR csr;
+  csr.add_row(ids.data(), nullptr, degree);
+  std::mt19937_64 rng(1);
+  std::vector<int> res;
+  const int round = 20000;
+  for (int k : {1, 10, 60}) {
+    std::vector<int> counts(degree, 0);
+    for (int r = 0; r < round; r++) {
+      csr.sample_k(0, k, rng, &res);
+      CheckSample(res, k, degree);
+      for (int idx : res) counts[idx]++;
+    }
+    double expected = (double)round * k / degree;
+    for (int count : counts) {
+      ASSERT_NEAR(count, expected, 5 * std::sqrt(expected));
+    }
+  }
+}
+
+// the neighbors are taken as often as the tree sampler takes them
+TEST(GraphCSR, sample_weighted) {
+  const int round = 20000;
+  std::mt19937_64 rng(2);
+  auto sampler_rng = std::make_shared<std::mt19937_64>(3);
+  for (bool skewed : {false, true}) {
+    const size_t degree = 40;
+    std::vector<uint64_t> ids(degree);
+    std::vector<float> weights(degree);
+    WeightedGraphEdgeBlob edges;
+    for (size_t i = 0; i < degree; i++) {
+      ids[i] = i;
+      weights[i] = skewed && i < 3 ? 1000 : 1 + i % 7;
+      edges.add_edge(ids[i], weights[i]);
+    }
+    GraphCSR csr(true);
+    csr.add_row(ids.data(), weights.data(), degree);
+    WeightedSampler sampler;
+    sampler.build(&edges);
+
+    std::vector<int> res;
+    for (int k : {1, 5, 25}) {
+      std::vector<int> counts(degree, 0), expected(degree, 0);
+      for (int r = 0; r < round; r++) {
+        csr.sample_k(0, k, rng, &res);
+        CheckSample(res, k, degree);
+        for (int idx : res) counts[idx]++;
+        for (int idx : sampler.sample_k(k, sampler_rng)) expected[idx]++;
+      }
+      for (size_t i = 0; i < degree; i++) {
+        ASSERT_NEAR(counts[i], expected[i], 6 * std::sqrt(expected[i]) + 20)
+            << "neighbor " << i << ", k " << k << ", skewed " << skewed;
+      }
+    }
+  }
+}
+
+// Not a pass / fail test, run it by --gtest_also_run_disabled_tests.
+TEST(GraphCSR, DISABLED_benchmark) {
+  const size_t degree = 1000;
+  const int k = 10, round = 100000;
+  std::vector<uint64_t> ids(degree);
+  std::vector<float> weights(degree);
+  WeightedGraphEdgeBlob edges;
+  for (size_t i = 0; i < degree; i++) {
+    ids[i] = i;
+    weights[i] = 1 + i % 13;
+    edges.add_edge(ids[i], weights[i]);
+  }
+  GraphCSR csr(true);
+  csr.add_row(ids.data(), weights.data(), degree);
+  WeightedSampler sampler;
+  sampler.build(&edges);
+  std::mt19937_64 rng(0);
+  auto sampler_rng = std::make_shared<std::mt19937_64>(0);
+  std::vector<int> res;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < round; r++) {
+    sampler.sample_k(k, sampler_rng);
+  }
+  auto middle = std::chrono::steady_clock::now();
+  for (int r = 0; r < round; r++) {
+    csr.sample_k(0, k, rng, &res);
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  auto ms = [](std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+  LOG(INFO) << round << " weighted samples of " << k << " from " << degree
+            << " neighbors: tree " << ms(middle - start) << " ms, alias "
+            << ms(end - middle) << " ms";
+}
+
+}  // namespace distributed
+}  // namespace paddle
@@ -18,6 +18,7 @@ limitations under the License. */
 #include <iomanip>
 #include <string>
 #include <thread>  // NOLINT
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 #include "google/protobuf/text_format.h"
@@ -546,6 +547,34 @@ void RunBrpcPushSparse() {
   vs = client1.batch_sample_neighboors(std::string("user2item"), node_ids, 4);
 
   ASSERT_EQ(vs.size(), 2);
+
+  // Test multi hop sampling, the reversed edges lead from the items back to
+  // the users and the nodes of both hops are spread over the two servers
+  client1.load_edge_file(std::string("user2item"), std::string(edge_file_name),
+                         1);
+  std::unordered_map<uint64_t, std::unordered_set<uint64_t>> item_users = {
+      {45, {37, 59}},  {145, {37, 59}}, {112, {37}},     {48, {96, 97}},
+      {247, {96, 97}}, {111, {96, 97}}, {122, {59}}};
+  auto hops = client1.batch_sample_multi_hop_neighboors(
+      std::string("user2item"), node_ids, std::vector<int>({2, 3}));
+  ASSERT_EQ(hops.size(), 2);
+  ASSERT_EQ(hops[0].size(), 2);
+  std::vector<uint64_t> hop_items;
+  for (auto& neighbors : hops[0]) {
+    ASSERT_EQ(neighbors.size(), 2);
+    for (auto& neighbor : neighbors) {
+      ASSERT_EQ(item_users.count(neighbor.first), 1);
+      hop_items.push_back(neighbor.first);
+    }
+  }
+  ASSERT_EQ(hops[1].size(), hop_items.size());
+  for (size_t i = 0; i < hop_items.size(); i++) {
+    auto& users = item_users[hop_items[i]];
+    ASSERT_EQ(hops[1][i].size(), users.size());
+    for (auto& neighbor : hops[1][i]) {
+      ASSERT_EQ(users.count(neighbor.first), 1);
+    }
+  }
   std::vector<uint64_t> nodes_ids = client2.random_sample_nodes("user", 0, 6);
   ASSERT_EQ(nodes_ids.size(), 2);
   ASSERT_EQ(true, (nodes_ids[0] == 59 && nodes_ids[1] == 37) ||
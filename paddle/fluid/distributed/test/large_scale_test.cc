@@ -15,6 +15,7 @@ limitations under the License. */
 #include <ThreadPool.h>
 
 #include <unistd.h>
+#include <unordered_map>
 #include <string>
 #include <thread>  // NOLINT
 
@@ -67,5 +68,55 @@ TEST(BENCHMARK, LargeScaleKV) {
   ASSERT_EQ(ret, 0);
 }
 
+TEST(ValueBlock, SlabStorage) {
+  std::vector<std::string> value_names = {"Param", "LearningRate"};
+  std::vector<int> value_dims = {8, 1};
+  std::vector<int> value_offsets = {0, 8};
+  std::unordered_map<std::string, int> value_idx = {{"Param", 0},
+                                                    {"LearningRate", 1}};
+  std::vector<std::string> init_attrs = {"fill_constant&0.5",
+                                         "fill_constant&1.0"};
+
+  ValueBlock block(value_names, value_dims, value_offsets, value_idx,
+                   init_attrs, "none", "slab:16");
+  ASSERT_TRUE(block.IsSlab());
+
+  for (uint64_t id = 0; id < 100; ++id) {
+    auto *value = block.Init(id);
+    ASSERT_FLOAT_EQ(value[0], 0.5);
+    ASSERT_FLOAT_EQ(value[8], 1.0);
+    value[0] = static_cast<float>(id);
+  }
+
+  for (uint64_t id = 0; id < 100; ++id) {
+    auto *value = block.GetValue(id);
+    ASSERT_TRUE(value->is_inline_);
+    ASSERT_EQ(value->count_, 1);
+    ASSERT_FLOAT_EQ(value->data_[0], static_cast<float>(id));
+  }
+
+  std::vector<uint64_t> keys = {3, 200, 5, 201};
+  std::vector<uint32_t> counters = {1, 1, 1, 1};
+  std::vector<int> offsets = {0, 1, 2, 3};
+  std::vector<float *> values;
+  block.InitBatch(keys.data(), counters.data(), offsets, true, &values);
+  ASSERT_EQ(values.size(), keys.size());
+  ASSERT_FLOAT_EQ(values[0][0], 3.0);
+  ASSERT_FLOAT_EQ(values[1][0], 0.5);
+  ASSERT_EQ(block.GetValue(5)->count_, 2);
+
+  // freed slots are reused and come back zeroed
+  block.erase(7);
+  auto *value = block.InitGet(1000);
+  ASSERT_EQ(value->count_, 0);
+  ASSERT_FALSE(value->is_entry_);
+  ASSERT_FLOAT_EQ(value->data_[0], 0.0);
+
+  block.Shrink(1);
+  for (auto &table : block.values_) {
+    ASSERT_EQ(table.size(), 0);
+  }
+}
+
 }  // namespace distributed
 }  // namespace paddle
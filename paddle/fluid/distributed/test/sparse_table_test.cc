@@ -20,6 +20,7 @@ limitations under the License. */
 
 #include "google/protobuf/text_format.h"
 #include "gtest/gtest.h"
+#include "paddle/fluid/distributed/common/sparse_snapshot_merge.h"
 #include "paddle/fluid/distributed/ps.pb.h"
 #include "paddle/fluid/distributed/table/common_dense_table.h"
 #include "paddle/fluid/distributed/table/common_sparse_table.h"
@@ -219,5 +220,159 @@ TEST(CommonSparseTable, Adam) {
   }
 }
 
+// CommonSparseTable binary snapshot
+TEST(CommonSparseTable, BinarySaveLoad) {
+  int emb_dim = 10;
+
+  TableParameter table_config;
+  table_config.set_table_class("CommonSparseTable");
+  table_config.set_save_format("binary");
+  FsClientParameter fs_config;
+  TableAccessorParameter *accessor_config = table_config.mutable_accessor();
+  accessor_config->set_accessor_class("CommMergeAccessor");
+  accessor_config->set_fea_dim(0);
+  CommonAccessorParameter *common_config = table_config.mutable_common();
+  common_config->set_name("sgd");
+  common_config->set_table_name("binary_test_table");
+  common_config->set_entry("none");
+  common_config->set_trainer_num(1);
+  common_config->add_params("Param");
+  common_config->add_dims(emb_dim);
+  common_config->add_initializers("uniform_random&0&-1.0&1.0");
+  common_config->add_params("LearningRate");
+  common_config->add_dims(1);
+  common_config->add_initializers("fill_constant&1.0");
+
+  std::unique_ptr<Table> table(new CommonSparseTable());
+  table->set_shard(0, 1);
+  ASSERT_EQ(table->initialize(table_config, fs_config), 0);
+
+  std::vector<uint64_t> keys;
+  std::vector<uint32_t> fres;
+  for (uint64_t id = 0; id < 1000; ++id) {
+    keys.push_back(id * 7);
+    fres.push_back(1);
+  }
+  std::vector<float> saved(keys.size() * emb_dim);
+  auto pull_value = PullSparseValue(keys, fres, emb_dim);
+  table->pull_sparse(saved.data(), pull_value);
+  ASSERT_EQ(table->save("./binary_test_dir", "0"), 0);
+
+  std::unique_ptr<Table> loaded(new CommonSparseTable());
+  loaded->set_shard(0, 1);
+  ASSERT_EQ(loaded->initialize(table_config, fs_config), 0);
+  ASSERT_EQ(loaded->load("./binary_test_dir", "0"), 0);
+  ASSERT_EQ(loaded->print_table_stat().first, keys.size());
+
+  std::vector<float> restored(keys.size() * emb_dim);
+  loaded->pull_sparse(restored.data(), pull_value);
+  for (size_t i = 0; i < saved.size(); ++i) {
+    ASSERT_FLOAT_EQ(saved[i], restored[i]);
+  }
+}
+
+// CommonSparseTable delta snapshot merged into its base
+TEST(CommonSparseTable, DeltaSaveMerge) {
+  int emb_dim = 4;
+
+  TableParameter table_config;
+  table_config.set_table_class("CommonSparseTable");
+  table_config.set_save_format("binary");
+  FsClientParameter fs_config;
+  TableAccessorParameter *accessor_config = table_config.mutable_accessor();
+  accessor_config->set_accessor_class("CommMergeAccessor");
+  accessor_config->set_fea_dim(0);
+  CommonAccessorParameter *common_config = table_config.mutable_common();
+  common_config->set_name("sgd");
+  common_config->set_table_name("delta_test_table");
+  common_config->set_entry("none");
+  common_config->set_trainer_num(1);
+  common_config->add_params("Param");
+  common_config->add_dims(emb_dim);
+  common_config->add_initializers("uniform_random&0&-1.0&1.0");
+  common_config->add_params("LearningRate");
+  common_config->add_dims(1);
+  common_config->add_initializers("fill_constant&1.0");
+
+  std::unique_ptr<Table> table(new CommonSparseTable());
+  table->set_shard(0, 1);
+  ASSERT_EQ(table->initialize(table_config, fs_config), 0);
+
+  std::vector<uint64_t> base_keys = {0, 1, 2, 3, 4, 5, 6, 7};
+  std::vector<uint32_t> base_fres(base_keys.size(), 1);
+  std::vector<float> values(base_keys.size() * emb_dim);
+  auto base_pull = PullSparseValue(base_keys, base_fres, emb_dim);
+  table->pull_sparse(values.data(), base_pull);
+  ASSERT_EQ(table->save("./delta_test_base", "1"), 0);
+
+  // touch two old rows, add two new ones and update one of them
+  std::vector<uint64_t> delta_keys = {1, 2, 100, 101};
+  std::vector<uint32_t> delta_fres(delta_keys.size(), 1);
+  auto delta_pull = PullSparseValue(delta_keys, delta_fres, emb_dim);
+  table->pull_sparse(values.data(), delta_pull);
+  std::vector<float> grads(delta_keys.size() * emb_dim, 0.5);
+  table->push_sparse(delta_keys.data(), grads.data(), delta_keys.size());
+  ASSERT_EQ(table->save("./delta_test_delta", "2"), 0);
+
+  SnapshotMerge merge;
+  auto rows = merge.MergeDirs(
+      {"./delta_test_base/delta_test_table.shard",
+       "./delta_test_delta/delta_test_table.shard"},
+      "./delta_test_merged/delta_test_table.shard", 4);
+  ASSERT_EQ(rows, base_keys.size() + 2);
+
+  std::unique_ptr<Table> loaded(new CommonSparseTable());
+  loaded->set_shard(0, 1);
+  ASSERT_EQ(loaded->initialize(table_config, fs_config), 0);
+  ASSERT_EQ(loaded->load("./delta_test_merged", "0"), 0);
+  ASSERT_EQ(loaded->print_table_stat().first, base_keys.size() + 2);
+
+  std::vector<uint64_t> all_keys = {0, 1, 2, 3, 4, 5, 6, 7, 100, 101};
+  std::vector<uint32_t> all_fres(all_keys.size(), 1);
+  auto all_pull = PullSparseValue(all_keys, all_fres, emb_dim);
+  all_pull.is_training_ = false;
+  std::vector<float> expect(all_keys.size() * emb_dim);
+  std::vector<float> restored(all_keys.size() * emb_dim);
+  table->pull_sparse(expect.data(), all_pull);
+  loaded->pull_sparse(restored.data(), all_pull);
+  for (size_t i = 0; i < expect.size(); ++i) {
+    ASSERT_FLOAT_EQ(expect[i], restored[i]);
+  }
+}
+
+// the deltas merged into a base should be of its value length and shard
+TEST(CommonSparseTable, DeltaMergeMismatch) {
+  auto write_header = [](const std::string &path, uint32_t kind,
+                         uint32_t value_length, uint32_t shard_num) {
+    SparseSnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SPARSE_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SPARSE_SNAPSHOT_VERSION;
+    header.value_length = value_length;
+    header.record_size = SparseSnapshotRecordSize(value_length);
+    header.shard_num = shard_num;
+    header.kind = kind;
+    FILE *fp = fopen(path.c_str(), "wb");
+    ASSERT_NE(fp, nullptr);
+    fwrite(&header, sizeof(header), 1, fp);
+    fclose(fp);
+  };
+  write_header("./mismatch_base.bin", kSnapshotBase, 4, 1);
+  write_header("./mismatch_delta.bin", kSnapshotDelta, 4, 1);
+  write_header("./mismatch_dims.bin", kSnapshotDelta, 8, 1);
+  write_header("./mismatch_shards.bin", kSnapshotDelta, 4, 2);
+
+  SnapshotMerge merge;
+  ASSERT_EQ(merge.Merge({"./mismatch_base.bin", "./mismatch_delta.bin"},
+                        "./mismatch_merged.bin"),
+            0);
+  for (auto delta : {"./mismatch_dims.bin", "./mismatch_shards.bin",
+                     "./mismatch_base.bin"}) {
+    EXPECT_THROW(
+        merge.Merge({"./mismatch_base.bin", delta}, "./mismatch_merged.bin"),
+        paddle::platform::EnforceNotMet);
+  }
+}
+
 }  // namespace distributed
 }  // namespace paddle
@@ -0,0 +1,139 @@
+/* Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "gtest/gtest.h"
+#include "paddle/fluid/distributed/ps.pb.h"
+#include "paddle/fluid/distributed/table/ssd_sparse_table.h"
+#include "paddle/fluid/distributed/table/table.h"
+
+DECLARE_string(rocksdb_path);
+DECLARE_int64(ssd_sparse_table_cache_rows);
+
+namespace paddle {
+namespace distributed {
+
+static std::unique_ptr<SSDSparseTable> MakeTable(int emb_dim,
+                                                 const std::string &db_path,
+                                                 int64_t cache_rows) {
+  FLAGS_rocksdb_path = db_path;
+  FLAGS_ssd_sparse_table_cache_rows = cache_rows;
+
+  TableParameter table_config;
+  table_config.set_table_class("SSDSparseTable");
+  FsClientParameter fs_config;
+  TableAccessorParameter *accessor_config = table_config.mutable_accessor();
+  accessor_config->set_accessor_class("CommMergeAccessor");
+  accessor_config->set_fea_dim(0);
+  CommonAccessorParameter *common_config = table_config.mutable_common();
+  common_config->set_name("sgd");
+  common_config->set_table_name("ssd_test_table");
+  common_config->set_entry("none");
+  common_config->set_trainer_num(1);
+  common_config->add_params("Param");
+  common_config->add_dims(emb_dim);
+  common_config->add_initializers("uniform_random&0&-1.0&1.0");
+  common_config->add_params("LearningRate");
+  common_config->add_dims(1);
+  common_config->add_initializers("fill_constant&1.0");
+
+  std::unique_ptr<SSDSparseTable> table(new SSDSparseTable());
+  table->set_shard(0, 1);
+  EXPECT_EQ(table->initialize(table_config, fs_config), 0);
+  return table;
+}
+
+// SSDSparseTable + SGD, pushed after the rows are evicted to rocksdb
+TEST(SSDSparseTable, PushEvicted) {
+  int emb_dim = 4;
+  auto table = MakeTable(emb_dim, "./ssd_test_db", 1);
+
+  std::vector<uint64_t> keys;
+  std::vector<uint32_t> fres;
+  for (uint64_t id = 0; id < 100; ++id) {
+    keys.push_back(id);
+    fres.push_back(1);
+  }
+  std::vector<float> init_values(keys.size() * emb_dim);
+  auto pull_value = PullSparseValue(keys, fres, emb_dim);
+  table->pull_sparse(init_values.data(), pull_value);
+
+  // at most one row of each shard is left in memory
+  ASSERT_EQ(table->update_table(), 0);
+  auto rows_in_memory = table->print_table_stat().first;
+  ASSERT_LT(static_cast<size_t>(rows_in_memory), keys.size());
+
+  std::vector<std::vector<float>> grads(keys.size());
+  std::vector<const float *> grad_ptrs;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    grads[i].assign(emb_dim, 0.01 * i);
+    grad_ptrs.push_back(grads[i].data());
+  }
+  table->push_sparse(keys.data(), grad_ptrs.data(), keys.size());
+
+  pull_value.is_training_ = false;
+  std::vector<float> pull_values(keys.size() * emb_dim);
+  table->pull_sparse(pull_values.data(), pull_value);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    for (int k = 0; k < emb_dim; ++k) {
+      ASSERT_NEAR(init_values[i * emb_dim + k] - grads[i][k],
+                  pull_values[i * emb_dim + k], 1e-5);
+    }
+  }
+}
+
+// the batches written back are freed once rocksdb has them
+TEST(SSDSparseTable, WriteBackFreed) {
+  int emb_dim = 4;
+  auto table = MakeTable(emb_dim, "./ssd_write_back_db", 0);
+
+  std::vector<uint64_t> keys;
+  std::vector<uint32_t> fres;
+  for (uint64_t id = 0; id < 100; ++id) {
+    keys.push_back(id);
+    fres.push_back(1);
+  }
+  std::vector<float> init_values(keys.size() * emb_dim);
+  auto pull_value = PullSparseValue(keys, fres, emb_dim);
+  table->pull_sparse(init_values.data(), pull_value);
+
+  std::vector<std::weak_ptr<SSDSparseTable::WriteBackBatch>> batches;
+  for (size_t shard_id = 0; shard_id < table->_write_back.size();
+       ++shard_id) {
+    if (table->Evict(shard_id, 0, false) > 0) {
+      batches.push_back(table->_write_back[shard_id].back());
+    }
+    table->WaitWriteBack(shard_id);
+  }
+  ASSERT_FALSE(batches.empty());
+  for (auto &batch : batches) {
+    EXPECT_TRUE(batch.expired());
+  }
+  EXPECT_EQ(table->print_table_stat().first, 0);
+
+  // the evicted rows are read back from rocksdb
+  pull_value.is_training_ = false;
+  std::vector<float> pull_values(keys.size() * emb_dim);
+  table->pull_sparse(pull_values.data(), pull_value);
+  for (size_t i = 0; i < init_values.size(); ++i) {
+    ASSERT_NEAR(init_values[i], pull_values[i], 1e-5);
+  }
+}
+
+}  // namespace distributed
+}  // namespace paddle
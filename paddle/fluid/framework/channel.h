@@ -21,6 +21,7 @@
 
 #include <glog/logging.h>
 #include <algorithm>
+#include <atomic>
 #include <condition_variable>  // NOLINT
 #include <deque>
 #include <limits>
@@ -43,13 +44,38 @@ class ChannelObject {
     capacity_ = (std::min)(MaxCapacity(), capacity);
   }
 
-  const std::deque<T>& GetData() const { return data_; }
+  // With shard_num > 1 the data is split over shard_num queues with a lock
+  // each. A writer puts a whole block into the queue of its thread and a
+  // reader takes from the queue of its thread first, then from the others,
+  // so that threads seldom meet on a lock; the channel mutex is only taken
+  // to sleep when it is empty or full. Data is not FIFO across threads.
+  ChannelObject(size_t capacity, size_t shard_num) : ChannelObject(capacity) {
+    if (shard_num > 1) {
+      shard_num_ = shard_num;
+      shards_.reset(new Shard[shard_num]);
+    }
+  }
+
+  // A sharded channel first moves all of its data into the first shard, which
+  // the readers of every thread still take from.
+  const std::deque<T>& GetData() const {
+    if (shard_num_ != 0) {
+      return GatherShards();
+    }
+    return data_;
+  }
   void Clear() {
+    if (shard_num_ != 0) {
+      ClearShards();
+      return;
+    }
     std::unique_lock<std::mutex> lock(mutex_);
     data_.clear();
     data_.shrink_to_fit();
   }
 
+  size_t ShardNum() { return shard_num_ == 0 ? 1 : shard_num_; }
+
   size_t Capacity() {
     return capacity_;  // atomic
   }
@@ -57,6 +83,10 @@ class ChannelObject {
   void SetCapacity(size_t x) {  // capacity can be zero
     std::lock_guard<std::mutex> lock(mutex_);
     capacity_ = std::min(MaxCapacity(), x);
+    if (shard_num_ != 0) {
+      full_cond_.notify_all();
+      return;
+    }
     Notify();
   }
 
@@ -85,22 +115,35 @@ class ChannelObject {
   void Open() {
     std::lock_guard<std::mutex> lock(mutex_);
     closed_ = false;
-    Notify();
+    if (shard_num_ == 0) {
+      Notify();
+    }
   }
 
   // close channel, then no more data can be write() to channel
   void Close() {
     std::lock_guard<std::mutex> lock(mutex_);
     closed_ = true;
+    if (shard_num_ != 0) {
+      empty_cond_.notify_all();
+      full_cond_.notify_all();
+      return;
+    }
     Notify();
   }
 
   size_t Size() {
+    if (shard_num_ != 0) {
+      return ready_;  // atomic
+    }
     std::lock_guard<std::mutex> lock(mutex_);
     return data_.size();
   }
 
   bool Empty() {
+    if (shard_num_ != 0) {
+      return ready_ == 0;  // atomic
+    }
     std::lock_guard<std::mutex> lock(mutex_);
     return EmptyUnlocked();
   }
@@ -114,6 +157,9 @@ class ChannelObject {
     if (n == 0) {
       return 0;
     }
+    if (shard_num_ != 0) {
+      return ReadShards(n, p, false);
+    }
 
     std::unique_lock<std::mutex> lock(mutex_);
     size_t finished = Read(n, p, lock);
@@ -133,6 +179,9 @@ class ChannelObject {
     if (n == 0) {
       return 0;
     }
+    if (shard_num_ != 0) {
+      return WriteShards(n, p, [](const T& val) -> const T& { return val; });
+    }
     std::unique_lock<std::mutex> lock(mutex_);
     size_t finished = Write(n, p, lock);
     Notify();
@@ -144,6 +193,9 @@ class ChannelObject {
     if (n == 0) {
       return 0;
     }
+    if (shard_num_ != 0) {
+      return WriteShards(n, p, [](T& val) -> T&& { return std::move(val); });
+    }
     std::unique_lock<std::mutex> lock(mutex_);
     size_t finished = WriteMove(n, p, lock);
     Notify();
@@ -162,6 +214,12 @@ class ChannelObject {
     if (size == 0) {
       return 0;
     }
+    if (shard_num_ != 0) {
+      p.resize(size);
+      size_t finished = ReadShards(size, &p[0], true);
+      p.resize(finished);
+      return finished;
+    }
     std::unique_lock<std::mutex> lock(mutex_);
     p.resize(size);
     size_t finished = Read(size, &p[0], lock, true);
@@ -192,9 +250,15 @@ class ChannelObject {
   size_t Write(std::vector<T>&& p) { return WriteMove(p.size(), &p[0]); }
 
  private:
-  size_t capacity_ = MaxCapacity();
+  struct Shard {
+    std::mutex mutex;
+    std::deque<T> data;
+    std::atomic<size_t> size{0};
+  };
+
+  std::atomic<size_t> capacity_{MaxCapacity()};
   size_t block_size_ = 1024;
-  bool closed_ = false;
+  std::atomic<bool> closed_{false};
   std::mutex mutex_;
   // use deque to store data
   std::deque<T> data_;
@@ -204,6 +268,19 @@ class ChannelObject {
   std::condition_variable empty_cond_;
   std::condition_variable full_cond_;
 
+  // only used by sharded channel, the channel mutex and conditions above are
+  // then only taken by the threads going to sleep and those waking them
+  size_t shard_num_ = 0;
+  std::unique_ptr<Shard[]> shards_;
+  // data in the shards, and data in the shards or being written to them,
+  // which is what the capacity bounds
+  std::atomic<size_t> ready_{0};
+  std::atomic<size_t> reserved_{0};
+  std::atomic<size_t> sharded_reading_{0};
+  std::atomic<size_t> writing_{0};
+  std::atomic<int> sharded_empty_waiters_{0};
+  std::atomic<int> sharded_full_waiters_{0};
+
   static constexpr size_t MaxCapacity() {
     return (std::numeric_limits<size_t>::max)() / 2;
   }
@@ -300,6 +377,167 @@ class ChannelObject {
     }
     return finished;
   }
+
+  size_t HomeShard() {
+    static std::atomic<size_t> next_thread{0};
+    static thread_local size_t thread_id = next_thread++;
+    return thread_id % shard_num_;
+  }
+
+  // reserves room for at most n values, 0 if the channel is full
+  size_t ReserveShards(size_t n) {
+    size_t reserved = reserved_.load();
+    while (true) {
+      size_t limit = capacity_ + sharded_reading_;
+      if (reserved >= limit) {
+        return 0;
+      }
+      size_t m = (std::min)(n, limit - reserved);
+      if (reserved_.compare_exchange_weak(reserved, reserved + m)) {
+        return m;
+      }
+    }
+  }
+
+  void WakeShardReaders() {
+    if (sharded_empty_waiters_ != 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      empty_cond_.notify_all();
+    }
+  }
+
+  void WakeShardWriters() {
+    if (sharded_full_waiters_ != 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      full_cond_.notify_all();
+    }
+  }
+
+  // writing_ lets the readers tell a closed channel from one a writer that
+  // passed the closed check is still filling
+  template <class Value, class Get>
+  size_t WriteShards(size_t n, Value* p, Get get) {
+    Shard& shard = shards_[HomeShard()];
+    size_t finished = 0;
+    while (finished < n) {
+      writing_++;
+      if (closed_) {
+        writing_--;
+        WakeShardReaders();
+        break;
+      }
+      size_t m = ReserveShards(n - finished);
+      if (m == 0) {
+        writing_--;
+        std::unique_lock<std::mutex> lock(mutex_);
+        sharded_full_waiters_++;
+        full_cond_.wait(lock, [this] {
+          return closed_ || reserved_ < capacity_ + sharded_reading_;
+        });
+        sharded_full_waiters_--;
+        continue;
+      }
+      {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (size_t i = 0; i < m; i++) {
+          shard.data.push_back(get(p[finished++]));
+        }
+        shard.size += m;
+        // before the shard is unlocked, so that ready_ never goes below the
+        // data the readers can see
+        ready_ += m;
+      }
+      writing_--;
+      WakeShardReaders();
+    }
+    return finished;
+  }
+
+  // moves at most n values of the first non empty shards to p
+  size_t TakeFromShards(size_t n, T* p) {
+    size_t finished = 0;
+    size_t home = HomeShard();
+    for (size_t i = 0; i < shard_num_ && finished < n; ++i) {
+      Shard& shard = shards_[(home + i) % shard_num_];
+      if (shard.size == 0) {
+        continue;
+      }
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      size_t m = (std::min)(n - finished, shard.data.size());
+      for (size_t j = 0; j < m; j++) {
+        p[finished++] = std::move(shard.data.front());
+        shard.data.pop_front();
+      }
+      shard.size -= m;
+    }
+    return finished;
+  }
+
+  size_t ReadShards(size_t n, T* p, bool once) {
+    CHECK(n <= MaxCapacity() - sharded_reading_);
+    sharded_reading_ += n;
+    // a waiting reader makes room, as in the unsharded channel
+    WakeShardWriters();
+    size_t finished = 0;
+    while (finished < n) {
+      size_t m = TakeFromShards(n - finished, p + finished);
+      if (m != 0) {
+        finished += m;
+        ready_ -= m;
+        sharded_reading_ -= m;
+        reserved_ -= m;
+        WakeShardWriters();
+        if (once) {
+          break;
+        }
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(mutex_);
+      sharded_empty_waiters_++;
+      empty_cond_.wait(lock, [this] {
+        return ready_ != 0 || (closed_ && writing_ == 0);
+      });
+      sharded_empty_waiters_--;
+      // ready_ is lowered after the shards by the other readers, so it is
+      // only the end of the data when no writer can add more
+      if (closed_ && writing_ == 0 && ready_ == 0) {
+        break;
+      }
+    }
+    sharded_reading_ -= n - finished;
+    return finished;
+  }
+
+  const std::deque<T>& GatherShards() const {
+    Shard& first = shards_[0];
+    std::lock_guard<std::mutex> first_lock(first.mutex);
+    for (size_t i = 1; i < shard_num_; ++i) {
+      Shard& shard = shards_[i];
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      size_t m = shard.data.size();
+      for (auto& value : shard.data) {
+        first.data.push_back(std::move(value));
+      }
+      shard.data.clear();
+      shard.data.shrink_to_fit();
+      shard.size -= m;
+      first.size += m;
+    }
+    return first.data;
+  }
+
+  void ClearShards() {
+    for (size_t i = 0; i < shard_num_; ++i) {
+      std::lock_guard<std::mutex> lock(shards_[i].mutex);
+      size_t m = shards_[i].data.size();
+      shards_[i].data.clear();
+      shards_[i].data.shrink_to_fit();
+      shards_[i].size -= m;
+      ready_ -= m;
+      reserved_ -= m;
+    }
+    WakeShardWriters();
+  }
 };  // NOLINT
 
 template <class T>
@@ -310,6 +548,14 @@ Channel<T> MakeChannel(size_t capacity = (std::numeric_limits<size_t>::max)()) {
   return std::make_shared<ChannelObject<T>>(capacity);
 }
 
+// see the sharded constructor of ChannelObject
+template <class T>
+Channel<T> MakeShardedChannel(
+    size_t shard_num,
+    size_t capacity = (std::numeric_limits<size_t>::max)()) {
+  return std::make_shared<ChannelObject<T>>(capacity, shard_num);
+}
+
 template <class T, class U>
 Channel<T> MakeChannel(const Channel<U>& other) {
   CHECK(other != nullptr) << "channel can not be NULL";
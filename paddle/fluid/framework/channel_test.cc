@@ -0,0 +1,244 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/channel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace paddle {
+namespace framework {
+
+static Channel<int> NewChannel(size_t shard_num, size_t capacity) {
+  return shard_num == 1 ? MakeChannel<int>(capacity)
+                        : MakeShardedChannel<int>(shard_num, capacity);
+}
+
+TEST(Channel, read_write) {
+  for (size_t shard_num : {1, 4}) {
+    auto chan = NewChannel(shard_num, 100);
+    std::vector<int> data(10);
+    for (int i = 0; i < 10; ++i) {
+      data[i] = i;
+    }
+    ASSERT_EQ(chan->Write(data), 10UL);
+    ASSERT_EQ(chan->Size(), 10UL);
+
+    std::vector<int> out;
+    ASSERT_EQ(chan->ReadOnce(out, 4), 4UL);
+    ASSERT_EQ(chan->ReadOnce(out, 100), 6UL);
+    ASSERT_TRUE(chan->Empty());
+
+    chan->Write(std::move(data));
+    chan->Close();
+    ASSERT_EQ(chan->Write(std::vector<int>{1}), 0UL);
+    ASSERT_EQ(chan->ReadAll(out), 10UL);
+    std::sort(out.begin(), out.end());
+    for (int i = 0; i < 10; ++i) {
+      ASSERT_EQ(out[i], i);
+    }
+    int val = 0;
+    ASSERT_FALSE(chan->Get(val));
+
+    chan->Open();
+    ASSERT_TRUE(chan->Put(3));
+    chan->Clear();
+    ASSERT_EQ(chan->Size(), 0UL);
+  }
+}
+
+// GetData sees the data of every shard, which can still be read after it, as
+// PSGPUWrapper::BuildTask does with the input channel of a dataset.
+TEST(Channel, get_data) {
+  for (size_t shard_num : {1, 4}) {
+    auto chan = NewChannel(shard_num, 1000);
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+      writers.emplace_back([&chan, t] {
+        std::vector<int> block(25);
+        for (int i = 0; i < 25; ++i) {
+          block[i] = t * 25 + i;
+        }
+        chan->Write(std::move(block));
+      });
+    }
+    for (auto& t : writers) {
+      t.join();
+    }
+
+    const auto& data = chan->GetData();
+    std::vector<int> values(data.begin(), data.end());
+    std::sort(values.begin(), values.end());
+    ASSERT_EQ(values.size(), 100UL);
+    for (int i = 0; i < 100; ++i) {
+      ASSERT_EQ(values[i], i);
+    }
+    ASSERT_EQ(chan->Size(), 100UL);
+
+    chan->Close();
+    std::vector<int> out;
+    ASSERT_EQ(chan->ReadAll(out), 100UL);
+    std::sort(out.begin(), out.end());
+    ASSERT_EQ(out, values);
+  }
+}
+
+// writers block on a full channel until the readers make room
+TEST(Channel, capacity) {
+  for (size_t shard_num : {1, 4}) {
+    auto chan = NewChannel(shard_num, 16);
+    chan->SetBlockSize(4);
+    const int num = 10000;
+    std::thread writer([&chan] {
+      std::vector<int> block(7);
+      for (int i = 0; i < num; i += 7) {
+        for (int j = 0; j < 7; ++j) {
+          block[j] = i + j;
+        }
+        EXPECT_EQ(chan->Write(std::min(7, num - i), block.data()),
+                  static_cast<size_t>(std::min(7, num - i)));
+        // a blocked reader makes room for the values it waits for
+        EXPECT_LE(chan->Size(), 16UL + chan->BlockSize());
+      }
+      chan->Close();
+    });
+    std::vector<int> out;
+    ASSERT_EQ(chan->ReadAll(out), static_cast<size_t>(num));
+    writer.join();
+    std::sort(out.begin(), out.end());
+    for (int i = 0; i < num; ++i) {
+      ASSERT_EQ(out[i], i);
+    }
+  }
+}
+
+// Every value written by the writers is read exactly once, and no reader
+// stops before the channel is closed. The readers outnumber the writers and
+// race to take the few values the writers put, so that they often find a
+// shard emptied by another reader.
+static void ReadWriteRace(size_t shard_num) {
+  auto chan = NewChannel(shard_num, 64);
+  const int writer_num = 4;
+  const int reader_num = 16;
+  const int values_per_writer = 10000;
+  std::atomic<int> running_writers{writer_num};
+  std::vector<std::vector<int>> outs(reader_num);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < writer_num; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < values_per_writer; ++i) {
+        EXPECT_TRUE(chan->Put(t * values_per_writer + i));
+      }
+      if (--running_writers == 0) {
+        chan->Close();
+      }
+    });
+  }
+  for (int t = 0; t < reader_num; ++t) {
+    threads.emplace_back([&, t] {
+      std::vector<int> block;
+      while (chan->ReadOnce(block, 1 + t % 2) != 0) {
+        outs[t].insert(outs[t].end(), block.begin(), block.end());
+      }
+      // no reader sees the end of an open channel
+      EXPECT_TRUE(chan->Closed());
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  std::vector<int> out;
+  for (auto& o : outs) {
+    out.insert(out.end(), o.begin(), o.end());
+  }
+  ASSERT_EQ(out.size(), static_cast<size_t>(writer_num * values_per_writer));
+  std::sort(out.begin(), out.end());
+  for (size_t i = 0; i < out.size(); ++i) {
+    ASSERT_EQ(out[i], static_cast<int>(i));
+  }
+}
+
+TEST(Channel, multi_reader_writer) {
+  for (size_t shard_num : {1, 4}) {
+    // the race is rare in one round
+    for (int round = 0; round < 5; ++round) {
+      ReadWriteRace(shard_num);
+    }
+  }
+}
+
+// Half of the threads write blocks of ints while the other half read them,
+// as LoadIntoMemory and the readers of a dataset do. Returns the number of
+// values moved per second.
+static double ProduceConsume(size_t shard_num, int thread_num,
+                             size_t block_size, size_t values_per_writer) {
+  auto chan = NewChannel(shard_num, 1 << 20);
+  int writer_num = thread_num / 2;
+  std::atomic<int> running_writers{writer_num};
+  std::atomic<size_t> read_num{0};
+  std::vector<std::thread> threads;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < writer_num; ++t) {
+    threads.emplace_back([&] {
+      std::vector<int> block(block_size, 1);
+      for (size_t i = 0; i < values_per_writer; i += block_size) {
+        chan->Write(block_size, block.data());
+      }
+      if (--running_writers == 0) {
+        chan->Close();
+      }
+    });
+  }
+  for (int t = writer_num; t < thread_num; ++t) {
+    threads.emplace_back([&] {
+      std::vector<int> block;
+      size_t num = 0;
+      size_t n = 0;
+      while ((n = chan->ReadOnce(block, block_size)) != 0) {
+        num += n;
+      }
+      read_num += num;
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  auto end = std::chrono::steady_clock::now();
+  EXPECT_EQ(read_num.load(), writer_num * values_per_writer);
+  return read_num / std::chrono::duration<double>(end - start).count();
+}
+
+// Not a pass / fail test, run it by --gtest_also_run_disabled_tests.
+TEST(Channel, DISABLED_benchmark) {
+  for (int thread_num : {32, 64, 128}) {
+    for (size_t block_size : {1, 64}) {
+      size_t values = (block_size == 1 ? 1 << 12 : 1 << 16);
+      double locked = ProduceConsume(1, thread_num, block_size, values);
+      double sharded = ProduceConsume(16, thread_num, block_size, values);
+      LOG(INFO) << thread_num << " threads, block size " << block_size
+                << ": one lock " << locked / 1e6 << "M values/s, 16 shards "
+                << sharded / 1e6 << "M values/s";
+    }
+  }
+}
+
+}  // namespace framework
+}  // namespace paddle
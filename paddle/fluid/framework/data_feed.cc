@@ -19,9 +19,11 @@ limitations under the License. */
 
 #include "paddle/fluid/framework/data_feed.h"
 #ifdef _LINUX
+#include <fcntl.h>
 #include <stdio_ext.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #endif
 #include "io/fs.h"
 #include "paddle/fluid/platform/monitor.h"
@@ -372,7 +374,16 @@ template <typename T>
 int InMemoryDataFeed<T>::Next() {
 #ifdef _LINUX
   this->CheckStart();
-  if (!enable_heterps_) {
+  if (shuffle_index_ != nullptr) {
+    const uint32_t* positions = nullptr;
+    this->batch_size_ = static_cast<int>(
+        shuffle_index_->Next(this->default_batch_size_, &positions));
+    VLOG(3) << "batch_size_=" << this->batch_size_
+            << ", thread_id=" << thread_id_;
+    if (this->batch_size_ != 0) {
+      PutToFeedVec(records_, positions, this->batch_size_);
+    }
+  } else if (!enable_heterps_) {
     CHECK(output_channel_ != nullptr);
     CHECK(consume_channel_ != nullptr);
     VLOG(3) << "output_channel_ size=" << output_channel_->Size()
@@ -445,6 +456,32 @@ void InMemoryDataFeed<T>::SetConsumeChannel(void* channel) {
   consume_channel_ = static_cast<paddle::framework::ChannelObject<T>*>(channel);
 }
 
+template <typename T>
+void InMemoryDataFeed<T>::SetShuffleIndex(ShuffleIndex* shuffle_index,
+                                          void* records) {
+  shuffle_index_ = shuffle_index;
+  records_ = static_cast<T*>(records);
+}
+
+template <typename T>
+bool InMemoryDataFeed<T>::PickFileToLoad(std::string* filename) {
+  if (file_prefetcher_ != nullptr) {
+    return file_prefetcher_->Next(filename, &fp_);
+  }
+  fp_ = nullptr;
+  return this->PickOneFile(filename);
+}
+
+template <typename T>
+void InMemoryDataFeed<T>::OpenPickedFile(const std::string& filename) {
+  if (file_prefetcher_ != nullptr) {
+    rewind(fp_.get());
+    return;
+  }
+  int err_no = 0;
+  fp_ = fs_open_read(filename, &err_no, this->pipe_command_);
+}
+
 template <typename T>
 void InMemoryDataFeed<T>::SetInputPvChannel(void* channel) {
   input_pv_channel_ =
@@ -507,17 +544,17 @@ void InMemoryDataFeed<T>::LoadIntoMemory() {
   }
   VLOG(3) << "LoadIntoMemory() begin, thread_id=" << thread_id_;
   std::string filename;
-  while (this->PickOneFile(&filename)) {
+  while (this->PickFileToLoad(&filename)) {
     VLOG(3) << "PickOneFile, filename=" << filename
             << ", thread_id=" << thread_id_;
 #ifdef PADDLE_WITH_BOX_PS
-    if (BoxWrapper::GetInstance()->UseAfsApi()) {
+    if (file_prefetcher_ == nullptr &&
+        BoxWrapper::GetInstance()->UseAfsApi()) {
       this->fp_ = BoxWrapper::GetInstance()->afs_manager->GetFile(
           filename, this->pipe_command_);
     } else {
 #endif
-      int err_no = 0;
-      this->fp_ = fs_open_read(filename, &err_no, this->pipe_command_);
+      this->OpenPickedFile(filename);
 #ifdef PADDLE_WITH_BOX_PS
     }
 #endif
@@ -557,11 +594,10 @@ void InMemoryDataFeed<T>::LoadIntoMemoryFromSo() {
       global_dlmanager_pool().Load(so_parser_name_, slot_conf_);
 
   std::string filename;
-  while (this->PickOneFile(&filename)) {
+  while (this->PickFileToLoad(&filename)) {
     VLOG(3) << "PickOneFile, filename=" << filename
             << ", thread_id=" << thread_id_;
-    int err_no = 0;
-    this->fp_ = fs_open_read(filename, &err_no, this->pipe_command_);
+    this->OpenPickedFile(filename);
     CHECK(this->fp_ != nullptr);
     __fsetlocking(&*(this->fp_), FSETLOCKING_BYCALLER);
 
@@ -1095,44 +1131,32 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstanceFromPipe(Record* instance) {
     return false;
   } else {
     const char* str = reader.get();
-    std::string line = std::string(str);
-    // VLOG(3) << line;
-    char* endptr = const_cast<char*>(str);
-    int pos = 0;
+    SlotTokenizer tokenizer(str, str + reader.length());
+    const char* token = nullptr;
+    size_t len = 0;
     if (parse_ins_id_) {
-      int num = strtol(&str[pos], &endptr, 10);
+      int num = 0;
+      tokenizer.ParseInt(&num);
       CHECK(num == 1);  // NOLINT
-      pos = endptr - str + 1;
-      size_t len = 0;
-      while (str[pos + len] != ' ') {
-        ++len;
-      }
-      instance->ins_id_ = std::string(str + pos, len);
-      pos += len + 1;
+      tokenizer.ParseToken(&token, &len);
+      instance->ins_id_ = std::string(token, len);
       VLOG(3) << "ins_id " << instance->ins_id_;
     }
     if (parse_content_) {
-      int num = strtol(&str[pos], &endptr, 10);
+      int num = 0;
+      tokenizer.ParseInt(&num);
       CHECK(num == 1);  // NOLINT
-      pos = endptr - str + 1;
-      size_t len = 0;
-      while (str[pos + len] != ' ') {
-        ++len;
-      }
-      instance->content_ = std::string(str + pos, len);
-      pos += len + 1;
+      tokenizer.ParseToken(&token, &len);
+      instance->content_ = std::string(token, len);
       VLOG(3) << "content " << instance->content_;
     }
     if (parse_logkey_) {
-      int num = strtol(&str[pos], &endptr, 10);
+      int num = 0;
+      tokenizer.ParseInt(&num);
       CHECK(num == 1);  // NOLINT
-      pos = endptr - str + 1;
-      size_t len = 0;
-      while (str[pos + len] != ' ') {
-        ++len;
-      }
+      tokenizer.ParseToken(&token, &len);
       // parse_logkey
-      std::string log_key = std::string(str + pos, len);
+      std::string log_key = std::string(token, len);
       uint64_t search_id;
       uint32_t cmatch;
       uint32_t rank;
@@ -1142,62 +1166,8 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstanceFromPipe(Record* instance) {
       instance->search_id = search_id;
       instance->cmatch = cmatch;
       instance->rank = rank;
-      pos += len + 1;
     }
-    for (size_t i = 0; i < use_slots_index_.size(); ++i) {
-      int idx = use_slots_index_[i];
-      int num = strtol(&str[pos], &endptr, 10);
-      PADDLE_ENFORCE_NE(
-          num, 0,
-          platform::errors::InvalidArgument(
-              "The number of ids can not be zero, you need padding "
-              "it in data generator; or if there is something wrong with "
-              "the data, please check if the data contains unresolvable "
-              "characters.\nplease check this error line: %s, \n Specifically, "
-              "something wrong happened(the length of this slot's feasign is 0)"
-              "when we parse the %d th slots."
-              "Maybe something wrong around this slot"
-              "\nWe detect the feasign number of this slot is %d, "
-              "which is illegal.",
-              str, i, num));
-      if (idx != -1) {
-        if (all_slots_type_[i][0] == 'f') {  // float
-          for (int j = 0; j < num; ++j) {
-            float feasign = strtof(endptr, &endptr);
-            // if float feasign is equal to zero, ignore it
-            // except when slot is dense
-            if (fabs(feasign) < 1e-6 && !use_slots_is_dense_[i]) {
-              continue;
-            }
-            FeatureFeasign f;
-            f.float_feasign_ = feasign;
-            instance->float_feasigns_.push_back(FeatureItem(f, idx));
-          }
-        } else if (all_slots_type_[i][0] == 'u') {  // uint64
-          for (int j = 0; j < num; ++j) {
-            uint64_t feasign = (uint64_t)strtoull(endptr, &endptr, 10);
-            // if uint64 feasign is equal to zero, ignore it
-            // except when slot is dense
-            if (feasign == 0 && !use_slots_is_dense_[i]) {
-              continue;
-            }
-            FeatureFeasign f;
-            f.uint64_feasign_ = feasign;
-            instance->uint64_feasigns_.push_back(FeatureItem(f, idx));
-          }
-        }
-        pos = endptr - str;
-      } else {
-        for (int j = 0; j <= num; ++j) {
-          // pos = line.find_first_of(' ', pos + 1);
-          while (line[pos + 1] != ' ') {
-            pos++;
-          }
-        }
-      }
-    }
-    instance->float_feasigns_.shrink_to_fit();
-    instance->uint64_feasigns_.shrink_to_fit();
+    ParseSlots(str, &tokenizer, true, instance);
     fea_num_ += instance->uint64_feasigns_.size();
     return true;
   }
@@ -1208,70 +1178,94 @@ bool MultiSlotInMemoryDataFeed::ParseOneInstanceFromPipe(Record* instance) {
 
 bool MultiSlotInMemoryDataFeed::ParseOneInstance(Record* instance) {
 #ifdef _LINUX
-  std::string line;
+  thread_local std::string line;
   if (getline(file_, line)) {
     VLOG(3) << line;
     // parse line
     const char* str = line.c_str();
-    char* endptr = const_cast<char*>(str);
-    int pos = 0;
-    for (size_t i = 0; i < use_slots_index_.size(); ++i) {
-      int idx = use_slots_index_[i];
-      int num = strtol(&str[pos], &endptr, 10);
-      PADDLE_ENFORCE_NE(
-          num, 0,
-          platform::errors::InvalidArgument(
-              "The number of ids can not be zero, you need padding "
-              "it in data generator; or if there is something wrong with "
-              "the data, please check if the data contains unresolvable "
-              "characters.\nplease check this error line: %s, \n Specifically, "
-              "something wrong happened(the length of this slot's feasign is 0)"
-              "when we parse the %d th slots."
-              "Maybe something wrong around this slot"
-              "\nWe detect the feasign number of this slot is %d, "
-              "which is illegal.",
-              str, i, num));
+    SlotTokenizer tokenizer(str, str + line.size());
+    ParseSlots(str, &tokenizer, false, instance);
+    return true;
+  } else {
+    return false;
+  }
+#endif
+  return false;
+}
 
-      if (idx != -1) {
-        if (all_slots_type_[i][0] == 'f') {  // float
-          for (int j = 0; j < num; ++j) {
-            float feasign = strtof(endptr, &endptr);
-            if (fabs(feasign) < 1e-6) {
-              continue;
-            }
-            FeatureFeasign f;
-            f.float_feasign_ = feasign;
-            instance->float_feasigns_.push_back(FeatureItem(f, idx));
-          }
-        } else if (all_slots_type_[i][0] == 'u') {  // uint64
-          for (int j = 0; j < num; ++j) {
-            uint64_t feasign = (uint64_t)strtoull(endptr, &endptr, 10);
-            if (feasign == 0) {
-              continue;
-            }
-            FeatureFeasign f;
-            f.uint64_feasign_ = feasign;
-            instance->uint64_feasigns_.push_back(FeatureItem(f, idx));
+void MultiSlotInMemoryDataFeed::ParseSlots(const char* str,
+                                           SlotTokenizer* tokenizer,
+                                           bool keep_dense_zeros,
+                                           Record* instance) {
+  // feasigns are gathered in buffers kept by the thread, so the record is
+  // allocated once with its final size
+  thread_local std::vector<FeatureItem> float_feasigns;
+  thread_local std::vector<FeatureItem> uint64_feasigns;
+  float_feasigns.clear();
+  uint64_feasigns.clear();
+  for (size_t i = 0; i < use_slots_index_.size(); ++i) {
+    int idx = use_slots_index_[i];
+    int num = 0;
+    tokenizer->ParseInt(&num);
+    PADDLE_ENFORCE_NE(
+        num, 0,
+        platform::errors::InvalidArgument(
+            "The number of ids can not be zero, you need padding "
+            "it in data generator; or if there is something wrong with "
+            "the data, please check if the data contains unresolvable "
+            "characters.\nplease check this error line: %s, \n Specifically, "
+            "something wrong happened(the length of this slot's feasign is 0)"
+            "when we parse the %d th slots."
+            "Maybe something wrong around this slot"
+            "\nWe detect the feasign number of this slot is %d, "
+            "which is illegal.",
+            str, i, num));
+    // if a feasign is equal to zero, ignore it, except when the slot is dense
+    // and dense slots are kept
+    bool keep_zeros = keep_dense_zeros && use_slots_is_dense_[i];
+    if (idx != -1) {
+      if (all_slots_type_[i][0] == 'f') {  // float
+        for (int j = 0; j < num; ++j) {
+          float feasign = 0;
+          tokenizer->ParseFloat(&feasign);
+          if (fabs(feasign) < 1e-6 && !keep_zeros) {
+            continue;
           }
+          FeatureFeasign f;
+          f.float_feasign_ = feasign;
+          float_feasigns.push_back(FeatureItem(f, idx));
         }
-        pos = endptr - str;
-      } else {
-        for (int j = 0; j <= num; ++j) {
-          pos = line.find_first_of(' ', pos + 1);
+      } else if (all_slots_type_[i][0] == 'u') {  // uint64
+        for (int j = 0; j < num; ++j) {
+          uint64_t feasign = 0;
+          tokenizer->ParseUint64(&feasign);
+          if (feasign == 0 && !keep_zeros) {
+            continue;
+          }
+          FeatureFeasign f;
+          f.uint64_feasign_ = feasign;
+          uint64_feasigns.push_back(FeatureItem(f, idx));
         }
       }
+    } else {
+      for (int j = 0; j < num; ++j) {
+        tokenizer->SkipToken();
+      }
     }
-    instance->float_feasigns_.shrink_to_fit();
-    instance->uint64_feasigns_.shrink_to_fit();
-    return true;
-  } else {
-    return false;
   }
-#endif
-  return false;
+  instance->float_feasigns_.assign(float_feasigns.begin(),
+                                   float_feasigns.end());
+  instance->uint64_feasigns_.assign(uint64_feasigns.begin(),
+                                    uint64_feasigns.end());
 }
 
 void MultiSlotInMemoryDataFeed::PutToFeedVec(const Record* ins_vec, int num) {
+  PutToFeedVec(ins_vec, nullptr, num);
+}
+
+void MultiSlotInMemoryDataFeed::PutToFeedVec(const Record* ins_vec,
+                                             const uint32_t* positions,
+                                             int num) {
 #ifdef _LINUX
   for (size_t i = 0; i < batch_float_feasigns_.size(); ++i) {
     batch_float_feasigns_[i].clear();
@@ -1284,7 +1278,7 @@ void MultiSlotInMemoryDataFeed::PutToFeedVec(const Record* ins_vec, int num) {
   ins_id_vec_.clear();
   ins_id_vec_.reserve(num);
   for (int i = 0; i < num; ++i) {
-    auto& r = ins_vec[i];
+    auto& r = positions == nullptr ? ins_vec[i] : ins_vec[positions[i]];
     ins_id_vec_.push_back(r.ins_id_);
     ins_content_vec_.push_back(r.content_);
     for (auto& item : r.float_feasigns_) {
@@ -2083,7 +2077,7 @@ void SlotRecordInMemoryDataFeed::LoadIntoMemoryByFile(void) {
   };
 
   std::string filename;
-  while (this->PickOneFile(&filename)) {
+  while (this->PickFileToLoad(&filename)) {
     VLOG(3) << "PickOneFile, filename=" << filename
             << ", thread_id=" << thread_id_;
     platform::Timer timeline;
@@ -2092,9 +2086,7 @@ void SlotRecordInMemoryDataFeed::LoadIntoMemoryByFile(void) {
     int lines = 0;
     bool is_ok = true;
     do {
-      int err_no = 0;
-      this->fp_ = fs_open_read(filename, &err_no, this->pipe_command_);
-
+      this->OpenPickedFile(filename);
       CHECK(this->fp_ != nullptr);
       __fsetlocking(&*(this->fp_), FSETLOCKING_BYCALLER);
       is_ok = parser->ParseFileInstance(
@@ -2125,7 +2117,7 @@ void SlotRecordInMemoryDataFeed::LoadIntoMemoryByLine(void) {
   line_reader.set_sample_rate(sample_rate_);
   BufferedLineFileReader::LineFunc line_func = nullptr;
 
-  while (this->PickOneFile(&filename)) {
+  while (this->PickFileToLoad(&filename)) {
     VLOG(3) << "PickOneFile, filename=" << filename
             << ", thread_id=" << thread_id_;
     std::vector<SlotRecord> record_vec;
@@ -2175,8 +2167,7 @@ void SlotRecordInMemoryDataFeed::LoadIntoMemoryByLine(void) {
     int lines = 0;
 
     do {
-      int err_no = 0;
-      this->fp_ = fs_open_read(filename, &err_no, this->pipe_command_);
+      this->OpenPickedFile(filename);
       CHECK(this->fp_ != nullptr);
       __fsetlocking(&*(this->fp_), FSETLOCKING_BYCALLER);
       lines = line_reader.read_file(this->fp_.get(), line_func, lines);
@@ -2213,7 +2204,7 @@ void SlotRecordInMemoryDataFeed::LoadIntoMemoryByCommand(void) {
   BufferedLineFileReader line_reader;
   line_reader.set_sample_rate(sample_rate_);
 
-  while (this->PickOneFile(&filename)) {
+  while (this->PickFileToLoad(&filename)) {
     VLOG(3) << "PickOneFile, filename=" << filename
             << ", thread_id=" << thread_id_;
     int lines = 0;
@@ -2224,8 +2215,7 @@ void SlotRecordInMemoryDataFeed::LoadIntoMemoryByCommand(void) {
     int offset = 0;
 
     do {
-      int err_no = 0;
-      this->fp_ = fs_open_read(filename, &err_no, this->pipe_command_);
+      this->OpenPickedFile(filename);
       CHECK(this->fp_ != nullptr);
       __fsetlocking(&*(this->fp_), FSETLOCKING_BYCALLER);
 
@@ -2287,35 +2277,24 @@ bool SlotRecordInMemoryDataFeed::ParseOneInstance(const std::string& line,
   SlotRecord& rec = (*ins);
   // parse line
   const char* str = line.c_str();
-  char* endptr = const_cast<char*>(str);
-  int pos = 0;
-
-  thread_local std::vector<std::vector<float>> slot_float_feasigns;
-  thread_local std::vector<std::vector<uint64_t>> slot_uint64_feasigns;
-  slot_float_feasigns.resize(float_use_slot_size_);
-  slot_uint64_feasigns.resize(uint64_use_slot_size_);
+  SlotTokenizer tokenizer(str, str + line.size());
+  const char* token = nullptr;
+  size_t len = 0;
 
   if (parse_ins_id_) {
-    int num = strtol(&str[pos], &endptr, 10);
+    int num = 0;
+    tokenizer.ParseInt(&num);
     CHECK(num == 1);  // NOLINT
-    pos = endptr - str + 1;
-    size_t len = 0;
-    while (str[pos + len] != ' ') {
-      ++len;
-    }
-    rec->ins_id_ = std::string(str + pos, len);
-    pos += len + 1;
+    tokenizer.ParseToken(&token, &len);
+    rec->ins_id_ = std::string(token, len);
   }
   if (parse_logkey_) {
-    int num = strtol(&str[pos], &endptr, 10);
+    int num = 0;
+    tokenizer.ParseInt(&num);
     CHECK(num == 1);  // NOLINT
-    pos = endptr - str + 1;
-    size_t len = 0;
-    while (str[pos + len] != ' ') {
-      ++len;
-    }
+    tokenizer.ParseToken(&token, &len);
     // parse_logkey
-    std::string log_key = std::string(str + pos, len);
+    std::string log_key = std::string(token, len);
     uint64_t search_id;
     uint32_t cmatch;
     uint32_t rank;
@@ -2325,15 +2304,21 @@ bool SlotRecordInMemoryDataFeed::ParseOneInstance(const std::string& line,
     rec->search_id = search_id;
     rec->cmatch = cmatch;
     rec->rank = rank;
-    pos += len + 1;
   }
 
-  int float_total_slot_num = 0;
-  int uint64_total_slot_num = 0;
+  // used slots of a type appear in the order of their slot_value_idx, so the
+  // values go straight into the pooled storage of the record
+  auto& float_feasigns = rec->slot_float_feasigns_;
+  auto& uint64_feasigns = rec->slot_uint64_feasigns_;
+  float_feasigns.clear(false);
+  uint64_feasigns.clear(false);
+  float_feasigns.slot_offsets.resize(float_use_slot_size_ + 1, 0);
+  uint64_feasigns.slot_offsets.resize(uint64_use_slot_size_ + 1, 0);
 
   for (size_t i = 0; i < all_slots_info_.size(); ++i) {
     auto& info = all_slots_info_[i];
-    int num = strtol(&str[pos], &endptr, 10);
+    int num = 0;
+    tokenizer.ParseInt(&num);
     PADDLE_ENFORCE(num,
                    "The number of ids can not be zero, you need padding "
                    "it in data generator; or if there is something wrong with "
@@ -2341,46 +2326,44 @@ bool SlotRecordInMemoryDataFeed::ParseOneInstance(const std::string& line,
                    "characters.\nplease check this error line: %s",
                    str);
     if (info.used_idx != -1) {
+      bool dense = used_slots_info_[info.used_idx].dense;
       if (info.type[0] == 'f') {  // float
-        auto& slot_fea = slot_float_feasigns[info.slot_value_idx];
-        slot_fea.clear();
+        auto& values = float_feasigns.slot_values;
+        float_feasigns.slot_offsets[info.slot_value_idx] =
+            static_cast<uint32_t>(values.size());
         for (int j = 0; j < num; ++j) {
-          float feasign = strtof(endptr, &endptr);
-          if (fabs(feasign) < 1e-6 && !used_slots_info_[info.used_idx].dense) {
+          float feasign = 0;
+          tokenizer.ParseFloat(&feasign);
+          if (fabs(feasign) < 1e-6 && !dense) {
             continue;
           }
-          slot_fea.push_back(feasign);
-          ++float_total_slot_num;
+          values.push_back(feasign);
         }
       } else if (info.type[0] == 'u') {  // uint64
-        auto& slot_fea = slot_uint64_feasigns[info.slot_value_idx];
-        slot_fea.clear();
+        auto& values = uint64_feasigns.slot_values;
+        uint64_feasigns.slot_offsets[info.slot_value_idx] =
+            static_cast<uint32_t>(values.size());
         for (int j = 0; j < num; ++j) {
-          uint64_t feasign =
-              static_cast<uint64_t>(strtoull(endptr, &endptr, 10));
-          if (feasign == 0 && !used_slots_info_[info.used_idx].dense) {
+          uint64_t feasign = 0;
+          tokenizer.ParseUint64(&feasign);
+          if (feasign == 0 && !dense) {
             continue;
           }
-          slot_fea.push_back(feasign);
-          ++uint64_total_slot_num;
+          values.push_back(feasign);
         }
       }
-      pos = endptr - str;
     } else {
-      for (int j = 0; j <= num; ++j) {
-        // pos = line.find_first_of(' ', pos + 1);
-        while (line[pos + 1] != ' ') {
-          pos++;
-        }
+      for (int j = 0; j < num; ++j) {
+        tokenizer.SkipToken();
       }
     }
   }
-  rec->slot_float_feasigns_.add_slot_feasigns(slot_float_feasigns,
-                                              float_total_slot_num);
-  rec->slot_uint64_feasigns_.add_slot_feasigns(slot_uint64_feasigns,
-                                               uint64_total_slot_num);
+  float_feasigns.slot_offsets[float_use_slot_size_] =
+      static_cast<uint32_t>(float_feasigns.slot_values.size());
+  uint64_feasigns.slot_offsets[uint64_use_slot_size_] =
+      static_cast<uint32_t>(uint64_feasigns.slot_values.size());
 
-  return (uint64_total_slot_num > 0);
+  return (uint64_feasigns.slot_values.size() > 0);
 }
 
 void SlotRecordInMemoryDataFeed::PutToFeedVec(const SlotRecord* ins_vec,
@@ -2463,6 +2446,17 @@ void SlotRecordInMemoryDataFeed::PutToFeedVec(const SlotRecord* ins_vec,
   }
 }
 
+void SlotRecordInMemoryDataFeed::PutToFeedVec(const SlotRecord* ins_vec,
+                                              const uint32_t* positions,
+                                              int num) {
+  // SlotRecords are pointers, gathering them costs nothing next to the values
+  batch_records_.resize(num);
+  for (int i = 0; i < num; ++i) {
+    batch_records_[i] = ins_vec[positions[i]];
+  }
+  PutToFeedVec(batch_records_.data(), num);
+}
+
 void SlotRecordInMemoryDataFeed::ExpandSlotRecord(SlotRecord* rec) {
   SlotRecord& ins = (*rec);
   if (ins->slot_float_feasigns_.slot_offsets.empty()) {
@@ -2544,6 +2538,18 @@ int SlotRecordInMemoryDataFeed::Next() {
 #ifdef _LINUX
   this->CheckStart();
 
+  if (shuffle_index_ != nullptr) {
+    const uint32_t* positions = nullptr;
+    this->batch_size_ = static_cast<int>(
+        shuffle_index_->Next(this->default_batch_size_, &positions));
+    VLOG(3) << "batch_size_=" << this->batch_size_
+            << ", thread_id=" << thread_id_;
+    if (this->batch_size_ != 0) {
+      PutToFeedVec(records_, positions, this->batch_size_);
+    }
+    return this->batch_size_;
+  }
+
   VLOG(3) << "enable heter next: " << offset_index_
           << " batch_offsets: " << batch_offsets_.size();
   if (offset_index_ >= batch_offsets_.size()) {
@@ -2571,5 +2577,169 @@ int SlotRecordInMemoryDataFeed::Next() {
 #endif
 }
 
+void SlotRecordBinaryInMemoryDataFeed::LoadIntoMemory() {
+#ifdef _LINUX
+  VLOG(3) << "SlotRecordBinary LoadIntoMemory() begin, thread_id="
+          << thread_id_;
+  std::string filename;
+  while (this->PickFileToLoad(&filename)) {
+    VLOG(3) << "PickOneFile, filename=" << filename
+            << ", thread_id=" << thread_id_;
+    platform::Timer timeline;
+    timeline.Start();
+    size_t ins_num = 0;
+    // a prefetched file is read from memory already
+    bool mmap_file = file_prefetcher_ == nullptr &&
+                     fs_select_internal(filename) == 0 &&
+                     (pipe_command_.empty() || pipe_command_ == "cat");
+    if (mmap_file) {
+      int fd = open(filename.c_str(), O_RDONLY);
+      PADDLE_ENFORCE_NE(fd, -1, platform::errors::Unavailable(
+                                    "Fail to open file %s.", filename));
+      struct stat file_stat;
+      int ret = fstat(fd, &file_stat);
+      size_t size = static_cast<size_t>(file_stat.st_size);
+      void* data = ret != 0 || size == 0
+                       ? nullptr
+                       : mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+      PADDLE_ENFORCE_EQ(ret, 0,
+                        platform::errors::Unavailable(
+                            "Fail to get the size of file %s.", filename));
+      PADDLE_ENFORCE_NE(data, MAP_FAILED,
+                        platform::errors::Unavailable(
+                            "Fail to mmap file %s.", filename));
+      // unmapped even when a corrupted block throws
+      std::unique_ptr<void, std::function<void(void*)>> mapping(
+          data, [size](void* ptr) { munmap(ptr, size); });
+      madvise(data, size, MADV_SEQUENTIAL);
+      SlotRecordBinaryReader reader(reinterpret_cast<const char*>(data), size);
+      ins_num = LoadBlocks(&reader, filename);
+    } else {
+      this->OpenPickedFile(filename);
+      CHECK(this->fp_ != nullptr);
+      __fsetlocking(&*(this->fp_), FSETLOCKING_BYCALLER);
+      SlotRecordBinaryReader reader(this->fp_.get());
+      ins_num = LoadBlocks(&reader, filename);
+    }
+    timeline.Pause();
+    VLOG(3) << "LoadIntoMemory() read all instances, file=" << filename
+            << ", instances=" << ins_num << ", mmap=" << mmap_file
+            << ", cost time=" << timeline.ElapsedSec()
+            << " seconds, thread_id=" << thread_id_;
+  }
+  VLOG(3) << "SlotRecordBinary LoadIntoMemory() end, thread_id="
+          << thread_id_;
+#endif
+}
+
+size_t SlotRecordBinaryInMemoryDataFeed::LoadBlocks(
+    SlotRecordBinaryReader* reader, const std::string& filename) {
+  const auto& file_slots = reader->slots();
+  PADDLE_ENFORCE_EQ(
+      !(parse_ins_id_ || parse_logkey_) || reader->with_ins_id(), true,
+      platform::errors::InvalidArgument(
+          "File %s has no ins ids, convert it with ins ids to use "
+          "parse_ins_id or parse_logkey.",
+          filename));
+  // file slot of each used slot
+  std::vector<size_t> file_slot_index(use_slot_size_);
+  for (int i = 0; i < use_slot_size_; ++i) {
+    auto& info = used_slots_info_[i];
+    size_t j = 0;
+    while (j < file_slots.size() && file_slots[j].name != info.slot) {
+      ++j;
+    }
+    PADDLE_ENFORCE_LT(j, file_slots.size(),
+                      platform::errors::NotFound(
+                          "Slot %s is not in file %s.", info.slot, filename));
+    PADDLE_ENFORCE_EQ(file_slots[j].type, info.type[0],
+                      platform::errors::InvalidArgument(
+                          "Slot %s has type %s, but type %c in file %s.",
+                          info.slot, info.type, file_slots[j].type, filename));
+    file_slot_index[i] = j;
+  }
+
+  size_t ins_num = 0;
+  SlotRecordBinaryBlock block;
+  std::vector<SlotRecord> record_vec;
+  while (reader->NextBlock(&block)) {
+    SlotRecordPool().get(&record_vec, block.ins_num);
+    // instances without uint64 feasigns are dropped, as by the text parser
+    size_t kept = 0;
+    for (uint32_t k = 0; k < block.ins_num; ++k) {
+      SlotRecord rec = record_vec[k];
+      if (reader->with_ins_id()) {
+        uint32_t begin = block.ins_id_offsets[k];
+        rec->ins_id_.assign(block.ins_ids + begin,
+                            block.ins_id_offsets[k + 1] - begin);
+        if (parse_logkey_) {
+          parser_log_key(rec->ins_id_, &rec->search_id, &rec->cmatch,
+                         &rec->rank);
+        }
+      }
+      auto& float_feasigns = rec->slot_float_feasigns_;
+      auto& uint64_feasigns = rec->slot_uint64_feasigns_;
+      float_feasigns.clear(false);
+      uint64_feasigns.clear(false);
+      float_feasigns.slot_offsets.resize(float_use_slot_size_ + 1, 0);
+      uint64_feasigns.slot_offsets.resize(uint64_use_slot_size_ + 1, 0);
+      for (int i = 0; i < use_slot_size_; ++i) {
+        auto& info = used_slots_info_[i];
+        size_t slot = file_slot_index[i];
+        uint32_t begin = block.offsets[slot][k];
+        uint32_t end = block.offsets[slot][k + 1];
+        // zero feasigns of sparse slots are dropped, as by the text parser
+        if (info.type[0] == 'f') {
+          auto& values = float_feasigns.slot_values;
+          float_feasigns.slot_offsets[info.slot_value_idx] =
+              static_cast<uint32_t>(values.size());
+          const float* src = block.FloatValues(slot);
+          if (info.dense) {
+            values.insert(values.end(), src + begin, src + end);
+          } else {
+            for (uint32_t j = begin; j < end; ++j) {
+              if (fabs(src[j]) >= 1e-6) {
+                values.push_back(src[j]);
+              }
+            }
+          }
+        } else {
+          auto& values = uint64_feasigns.slot_values;
+          uint64_feasigns.slot_offsets[info.slot_value_idx] =
+              static_cast<uint32_t>(values.size());
+          const uint64_t* src = block.Uint64Values(slot);
+          if (info.dense) {
+            values.insert(values.end(), src + begin, src + end);
+          } else {
+            for (uint32_t j = begin; j < end; ++j) {
+              if (src[j] != 0) {
+                values.push_back(src[j]);
+              }
+            }
+          }
+        }
+      }
+      float_feasigns.slot_offsets[float_use_slot_size_] =
+          static_cast<uint32_t>(float_feasigns.slot_values.size());
+      uint64_feasigns.slot_offsets[uint64_use_slot_size_] =
+          static_cast<uint32_t>(uint64_feasigns.slot_values.size());
+      if (!uint64_feasigns.slot_values.empty()) {
+        std::swap(record_vec[kept++], record_vec[k]);
+      }
+    }
+    if (kept < block.ins_num) {
+      SlotRecordPool().put(&record_vec[kept], block.ins_num - kept);
+      record_vec.resize(kept);
+    }
+    ins_num += kept;
+    if (kept > 0) {
+      input_channel_->Write(std::move(record_vec));
+    }
+    record_vec.clear();
+  }
+  return ins_num;
+}
+
 }  // namespace framework
 }  // namespace paddle
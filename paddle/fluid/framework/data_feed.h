@@ -35,9 +35,13 @@ limitations under the License. */
 #include "paddle/fluid/framework/blocking_queue.h"
 #include "paddle/fluid/framework/channel.h"
 #include "paddle/fluid/framework/data_feed.pb.h"
+#include "paddle/fluid/framework/file_prefetcher.h"
 #include "paddle/fluid/framework/fleet/fleet_wrapper.h"
 #include "paddle/fluid/framework/lod_tensor.h"
 #include "paddle/fluid/framework/reader.h"
+#include "paddle/fluid/framework/shuffle_index.h"
+#include "paddle/fluid/framework/slot_record_binary.h"
+#include "paddle/fluid/framework/slot_tokenizer.h"
 #include "paddle/fluid/framework/variable.h"
 #include "paddle/fluid/platform/timer.h"
 #include "paddle/fluid/string/string_helper.h"
@@ -553,6 +557,11 @@ class DataFeed {
   virtual void SetOutputChannel(void* channel) {}
   // This function will do nothing at default
   virtual void SetConsumeChannel(void* channel) {}
+  // This function will do nothing at default, records is the T* of the
+  // in memory instances the positions of shuffle_index refer to
+  virtual void SetShuffleIndex(ShuffleIndex* shuffle_index, void* records) {}
+  // This function will do nothing at default
+  virtual void SetFilePrefetcher(FilePrefetcher* file_prefetcher) {}
   // This function will do nothing at default
   virtual void SetThreadId(int thread_id) {}
   // This function will do nothing at default
@@ -703,6 +712,10 @@ class InMemoryDataFeed : public DataFeed {
   virtual void SetInputChannel(void* channel);
   virtual void SetOutputChannel(void* channel);
   virtual void SetConsumeChannel(void* channel);
+  virtual void SetShuffleIndex(ShuffleIndex* shuffle_index, void* records);
+  virtual void SetFilePrefetcher(FilePrefetcher* file_prefetcher) {
+    file_prefetcher_ = file_prefetcher;
+  }
   virtual void SetThreadId(int thread_id);
   virtual void SetThreadNum(int thread_num);
   virtual void SetParseInsId(bool parse_ins_id);
@@ -725,6 +738,15 @@ class InMemoryDataFeed : public DataFeed {
                                       CustomParser* parser) {}
   virtual void PutToFeedVec(const std::vector<T>& ins_vec) = 0;
   virtual void PutToFeedVec(const T* ins_vec, int num) = 0;
+  // the instances ins_vec[positions[0]] .. ins_vec[positions[num - 1]]
+  virtual void PutToFeedVec(const T* ins_vec, const uint32_t* positions,
+                            int num) = 0;
+  // Picks the next file to load. With a file prefetcher it is the next
+  // fetched file, which is then opened in fp_ already.
+  bool PickFileToLoad(std::string* filename);
+  // Opens fp_ at the start of the picked file, a fetched file is read again
+  // from memory.
+  void OpenPickedFile(const std::string& filename);
 
   std::vector<std::vector<float>> batch_float_feasigns_;
   std::vector<std::vector<uint64_t>> batch_uint64_feasigns_;
@@ -752,6 +774,10 @@ class InMemoryDataFeed : public DataFeed {
   uint64_t offset_index_ = 0;
   bool enable_heterps_ = false;
   T* records_ = nullptr;
+  // when set, Next() takes its batches from it instead of the channels
+  ShuffleIndex* shuffle_index_ = nullptr;
+  // when set, LoadIntoMemory() parses the files it fetched
+  FilePrefetcher* file_prefetcher_ = nullptr;
 };
 
 // This class define the data type of instance(ins_vec) in MultiSlotDataFeed
@@ -1101,6 +1127,12 @@ class MultiSlotInMemoryDataFeed : public InMemoryDataFeed<Record> {
   virtual void GetMsgFromLogKey(const std::string& log_key, uint64_t* search_id,
                                 uint32_t* cmatch, uint32_t* rank);
   virtual void PutToFeedVec(const Record* ins_vec, int num);
+  virtual void PutToFeedVec(const Record* ins_vec, const uint32_t* positions,
+                            int num);
+  // parses the slots of the line str, keep_dense_zeros keeps zero feasigns
+  // of dense slots
+  void ParseSlots(const char* str, SlotTokenizer* tokenizer,
+                  bool keep_dense_zeros, Record* instance);
 };
 
 class SlotRecordInMemoryDataFeed : public InMemoryDataFeed<SlotRecord> {
@@ -1129,6 +1161,8 @@ class SlotRecordInMemoryDataFeed : public InMemoryDataFeed<SlotRecord> {
   }
   bool ParseOneInstance(const std::string& line, SlotRecord* rec);
   virtual void PutToFeedVec(const SlotRecord* ins_vec, int num);
+  virtual void PutToFeedVec(const SlotRecord* ins_vec,
+                            const uint32_t* positions, int num);
   float sample_rate_ = 1.0f;
   int use_slot_size_ = 0;
   int float_use_slot_size_ = 0;
@@ -1137,6 +1171,24 @@ class SlotRecordInMemoryDataFeed : public InMemoryDataFeed<SlotRecord> {
   std::vector<UsedSlotInfo> used_slots_info_;
   size_t float_total_dims_size_ = 0;
   std::vector<int> float_total_dims_without_inductives_;
+  // the records of the batch taken from the shuffle index
+  std::vector<SlotRecord> batch_records_;
+};
+
+// Loads the binary columnar files written by ConvertSlotTextToBinary. The
+// used slots are matched by name and their values copied into the
+// SlotRecords without any parsing; local files are mmap-ed when there is no
+// pipe command, other files are streamed through it.
+class SlotRecordBinaryInMemoryDataFeed : public SlotRecordInMemoryDataFeed {
+ public:
+  SlotRecordBinaryInMemoryDataFeed() {}
+  virtual ~SlotRecordBinaryInMemoryDataFeed() {}
+  virtual void LoadIntoMemory();
+
+ protected:
+  // returns the number of instances
+  size_t LoadBlocks(SlotRecordBinaryReader* reader,
+                    const std::string& filename);
 };
 
 class PaddleBoxDataFeed : public MultiSlotInMemoryDataFeed {
@@ -57,6 +57,7 @@ void DatasetImpl<T>::SetFileList(const std::vector<std::string>& filelist) {
   VLOG(3) << "filelist size: " << filelist.size();
   filelist_ = filelist;
   file_idx_ = 0;
+  file_prefetcher_ = nullptr;
 }
 
 // set expect thread num. actually it may change
@@ -161,6 +162,26 @@ void DatasetImpl<T>::SetFeaEval(bool fea_eval, int record_candidate_size) {
           << " with record candidate size: " << record_candidate_size;
 }
 
+template <typename T>
+void DatasetImpl<T>::SetShuffleByIndex(bool shuffle_by_index) {
+  shuffle_by_index_ = shuffle_by_index;
+  VLOG(3) << "Set shuffle by index: " << shuffle_by_index;
+}
+
+template <typename T>
+void DatasetImpl<T>::SetChannelShardNum(int shard_num) {
+  PADDLE_ENFORCE_GE(shard_num, 1,
+                    platform::errors::InvalidArgument(
+                        "Channel shard num should be >= 1, but received %d.",
+                        shard_num));
+  PADDLE_ENFORCE_EQ(input_channel_, nullptr,
+                    platform::errors::PreconditionNotMet(
+                        "Channel shard num should be set before the channels "
+                        "are created."));
+  channel_shard_num_ = shard_num;
+  VLOG(3) << "Set channel shard num: " << shard_num;
+}
+
 template <typename T>
 std::vector<paddle::framework::DataFeed*> DatasetImpl<T>::GetReaders() {
   std::vector<paddle::framework::DataFeed*> ret;
@@ -174,7 +195,8 @@ std::vector<paddle::framework::DataFeed*> DatasetImpl<T>::GetReaders() {
 template <typename T>
 void DatasetImpl<T>::CreateChannel() {
   if (input_channel_ == nullptr) {
-    input_channel_ = paddle::framework::MakeChannel<T>();
+    input_channel_ =
+        paddle::framework::MakeShardedChannel<T>(channel_shard_num_);
   }
   if (multi_output_channel_.size() == 0) {
     multi_output_channel_.reserve(channel_num_);
@@ -396,6 +418,10 @@ void DatasetImpl<T>::LoadIntoMemory() {
   VLOG(3) << "DatasetImpl<T>::LoadIntoMemory() begin";
   platform::Timer timeline;
   timeline.Start();
+  if (prefetch_thread_num_ > 0) {
+    PrefetchFiles();
+    SetReadersFilePrefetcher(file_prefetcher_.get());
+  }
   std::vector<std::thread> load_threads;
   for (int64_t i = 0; i < thread_num_; ++i) {
     load_threads.push_back(std::thread(
@@ -404,6 +430,10 @@ void DatasetImpl<T>::LoadIntoMemory() {
   for (std::thread& t : load_threads) {
     t.join();
   }
+  if (file_prefetcher_ != nullptr) {
+    SetReadersFilePrefetcher(nullptr);
+    file_prefetcher_ = nullptr;
+  }
   input_channel_->Close();
   int64_t in_chan_size = input_channel_->Size();
   input_channel_->SetBlockSize(in_chan_size / thread_num_ + 1);
@@ -417,6 +447,10 @@ void DatasetImpl<T>::LoadIntoMemory() {
 template <typename T>
 void DatasetImpl<T>::PreLoadIntoMemory() {
   VLOG(3) << "DatasetImpl<T>::PreLoadIntoMemory() begin";
+  if (prefetch_thread_num_ > 0) {
+    PrefetchFiles();
+    SetReadersFilePrefetcher(file_prefetcher_.get());
+  }
   if (preload_thread_num_ != 0) {
     CHECK(static_cast<size_t>(preload_thread_num_) == preload_readers_.size());
     preload_threads_.clear();
@@ -442,12 +476,60 @@ void DatasetImpl<T>::WaitPreLoadDone() {
   for (std::thread& t : preload_threads_) {
     t.join();
   }
+  if (file_prefetcher_ != nullptr) {
+    SetReadersFilePrefetcher(nullptr);
+    file_prefetcher_ = nullptr;
+  }
   input_channel_->Close();
   int64_t in_chan_size = input_channel_->Size();
   input_channel_->SetBlockSize(in_chan_size / thread_num_ + 1);
   VLOG(3) << "DatasetImpl<T>::WaitPreLoadDone() end";
 }
 
+template <typename T>
+void DatasetImpl<T>::SetFilePrefetch(int thread_num, int memory_budget_mb) {
+  PADDLE_ENFORCE_GE(thread_num, 0,
+                    platform::errors::InvalidArgument(
+                        "Prefetch thread num should be >= 0, but received %d.",
+                        thread_num));
+  PADDLE_ENFORCE_GT(memory_budget_mb, 0,
+                    platform::errors::InvalidArgument(
+                        "Prefetch memory budget should be > 0 MB, but "
+                        "received %d.",
+                        memory_budget_mb));
+  prefetch_thread_num_ = thread_num;
+  prefetch_memory_budget_mb_ = memory_budget_mb;
+  VLOG(3) << "Set file prefetch thread num: " << thread_num
+          << ", memory budget: " << memory_budget_mb << " MB";
+}
+
+// may be called while the trainers still train on the data loaded before,
+// the next LoadIntoMemory or PreLoadIntoMemory parses what it fetched
+template <typename T>
+void DatasetImpl<T>::PrefetchFiles() {
+  PADDLE_ENFORCE_GT(prefetch_thread_num_, 0,
+                    platform::errors::PreconditionNotMet(
+                        "Call SetFilePrefetch with a thread num > 0 before "
+                        "PrefetchFiles."));
+  if (file_prefetcher_ == nullptr) {
+    file_prefetcher_ = std::make_shared<FilePrefetcher>(
+        filelist_, data_feed_desc_.pipe_command(), prefetch_thread_num_,
+        static_cast<size_t>(prefetch_memory_budget_mb_) << 20);
+  }
+  file_prefetcher_->Start();
+}
+
+template <typename T>
+void DatasetImpl<T>::SetReadersFilePrefetcher(
+    FilePrefetcher* file_prefetcher) {
+  for (auto& reader : readers_) {
+    reader->SetFilePrefetcher(file_prefetcher);
+  }
+  for (auto& reader : preload_readers_) {
+    reader->SetFilePrefetcher(file_prefetcher);
+  }
+}
+
 // release memory data
 template <typename T>
 void DatasetImpl<T>::ReleaseMemory() {
@@ -503,6 +585,8 @@ void DatasetImpl<T>::ReleaseMemory() {
   std::vector<std::shared_ptr<paddle::framework::DataFeed>>().swap(readers_);
   input_records_.clear();
   std::vector<T>().swap(input_records_);
+  shuffle_index_.Clear();
+  index_shuffle_pending_ = false;
   std::vector<T>().swap(slots_shuffle_original_data_);
   VLOG(3) << "DatasetImpl<T>::ReleaseMemory() end";
   VLOG(3) << "total_feasign_num_(" << STAT_GET(STAT_total_feasign_num_in_mem)
@@ -519,6 +603,17 @@ void DatasetImpl<T>::LocalShuffle() {
   platform::Timer timeline;
   timeline.Start();
 
+  if (shuffle_by_index_) {
+    MoveChannelsToRecords();
+    index_shuffle_pending_ = true;
+    PrepareShuffleIndex();
+    timeline.Pause();
+    VLOG(3) << "DatasetImpl<T>::LocalShuffle() end, shuffled index of "
+            << shuffle_index_.size()
+            << " instances, cost time=" << timeline.ElapsedSec() << " seconds";
+    return;
+  }
+
   if (!input_channel_ || input_channel_->Size() == 0) {
     VLOG(3) << "DatasetImpl<T>::LocalShuffle() end, no data to shuffle";
     return;
@@ -539,8 +634,70 @@ void DatasetImpl<T>::LocalShuffle() {
           << timeline.ElapsedSec() << " seconds";
 }
 
+template <typename T>
+size_t DatasetImpl<T>::MoveChannelToRecords(const Channel<T>& channel) {
+  if (channel == nullptr || channel->Size() == 0) {
+    return 0;
+  }
+  bool closed = channel->Closed();
+  channel->Close();
+  size_t moved = 0;
+  if (input_records_.empty()) {
+    moved = channel->ReadAll(input_records_);
+  } else {
+    std::vector<T> data;
+    moved = channel->ReadAll(data);
+    input_records_.insert(input_records_.end(),
+                          std::make_move_iterator(data.begin()),
+                          std::make_move_iterator(data.end()));
+  }
+  if (!closed) {
+    channel->Open();
+  }
+  return moved;
+}
+
+template <typename T>
+size_t DatasetImpl<T>::MoveChannelsToRecords() {
+  size_t moved = MoveChannelToRecords(input_channel_);
+  for (auto& channel : multi_output_channel_) {
+    moved += MoveChannelToRecords(channel);
+  }
+  for (auto& channel : multi_consume_channel_) {
+    moved += MoveChannelToRecords(channel);
+  }
+  VLOG(3) << "moved " << moved << " instances from channels to records, "
+          << "records size: " << input_records_.size();
+  return moved;
+}
+
+template <typename T>
+void DatasetImpl<T>::PrepareShuffleIndex() {
+  if (!shuffle_by_index_) {
+    return;
+  }
+  size_t moved = MoveChannelsToRecords();
+  if (moved != 0 || index_shuffle_pending_ ||
+      shuffle_index_.size() != input_records_.size()) {
+    auto fleet_ptr = FleetWrapper::GetInstance();
+    shuffle_index_.Build(input_records_.size(), index_shuffle_pending_,
+                         thread_num_, fleet_ptr->LocalRandomEngine()());
+    index_shuffle_pending_ = false;
+  }
+  shuffle_index_.Rewind();
+  for (auto& reader : readers_) {
+    reader->SetShuffleIndex(&shuffle_index_, input_records_.data());
+  }
+  VLOG(3) << "prepared shuffle index of " << shuffle_index_.size()
+          << " instances for " << readers_.size() << " readers";
+}
+
 void MultiSlotDataset::GlobalShuffle(int thread_num) {
 #ifdef PADDLE_WITH_PSLIB
+  if (shuffle_by_index_) {
+    GlobalShuffleByIndex(thread_num);
+    return;
+  }
   VLOG(3) << "MultiSlotDataset::GlobalShuffle() begin";
   platform::Timer timeline;
   timeline.Start();
@@ -636,6 +793,126 @@ void MultiSlotDataset::GlobalShuffle(int thread_num) {
 #endif
 }
 
+void MultiSlotDataset::GlobalShuffleByIndex(int thread_num) {
+#ifdef PADDLE_WITH_PSLIB
+  VLOG(3) << "MultiSlotDataset::GlobalShuffleByIndex() begin";
+  platform::Timer timeline;
+  timeline.Start();
+  auto fleet_ptr = FleetWrapper::GetInstance();
+  if (thread_num == -1) {
+    thread_num = thread_num_;
+  }
+  // the other trainers may already be sending to the output channels
+  MoveChannelToRecords(input_channel_);
+  // the instances received from the other trainers are shuffled with the
+  // index when the readers are prepared
+  index_shuffle_pending_ = true;
+  shuffle_index_.Clear();
+  size_t ins_num = input_records_.size();
+  if (ins_num == 0) {
+    VLOG(3) << "MultiSlotDataset::GlobalShuffleByIndex() end, no data to "
+               "shuffle";
+    return;
+  }
+  PADDLE_ENFORCE_LE(
+      ins_num, static_cast<size_t>(std::numeric_limits<uint32_t>::max()),
+      platform::errors::InvalidArgument(
+          "Shuffle by index supports at most %u instances per dataset, but "
+          "received %d.",
+          std::numeric_limits<uint32_t>::max(), ins_num));
+
+  auto get_client_id = [this, fleet_ptr](const Record& data) -> size_t {
+    if (!this->merge_by_insid_) {
+      return fleet_ptr->LocalRandomEngine()() % this->trainer_num_;
+    } else {
+      return XXH64(data.ins_id_.data(), data.ins_id_.length(), 0) %
+             this->trainer_num_;
+    }
+  };
+  auto run_threads = [thread_num](std::function<void(int)> func) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_num; ++i) {
+      threads.push_back(std::thread(func, i));
+    }
+    for (std::thread& t : threads) {
+      t.join();
+    }
+  };
+
+  // positions[t][c]: instances of the t-th part of the records sent to c
+  std::vector<std::vector<std::vector<uint32_t>>> positions(
+      thread_num, std::vector<std::vector<uint32_t>>(trainer_num_));
+  run_threads([this, &positions, &get_client_id, ins_num, thread_num](int t) {
+    for (size_t i = ins_num * t / thread_num;
+         i < ins_num * (t + 1) / thread_num; ++i) {
+      positions[t][get_client_id(input_records_[i])].push_back(i);
+    }
+  });
+
+  struct SendBatch {
+    const uint32_t* positions;
+    size_t num;
+    int client_id;
+  };
+  std::vector<SendBatch> batches;
+  size_t batch_size = std::max<int64_t>(fleet_send_batch_size_, 1);
+  for (auto& part : positions) {
+    for (int c = 0; c < trainer_num_; ++c) {
+      for (size_t k = 0; k < part[c].size(); k += batch_size) {
+        batches.push_back({part[c].data() + k,
+                           std::min(batch_size, part[c].size() - k), c});
+      }
+    }
+  }
+  // interleave the trainers, as the sends of a batch of records would
+  std::shuffle(batches.begin(), batches.end(), fleet_ptr->LocalRandomEngine());
+  VLOG(3) << "global shuffle " << ins_num << " instances in "
+          << batches.size() << " batches with " << thread_num << " threads";
+
+  std::atomic<size_t> next_batch{0};
+  run_threads([this, &batches, &next_batch](int) {
+    auto fleet_ptr = FleetWrapper::GetInstance();
+    // one archive per thread, its buffer is reused by all the batches
+    paddle::framework::BinaryArchive ar;
+    std::vector<std::future<int32_t>> total_status;
+    for (size_t b = next_batch++; b < batches.size(); b = next_batch++) {
+      auto& batch = batches[b];
+      ar.Clear();
+      for (size_t k = 0; k < batch.num; ++k) {
+        ar << input_records_[batch.positions[k]];
+      }
+      std::string msg(ar.Buffer(), ar.Length());
+      total_status.push_back(
+          fleet_ptr->SendClientToClientMsg(0, batch.client_id, msg));
+      // serialized, so the memory of the records can go now
+      for (size_t k = 0; k < batch.num; ++k) {
+        input_records_[batch.positions[k]] = Record();
+      }
+      // as many messages in flight as there are trainers, then wait, see the
+      // comment on fleet_send_sleep_seconds_ in GlobalShuffle
+      if (static_cast<int>(total_status.size()) >= this->trainer_num_) {
+        for (auto& status : total_status) {
+          status.wait();
+        }
+        total_status.clear();
+        if (fleet_send_sleep_seconds_ != 0) {
+          sleep(this->fleet_send_sleep_seconds_);
+        }
+      }
+    }
+    for (auto& status : total_status) {
+      status.wait();
+    }
+  });
+  // every instance comes back through ReceiveFromClient, this one included,
+  // the capacity is kept for them
+  input_records_.clear();
+  timeline.Pause();
+  VLOG(3) << "MultiSlotDataset::GlobalShuffleByIndex() end, cost time="
+          << timeline.ElapsedSec() << " seconds";
+#endif
+}
+
 template <typename T>
 void DatasetImpl<T>::DynamicAdjustChannelNum(int channel_num,
                                              bool discard_remaining_ins) {
@@ -759,6 +1036,7 @@ void DatasetImpl<T>::DynamicAdjustReadersNum(int thread_num) {
   if (thread_num_ == thread_num) {
     VLOG(3) << "DatasetImpl<T>::DynamicAdjustReadersNum thread_num_="
             << thread_num_ << ", thread_num_=thread_num, no need to adjust";
+    PrepareShuffleIndex();
     return;
   }
   VLOG(3) << "adjust readers num from " << thread_num_ << " to " << thread_num;
@@ -766,6 +1044,7 @@ void DatasetImpl<T>::DynamicAdjustReadersNum(int thread_num) {
   std::vector<std::shared_ptr<paddle::framework::DataFeed>>().swap(readers_);
   CreateReaders();
   VLOG(3) << "adjust readers num done";
+  PrepareShuffleIndex();
 }
 
 template <typename T>
@@ -895,6 +1174,9 @@ void DatasetImpl<T>::DestroyPreLoadReaders() {
 
 template <typename T>
 int64_t DatasetImpl<T>::GetMemoryDataSize() {
+  if (shuffle_by_index_) {
+    return input_channel_->Size() + input_records_.size();
+  }
   return input_channel_->Size();
 }
 
@@ -914,6 +1196,9 @@ int64_t DatasetImpl<T>::GetShuffleDataSize() {
   for (size_t i = 0; i < multi_output_channel_.size(); ++i) {
     sum += multi_output_channel_[i]->Size() + multi_consume_channel_[i]->Size();
   }
+  if (shuffle_by_index_) {
+    sum += input_records_.size();
+  }
   return sum;
 }
 
@@ -963,6 +1248,7 @@ void MultiSlotDataset::DynamicAdjustReadersNum(int thread_num) {
   if (thread_num_ == thread_num) {
     VLOG(3) << "DatasetImpl<T>::DynamicAdjustReadersNum thread_num_="
             << thread_num_ << ", thread_num_=thread_num, no need to adjust";
+    PrepareShuffleIndex();
     return;
   }
   VLOG(3) << "adjust readers num from " << thread_num_ << " to " << thread_num;
@@ -970,7 +1256,11 @@ void MultiSlotDataset::DynamicAdjustReadersNum(int thread_num) {
   std::vector<std::shared_ptr<paddle::framework::DataFeed>>().swap(readers_);
   CreateReaders();
   VLOG(3) << "adjust readers num done";
-  PrepareTrain();
+  if (shuffle_by_index_) {
+    PrepareShuffleIndex();
+  } else {
+    PrepareTrain();
+  }
 }
 
 void MultiSlotDataset::PostprocessInstance() {
@@ -1148,6 +1438,9 @@ void MultiSlotDataset::MergeByInsId() {
     VLOG(3) << "merge_by_insid=false, will not MergeByInsId";
     return;
   }
+  PADDLE_ENFORCE_EQ(shuffle_by_index_, false,
+                    platform::errors::PreconditionNotMet(
+                        "merge by ins id does not support shuffle by index"));
   auto multi_slot_desc = data_feed_desc_.multi_slot_desc();
   std::vector<std::string> use_slots;
   std::vector<bool> use_slots_is_dense;
@@ -1488,6 +1781,9 @@ void MultiSlotDataset::SlotsShuffle(
   PADDLE_ENFORCE_EQ(slots_shuffle_fea_eval_, true,
                     platform::errors::PreconditionNotMet(
                         "fea eval mode off, need to set on for slots shuffle"));
+  PADDLE_ENFORCE_EQ(shuffle_by_index_, false,
+                    platform::errors::PreconditionNotMet(
+                        "slots shuffle does not support shuffle by index"));
   platform::Timer timeline;
   timeline.Start();
   std::unordered_set<uint16_t> index_slots;
@@ -1513,7 +1809,8 @@ void MultiSlotDataset::SlotsShuffle(
 template class DatasetImpl<SlotRecord>;
 void SlotRecordDataset::CreateChannel() {
   if (input_channel_ == nullptr) {
-    input_channel_ = paddle::framework::MakeChannel<SlotRecord>();
+    input_channel_ =
+        paddle::framework::MakeShardedChannel<SlotRecord>(channel_shard_num_);
   }
 }
 void SlotRecordDataset::CreateReaders() {
@@ -1562,7 +1859,9 @@ void SlotRecordDataset::ReleaseMemory() {
     input_channel_->Clear();
     input_channel_ = nullptr;
   }
-  if (enable_heterps_) {
+  shuffle_index_.Clear();
+  index_shuffle_pending_ = false;
+  if (enable_heterps_ || shuffle_by_index_) {
     VLOG(3) << "put pool records size: " << input_records_.size();
     SlotRecordPool().put(&input_records_);
     input_records_.clear();
@@ -1649,6 +1948,7 @@ void SlotRecordDataset::DynamicAdjustReadersNum(int thread_num) {
   if (thread_num_ == thread_num) {
     VLOG(3) << "DatasetImpl<T>::DynamicAdjustReadersNum thread_num_="
             << thread_num_ << ", thread_num_=thread_num, no need to adjust";
+    PrepareShuffleIndex();
     return;
   }
   VLOG(3) << "adjust readers num from " << thread_num_ << " to " << thread_num;
@@ -1656,7 +1956,11 @@ void SlotRecordDataset::DynamicAdjustReadersNum(int thread_num) {
   std::vector<std::shared_ptr<paddle::framework::DataFeed>>().swap(readers_);
   CreateReaders();
   VLOG(3) << "adjust readers num done";
-  PrepareTrain();
+  if (shuffle_by_index_) {
+    PrepareShuffleIndex();
+  } else {
+    PrepareTrain();
+  }
 }
 
 }  // end namespace framework
@@ -78,6 +78,12 @@ class Dataset {
   virtual void SetGenerateUniqueFeasign(bool gen_uni_feasigns) = 0;
   // set fea eval mode
   virtual void SetFeaEval(bool fea_eval, int record_candidate_size) = 0;
+  // shuffle the positions of the instances instead of the instances
+  virtual void SetShuffleByIndex(bool shuffle_by_index) = 0;
+  // start a pass of the readers over the shuffle index
+  virtual void PrepareShuffleIndex() = 0;
+  // split the input channel into shard_num locked queues, 1 is one queue
+  virtual void SetChannelShardNum(int shard_num) = 0;
   // get file list
   virtual const std::vector<std::string>& GetFileList() = 0;
   // get thread num
@@ -107,6 +113,11 @@ class Dataset {
   virtual void PreLoadIntoMemory() = 0;
   // wait async load done
   virtual void WaitPreLoadDone() = 0;
+  // fetch the files into memory with thread_num threads of their own, at
+  // most about memory_budget_mb ahead of the parsing, 0 thread_num is off
+  virtual void SetFilePrefetch(int thread_num, int memory_budget_mb) = 0;
+  // start fetching the files, e.g. those of the next pass while training
+  virtual void PrefetchFiles() = 0;
   // release all memory data
   virtual void ReleaseMemory() = 0;
   // local shuffle data
@@ -181,6 +192,8 @@ class DatasetImpl : public Dataset {
   virtual void SetMergeByInsId(int merge_size);
   virtual void SetGenerateUniqueFeasign(bool gen_uni_feasigns);
   virtual void SetFeaEval(bool fea_eval, int record_candidate_size);
+  virtual void SetShuffleByIndex(bool shuffle_by_index);
+  virtual void SetChannelShardNum(int shard_num);
   virtual const std::vector<std::string>& GetFileList() { return filelist_; }
   virtual int GetThreadNum() { return thread_num_; }
   virtual int GetTrainerNum() { return trainer_num_; }
@@ -204,6 +217,8 @@ class DatasetImpl : public Dataset {
   virtual void LoadIntoMemory();
   virtual void PreLoadIntoMemory();
   virtual void WaitPreLoadDone();
+  virtual void SetFilePrefetch(int thread_num, int memory_budget_mb);
+  virtual void PrefetchFiles();
   virtual void ReleaseMemory();
   virtual void LocalShuffle();
   virtual void GlobalShuffle(int thread_num = -1) {}
@@ -252,7 +267,19 @@ class DatasetImpl : public Dataset {
 
   Channel<T>& GetInputChannelRef() { return input_channel_; }
 
+  // With shuffle by index, collects the instances left in the channels into
+  // input_records_, builds the index if they changed, and points the readers
+  // at the start of it. Does nothing otherwise.
+  virtual void PrepareShuffleIndex();
+
  protected:
+  // moves the instances of the channel to the end of input_records_, returns
+  // their number
+  size_t MoveChannelToRecords(const Channel<T>& channel);
+  // the same for input_channel_ and all the output and consume channels
+  size_t MoveChannelsToRecords();
+  // nullptr makes the readers open the files themselves again
+  void SetReadersFilePrefetcher(FilePrefetcher* file_prefetcher);
   virtual int ReceiveFromClient(int msg_type, int client_id,
                                 const std::string& msg) {
     // TODO(yaoxuefeng) for SlotRecordDataset
@@ -305,6 +332,17 @@ class DatasetImpl : public Dataset {
   std::vector<std::shared_ptr<ThreadPool>> consume_task_pool_;
   std::vector<T> input_records_;  // only for paddleboxdatafeed
   bool enable_heterps_ = false;
+  // the instances stay in input_records_ and only shuffle_index_ is shuffled
+  bool shuffle_by_index_ = false;
+  // the next build of shuffle_index_ shuffles it, a global shuffle only sets
+  // it since the instances it receives come in later
+  bool index_shuffle_pending_ = false;
+  ShuffleIndex shuffle_index_;
+  int channel_shard_num_ = 1;
+  int prefetch_thread_num_ = 0;
+  int prefetch_memory_budget_mb_ = 0;
+  // fetches filelist_ for the next load, the readers hold it while loading
+  std::shared_ptr<FilePrefetcher> file_prefetcher_;
 };
 
 // use std::vector<MultiSlotType> or Record as data type
@@ -340,6 +378,11 @@ class MultiSlotDataset : public DatasetImpl<Record> {
  protected:
   virtual int ReceiveFromClient(int msg_type, int client_id,
                                 const std::string& msg);
+  // Global shuffle with shuffle by index: the instances are serialized
+  // straight from input_records_ in batches of fleet_send_batch_size_ per
+  // trainer and freed as soon as they are sent, without going through
+  // input_channel_.
+  void GlobalShuffleByIndex(int thread_num);
 };
 class SlotRecordDataset : public DatasetImpl<SlotRecord> {
  public:
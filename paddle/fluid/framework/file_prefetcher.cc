@@ -0,0 +1,211 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/file_prefetcher.h"
+
+#include <algorithm>
+
+#include "glog/logging.h"
+#include "paddle/fluid/framework/io/fs.h"
+#include "paddle/fluid/platform/enforce.h"
+#include "paddle/fluid/platform/timer.h"
+
+namespace paddle {
+namespace framework {
+
+namespace {
+
+// the fetch threads read the pipes and count the budget in chunks this size
+constexpr size_t kFetchChunkSize = 1 << 20;
+constexpr int kMaxFetchRetry = 3;
+
+}  // namespace
+
+FilePrefetcher::FilePrefetcher(const std::vector<std::string>& filelist,
+                               const std::string& pipe_command,
+                               int thread_num, size_t memory_budget)
+    : filelist_(filelist),
+      pipe_command_(pipe_command),
+      thread_num_(thread_num),
+      memory_budget_(memory_budget) {
+  PADDLE_ENFORCE_GT(thread_num, 0,
+                    platform::errors::InvalidArgument(
+                        "Prefetch thread num should be > 0, but received %d.",
+                        thread_num));
+}
+
+FilePrefetcher::~FilePrefetcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  room_cond_.notify_all();
+  for (auto& t : threads_) {
+    t.join();
+  }
+}
+
+void FilePrefetcher::Start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (started_) {
+    return;
+  }
+  started_ = true;
+  int thread_num = static_cast<int>(
+      std::min(static_cast<size_t>(thread_num_), filelist_.size()));
+  for (int i = 0; i < thread_num; ++i) {
+    threads_.emplace_back(&FilePrefetcher::FetchThread, this);
+  }
+  VLOG(3) << "FilePrefetcher started " << thread_num << " threads for "
+          << filelist_.size() << " files, memory budget " << memory_budget_;
+}
+
+void FilePrefetcher::FetchThread() {
+  while (true) {
+    std::string filename;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      room_cond_.wait(lock, [this] {
+        return stopped_ || next_file_ == filelist_.size() ||
+               buffered_bytes_ < memory_budget_;
+      });
+      if (stopped_ || next_file_ == filelist_.size()) {
+        return;
+      }
+      filename = filelist_[next_file_++];
+    }
+
+    std::unique_ptr<std::string> data(new std::string());
+    bool ok = FetchFile(filename, data.get());
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!ok) {
+        failed_file_ = filename;
+      } else {
+        ready_.push_back(FetchedFile{filename, std::move(data)});
+      }
+    }
+    ready_cond_.notify_all();
+    if (!ok) {
+      return;
+    }
+  }
+}
+
+bool FilePrefetcher::FetchFile(const std::string& filename,
+                               std::string* data) {
+  for (int retry = 0;; ++retry) {
+    int err_no = 0;
+    platform::Timer timeline;
+    timeline.Start();
+    {
+      std::shared_ptr<FILE> fp = fs_open_read(filename, &err_no, pipe_command_);
+      if (fp != nullptr) {
+        size_t size = 0;
+        while (true) {
+          data->resize(size + kFetchChunkSize);
+          size_t n = fread(&(*data)[size], 1, kFetchChunkSize, fp.get());
+          size += n;
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            buffered_bytes_ += n;
+          }
+          if (n < kFetchChunkSize) {
+            break;
+          }
+        }
+        data->resize(size);
+      } else {
+        err_no = -1;
+      }
+    }  // the pipe is closed here and sets err_no when the command failed
+    timeline.Pause();
+    if (err_no == 0) {
+      VLOG(3) << "FilePrefetcher fetched file=" << filename
+              << ", bytes=" << data->size()
+              << ", cost time=" << timeline.ElapsedSec() << " seconds";
+      return true;
+    }
+    Release(data->size());
+    data->clear();
+    LOG(WARNING) << "FilePrefetcher failed to fetch file=" << filename
+                 << ", retry=" << retry;
+    if (retry == kMaxFetchRetry) {
+      return false;
+    }
+  }
+}
+
+void FilePrefetcher::Release(size_t bytes) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffered_bytes_ -= bytes;
+  }
+  room_cond_.notify_all();
+}
+
+bool FilePrefetcher::Next(std::string* filename, std::shared_ptr<FILE>* fp) {
+  FetchedFile file;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ready_cond_.wait(lock, [this] {
+      return !ready_.empty() || taken_num_ == filelist_.size() ||
+             !failed_file_.empty();
+    });
+    PADDLE_ENFORCE_EQ(
+        failed_file_.empty(), true,
+        platform::errors::Unavailable("Failed to fetch file %s with pipe "
+                                      "command %s.",
+                                      failed_file_, pipe_command_));
+    if (ready_.empty()) {
+      return false;
+    }
+    file = std::move(ready_.front());
+    ready_.pop_front();
+    ++taken_num_;
+  }
+
+  *filename = file.filename;
+#if defined(_WIN32) || defined(__APPLE__)
+  PADDLE_THROW(platform::errors::Unimplemented(
+      "File prefetch is only supported on Linux."));
+#else
+  std::string& content = *file.data;
+  // fmemopen can not open an empty buffer
+  FILE* mem_fp = content.empty()
+                     ? fopen("/dev/null", "r")
+                     : fmemopen(&content[0], content.size(), "r");
+  PADDLE_ENFORCE_NOT_NULL(
+      mem_fp, platform::errors::Unavailable(
+                  "Failed to open the fetched file %s in memory.", *filename));
+  std::string* data = file.data.release();
+  // the fetched data may outlive the dataset that fetched it in fp_ of the
+  // readers, so its budget is given back to a prefetcher kept alive for it
+  auto self = shared_from_this();
+  *fp = std::shared_ptr<FILE>(mem_fp, [self, data](FILE* f) {
+    fclose(f);
+    self->Release(data->size());
+    delete data;
+  });
+  return true;
+#endif
+}
+
+size_t FilePrefetcher::BufferedBytes() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return buffered_bytes_;
+}
+
+}  // namespace framework
+}  // namespace paddle
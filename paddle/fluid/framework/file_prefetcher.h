@@ -0,0 +1,88 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdio.h>
+
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+namespace paddle {
+namespace framework {
+
+// Fetches the files of a dataset into memory through the pipe command on
+// threads of its own, so that the download of the next files, or of the
+// whole next pass, runs while the readers parse and the trainers train.
+// The readers take the fetched files in the order they are ready and parse
+// them from memory. A fetch thread only starts a new file while less than
+// memory_budget bytes are fetched and not parsed yet, so at most thread_num
+// files go over the budget. It is owned by a shared_ptr, which the files
+// handed out keep alive.
+class FilePrefetcher : public std::enable_shared_from_this<FilePrefetcher> {
+ public:
+  FilePrefetcher(const std::vector<std::string>& filelist,
+                 const std::string& pipe_command, int thread_num,
+                 size_t memory_budget);
+  ~FilePrefetcher();
+
+  // starts the fetch threads, only the first call does anything
+  void Start();
+
+  // Takes the next fetched file, blocking until one is ready, and returns
+  // false once all files are taken. *fp reads the file from memory, which
+  // is given back to the budget when *fp is closed.
+  bool Next(std::string* filename, std::shared_ptr<FILE>* fp);
+
+  // bytes fetched and not given back yet
+  size_t BufferedBytes();
+
+ private:
+  struct FetchedFile {
+    std::string filename;
+    std::unique_ptr<std::string> data;
+  };
+
+  void FetchThread();
+  // returns false when the pipe command of the file keeps failing
+  bool FetchFile(const std::string& filename, std::string* data);
+  void Release(size_t bytes);
+
+  const std::vector<std::string> filelist_;
+  const std::string pipe_command_;
+  const int thread_num_;
+  const size_t memory_budget_;
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  // a file is ready, or the fetching failed
+  std::condition_variable ready_cond_;
+  // there is room in the budget, or the prefetcher stops
+  std::condition_variable room_cond_;
+  std::deque<FetchedFile> ready_;
+  size_t next_file_ = 0;
+  size_t taken_num_ = 0;
+  size_t buffered_bytes_ = 0;
+  bool started_ = false;
+  bool stopped_ = false;
+  std::string failed_file_;
+};
+
+}  // namespace framework
+}  // namespace paddle
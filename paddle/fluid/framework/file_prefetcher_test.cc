@@ -0,0 +1,120 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/file_prefetcher.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace paddle {
+namespace framework {
+
+static std::vector<std::string> WriteFiles(int file_num, int line_num) {
+  std::vector<std::string> filelist;
+  for (int i = 0; i < file_num; ++i) {
+    filelist.push_back("file_prefetcher_test_" + std::to_string(i) + ".txt");
+    std::ofstream file(filelist.back());
+    // one empty file
+    for (int j = 0; i != 0 && j < line_num; ++j) {
+      file << i << " " << j << "\n";
+    }
+  }
+  return filelist;
+}
+
+static void RemoveFiles(const std::vector<std::string>& filelist) {
+  for (auto& filename : filelist) {
+    remove(filename.c_str());
+  }
+}
+
+TEST(FilePrefetcher, read_all) {
+  auto filelist = WriteFiles(20, 1000);
+  // a budget below one file still moves on as the files are parsed
+  auto prefetcher =
+      std::make_shared<FilePrefetcher>(filelist, "cat", 3, 1024);
+  prefetcher->Start();
+
+  std::map<std::string, std::string> contents;
+  std::mutex mutex;
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&] {
+      std::string filename;
+      std::shared_ptr<FILE> fp;
+      while (prefetcher->Next(&filename, &fp)) {
+        std::string content;
+        char buffer[256];
+        size_t n = 0;
+        while ((n = fread(buffer, 1, sizeof(buffer), fp.get())) > 0) {
+          content.append(buffer, n);
+        }
+        fp = nullptr;
+        std::lock_guard<std::mutex> lock(mutex);
+        contents[filename] = content;
+      }
+    });
+  }
+  for (auto& t : readers) {
+    t.join();
+  }
+
+  ASSERT_EQ(contents.size(), filelist.size());
+  for (auto& filename : filelist) {
+    std::ifstream file(filename);
+    std::string expected((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+    ASSERT_EQ(contents[filename], expected);
+  }
+  ASSERT_EQ(prefetcher->BufferedBytes(), 0UL);
+  RemoveFiles(filelist);
+}
+
+TEST(FilePrefetcher, memory_budget) {
+  auto filelist = WriteFiles(20, 1000);
+  std::ifstream last(filelist.back(), std::ios::ate);
+  size_t file_size = last.tellg();
+  size_t budget = file_size * 3;
+  auto prefetcher =
+      std::make_shared<FilePrefetcher>(filelist, "cat", 2, budget);
+  prefetcher->Start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  // nothing is parsed, so the fetching stops at the budget
+  ASSERT_LE(prefetcher->BufferedBytes(), budget + 2 * file_size);
+  ASSERT_GT(prefetcher->BufferedBytes(), 0UL);
+
+  std::string filename;
+  std::shared_ptr<FILE> fp;
+  int file_num = 0;
+  while (prefetcher->Next(&filename, &fp)) {
+    ++file_num;
+  }
+  fp = nullptr;
+  ASSERT_EQ(file_num, 20);
+  ASSERT_EQ(prefetcher->BufferedBytes(), 0UL);
+  RemoveFiles(filelist);
+}
+
+}  // namespace framework
+}  // namespace paddle
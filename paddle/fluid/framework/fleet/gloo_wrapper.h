@@ -224,6 +224,26 @@ class GlooWrapper {
     return recvbuf;
   }
 
+  // sums element_num numbers of all ranks into output_ptr, in place when
+  // input_ptr is output_ptr
+  template <typename T>
+  void AllReduceVector(T* input_ptr, T* output_ptr, size_t element_num) {
+    CHECK_EQ(is_initialized_, true);
+#ifdef PADDLE_WITH_GLOO
+    gloo::AllreduceOptions opts(context_);
+    if (input_ptr != output_ptr) {
+      opts.setInput(input_ptr, element_num);
+    }
+    opts.setOutput(output_ptr, element_num);
+    opts.setReduceFunction(
+        static_cast<void (*)(void*, const void*, const void*, size_t)>(
+            &gloo::sum<T>));
+    gloo::allreduce(opts);
+#else
+    LOG(WARNING) << "AllReduce does nothing when WITH_GLOO=OFF";
+#endif
+  }
+
   template <typename T>
   std::vector<T> AllGather(T& input) {  // NOLINT
     CHECK_EQ(is_initialized_, true);
@@ -14,6 +14,7 @@ limitations under the License. */
 
 #include "paddle/fluid/framework/ir/fusion_group/code_generator.h"
 #include "paddle/fluid/framework/ir/fusion_group/code_generator_helper.h"
+#include "paddle/fluid/framework/ir/fusion_group/cpu_resources.h"
 #include "paddle/fluid/framework/ir/fusion_group/cuda_resources.h"
 
 namespace paddle {
@@ -42,11 +43,12 @@ std::string ExtractDataType(const std::vector<Node*>& nodes) {
   return dtype_str;
 }
 
-CodeGenerator::CodeGenerator() {
+CodeGenerator::CodeGenerator(bool use_gpu) : use_gpu_(use_gpu) {
   // Only support elementwise operations now.
   code_templates_.resize(1);
 
-  CodeTemplate elementwise_t(cuda_kernel_template_1d);
+  CodeTemplate elementwise_t(use_gpu ? cuda_kernel_template_1d
+                                     : cpu_kernel_template_1d);
   code_templates_[0] = elementwise_t;
 }
 
@@ -170,6 +172,35 @@ std::string CodeGenerator::Generate(
       std::move(DistilIntermediateIds(expressions));
   std::unordered_map<int, std::string> dtypes =
       std::move(DistilDtypes(expressions));
+  std::set<std::string> all_dtype;
+  for (const auto& type : dtypes) {
+    all_dtype.insert(type.second);
+  }
+  if (!use_gpu_) {
+    // There is no __half on CPU.
+    if (all_dtype.find("__half") != all_dtype.end()) {
+      VLOG(3) << "Cannot generate the CPU code of " << func_name
+              << " for float16.";
+      return "";
+    }
+    std::string predefined_cpu_functions = predefined_cpu_headers;
+    if (all_dtype.find("float") != all_dtype.end()) {
+      predefined_cpu_functions += predefined_cpu_functions_fp32;
+    }
+    if (all_dtype.find("double") != all_dtype.end()) {
+      predefined_cpu_functions += predefined_cpu_functions_fp64;
+    }
+    TemplateVariable template_var;
+    template_var.Add("func_name", func_name);
+    template_var.Add("parameters",
+                     EmitCPUParameters(input_ids, output_ids,
+                                       intermediate_output_ids, dtypes));
+    template_var.Add("compute_body",
+                     EmitComputeBody(expressions, input_ids, output_ids,
+                                     intermediate_output_ids, dtypes));
+    return predefined_cpu_functions + code_templates_[0].Format(template_var);
+  }
+
   TemplateVariable template_var;
   template_var.Add("func_name", func_name);
   template_var.Add(
@@ -179,10 +210,6 @@ std::string CodeGenerator::Generate(
                    EmitComputeBody(expressions, input_ids, output_ids,
                                    intermediate_output_ids, dtypes));
 
-  std::set<std::string> all_dtype;
-  for (const auto& type : dtypes) {
-    all_dtype.insert(type.second);
-  }
   std::string predefined_cuda_functions = "";
   if (all_dtype.find("float") != all_dtype.end() &&
       all_dtype.find("__half") == all_dtype.end()) {
@@ -300,6 +327,31 @@ std::string CodeGenerator::EmitParameters(
   return ret.str();
 }
 
+// The CPU kernel gets the same arguments as the GPU kernel in an array, so
+// that the parameters are unpacked from args, where args[0] is N.
+std::string CodeGenerator::EmitCPUParameters(
+    const std::set<int>& input_ids, const std::set<int>& output_ids,
+    const std::set<int>& intermediate_ids,
+    const std::unordered_map<int, std::string>& dtypes) const {
+  std::stringstream ret;
+  int index = 1;
+  for (auto id : input_ids) {
+    if (output_ids.find(id) == output_ids.end()) {
+      ret << "const " << dtypes.at(id) << "* __restrict__ " << ArgName(id)
+          << " = static_cast<const " << dtypes.at(id)
+          << "*>(*static_cast<void**>(args[" << index++ << "]));";
+    }
+  }
+  for (auto id : output_ids) {
+    if (intermediate_ids.find(id) == intermediate_ids.end()) {
+      ret << dtypes.at(id) << "* __restrict__ " << ArgName(id)
+          << " = static_cast<" << dtypes.at(id)
+          << "*>(*static_cast<void**>(args[" << index++ << "]));";
+    }
+  }
+  return ret.str();
+}
+
 std::string CodeGenerator::EmitComputeBody(
     const std::vector<OperationExpression>& expressions,
     const std::set<int>& input_ids, const std::set<int>& output_ids,
@@ -317,9 +369,13 @@ std::string CodeGenerator::EmitComputeBody(
   for (auto id : input_ids) {
     if (output_ids.find(id) == output_ids.end() &&
         used.find(id) != used.end()) {
-      load << dtypes.at(id) << " " << TmpName(id) << " = "
-           << "__ldg(&" << VarName(id) << ")"
-           << ";";
+      load << dtypes.at(id) << " " << TmpName(id) << " = ";
+      if (use_gpu_) {
+        load << "__ldg(&" << VarName(id) << ")";
+      } else {
+        load << VarName(id);
+      }
+      load << ";";
     }
   }
   // Store temporal variables to memory.
@@ -13,7 +13,9 @@ See the License for the specific language governing permissions and
 limitations under the License. */
 
 #include <gtest/gtest.h>
+#include <sys/time.h>
 #include <cmath>
+#include <random>
 #include <string>
 
 #include "paddle/fluid/framework/ir/fusion_group/code_generator.h"
@@ -28,7 +30,7 @@ class LoDTensor;
 }  // namespace framework
 }  // namespace paddle
 
-#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
+#ifndef _WIN32
 
 namespace paddle {
 namespace framework {
@@ -171,6 +173,36 @@ void SetupRandomCPUTensor(LoDTensor* tensor) {
 
 namespace fusion_group = paddle::framework::ir::fusion_group;
 
+void TestMainImplCPU(std::string func_name, std::string code_str,
+                     std::vector<paddle::framework::LoDTensor> cpu_tensors,
+                     int n, std::vector<int> input_ids,
+                     std::vector<int> output_ids) {
+  paddle::platform::CPUPlace place;
+  paddle::platform::CPUDeviceCode device_code(place, func_name, code_str);
+  EXPECT_EQ(device_code.Compile(), true);
+
+  std::vector<float*> ptrs(cpu_tensors.size());
+  std::vector<void*> args;
+  args.push_back(&n);
+
+  for (auto id : input_ids) {
+    if (id >= 0) {
+      fusion_group::SetupRandomCPUTensor<float>(&cpu_tensors[id]);
+      ptrs[id] = cpu_tensors[id].data<float>();
+      args.push_back(&ptrs[id]);
+    }
+  }
+
+  for (auto id : output_ids) {
+    ptrs[id] = cpu_tensors[id].mutable_data<float>(place);
+    args.push_back(&ptrs[id]);
+  }
+
+  device_code.SetWorkloadPerThread(4096);
+  device_code.Launch(n, &args);
+}
+
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
 template <typename T>
 void TestMainImpl(std::string func_name, std::string code_str,
                   std::vector<paddle::framework::LoDTensor> cpu_tensors, int n,
@@ -248,12 +280,13 @@ void TestMainImpl(std::string func_name, std::string code_str,
     }
   }
 }
+#endif
 
 void TestElementwiseMain(
     std::string func_name, std::string code_str,
     std::vector<fusion_group::OperationExpression> expressions,
-    std::vector<int> input_ids, std::vector<int> output_ids,
-    std::string dtype) {
+    std::vector<int> input_ids, std::vector<int> output_ids, std::string dtype,
+    bool use_gpu) {
   std::unordered_set<int> ids;
   for (auto id : input_ids) {
     ids.insert(id);
@@ -271,12 +304,19 @@ void TestElementwiseMain(
   }
 
   int n = cpu_tensors[0].numel();
-  if (dtype == "__half") {
+  if (!use_gpu) {
+    TestMainImplCPU(func_name, code_str, cpu_tensors, n, input_ids,
+                    output_ids);
+  } else if (dtype == "__half") {
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
     TestMainImpl<paddle::platform::float16>(func_name, code_str, cpu_tensors, n,
                                             input_ids, output_ids);
+#endif
   } else {
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
     TestMainImpl<float>(func_name, code_str, cpu_tensors, n, input_ids,
                         output_ids);
+#endif
   }
 
   // Check the results
@@ -290,21 +330,21 @@ void TestElementwiseMain(
 void TestMain(std::string func_name,
               std::vector<fusion_group::OperationExpression> expressions,
               std::vector<int> input_ids, std::vector<int> output_ids,
-              std::string dtype) {
+              std::string dtype, bool use_gpu) {
   fusion_group::OperationMap::Init();
-  fusion_group::CodeGenerator code_generator;
+  fusion_group::CodeGenerator code_generator(use_gpu);
   std::string code_str = code_generator.Generate(func_name, expressions);
   VLOG(3) << code_str;
 
   LOG(INFO) << "dtype: " << dtype;
   TestElementwiseMain(func_name, code_str, expressions, input_ids, output_ids,
-                      dtype);
+                      dtype, use_gpu);
 }
 
 void TestMain(fusion_group::SubGraph* subgraph, std::vector<int> input_ids,
-              std::vector<int> output_ids, std::string dtype) {
+              std::vector<int> output_ids, std::string dtype, bool use_gpu) {
   fusion_group::OperationMap::Init();
-  fusion_group::CodeGenerator code_generator;
+  fusion_group::CodeGenerator code_generator(use_gpu);
   std::string code_str = code_generator.Generate(subgraph);
   VLOG(3) << code_str;
 
@@ -313,60 +353,57 @@ void TestMain(fusion_group::SubGraph* subgraph, std::vector<int> input_ids,
       code_generator.ConvertToExpressions(subgraph);
 
   TestElementwiseMain(subgraph->GetFuncName(), code_str, expressions, input_ids,
-                      output_ids, dtype);
+                      output_ids, dtype, use_gpu);
 }
 
-TEST(code_generator, elementwise) {
-  for (std::string dtype : {"float", "__half"}) {
-    // t2 = t0 * t1
-    // t4 = t2 + t3
-    // t6 = t4 - t5
-    // t7 = relu(t6)
-    // t8 = sigmoid(t7)
-    fusion_group::OperationExpression exp1("elementwise_mul", {0, 1}, {2},
-                                           dtype, dtype);
-    fusion_group::OperationExpression exp2("elementwise_add", {2, 3}, {4},
-                                           dtype, dtype);
-    fusion_group::OperationExpression exp3("elementwise_sub", {4, 5}, {6},
-                                           dtype, dtype);
-    fusion_group::OperationExpression exp4("relu", {6}, {7}, dtype, dtype);
-    fusion_group::OperationExpression exp5("sigmoid", {7}, {8}, dtype, dtype);
-    std::vector<fusion_group::OperationExpression> expressions = {
-        exp1, exp2, exp3, exp4, exp5};
-
-    // Expressions:
-    //  Op(elementwise_mul), inputs:{0,1}, outputs:{2}
-    //  Op(elementwise_add), inputs:{2,3}, outputs:{4}
-    //  Op(elementwise_sub), inputs:{4,5}, outputs:{6}
-    //  Op(relu), inputs:{6}, outputs:{7}
-    //  Op(sigmoid), inputs:{7}, outputs:{8}
-    std::vector<int> input_ids = {0, 1, 3, 5};
-    std::vector<int> output_ids = {2, 4, 6, 7, 8};
-    TestMain("elementwise_kernel_0", expressions, input_ids, output_ids, dtype);
-  }
+void TestElementwise(std::string dtype, bool use_gpu) {
+  // t2 = t0 * t1
+  // t4 = t2 + t3
+  // t6 = t4 - t5
+  // t7 = relu(t6)
+  // t8 = sigmoid(t7)
+  fusion_group::OperationExpression exp1("elementwise_mul", {0, 1}, {2}, dtype,
+                                         dtype);
+  fusion_group::OperationExpression exp2("elementwise_add", {2, 3}, {4}, dtype,
+                                         dtype);
+  fusion_group::OperationExpression exp3("elementwise_sub", {4, 5}, {6}, dtype,
+                                         dtype);
+  fusion_group::OperationExpression exp4("relu", {6}, {7}, dtype, dtype);
+  fusion_group::OperationExpression exp5("sigmoid", {7}, {8}, dtype, dtype);
+  std::vector<fusion_group::OperationExpression> expressions = {
+      exp1, exp2, exp3, exp4, exp5};
+
+  // Expressions:
+  //  Op(elementwise_mul), inputs:{0,1}, outputs:{2}
+  //  Op(elementwise_add), inputs:{2,3}, outputs:{4}
+  //  Op(elementwise_sub), inputs:{4,5}, outputs:{6}
+  //  Op(relu), inputs:{6}, outputs:{7}
+  //  Op(sigmoid), inputs:{7}, outputs:{8}
+  std::vector<int> input_ids = {0, 1, 3, 5};
+  std::vector<int> output_ids = {2, 4, 6, 7, 8};
+  TestMain("elementwise_kernel_0", expressions, input_ids, output_ids, dtype,
+           use_gpu);
 }
 
-TEST(code_generator, elementwise_grad) {
-  for (std::string dtype : {"float", "__half"}) {
-    // The var order: t0, t1, t2, t3, t0', t1', t2', t3'
-    // t2 = t0 * t1
-    // t3 = relu(t2)
-    // t2' = relu_grad(t2, t3, t3')
-    // t0', t1' = elementwise_mul_grad(t0, t1, t2, t2')
-    fusion_group::OperationExpression exp1("relu_grad", {-1, 3, 7}, {6}, dtype,
-                                           dtype);
-    fusion_group::OperationExpression exp2("elementwise_mul_grad", {0, 1, 2, 6},
-                                           {4, 5}, dtype, dtype);
-    std::vector<fusion_group::OperationExpression> expressions = {exp1, exp2};
-
-    // Expressions:
-    //  Op(relu_grad), inputs:{2,3,7}, outputs:{6}
-    //  Op(elementwise_mul_grad), inputs:{0,1,2,6}, outputs:{4,5}
-    std::vector<int> input_ids = {0, 1, 2, 3, 7};
-    std::vector<int> output_ids = {4, 5, 6};
-    TestMain("elementwise_grad_kernel_0", expressions, input_ids, output_ids,
-             dtype);
-  }
+void TestElementwiseGrad(std::string dtype, bool use_gpu) {
+  // The var order: t0, t1, t2, t3, t0', t1', t2', t3'
+  // t2 = t0 * t1
+  // t3 = relu(t2)
+  // t2' = relu_grad(t2, t3, t3')
+  // t0', t1' = elementwise_mul_grad(t0, t1, t2, t2')
+  fusion_group::OperationExpression exp1("relu_grad", {-1, 3, 7}, {6}, dtype,
+                                         dtype);
+  fusion_group::OperationExpression exp2("elementwise_mul_grad", {0, 1, 2, 6},
+                                         {4, 5}, dtype, dtype);
+  std::vector<fusion_group::OperationExpression> expressions = {exp1, exp2};
+
+  // Expressions:
+  //  Op(relu_grad), inputs:{2,3,7}, outputs:{6}
+  //  Op(elementwise_mul_grad), inputs:{0,1,2,6}, outputs:{4,5}
+  std::vector<int> input_ids = {0, 1, 2, 3, 7};
+  std::vector<int> output_ids = {4, 5, 6};
+  TestMain("elementwise_grad_kernel_0", expressions, input_ids, output_ids,
+           dtype, use_gpu);
 }
 
 std::unique_ptr<paddle::framework::ir::Graph> BuildGraph(bool backward,
@@ -467,41 +504,203 @@ std::unordered_set<paddle::framework::ir::Node*> DistilGradNodes(
   return grad_nodes;
 }
 
-TEST(code_generator, subgraph) {
+void TestSubgraph(std::string dtype, bool use_gpu) {
+  std::unique_ptr<paddle::framework::ir::Graph> graph =
+      BuildGraph(false, dtype);
+  fusion_group::SubGraph subgraph(0, "elementwise_kernel_1", true,
+                                  graph->Nodes());
+
+  // Expressions generated by code_generator (they may be different):
+  //  Op(sigmoid), inputs:{0}, outputs:{4}
+  //  Op(elementwise_mul), inputs:{4,1}, outputs:{7}
+  //  Op(tanh), inputs:{2}, outputs:{5}
+  //  Op(elementwise_mul), inputs:{3,5}, outputs:{6}
+  //  Op(elementwise_add), inputs:{7,6}, outputs:{8}
+  std::vector<int> input_ids = {0, 1, 2, 3};
+  std::vector<int> output_ids = {4, 5, 6, 7, 8};
+  TestMain(&subgraph, input_ids, output_ids, dtype, use_gpu);
+}
+
+void TestSubgraphGrad(std::string dtype, bool use_gpu) {
+  std::unique_ptr<paddle::framework::ir::Graph> graph = BuildGraph(true, dtype);
+  fusion_group::SubGraph subgraph(0, "elementwise_grad_kernel_1", true,
+                                  DistilGradNodes(graph));
+
+  // Expressions generated by code_generator (they may be different):
+  //  Op(elementwise_add_grad), inputs:{1,2,3,0}, outputs:{11,10}
+  //  Op(elementwise_mul_grad), inputs:{5,4,2,10}, outputs:{17,13}
+  //  Op(elementwise_mul_grad), inputs:{7,6,1,11}, outputs:{12,15}
+  //  Op(sigmoid_grad), inputs:{8,7,12}, outputs:{16}
+  //  Op(tanh_grad), inputs:{9,4,13}, outputs:{14}
+  std::vector<int> input_ids = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  std::vector<int> output_ids = {10, 11, 12, 13, 14, 15, 16, 17};
+  TestMain(&subgraph, input_ids, output_ids, dtype, use_gpu);
+}
+
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
+TEST(code_generator, elementwise) {
   for (std::string dtype : {"float", "__half"}) {
-    std::unique_ptr<paddle::framework::ir::Graph> graph =
-        BuildGraph(false, dtype);
-    fusion_group::SubGraph subgraph(0, "elementwise_kernel_1", true,
-                                    graph->Nodes());
+    TestElementwise(dtype, true);
+  }
+}
 
-    // Expressions generated by code_generator (they may be different):
-    //  Op(sigmoid), inputs:{0}, outputs:{4}
-    //  Op(elementwise_mul), inputs:{4,1}, outputs:{7}
-    //  Op(tanh), inputs:{2}, outputs:{5}
-    //  Op(elementwise_mul), inputs:{3,5}, outputs:{6}
-    //  Op(elementwise_add), inputs:{7,6}, outputs:{8}
-    std::vector<int> input_ids = {0, 1, 2, 3};
-    std::vector<int> output_ids = {4, 5, 6, 7, 8};
-    TestMain(&subgraph, input_ids, output_ids, dtype);
+TEST(code_generator, elementwise_grad) {
+  for (std::string dtype : {"float", "__half"}) {
+    TestElementwiseGrad(dtype, true);
+  }
+}
+
+TEST(code_generator, subgraph) {
+  for (std::string dtype : {"float", "__half"}) {
+    TestSubgraph(dtype, true);
   }
 }
 
 TEST(code_generator, subgraph_grad) {
   for (std::string dtype : {"float", "__half"}) {
-    std::unique_ptr<paddle::framework::ir::Graph> graph =
-        BuildGraph(true, dtype);
-    fusion_group::SubGraph subgraph(0, "elementwise_grad_kernel_1", true,
-                                    DistilGradNodes(graph));
-
-    // Expressions generated by code_generator (they may be different):
-    //  Op(elementwise_add_grad), inputs:{1,2,3,0}, outputs:{11,10}
-    //  Op(elementwise_mul_grad), inputs:{5,4,2,10}, outputs:{17,13}
-    //  Op(elementwise_mul_grad), inputs:{7,6,1,11}, outputs:{12,15}
-    //  Op(sigmoid_grad), inputs:{8,7,12}, outputs:{16}
-    //  Op(tanh_grad), inputs:{9,4,13}, outputs:{14}
-    std::vector<int> input_ids = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
-    std::vector<int> output_ids = {10, 11, 12, 13, 14, 15, 16, 17};
-    TestMain(&subgraph, input_ids, output_ids, dtype);
+    TestSubgraphGrad(dtype, true);
+  }
+}
+#endif
+
+TEST(code_generator, elementwise_cpu) {
+  if (!paddle::platform::CPUDeviceCode::IsAvailable()) {
+    return;
+  }
+  TestElementwise("float", false);
+  TestElementwiseGrad("float", false);
+}
+
+TEST(code_generator, subgraph_cpu) {
+  if (!paddle::platform::CPUDeviceCode::IsAvailable()) {
+    return;
+  }
+  TestSubgraph("float", false);
+  TestSubgraphGrad("float", false);
+}
+
+TEST(code_generator, float16_cpu) {
+  fusion_group::OperationMap::Init();
+  fusion_group::OperationExpression exp("relu", {0}, {1}, "__half", "__half");
+  fusion_group::CodeGenerator code_generator(false);
+  EXPECT_EQ(code_generator.Generate("relu_kernel", {exp}), "");
+}
+
+inline double GetCurrentUS() {
+  struct timeval time;
+  gettimeofday(&time, NULL);
+  return 1e+6 * time.tv_sec + time.tv_usec;
+}
+
+// Launches the kernel of expressions, where the arguments are ordered as the
+// parameters generated, the inputs first and then the outputs.
+void LaunchCPUKernel(const paddle::platform::DeviceCode& device_code,
+                     const std::vector<fusion_group::OperationExpression>& exps,
+                     std::vector<float*>* ptrs, int n) {
+  std::set<int> input_ids;
+  std::set<int> output_ids;
+  std::set<int> intermediate_ids;
+  for (auto& exp : exps) {
+    for (auto id : exp.GetInputIds()) {
+      input_ids.insert(id);
+    }
+    for (auto id : exp.GetOutputIds()) {
+      output_ids.insert(id);
+    }
+    for (auto id : exp.GetIntermediateOutputIds()) {
+      intermediate_ids.insert(id);
+    }
+  }
+  std::vector<void*> args;
+  args.push_back(&n);
+  for (auto id : input_ids) {
+    if (output_ids.find(id) == output_ids.end()) {
+      args.push_back(&(*ptrs)[id]);
+    }
+  }
+  for (auto id : output_ids) {
+    if (intermediate_ids.find(id) == intermediate_ids.end()) {
+      args.push_back(&(*ptrs)[id]);
+    }
+  }
+  device_code.Launch(n, &args);
+}
+
+TEST(code_generator, cpu_fused_vs_unfused) {
+  if (!paddle::platform::CPUDeviceCode::IsAvailable()) {
+    return;
+  }
+  // t2 = t0 * t1, t4 = t2 + t3, t6 = t4 - t5, t7 = relu(t6), t8 = sigmoid(t7)
+  //
+  // The unfused kernels write and read the intermediate outputs, while the
+  // fused kernel keeps them in registers.
+  std::string dtype = "float";
+  std::vector<fusion_group::OperationExpression> unfused = {
+      fusion_group::OperationExpression("elementwise_mul", {0, 1}, {2}, dtype,
+                                        dtype),
+      fusion_group::OperationExpression("elementwise_add", {2, 3}, {4}, dtype,
+                                        dtype),
+      fusion_group::OperationExpression("elementwise_sub", {4, 5}, {6}, dtype,
+                                        dtype),
+      fusion_group::OperationExpression("relu", {6}, {7}, dtype, dtype),
+      fusion_group::OperationExpression("sigmoid", {7}, {8}, dtype, dtype)};
+  std::vector<fusion_group::OperationExpression> fused = {
+      fusion_group::OperationExpression("elementwise_mul", {0, 1}, {2}, dtype,
+                                        dtype, {2}),
+      fusion_group::OperationExpression("elementwise_add", {2, 3}, {4}, dtype,
+                                        dtype, {4}),
+      fusion_group::OperationExpression("elementwise_sub", {4, 5}, {6}, dtype,
+                                        dtype, {6}),
+      fusion_group::OperationExpression("relu", {6}, {7}, dtype, dtype, {7}),
+      fusion_group::OperationExpression("sigmoid", {7}, {8}, dtype, dtype)};
+
+  fusion_group::OperationMap::Init();
+  fusion_group::CodeGenerator code_generator(false);
+  paddle::platform::CPUPlace place;
+  std::vector<std::unique_ptr<paddle::platform::CPUDeviceCode>> unfused_codes;
+  for (size_t i = 0; i < unfused.size(); ++i) {
+    std::string func_name = "unfused_kernel_" + std::to_string(i);
+    unfused_codes.emplace_back(new paddle::platform::CPUDeviceCode(
+        place, func_name, code_generator.Generate(func_name, {unfused[i]})));
+    ASSERT_EQ(unfused_codes.back()->Compile(), true);
+  }
+  paddle::platform::CPUDeviceCode fused_code(
+      place, "fused_kernel", code_generator.Generate("fused_kernel", fused));
+  ASSERT_EQ(fused_code.Compile(), true);
+
+  int n = 1 << 21;
+  auto dims = paddle::framework::make_ddim({n});
+  std::vector<paddle::framework::LoDTensor> tensors(9);
+  std::vector<float*> ptrs(tensors.size());
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    ptrs[i] = tensors[i].mutable_data<float>(dims, place);
+  }
+  for (int id : {0, 1, 3, 5}) {
+    fusion_group::SetupRandomCPUTensor<float>(&tensors[id]);
+  }
+  paddle::framework::LoDTensor unfused_out;
+  unfused_out.mutable_data<float>(dims, place);
+
+  const int repeat = 20;
+  auto st = GetCurrentUS();
+  for (int i = 0; i < repeat; ++i) {
+    for (size_t j = 0; j < unfused.size(); ++j) {
+      LaunchCPUKernel(*unfused_codes[j], {unfused[j]}, &ptrs, n);
+    }
+  }
+  auto mt = GetCurrentUS();
+  TensorCopySync(tensors[8], place, &unfused_out);
+  for (int i = 0; i < repeat; ++i) {
+    LaunchCPUKernel(fused_code, fused, &ptrs, n);
+  }
+  auto et = GetCurrentUS();
+
+  LOG(INFO) << "Elementwise chain of " << n << " elements: unfused takes "
+            << (mt - st) / repeat << " us, fused takes " << (et - mt) / repeat
+            << " us.";
+  for (int i = 0; i < n; ++i) {
+    EXPECT_NEAR(tensors[8].data<float>()[i], unfused_out.data<float>()[i],
+                1e-5);
   }
 }
 #endif
@@ -0,0 +1,62 @@
+/* Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License. */
+
+#pragma once
+
+namespace paddle {
+namespace framework {
+namespace ir {
+namespace fusion_group {
+
+static constexpr char predefined_cpu_headers[] = R"(
+#include <cmath>
+#include <cstddef>
+
+)";
+
+static constexpr char predefined_cpu_functions_fp32[] = R"(
+inline float Max(float x, float y) { return x > y ? x : y; }
+inline float Exp(float x) { return std::exp(x); }
+inline float Log(float x) { return std::log(x); }
+inline float Sqrt(float x) { return std::sqrt(x); }
+
+)";
+
+static constexpr char predefined_cpu_functions_fp64[] = R"(
+inline double Max(double x, double y) { return x > y ? x : y; }
+inline double Exp(double x) { return std::exp(x); }
+inline double Log(double x) { return std::log(x); }
+inline double Sqrt(double x) { return std::sqrt(x); }
+
+)";
+
+// The elements in [begin, end) are computed in one vectorized loop, and
+// args[0] is the number of all the elements, args[i] is the pointer to the
+// data of the (i - 1)-th input or output.
+static constexpr char cpu_kernel_template_1d[] = R"(
+extern "C" void $func_name(size_t begin, size_t end, void** args) {
+  $parameters
+#pragma omp simd
+  for(size_t idx = begin;
+      idx < end;
+      ++idx) {
+    $compute_body
+  }
+}
+)";
+
+}  // namespace fusion_group
+}  // namespace ir
+}  // namespace framework
+}  // namespace paddle
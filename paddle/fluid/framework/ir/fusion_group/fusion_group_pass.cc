@@ -33,26 +33,37 @@ class Node;
 
 void FusionGroupPass::ApplyImpl(ir::Graph* graph) const {
   FusePassBase::Init("fusion_group_pass", graph);
+  bool use_gpu = Get<bool>("use_gpu");
+  // TODO(liuyiqun): open this check.
+  // if (use_gpu && !platform::CUDADeviceCode::IsAvailable()) {
+  //   LOG(WARNING)
+  //       << "Disable fusion_group because CUDA Driver or NVRTC is not
+  //       avaiable.";
+  //   return;
+  // }
+  if (!use_gpu && !platform::CPUDeviceCode::IsAvailable()) {
+    LOG(WARNING) << "Disable fusion_group on CPU because the host compiler "
+                    "is not available.";
+    return;
+  }
+
+  fusion_group::OperationMap::Init();
+  int num_elementwise_groups = DetectFusionGroup(graph, 0);
+  AddStatis(num_elementwise_groups);
+  LOG(INFO) << "Detect " << num_elementwise_groups
+            << " elementwise fusion groups.";
+}
+
+platform::Place FusionGroupPass::GetPlace() const {
+  // TODO(liuyiqun): supported different places
   if (Get<bool>("use_gpu")) {
-    // TODO(liuyiqun): open this check.
-    // if (!platform::CUDADeviceCode::IsAvailable()) {
-    //   LOG(WARNING)
-    //       << "Disable fusion_group because CUDA Driver or NVRTC is not
-    //       avaiable.";
-    //   return 0;
-    // }
-
-    fusion_group::OperationMap::Init();
-    int num_elementwise_groups = DetectFusionGroup(graph, 0);
-    AddStatis(num_elementwise_groups);
-    LOG(INFO) << "Detect " << num_elementwise_groups
-              << " elementwise fusion groups.";
+    return platform::CUDAPlace(0);
   }
+  return platform::CPUPlace();
 }
 
 int FusionGroupPass::DetectFusionGroup(Graph* graph, int type) const {
-  // TODO(liuyiqun): supported different places
-  platform::CUDAPlace place = platform::CUDAPlace(0);
+  platform::Place place = GetPlace();
   int index = platform::DeviceCodePool::Init({place}).size(place);
 
   std::vector<std::vector<Node*>> subgraphs =
@@ -79,14 +90,27 @@ int FusionGroupPass::DetectFusionGroup(Graph* graph, int type) const {
 }
 
 bool FusionGroupPass::GenerateCode(fusion_group::SubGraph* subgraph) const {
-  fusion_group::CodeGenerator code_generator;
+  bool use_gpu = Get<bool>("use_gpu");
+  fusion_group::CodeGenerator code_generator(use_gpu);
   std::string code_str = code_generator.Generate(subgraph);
   VLOG(4) << code_str;
+  if (code_str.empty()) {
+    return false;
+  }
 
-  // TODO(liuyiqun): supported different places
-  platform::CUDAPlace place = platform::CUDAPlace(0);
-  std::unique_ptr<platform::CUDADeviceCode> device_code(
-      new platform::CUDADeviceCode(place, subgraph->GetFuncName(), code_str));
+  platform::Place place = GetPlace();
+  std::unique_ptr<platform::DeviceCode> device_code;
+  if (use_gpu) {
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
+    device_code.reset(new platform::CUDADeviceCode(
+        place, subgraph->GetFuncName(), code_str));
+#else
+    return false;
+#endif
+  } else {
+    device_code.reset(new platform::CPUDeviceCode(
+        place, subgraph->GetFuncName(), code_str));
+  }
   bool is_compiled = device_code->Compile();
   if (is_compiled) {
     platform::DeviceCodePool& pool = platform::DeviceCodePool::Init({place});
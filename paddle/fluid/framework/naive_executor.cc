@@ -13,9 +13,12 @@
 // limitations under the License.
 
 #include "paddle/fluid/framework/naive_executor.h"
+#include <algorithm>
 #include <string>
 #include "paddle/fluid/framework/op_registry.h"
+#include "paddle/fluid/framework/static_memory_plan.h"
 #include "paddle/fluid/framework/variable_helper.h"
+#include "paddle/fluid/memory/malloc.h"
 #include "paddle/fluid/platform/denormal.h"
 #ifdef PADDLE_WITH_MKLDNN
 #include "paddle/fluid/platform/mkldnn_helper.h"
@@ -23,6 +26,54 @@
 
 namespace paddle {
 namespace framework {
+
+// Offsets in the arena are aligned as the allocators align.
+static constexpr size_t kArenaAlignment = 256;
+// The input shapes planned at most, the others run without plan.
+static constexpr size_t kMaxMemoryPlans = 16;
+
+// A part of the arena bound to a tensor, keeps the arena alive.
+class ArenaSlice : public memory::Allocation {
+ public:
+  ArenaSlice(std::shared_ptr<memory::Allocation> arena, size_t offset,
+             size_t size)
+      : memory::Allocation(static_cast<uint8_t *>(arena->ptr()) + offset,
+                           size, arena->place()),
+        arena_(std::move(arena)) {}
+
+ private:
+  std::shared_ptr<memory::Allocation> arena_;
+};
+
+struct NaiveExecutor::MemoryPlan {
+  struct Slot {
+    Variable *var;
+    size_t offset;
+    size_t size;
+    std::shared_ptr<memory::Allocation> slice;
+  };
+  std::vector<Slot> slots;
+  size_t arena_size;
+  // The arena the slices are cut from.
+  memory::Allocation *arena{nullptr};
+};
+
+// The memory of the tensors seen in a run without plan.
+struct NaiveExecutor::MemoryProfile {
+  std::unordered_map<std::string, size_t> sizes;
+  // The tensors sharing the memory of another one, mapped to it.
+  std::unordered_map<std::string, std::string> aliases;
+  // The owner of every memory seen, empty for the memory not planned. The
+  // memory is held so that its address is not reused in the run.
+  std::unordered_map<memory::Allocation *,
+                     std::pair<std::shared_ptr<memory::Allocation>,
+                               std::string>>
+      owners;
+  // The tensors owning a memory not planned.
+  std::unordered_set<std::string> excluded;
+  bool failed{false};
+};
+
 void NaiveExecutor::Prepare(Scope *scope, const ProgramDesc &program_desc,
                             int block_id, bool with_feed_fetch_ops) {
   if (!scope) {
@@ -40,12 +91,264 @@ void NaiveExecutor::Run() {
   platform::AttachPointerHashToMKLDNNKey(this, place_);
 #endif
   platform::ScopedFlushDenormal flush;
-  for (auto &op : ops_) {
+  std::string shape_key;
+  std::unique_ptr<MemoryProfile> profile;
+  if (memory_plan_enabled_) {
+    if (!lifetimes_analyzed_) {
+      AnalyzeVarLifetimes();
+    }
+    if (memory_plan_supported_) {
+      shape_key = InputShapeKey();
+      auto it = memory_plans_.find(shape_key);
+      if (it != memory_plans_.end() && it->second) {
+        BindMemoryPlan(it->second.get());
+      } else {
+        ReleaseMemoryPlan();
+      }
+      if (it == memory_plans_.end() &&
+          memory_plans_.size() < kMaxMemoryPlans) {
+        profile.reset(new MemoryProfile);
+        // the ops may share the memory of the inputs and parameters
+        auto seed = [&](const std::string &name) {
+          auto *var = scope_->FindVar(name);
+          if (var && var->IsType<LoDTensor>()) {
+            auto &holder = var->Get<LoDTensor>().Holder();
+            if (holder) {
+              profile->owners[holder.get()] = std::make_pair(holder, "");
+            }
+          }
+        };
+        std::for_each(input_vars_.begin(), input_vars_.end(), seed);
+        std::for_each(persistable_vars_.begin(), persistable_vars_.end(),
+                      seed);
+      }
+    }
+  }
+  for (size_t i = 0; i < ops_.size(); ++i) {
+    auto &op = ops_[i];
     VLOG(4) << std::this_thread::get_id() << " run "
             << op->DebugStringEx(scope_) << " on scope " << scope_;
     op->SetIsCalledByExecutor(false);
     op->Run(*scope_, place_);
+    if (profile) {
+      ProfileOp(i, profile.get());
+    }
   }
+  if (profile) {
+    if (profile->failed) {
+      VLOG(3) << "No memory plan for the input shapes " << shape_key
+              << ", some tensor both owns and shares memory.";
+      memory_plans_[shape_key] = nullptr;
+    } else {
+      memory_plans_[shape_key] = BuildMemoryPlan(*profile);
+    }
+  }
+}
+
+void NaiveExecutor::SetFetchTargets(const std::vector<std::string> &names) {
+  std::unordered_set<std::string> targets(names.begin(), names.end());
+  if (targets == fetch_targets_) return;
+  fetch_targets_.swap(targets);
+  // the plans are built with the lifetimes of the old targets
+  ReleaseMemoryPlan();
+  memory_plans_.clear();
+  lifetimes_analyzed_ = false;
+}
+
+void NaiveExecutor::AnalyzeVarLifetimes() {
+  lifetimes_analyzed_ = true;
+  var_lifetimes_.clear();
+  input_vars_.clear();
+  std::unordered_set<std::string> inputs;
+  std::unordered_map<std::string, size_t> last_read, last_write;
+  for (size_t i = 0; i < ops_.size(); ++i) {
+    auto &op = ops_[i];
+    if (op->HasAttr("sub_block")) {
+      // the ops in the sub blocks use the tensors out of sight
+      VLOG(3) << "No memory plan for the program with " << op->Type();
+      memory_plan_supported_ = false;
+      return;
+    }
+    for (auto &item : op->Inputs()) {
+      for (auto &name : item.second) {
+        if (name == kEmptyVarName || persistable_vars_.count(name)) continue;
+        if (!var_lifetimes_.count(name)) {
+          inputs.insert(name);
+          continue;
+        }
+        var_lifetimes_[name].second = i;
+        last_read[name] = i;
+      }
+    }
+    for (auto &item : op->Outputs()) {
+      for (auto &name : item.second) {
+        if (name == kEmptyVarName || persistable_vars_.count(name)) continue;
+        // the fed tensors are owned by the caller
+        if (op->Type() == "feed" || inputs.count(name)) {
+          inputs.insert(name);
+          continue;
+        }
+        if (!var_lifetimes_.count(name)) {
+          var_lifetimes_[name] = std::make_pair(i, i);
+        }
+        var_lifetimes_[name].second = i;
+        last_write[name] = i;
+      }
+    }
+  }
+  // The tensors not read after written may be fetched by the caller.
+  for (auto &item : last_write) {
+    auto it = last_read.find(item.first);
+    if (it == last_read.end() || it->second < item.second) {
+      var_lifetimes_[item.first].second = ops_.size();
+    }
+  }
+  for (auto &name : fetch_targets_) {
+    auto it = var_lifetimes_.find(name);
+    if (it != var_lifetimes_.end()) {
+      it->second.second = ops_.size();
+    }
+  }
+  input_vars_.assign(inputs.begin(), inputs.end());
+  std::sort(input_vars_.begin(), input_vars_.end());
+}
+
+std::string NaiveExecutor::InputShapeKey() const {
+  std::string key;
+  for (auto &name : input_vars_) {
+    auto *var = scope_->FindVar(name);
+    if (var == nullptr || !var->IsType<LoDTensor>()) continue;
+    auto &tensor = var->Get<LoDTensor>();
+    key += name;
+    key += ':';
+    key += tensor.dims().to_str();
+    key += ';';
+  }
+  return key;
+}
+
+void NaiveExecutor::ProfileOp(size_t op_idx, MemoryProfile *profile) const {
+  for (auto &item : ops_[op_idx]->Outputs()) {
+    for (auto &name : item.second) {
+      if (!var_lifetimes_.count(name)) continue;
+      auto *var = scope_->FindVar(name);
+      if (var == nullptr || !var->IsType<LoDTensor>()) continue;
+      auto &tensor = var->Get<LoDTensor>();
+      auto &holder = tensor.Holder();
+      if (!holder) continue;
+      auto it = profile->owners.find(holder.get());
+      if (it == profile->owners.end()) {
+        if (profile->aliases.count(name)) {
+          // shared another memory before, and owns one now
+          profile->failed = true;
+          return;
+        }
+        if (!platform::is_same_place(holder->place(), place_) ||
+            tensor.offset() != 0) {
+          profile->owners[holder.get()] = std::make_pair(holder, "");
+          profile->excluded.insert(name);
+          continue;
+        }
+        profile->owners[holder.get()] = std::make_pair(holder, name);
+        auto &size = profile->sizes[name];
+        size = std::max(size, tensor.memory_size());
+      } else if (it->second.second != name) {
+        if (profile->sizes.count(name)) {
+          // owned a memory before, and shares another one now
+          profile->failed = true;
+          return;
+        }
+        profile->aliases[name] = it->second.second;
+      }
+    }
+  }
+}
+
+std::unique_ptr<NaiveExecutor::MemoryPlan> NaiveExecutor::BuildMemoryPlan(
+    const MemoryProfile &profile) {
+  std::unordered_map<std::string, size_t> last_op;
+  for (auto &item : profile.sizes) {
+    last_op[item.first] = var_lifetimes_.at(item.first).second;
+  }
+  for (auto &item : profile.aliases) {
+    if (item.second.empty()) continue;
+    // the memory lives as long as the tensors sharing it
+    auto &last = last_op[item.second];
+    last = std::max(last, var_lifetimes_.at(item.first).second);
+  }
+
+  std::vector<std::string> names;
+  for (auto &item : profile.sizes) {
+    if (item.second > 0 && !profile.excluded.count(item.first)) {
+      names.push_back(item.first);
+    }
+  }
+  std::sort(names.begin(), names.end());
+
+  std::unique_ptr<MemoryPlan> plan(new MemoryPlan);
+  std::vector<MemoryBlock> blocks;
+  for (auto &name : names) {
+    auto *var = scope_->FindVar(name);
+    if (var == nullptr) continue;
+    size_t size = profile.sizes.at(name);
+    plan->slots.push_back({var, 0, size, nullptr});
+    blocks.push_back({size, var_lifetimes_.at(name).first, last_op[name]});
+  }
+  plan->arena_size = PlanMemoryOffsets(&blocks, kArenaAlignment);
+  size_t total = 0;
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    plan->slots[i].offset = blocks[i].offset;
+    total += blocks[i].size;
+  }
+  if (!arena_ || arena_->size() < plan->arena_size) {
+    // the slices of the other plans hold the old arena, they are cut again
+    // from the new one when bound
+    for (auto &item : memory_plans_) {
+      if (!item.second) continue;
+      for (auto &slot : item.second->slots) slot.slice = nullptr;
+      item.second->arena = nullptr;
+    }
+    arena_.reset();
+    arena_ = memory::AllocShared(place_, plan->arena_size);
+  }
+  VLOG(3) << "Memory plan of " << plan->slots.size() << " tensors, "
+          << total << " bytes in an arena of " << plan->arena_size
+          << " bytes";
+  return plan;
+}
+
+void NaiveExecutor::BindMemoryPlan(MemoryPlan *plan) {
+  if (plan->arena == nullptr) {
+    for (auto &slot : plan->slots) {
+      slot.slice = std::make_shared<ArenaSlice>(arena_, slot.offset, slot.size);
+    }
+    plan->arena = arena_.get();
+  }
+  if (bound_plan_ != plan) {
+    ReleaseMemoryPlan();
+    bound_plan_ = plan;
+  }
+  for (auto &slot : plan->slots) {
+    auto *tensor = slot.var->GetMutable<LoDTensor>();
+    if (tensor->Holder() != slot.slice) {
+      tensor->clear();
+      tensor->ResetHolder(slot.slice);
+    }
+  }
+}
+
+void NaiveExecutor::ReleaseMemoryPlan() {
+  if (bound_plan_ == nullptr) return;
+  // the slices overlap as planned for the lifetimes, not for other shapes
+  for (auto &item : var_lifetimes_) {
+    auto *var = scope_->FindVar(item.first);
+    if (var == nullptr || !var->IsType<LoDTensor>()) continue;
+    auto *tensor = var->GetMutable<LoDTensor>();
+    if (dynamic_cast<ArenaSlice *>(tensor->Holder().get())) {
+      tensor->clear();
+    }
+  }
+  bound_plan_ = nullptr;
 }
 
 void NaiveExecutor::CreateVariables(const ProgramDesc &desc, int block_id,
@@ -92,6 +395,11 @@ void NaiveExecutor::CreateVariables(const ProgramDesc &desc, int block_id,
 
 void NaiveExecutor::CreateOps(const ProgramDesc &desc, int block_id,
                               bool with_feed_fetch_ops) {
+  for (auto *var : desc.Block(block_id).AllVars()) {
+    if (var->Persistable()) {
+      persistable_vars_.insert(var->Name());
+    }
+  }
   for (const auto &op_desc : desc.Block(block_id).AllOps()) {
     if (!with_feed_fetch_ops &&
         (op_desc->Type() == "feed" || op_desc->Type() == "fetch")) {
@@ -122,6 +430,9 @@ void NaiveExecutor::CleanFeedFetchOps() {
     }
   }
   ops_.swap(ops);
+  ReleaseMemoryPlan();
+  lifetimes_analyzed_ = false;
+  memory_plans_.clear();
 }
 
 NaiveExecutor::~NaiveExecutor() {
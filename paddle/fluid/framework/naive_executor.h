@@ -16,11 +16,19 @@
 
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
+#ifdef PADDLE_WITH_TESTING
+#include <gtest/gtest_prod.h>
+#endif
+
 #include "paddle/fluid/framework/operator.h"
 #include "paddle/fluid/framework/program_desc.h"
 #include "paddle/fluid/framework/scope.h"
+#include "paddle/fluid/memory/allocation/allocator.h"
 #include "paddle/fluid/platform/device_context.h"
 #include "paddle/fluid/platform/place.h"
 
@@ -63,15 +71,54 @@ class NaiveExecutor {
 
   void CleanFeedFetchOps();
 
+  // Pack the temporary tensors into one arena, planned with their sizes in
+  // the first run of each input shape and their lifetimes in the op order.
+  // The later runs of that shape bind the tensors to the arena before
+  // running, so that the ops allocate no memory for them. A tensor larger
+  // than planned, e.g. by its LoD, is still allocated by its op.
+  void EnableMemoryPlan(bool enable = true) { memory_plan_enabled_ = enable; }
+
+  // The tensors read by the caller after the run, kept alive to the end of
+  // the plan even if a later op reads them, e.g. without the fetch ops.
+  void SetFetchTargets(const std::vector<std::string>& names);
+
  protected:
   void CreateOps(const ProgramDesc& desc, int block_id,
                  bool with_feed_fetch_ops);
 
  private:
+  struct MemoryPlan;
+  struct MemoryProfile;
+
+  void AnalyzeVarLifetimes();
+  std::string InputShapeKey() const;
+  void ProfileOp(size_t op_idx, MemoryProfile* profile) const;
+  std::unique_ptr<MemoryPlan> BuildMemoryPlan(const MemoryProfile& profile);
+  void BindMemoryPlan(MemoryPlan* plan);
+  void ReleaseMemoryPlan();
+#ifdef PADDLE_WITH_TESTING
+  FRIEND_TEST(NaiveExecutor, MemoryPlanGrowingShapes);
+#endif
+
   const platform::Place place_;
   // Catch the required resource to avoid recreate.
   std::vector<std::unique_ptr<OperatorBase>> ops_;
   Scope* scope_;
+
+  bool memory_plan_enabled_{false};
+  std::unordered_set<std::string> persistable_vars_;
+  // The lifetimes of the temporary tensors in ops_, and the tensors read
+  // before written, whose shapes select the plan.
+  bool lifetimes_analyzed_{false};
+  bool memory_plan_supported_{true};
+  std::unordered_map<std::string, std::pair<size_t, size_t>> var_lifetimes_;
+  std::vector<std::string> input_vars_;
+  std::unordered_set<std::string> fetch_targets_;
+  std::unordered_map<std::string, std::unique_ptr<MemoryPlan>> memory_plans_;
+  // Shared by the plans, as only one of them runs at a time. Grown by a
+  // larger plan, after the slices of the others are dropped.
+  std::shared_ptr<memory::Allocation> arena_;
+  MemoryPlan* bound_plan_{nullptr};
 };
 
 }  // namespace framework
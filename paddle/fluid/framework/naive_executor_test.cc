@@ -64,6 +64,132 @@ TEST(NaiveExecutor, Basic) {
   }
 }
 
+// t0 = a + b, t1 = t0 + b, t2 = t1 + t0, out = t2 + a
+static void AppendAddOps(ProgramDesc* program) {
+  auto* main_block = program->MutableBlock(0);
+  for (auto name : {"a", "b", "t0", "t1", "t2", "out"}) {
+    main_block->Var(name)->SetType(proto::VarType::LOD_TENSOR);
+  }
+  auto add = [&](const std::string& x, const std::string& y,
+                 const std::string& out) {
+    auto* op = main_block->AppendOp();
+    op->SetType("elementwise_add");
+    op->SetInput("X", {x});
+    op->SetInput("Y", {y});
+    op->SetOutput("Out", {out});
+  };
+  add("a", "b", "t0");
+  add("t0", "b", "t1");
+  add("t1", "t0", "t2");
+  add("t2", "a", "out");
+}
+
+// runs the ops of AppendAddOps on rows of a and b, and checks out = 3a + 4b
+static void RunAddOps(NaiveExecutor* exe, int rows) {
+  auto place = platform::CPUPlace();
+  auto* a_tensor = exe->FindTensor("a");
+  auto* b_tensor = exe->FindTensor("b");
+  a_tensor->Resize({rows, 4});
+  b_tensor->Resize({rows, 4});
+  auto* a_data = a_tensor->mutable_data<float>(place);
+  auto* b_data = b_tensor->mutable_data<float>(place);
+  for (int i = 0; i < rows * 4; ++i) {
+    a_data[i] = i;
+    b_data[i] = 0.1 * i;
+  }
+  exe->Run();
+  auto* out_data = exe->FindTensor("out")->data<float>();
+  for (int i = 0; i < rows * 4; ++i) {
+    EXPECT_NEAR(out_data[i], 3.4 * i, 1e-3);
+  }
+}
+
+TEST(NaiveExecutor, MemoryPlan) {
+  ProgramDesc program;
+  AppendAddOps(&program);
+
+  auto place = platform::CPUPlace();
+  Scope scope;
+  auto& child = scope.NewScope();
+  NaiveExecutor exe(place);
+  exe.CreateVariables(program, 0, false, &child);
+  exe.Prepare(&child, program, 0, false);
+  exe.EnableMemoryPlan();
+
+  RunAddOps(&exe, 2);
+  RunAddOps(&exe, 2);
+  const void* t0_data = exe.FindTensor("t0")->data<float>();
+  // t0 is dead when out is written
+  EXPECT_EQ(exe.FindTensor("out")->data<float>(), t0_data);
+  EXPECT_NE(exe.FindTensor("t1")->data<float>(), t0_data);
+  RunAddOps(&exe, 2);
+  EXPECT_EQ(exe.FindTensor("t0")->data<float>(), t0_data);
+  RunAddOps(&exe, 8);
+  RunAddOps(&exe, 8);
+  RunAddOps(&exe, 2);
+  EXPECT_EQ(exe.FindTensor("out")->data<float>(),
+            exe.FindTensor("t0")->data<float>());
+}
+
+TEST(NaiveExecutor, MemoryPlanFetchTargets) {
+  ProgramDesc program;
+  AppendAddOps(&program);
+
+  auto place = platform::CPUPlace();
+  Scope scope;
+  auto& child = scope.NewScope();
+  NaiveExecutor exe(place);
+  exe.CreateVariables(program, 0, false, &child);
+  exe.Prepare(&child, program, 0, false);
+  exe.EnableMemoryPlan();
+  // t0 and t1 are fetched though read by the later ops
+  exe.SetFetchTargets({"t0", "t1", "out"});
+
+  for (int rows : {2, 2, 2, 8, 8, 2}) {
+    RunAddOps(&exe, rows);
+    auto* t0_data = exe.FindTensor("t0")->data<float>();
+    auto* t1_data = exe.FindTensor("t1")->data<float>();
+    auto* out_data = exe.FindTensor("out")->data<float>();
+    EXPECT_NE(out_data, t0_data);
+    EXPECT_NE(out_data, t1_data);
+    for (int i = 0; i < rows * 4; ++i) {
+      EXPECT_NEAR(t0_data[i], 1.1 * i, 1e-3);
+      EXPECT_NEAR(t1_data[i], 1.2 * i, 1e-3);
+    }
+  }
+}
+
+TEST(NaiveExecutor, MemoryPlanGrowingShapes) {
+  ProgramDesc program;
+  AppendAddOps(&program);
+
+  auto place = platform::CPUPlace();
+  Scope scope;
+  auto& child = scope.NewScope();
+  NaiveExecutor exe(place);
+  exe.CreateVariables(program, 0, false, &child);
+  exe.Prepare(&child, program, 0, false);
+  exe.EnableMemoryPlan();
+
+  std::weak_ptr<memory::Allocation> arena;
+  for (int rows : {2, 64, 256}) {
+    RunAddOps(&exe, rows);
+    // the plan of each shape needs a larger arena, the older one is freed
+    EXPECT_TRUE(arena.expired());
+    RunAddOps(&exe, rows);
+    arena = exe.arena_;
+  }
+  for (int rows : {2, 64, 256, 2}) {
+    RunAddOps(&exe, rows);
+    auto* begin = static_cast<const char*>(exe.arena_->ptr());
+    auto* t0_data =
+        reinterpret_cast<const char*>(exe.FindTensor("t0")->data<float>());
+    EXPECT_GE(t0_data, begin);
+    EXPECT_LT(t0_data, begin + exe.arena_->size());
+    EXPECT_EQ(exe.arena_, arena.lock());
+  }
+}
+
 }  // namespace framework
 }  // namespace paddle
 
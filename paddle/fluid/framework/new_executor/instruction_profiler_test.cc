@@ -0,0 +1,108 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/framework/new_executor/profiler.h"
+
+namespace paddle {
+namespace framework {
+
+static InstructionRecord MakeRecord(uint64_t start, uint64_t kernel_ns) {
+  InstructionRecord record;
+  record.ready = start - 1000;
+  record.start = start;
+  record.event_done = start + 2000;
+  record.end = start + 2000 + kernel_ns;
+  record.output_bytes = 64;
+  return record;
+}
+
+TEST(InstructionProfiler, Summary) {
+  InstructionProfiler profiler;
+  profiler.Prepare({"matmul", "relu", "matmul"});
+  profiler.AddRun(0, MakeRecord(1000000, 3000000));
+  profiler.AddRun(1, MakeRecord(5000000, 1000000));
+  profiler.AddRun(2, MakeRecord(7000000, 5000000));
+  profiler.AddRun(2, MakeRecord(13000000, 5000000));
+  profiler.AddGC(1, 4000);
+
+  auto& stats = profiler.Stats();
+  ASSERT_EQ(stats.size(), 3UL);
+  EXPECT_EQ(stats[2].run_count, 2UL);
+  EXPECT_EQ(stats[2].kernel_ns, 10000000UL);
+  EXPECT_EQ(stats[2].queue_ns, 2000UL);
+  EXPECT_EQ(stats[2].dependency_ns, 4000UL);
+  EXPECT_EQ(stats[1].gc_ns, 4000UL);
+
+  // the instructions of a type are merged, the slowest type comes first
+  std::istringstream summary(profiler.Summary());
+  std::vector<std::string> lines;
+  for (std::string line; std::getline(summary, line);) {
+    lines.push_back(line);
+  }
+  ASSERT_EQ(lines.size(), 4UL);
+  EXPECT_EQ(lines[0], "kernel 14000 us, queue + dependency + gc 16 us");
+  std::istringstream matmul(lines[2]);
+  std::string op_type;
+  uint64_t calls, kernel_us;
+  matmul >> op_type >> calls >> kernel_us;
+  EXPECT_EQ(op_type, "matmul");
+  EXPECT_EQ(calls, 3UL);
+  EXPECT_EQ(kernel_us, 13000UL);
+  EXPECT_EQ(lines[3].find("relu"), 0UL);
+}
+
+TEST(InstructionProfiler, ChromeTrace) {
+  InstructionProfiler profiler;
+  profiler.Prepare({"matmul", "relu"});
+  // only the last runs of an instruction are traced
+  size_t traced = InstructionProfiler::kTraceRunsPerInstruction;
+  size_t runs = traced + 10;
+  for (size_t i = 0; i < runs; ++i) {
+    profiler.AddRun(0, MakeRecord(1000000 * (i + 1), 1000));
+  }
+  profiler.AddRun(1, MakeRecord(500000, 1000));
+  EXPECT_EQ(profiler.Stats()[0].trace.size(), traced);
+
+  std::string path = "instruction_profiler_test.json";
+  profiler.SaveChromeTrace(path);
+  std::ifstream in(path);
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  auto trace = buffer.str();
+  EXPECT_EQ(trace.find("{\"traceEvents\":["), 0UL);
+
+  size_t matmul_events = 0;
+  size_t relu_events = 0;
+  for (size_t pos = trace.find("\"name\":"); pos != std::string::npos;
+       pos = trace.find("\"name\":", pos + 1)) {
+    if (trace.compare(pos, 15, "\"name\":\"matmul\"") == 0) ++matmul_events;
+    if (trace.compare(pos, 13, "\"name\":\"relu\"") == 0) ++relu_events;
+  }
+  EXPECT_EQ(matmul_events, traced);
+  EXPECT_EQ(relu_events, 1UL);
+  // the times are relative to the first traced run, relu here
+  EXPECT_NE(trace.find("\"name\":\"relu\",\"ph\":\"X\""), std::string::npos);
+  EXPECT_NE(trace.find(",\"ts\":0,"), std::string::npos);
+
+  EXPECT_ANY_THROW(profiler.SaveChromeTrace("not_exist_dir/trace.json"));
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -13,15 +13,38 @@
 // limitations under the License.
 
 #include "paddle/fluid/framework/new_executor/interpretercore.h"
+#include <fstream>
 #include <unordered_set>
 #include "paddle/fluid/framework/details/nan_inf_utils.h"
 #include "paddle/fluid/framework/details/share_tensor_buffer_functor.h"
 #include "paddle/fluid/framework/new_executor/interpretercore_util.h"
 #include "paddle/fluid/framework/operator.h"
 #include "paddle/fluid/platform/profiler.h"
+#include "paddle/fluid/string/printf.h"
 
 PADDLE_DEFINE_EXPORTED_bool(new_executor_use_inplace, true,
                             "Use inplace in new executor");
+PADDLE_DEFINE_EXPORTED_bool(
+    new_executor_work_stealing, false,
+    "Keep ready instructions on the thread that made them ready and only "
+    "hand them to other threads when those are idle in new executor");
+PADDLE_DEFINE_EXPORTED_bool(
+    new_executor_pin_host_chains, false,
+    "Run a host instruction whose only dependency is another host "
+    "instruction on the same thread right after it in new executor");
+PADDLE_DEFINE_EXPORTED_bool(
+    new_executor_static_schedule, false,
+    "Freeze a level partitioned execution plan in DryRun and replay it in "
+    "the following runs of new executor");
+PADDLE_DEFINE_EXPORTED_bool(
+    new_executor_profile, false,
+    "Collect kernel, queue, dependency and gc time of every instruction in "
+    "new executor");
+PADDLE_DEFINE_EXPORTED_string(
+    new_executor_profile_path, "",
+    "If not empty, the chrome trace (.json) and the summary (.txt) of "
+    "FLAGS_new_executor_profile are saved with this prefix when the "
+    "interpreter core is destroyed");
 
 DECLARE_bool(check_nan_inf);
 DECLARE_bool(benchmark);
@@ -60,6 +83,27 @@ InterpreterCore::InterpreterCore(const platform::Place& place,
   // convert to run graph
 }
 
+InterpreterCore::~InterpreterCore() {
+  if (!FLAGS_new_executor_profile || FLAGS_new_executor_profile_path.empty() ||
+      !is_build_) {
+    return;
+  }
+  // several cores may share the same executor and so the same prefix
+  static std::atomic<int> core_num{0};
+  auto prefix = string::Sprintf("%s.%d", FLAGS_new_executor_profile_path,
+                                core_num.fetch_add(1));
+  // a destructor must not throw, a profile that cannot be saved is dropped
+  try {
+    instruction_profiler_.SaveChromeTrace(prefix + ".json");
+    std::ofstream summary(prefix + ".txt");
+    summary << instruction_profiler_.Summary();
+    VLOG(1) << "save instruction profile of interpreter core to " << prefix;
+  } catch (std::exception& ex) {
+    LOG(WARNING) << "Failed to save the instruction profile to " << prefix
+                 << ": " << ex.what();
+  }
+}
+
 void InterpreterCore::AddFetch(const std::vector<std::string>& fetch_names) {
   auto* fetch_holder = main_program_.MutableBlock(0)->Var("fetch_vars");
   fetch_holder->SetType(proto::VarType::FETCH_LIST);
@@ -100,7 +144,11 @@ paddle::framework::FetchList InterpreterCore::Run(
     Convert();
   } else {
     FeedInput();
-    ExecuteInstructionList(vec_instruction_);
+    if (static_schedule_ != nullptr) {
+      ExecuteStaticSchedule();
+    } else {
+      ExecuteInstructionList(vec_instruction_);
+    }
   }
 
   // return Fetch Tensors
@@ -194,6 +242,8 @@ void InterpreterCore::Convert() {
     }
   }
 
+  BuildHostChains();
+
   for (size_t i = 0; i < vec_instruction_.size(); ++i) {
     BuildAndCacheInstructionCtx(&vec_instruction_[i], *global_scope_, place_);
   }
@@ -208,6 +258,13 @@ void InterpreterCore::Convert() {
   if (FLAGS_new_executor_use_inplace) {
     BuildInplace();
   }
+
+  std::vector<std::string> op_types;
+  op_types.reserve(vec_instruction_.size());
+  for (auto& instr : vec_instruction_) {
+    op_types.push_back(instr.OpBase()->Type());
+  }
+  instruction_profiler_.Prepare(op_types);
 }
 
 bool InterpreterCore::BuildInplaceCheckVarIsOnlyInput(size_t var_index) {
@@ -262,6 +319,39 @@ void InterpreterCore::BuildInplace() {
   }
 }
 
+void InterpreterCore::BuildHostChains() {
+  chain_next_.assign(vec_instruction_.size(), 0);
+  if (!FLAGS_new_executor_pin_host_chains) {
+    return;
+  }
+
+  auto IsHostOp = [&](size_t id) {
+    auto& instr = vec_instruction_[id];
+    return instr.KernelType() == OpFuncType::kQueueSync &&
+           platform::is_cpu_place(instr.DeviceContext().GetPlace());
+  };
+
+  size_t chain_num = 0;
+  for (size_t i = 0; i < vec_instruction_.size(); ++i) {
+    if (!IsHostOp(i)) {
+      continue;
+    }
+    auto& next_instr = vec_instruction_[i].NextInstructions();
+    auto direct_run_ops = interpretercore::merge_vector(
+        next_instr.SyncRunIds(), next_instr.DirectRunIds());
+    for (auto next_id : direct_run_ops) {
+      // next_id can not start before i finishes anyway, running it on the
+      // same thread saves a queue round trip and finds its inputs in cache
+      if (dependecy_count_[next_id] == 1 && IsHostOp(next_id)) {
+        chain_next_[i] = next_id;
+        ++chain_num;
+        break;
+      }
+    }
+  }
+  VLOG(3) << "pin " << chain_num << " host instructions to their predecessor";
+}
+
 void InterpreterCore::BuildAndCacheInstructionCtx(
     Instruction* instr_node, const VariableScope& var_scope,
     const platform::Place& place) {
@@ -370,6 +460,9 @@ void InterpreterCore::ExecuteInstructionList(
 
   for (size_t i = 0; i < dependecy_count_.size(); ++i) {
     if (dependecy_count_[i] == 0) {
+      if (FLAGS_new_executor_profile) {
+        instruction_profiler_.MarkReady(i);
+      }
       async_work_queue_.AddTask(vec_instr.at(i).KernelType(),
                                 [&, i] { RunInstructionAsync(i); });
     }
@@ -391,11 +484,17 @@ void InterpreterCore::ExecuteInstructionList(
 }
 
 void InterpreterCore::RunNextInstructions(
-    const Instruction& instr, std::queue<size_t>* reserved_next_ops) {
+    const Instruction& instr, std::deque<size_t>* reserved_next_ops) {
   auto& next_instr = instr.NextInstructions();
   auto& atomic_deps = async_work_queue_.AtomicDeps();
   auto IsReady = [&](size_t next_id) {
-    return atomic_deps[next_id]->fetch_sub(1, std::memory_order_relaxed) == 1;
+    if (atomic_deps[next_id]->fetch_sub(1, std::memory_order_relaxed) != 1) {
+      return false;
+    }
+    if (FLAGS_new_executor_profile) {
+      instruction_profiler_.MarkReady(next_id);
+    }
+    return true;
   };
 
   if (instr.KernelType() == OpFuncType::kQueueAsync) {
@@ -410,12 +509,12 @@ void InterpreterCore::RunNextInstructions(
     // keep all async_ops running in current thread
     for (auto next_id : next_instr.DirectRunIds()) {
       if (IsReady(next_id)) {
-        reserved_next_ops->push(next_id);
+        reserved_next_ops->push_back(next_id);
       }
     }
     for (auto next_id : next_instr.EventRunIds()) {
       if (IsReady(next_id)) {
-        reserved_next_ops->push(next_id);
+        reserved_next_ops->push_back(next_id);
       }
     }
   } else {
@@ -429,9 +528,19 @@ void InterpreterCore::RunNextInstructions(
     }
     auto direct_run_ops = interpretercore::merge_vector(
         next_instr.SyncRunIds(), next_instr.DirectRunIds());
-    size_t first_op = 0;
+    // the pinned op only depends on instr, so it is always ready here
+    size_t first_op = chain_next_[instr.Id()];
     for (auto next_id : direct_run_ops) {
       if (IsReady(next_id)) {
+        if (next_id == first_op) {
+          continue;
+        }
+        if (FLAGS_new_executor_work_stealing) {
+          // keep them in current thread, ShareReadyInstructions moves them
+          // to other threads once those are idle
+          reserved_next_ops->push_back(next_id);
+          continue;
+        }
         // only keep one op running in current thread
         if (first_op == 0) {
           first_op = next_id;
@@ -443,56 +552,237 @@ void InterpreterCore::RunNextInstructions(
             [&, next_id] { RunInstructionAsync(next_id); });
       }
     }
-    if (first_op != 0) reserved_next_ops->push(first_op);
+    if (first_op != 0) reserved_next_ops->push_back(first_op);
+  }
+}
+
+bool InterpreterCore::TryRunInstruction(size_t instr_id) {
+  auto& instr_node = vec_instruction_.at(instr_id);
+  auto* op = instr_node.OpBase();
+  platform::RecordEvent instruction_event(op->Type());
+  InstructionRecord record;
+  bool profile = FLAGS_new_executor_profile;
+  if (profile) {
+    record.ready = instruction_profiler_.ReadyTime(instr_id);
+    record.start = InstructionProfiler::NowNs();
+  }
+  event_manager_.WaitEvent(instr_node, place_);
+  if (profile) {
+    record.event_done = InstructionProfiler::NowNs();
+  }
+
+  try {
+    RunInstruction(instr_node);
+  } catch (platform::EnforceNotMet& ex) {
+    framework::InsertCallStackInfo(op->Type(), op->Attrs(), &ex);
+    exception_holder_.Catch(std::make_exception_ptr(std::move(ex)));
+  } catch (platform::EOFException&) {
+    exception_holder_.Catch(std::current_exception());
+  } catch (std::exception& ex) {
+    LOG(WARNING) << op->Type() << " raises an exception "
+                 << platform::demangle(typeid(ex).name()) << ", "
+                 << ex.what();
+    exception_holder_.Catch(std::current_exception());
+  } catch (...) {
+    LOG(WARNING) << op->Type() << " raises an unknown exception";
+    exception_holder_.Catch(std::current_exception());
+  }
+
+  if (UNLIKELY(exception_holder_.IsCaught())) {
+    VLOG(4) << "Exception caught";
+    if (exception_notifier_ != nullptr) {
+      exception_notifier_->NotifyEvent();
+    }
+    return false;
+  }
+
+  event_manager_.RecordEvent(instr_node, place_);
+  if (profile) {
+    record.end = InstructionProfiler::NowNs();
+    std::vector<Variable*> outputs;
+    for (auto& item : instr_node.InnerRuntimeContext()->outputs) {
+      outputs.insert(outputs.end(), item.second.begin(), item.second.end());
+    }
+    auto memory_size = GetTensorMemorySize(outputs);
+    record.output_bytes = memory_size.first + memory_size.second;
+    instruction_profiler_.AddRun(instr_id, record);
+  }
+  return true;
+}
+
+void InterpreterCore::ShareReadyInstructions(
+    std::deque<size_t>* reserved_next_ops) {
+  // the oldest ready ops go first, as long as some thread would run them at
+  // once. when all threads are busy nothing is queued and nobody is woken up.
+  while (!reserved_next_ops->empty()) {
+    size_t next_id = reserved_next_ops->front();
+    auto kernel_type = vec_instruction_[next_id].KernelType();
+    if (!async_work_queue_.HasIdleThreads(kernel_type)) {
+      break;
+    }
+    reserved_next_ops->pop_front();
+    async_work_queue_.AddTask(kernel_type,
+                              [&, next_id] { RunInstructionAsync(next_id); });
   }
 }
 
 void InterpreterCore::RunInstructionAsync(size_t instr_id) {
-  std::queue<size_t> ready_ops;
-  ready_ops.push(instr_id);
+  std::deque<size_t> ready_ops;
+  ready_ops.push_back(instr_id);
   while (!ready_ops.empty()) {
-    instr_id = ready_ops.front();
-    ready_ops.pop();
-    auto& instr_node = vec_instruction_.at(instr_id);
-    auto* op = instr_node.OpBase();
-    platform::RecordEvent instruction_event(op->Type());
-    event_manager_.WaitEvent(instr_node, place_);
-
-    try {
-      RunInstruction(instr_node);
-    } catch (platform::EnforceNotMet& ex) {
-      framework::InsertCallStackInfo(op->Type(), op->Attrs(), &ex);
-      exception_holder_.Catch(std::make_exception_ptr(std::move(ex)));
-    } catch (platform::EOFException&) {
-      exception_holder_.Catch(std::current_exception());
-    } catch (std::exception& ex) {
-      LOG(WARNING) << op->Type() << " raises an exception "
-                   << platform::demangle(typeid(ex).name()) << ", "
-                   << ex.what();
-      exception_holder_.Catch(std::current_exception());
-    } catch (...) {
-      LOG(WARNING) << op->Type() << " raises an unknown exception";
-      exception_holder_.Catch(std::current_exception());
+    if (FLAGS_new_executor_work_stealing) {
+      // run the latest ready op, whose inputs were just written by this
+      // thread, and offer the older ones to idle threads
+      instr_id = ready_ops.back();
+      ready_ops.pop_back();
+      ShareReadyInstructions(&ready_ops);
+    } else {
+      instr_id = ready_ops.front();
+      ready_ops.pop_front();
     }
-
-    if (UNLIKELY(exception_holder_.IsCaught())) {
-      VLOG(4) << "Exception caught";
-      if (exception_notifier_ != nullptr) {
-        exception_notifier_->NotifyEvent();
-      }
+    if (!TryRunInstruction(instr_id)) {
       return;
     }
-
-    event_manager_.RecordEvent(instr_node, place_);
+    auto& instr_node = vec_instruction_.at(instr_id);
     op_run_number_.fetch_add(1, std::memory_order_relaxed);
 
     // GC infomation
-    CheckGC(instr_node);
+    if (FLAGS_new_executor_profile) {
+      auto gc_start = InstructionProfiler::NowNs();
+      CheckGC(instr_node);
+      instruction_profiler_.AddGC(instr_id,
+                                  InstructionProfiler::NowNs() - gc_start);
+    } else {
+      CheckGC(instr_node);
+    }
 
     RunNextInstructions(instr_node, &ready_ops);
   }
 }
 
+void InterpreterCore::BuildStaticSchedule() {
+  auto op_num = vec_instruction_.size();
+  auto var_num = vec_meta_info_.size();
+
+  // level of an instruction is the longest dependency path reaching it, next
+  // instructions always come later in the program, so one pass is enough
+  std::vector<size_t> op_level(op_num, 0);
+  size_t level_num = 0;
+  for (size_t i = 0; i < op_num; ++i) {
+    level_num = std::max(level_num, op_level[i] + 1);
+    auto& next_instr = vec_instruction_[i].NextInstructions();
+    for (auto* next_ids : {&next_instr.DirectRunIds(),
+                           &next_instr.EventRunIds(),
+                           &next_instr.SyncRunIds()}) {
+      for (auto next_id : *next_ids) {
+        op_level[next_id] = std::max(op_level[next_id], op_level[i] + 1);
+      }
+    }
+  }
+
+  static_schedule_.reset(new StaticSchedule());
+  auto& schedule = *static_schedule_;
+  schedule.parallel_run_.resize(level_num);
+  schedule.inline_run_.resize(level_num);
+  schedule.gc_vars_.resize(level_num);
+
+  for (size_t i = 0; i < op_num; ++i) {
+    auto level = op_level[i];
+    if (vec_instruction_[i].KernelType() == OpFuncType::kQueueSync) {
+      schedule.parallel_run_[level].push_back(i);
+    } else {
+      // launching device kernels is cheap, keep their stream order
+      schedule.inline_run_[level].push_back(i);
+    }
+  }
+  for (size_t level = 0; level < level_num; ++level) {
+    // the calling thread runs one host instruction of the level as well
+    auto& parallel_run = schedule.parallel_run_[level];
+    if (!parallel_run.empty()) {
+      schedule.inline_run_[level].push_back(parallel_run.back());
+      parallel_run.pop_back();
+    }
+  }
+
+  // a var is collected after the last level using it, as CheckGC would do
+  // when its reference count drops to zero
+  std::vector<size_t> last_use(var_num, op_num);
+  for (size_t i = 0; i < op_num; ++i) {
+    for (auto var_id : vec_instruction_[i].GCCheckVars()) {
+      if (last_use[var_id] == op_num ||
+          op_level[last_use[var_id]] <= op_level[i]) {
+        last_use[var_id] = i;
+      }
+    }
+  }
+  auto& var_scope = *global_scope_;
+  size_t gc_num = 0;
+  for (size_t var_id = 0; var_id < var_num; ++var_id) {
+    if (last_use[var_id] == op_num) {
+      continue;
+    }
+    if (var_scope.VarDesc(var_id) && var_scope.VarDesc(var_id)->Persistable()) {
+      continue;
+    }
+    schedule.gc_vars_[op_level[last_use[var_id]]].emplace_back(
+        var_id, last_use[var_id]);
+    ++gc_num;
+  }
+
+  VLOG(3) << "freeze static schedule of " << op_num << " instructions in "
+          << level_num << " levels, " << gc_num << " vars to collect";
+}
+
+void InterpreterCore::ExecuteStaticSchedule() {
+  auto& schedule = *static_schedule_;
+  exception_holder_.Clear();
+
+  for (size_t level = 0; level < schedule.inline_run_.size(); ++level) {
+    auto& parallel_run = schedule.parallel_run_[level];
+    if (FLAGS_new_executor_profile) {
+      for (auto instr_id : parallel_run) {
+        instruction_profiler_.MarkReady(instr_id);
+      }
+      for (auto instr_id : schedule.inline_run_[level]) {
+        instruction_profiler_.MarkReady(instr_id);
+      }
+    }
+    static_run_pending_.store(parallel_run.size(), std::memory_order_relaxed);
+    for (auto instr_id : parallel_run) {
+      async_work_queue_.AddTask(OpFuncType::kQueueSync, [this, instr_id] {
+        TryRunInstruction(instr_id);
+        static_run_pending_.fetch_sub(1, std::memory_order_release);
+      });
+    }
+    for (auto instr_id : schedule.inline_run_[level]) {
+      if (!TryRunInstruction(instr_id)) {
+        break;
+      }
+    }
+    // the queue empty event of the previous level may still wake us up early
+    while (static_run_pending_.load(std::memory_order_acquire) != 0 &&
+           main_thread_blocker_.WaitEvent() != kExceptionCaught) {
+    }
+
+    if (UNLIKELY(exception_holder_.IsCaught())) {
+      VLOG(4) << "Exception caught " << exception_holder_.Type();
+      exception_holder_.ReThrow();
+    }
+
+    for (auto& var_instr : schedule.gc_vars_[level]) {
+      auto& instr = vec_instruction_[var_instr.second];
+      auto gc_start = FLAGS_new_executor_profile ? InstructionProfiler::NowNs()
+                                                 : 0;
+      gc_.Add(global_scope_->Var(var_instr.first), gc_event_.at(instr.Id()),
+              &instr.DeviceContext());
+      if (FLAGS_new_executor_profile) {
+        instruction_profiler_.AddGC(instr.Id(),
+                                    InstructionProfiler::NowNs() - gc_start);
+      }
+    }
+  }
+}
+
 void InterpreterCore::CheckGC(const Instruction& instr) {
   size_t instr_id = instr.Id();
   auto& var_scope = *global_scope_;
@@ -553,6 +843,9 @@ const CostInfo& InterpreterCore::DryRun(
   platform::DeviceContextPool::Instance().Get(place_)->Wait();
 
   dry_run_profiler_.Pause();
+  if (FLAGS_new_executor_static_schedule && static_schedule_ == nullptr) {
+    BuildStaticSchedule();
+  }
   dry_run_profiler_.TotalCUDAAllocatedMemorySize(place_);
   return dry_run_profiler_.GetCostInfo();
 }
@@ -13,8 +13,8 @@
 // limitations under the License.
 #pragma once
 
+#include <deque>
 #include <map>
-#include <queue>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -45,11 +45,18 @@ class InterpreterCore {
                   const std::vector<std::string>& feed_names,
                   const std::vector<std::string>& fetch_names);
 
+  ~InterpreterCore();
+
   paddle::framework::FetchList Run(
       const std::vector<framework::LoDTensor>& feed_tensors);
 
   const CostInfo& DryRun(const std::vector<framework::LoDTensor>& feed_tensors);
 
+  // filled under FLAGS_new_executor_profile
+  const InstructionProfiler& GetInstructionProfiler() const {
+    return instruction_profiler_;
+  }
+
  private:
   void Convert();
 
@@ -63,19 +70,28 @@ class InterpreterCore {
 
   void RunInstruction(const Instruction& instr_node);
 
+  bool TryRunInstruction(size_t instr_id);
+
   void ExecuteInstructionList(const std::vector<Instruction>& vec_instr);
 
+  void BuildStaticSchedule();
+
+  void ExecuteStaticSchedule();
+
   void DryRunPrepare(const std::vector<framework::LoDTensor>& feed_tensors);
 
   void CheckGC(const Instruction& instr);
 
   void RunInstructionAsync(size_t instr_id);
   void RunNextInstructions(const Instruction& instr_id,
-                           std::queue<size_t>* reserved_next_ops);
+                           std::deque<size_t>* reserved_next_ops);
+  void ShareReadyInstructions(std::deque<size_t>* reserved_next_ops);
   void AddFetch(const std::vector<std::string>& fetch_names);
 
   void BuildSkipShareLoDInfo();
 
+  void BuildHostChains();
+
   bool is_build_;
 
   const platform::Place& place_;
@@ -87,13 +103,22 @@ class InterpreterCore {
 
   InstructionInfo instruction_info_;
   std::vector<size_t> dependecy_count_;
+  // chain_next_[i] is the host instruction pinned to run right after i on the
+  // same thread, 0 for none (instruction 0 is never a successor)
+  std::vector<size_t> chain_next_;
   std::vector<std::vector<size_t>> input_var2op_info_;
   std::vector<VariableMetaInfo> ref_coun_info_;
   std::vector<VariableMetaInfo> vec_meta_info_;
 
   std::vector<std::string> feed_names_;
 
+  // built by DryRun under FLAGS_new_executor_static_schedule, and replayed
+  // by every following Run instead of the dynamic dispatch
+  std::unique_ptr<StaticSchedule> static_schedule_;
+  std::atomic<size_t> static_run_pending_{0};
+
   InterpreterProfiler dry_run_profiler_;
+  InstructionProfiler instruction_profiler_;
   StreamAnalyzer stream_analyzer_;
   EventManager event_manager_;
   EventsWaiter main_thread_blocker_;
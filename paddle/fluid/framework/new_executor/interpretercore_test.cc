@@ -0,0 +1,229 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/new_executor/interpretercore.h"
+
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "gtest/gtest.h"
+#include "paddle/fluid/framework/op_registry.h"
+#include "paddle/fluid/framework/program_desc.h"
+
+DECLARE_bool(new_executor_static_schedule);
+DECLARE_bool(new_executor_work_stealing);
+DECLARE_bool(new_executor_pin_host_chains);
+DECLARE_bool(new_executor_profile);
+
+USE_OP(elementwise_add);
+USE_OP(elementwise_mul);
+USE_OP(fetch_v2);
+
+namespace paddle {
+namespace framework {
+
+static void AppendBinaryOp(BlockDesc* block, const std::string& type,
+                           const std::string& x, const std::string& y,
+                           const std::string& out) {
+  block->Var(out)->SetType(proto::VarType::LOD_TENSOR);
+  auto* op = block->AppendOp();
+  op->SetType(type);
+  op->SetInput("X", {x});
+  op->SetInput("Y", {y});
+  op->SetOutput("Out", {out});
+  op->SetAttr("axis", -1);
+}
+
+// t0 = a + b, t1 = a * b, t2 = t0 + t1, t3 = t0 * b, out = t2 + t3
+// t0 and t1 run in the same level of the static schedule, as t2 and t3 do.
+static ProgramDesc BuildProgram() {
+  ProgramDesc program;
+  auto* block = program.MutableBlock(0);
+  block->Var("a")->SetType(proto::VarType::LOD_TENSOR);
+  block->Var("b")->SetType(proto::VarType::LOD_TENSOR);
+  auto append = [&](const std::string& type, const std::string& x,
+                    const std::string& y, const std::string& out) {
+    AppendBinaryOp(block, type, x, y, out);
+  };
+  append("elementwise_add", "a", "b", "t0");
+  append("elementwise_mul", "a", "b", "t1");
+  append("elementwise_add", "t0", "t1", "t2");
+  append("elementwise_mul", "t0", "b", "t3");
+  append("elementwise_add", "t2", "t3", "out");
+  return program;
+}
+
+static std::vector<LoDTensor> MakeFeeds(int rows, float scale) {
+  std::vector<LoDTensor> feeds(2);
+  for (size_t i = 0; i < feeds.size(); ++i) {
+    auto* data = feeds[i].mutable_data<float>(framework::make_ddim({rows, 3}),
+                                              platform::CPUPlace());
+    for (int j = 0; j < rows * 3; ++j) {
+      data[j] = scale * (j + 1) * (i + 1) * 0.1;
+    }
+  }
+  return feeds;
+}
+
+// the outputs of the runs with feeds of the given rows
+static std::vector<std::vector<float>> RunSchedule(
+    bool static_schedule, const std::vector<int>& rows) {
+  FLAGS_new_executor_static_schedule = static_schedule;
+  auto place = platform::CPUPlace();
+  auto program = BuildProgram();
+  VariableScope scope;
+  InterpreterCore core(place, program, &scope, {"a", "b"}, {"out"});
+  core.DryRun(MakeFeeds(rows[0], 1.0));
+
+  std::vector<std::vector<float>> outputs;
+  for (size_t i = 0; i < rows.size(); ++i) {
+    auto fetch_list = core.Run(MakeFeeds(rows[i], 1.0 + i));
+    auto& out = BOOST_GET_CONST(LoDTensor, fetch_list[0]);
+    EXPECT_EQ(out.dims(), framework::make_ddim({rows[i], 3}));
+    auto* data = out.data<float>();
+    outputs.emplace_back(data, data + out.numel());
+  }
+  FLAGS_new_executor_static_schedule = false;
+  return outputs;
+}
+
+TEST(InterpreterCore, StaticSchedule) {
+  // repeated runs, then other shapes and back
+  std::vector<int> rows = {2, 2, 2, 5, 5, 2};
+  auto dynamic_outputs = RunSchedule(false, rows);
+  auto static_outputs = RunSchedule(true, rows);
+  ASSERT_EQ(dynamic_outputs.size(), rows.size());
+  ASSERT_EQ(static_outputs.size(), rows.size());
+
+  for (size_t i = 0; i < rows.size(); ++i) {
+    auto feeds = MakeFeeds(rows[i], 1.0 + i);
+    auto* a = feeds[0].data<float>();
+    auto* b = feeds[1].data<float>();
+    ASSERT_EQ(dynamic_outputs[i].size(), static_cast<size_t>(rows[i] * 3));
+    ASSERT_EQ(static_outputs[i].size(), dynamic_outputs[i].size());
+    for (size_t j = 0; j < dynamic_outputs[i].size(); ++j) {
+      float expect = (a[j] + b[j]) + a[j] * b[j] + (a[j] + b[j]) * b[j];
+      EXPECT_NEAR(dynamic_outputs[i][j], expect, 1e-5);
+      EXPECT_EQ(static_outputs[i][j], dynamic_outputs[i][j]);
+    }
+  }
+}
+
+// all the ready instructions are kept by the thread making them ready and
+// shared with the idle threads, every one of them still runs once per run
+TEST(InterpreterCore, WorkStealing) {
+  FLAGS_new_executor_work_stealing = true;
+  FLAGS_new_executor_profile = true;
+  ProgramDesc program;
+  auto* block = program.MutableBlock(0);
+  block->Var("a")->SetType(proto::VarType::LOD_TENSOR);
+  block->Var("b")->SetType(proto::VarType::LOD_TENSOR);
+  // 16 independent branches w{i} = (a + b) * b + a, summed into out
+  constexpr int kBranchNum = 16;
+  for (int i = 0; i < kBranchNum; ++i) {
+    auto id = std::to_string(i);
+    AppendBinaryOp(block, "elementwise_add", "a", "b", "u" + id);
+    AppendBinaryOp(block, "elementwise_mul", "u" + id, "b", "v" + id);
+    AppendBinaryOp(block, "elementwise_add", "v" + id, "a", "w" + id);
+  }
+  AppendBinaryOp(block, "elementwise_add", "w0", "w1", "s1");
+  for (int i = 2; i < kBranchNum; ++i) {
+    AppendBinaryOp(block, "elementwise_add", "s" + std::to_string(i - 1),
+                   "w" + std::to_string(i), "s" + std::to_string(i));
+  }
+  auto out_name = "s" + std::to_string(kBranchNum - 1);
+
+  auto place = platform::CPUPlace();
+  VariableScope scope;
+  {
+    InterpreterCore core(place, program, &scope, {"a", "b"}, {out_name});
+    core.DryRun(MakeFeeds(4, 1.0));
+    constexpr size_t kRunNum = 20;
+    for (size_t i = 0; i < kRunNum; ++i) {
+      auto feeds = MakeFeeds(i % 2 ? 4 : 7, 1.0 + i);
+      auto fetch_list = core.Run(feeds);
+      auto& out = BOOST_GET_CONST(LoDTensor, fetch_list[0]);
+      auto* a = feeds[0].data<float>();
+      auto* b = feeds[1].data<float>();
+      ASSERT_EQ(out.numel(), feeds[0].numel());
+      for (int64_t j = 0; j < out.numel(); ++j) {
+        float expect = kBranchNum * ((a[j] + b[j]) * b[j] + a[j]);
+        EXPECT_NEAR(out.data<float>()[j], expect, 1e-3);
+      }
+    }
+    // DryRun and every Run execute each instruction once
+    for (auto& stats : core.GetInstructionProfiler().Stats()) {
+      EXPECT_EQ(stats.run_count, kRunNum + 1) << stats.op_type;
+    }
+  }
+  FLAGS_new_executor_work_stealing = false;
+  FLAGS_new_executor_profile = false;
+}
+
+TEST(InterpreterCore, PinHostChains) {
+  FLAGS_new_executor_pin_host_chains = true;
+  FLAGS_new_executor_profile = true;
+  ProgramDesc program;
+  auto* block = program.MutableBlock(0);
+  block->Var("a")->SetType(proto::VarType::LOD_TENSOR);
+  block->Var("b")->SetType(proto::VarType::LOD_TENSOR);
+  // c0 -> c1 -> c2 -> c3 is a chain, e also follows c0 but waits for d0 too
+  AppendBinaryOp(block, "elementwise_mul", "a", "b", "d0");   // 0
+  AppendBinaryOp(block, "elementwise_add", "a", "b", "c0");   // 1
+  AppendBinaryOp(block, "elementwise_add", "c0", "d0", "e");  // 2
+  AppendBinaryOp(block, "elementwise_mul", "c0", "b", "c1");  // 3
+  AppendBinaryOp(block, "elementwise_add", "c1", "a", "c2");  // 4
+  AppendBinaryOp(block, "elementwise_mul", "c2", "a", "c3");  // 5
+  const std::vector<size_t> chain = {1, 3, 4, 5};
+
+  auto place = platform::CPUPlace();
+  VariableScope scope;
+  {
+    InterpreterCore core(place, program, &scope, {"a", "b"}, {"c3", "e"});
+    core.DryRun(MakeFeeds(4, 1.0));
+    // fewer runs than the traced ones, so the trace holds all of them
+    constexpr size_t kRunNum = 20;
+    for (size_t i = 0; i < kRunNum; ++i) {
+      auto feeds = MakeFeeds(4, 1.0 + i);
+      auto fetch_list = core.Run(feeds);
+      auto& c3 = BOOST_GET_CONST(LoDTensor, fetch_list[0]);
+      auto& e = BOOST_GET_CONST(LoDTensor, fetch_list[1]);
+      auto* a = feeds[0].data<float>();
+      auto* b = feeds[1].data<float>();
+      for (int64_t j = 0; j < c3.numel(); ++j) {
+        float c0 = a[j] + b[j];
+        EXPECT_NEAR(c3.data<float>()[j], (c0 * b[j] + a[j]) * a[j], 1e-3);
+        EXPECT_NEAR(e.data<float>()[j], c0 + a[j] * b[j], 1e-3);
+      }
+    }
+
+    auto& stats = core.GetInstructionProfiler().Stats();
+    auto& head = stats[chain[0]].trace;
+    ASSERT_EQ(head.size(), kRunNum + 1);
+    for (size_t k = 1; k < chain.size(); ++k) {
+      auto& trace = stats[chain[k]].trace;
+      ASSERT_EQ(trace.size(), head.size());
+      for (size_t run = 0; run < trace.size(); ++run) {
+        EXPECT_EQ(trace[run].thread_id, head[run].thread_id)
+            << "instruction " << chain[k] << " of run " << run;
+      }
+    }
+  }
+  FLAGS_new_executor_pin_host_chains = false;
+  FLAGS_new_executor_profile = false;
+}
+
+}  // namespace framework
+}  // namespace paddle
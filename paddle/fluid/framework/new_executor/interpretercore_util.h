@@ -81,6 +81,11 @@ class AsyncWorkQueue {
     queue_group_->AddTask(static_cast<size_t>(op_func_type), std::move(fn));
   }
 
+  bool HasIdleThreads(const OpFuncType& op_func_type) const {
+    return queue_group_->QueueHasIdleThreads(
+        static_cast<size_t>(op_func_type));
+  }
+
   void Cancel() { queue_group_->Cancel(); }
 
   AtomicVectorSizeT& AtomicDeps() { return atomic_deps_; }
@@ -621,6 +621,19 @@ struct InstructionInfo {
   std::vector<size_t> dependecy_count_;
 };
 
+// An execution plan frozen from the dependency graph. The instructions of a
+// level only depend on instructions of earlier levels, so a level can run
+// without any dependency counting once the level before it has finished.
+struct StaticSchedule {
+  // host instructions handed to the work queue, per level
+  std::vector<std::vector<size_t>> parallel_run_;
+  // instructions run in order by the calling thread, per level
+  std::vector<std::vector<size_t>> inline_run_;
+  // (var id, instruction id) pairs whose last use is in the level, the var
+  // is collected with the event and context of that instruction
+  std::vector<std::vector<std::pair<size_t, size_t>>> gc_vars_;
+};
+
 enum class OpFuncType {
   kQueueSync = 0,   // CPU kernel, block host
   kQueueAsync = 1,  // GPU Kernel or d2h, h2d, send, recv, broadcast
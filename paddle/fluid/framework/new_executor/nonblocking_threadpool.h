@@ -181,6 +181,13 @@ class ThreadPoolTempl {
 
   size_t NumThreads() const { return num_threads_; }
 
+  // Whether some worker has nothing queued or running, i.e. a task added now
+  // would be picked up at once rather than wait behind other tasks.
+  bool HasIdleThreads() const {
+    return num_tasks_.load(std::memory_order_relaxed) <
+           static_cast<uint64_t>(num_threads_);
+  }
+
   int CurrentThreadId() const {
     const PerThread* pt = const_cast<ThreadPoolTempl*>(this)->GetPerThread();
     if (pt->pool == this) {
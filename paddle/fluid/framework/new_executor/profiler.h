@@ -13,6 +13,17 @@
 // limitations under the License.
 
 #pragma once
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
 #include "paddle/fluid/framework/tensor.h"
 #include "paddle/fluid/framework/variable.h"
 #include "paddle/fluid/platform/gpu_info.h"
@@ -99,5 +110,165 @@ class InterpreterProfiler {
   platform::Timer timer_;
   CostInfo cost_info_;
 };
+
+// One run of an instruction, times are in ns of a steady clock.
+struct InstructionRecord {
+  uint64_t ready{0};       // all dependencies of the instruction are done
+  uint64_t start{0};       // a thread picks the instruction up
+  uint64_t event_done{0};  // events of other streams have been waited
+  uint64_t end{0};         // InferShape and kernel are done
+  size_t output_bytes{0};  // memory held by the outputs after the kernel
+};
+
+struct InstructionStats {
+  std::string op_type;
+  uint64_t run_count{0};
+  uint64_t kernel_ns{0};
+  uint64_t queue_ns{0};
+  uint64_t dependency_ns{0};
+  uint64_t gc_ns{0};
+  uint64_t output_bytes{0};
+
+  // the last runs of the instruction, for the chrome trace
+  struct TraceEvent {
+    uint64_t start;
+    uint64_t end;
+    size_t thread_id;
+  };
+  std::vector<TraceEvent> trace;
+  size_t trace_next{0};
+};
+
+// InstructionProfiler accumulates the cost of every instruction over all the
+// runs of an InterpreterCore. An instruction runs at most once at a time, so
+// its stats are only written by the thread running it and need no lock; read
+// them when no run is in progress.
+class InstructionProfiler {
+ public:
+  static constexpr size_t kTraceRunsPerInstruction = 64;
+
+  static uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  void Prepare(const std::vector<std::string>& op_types) {
+    stats_.clear();
+    stats_.resize(op_types.size());
+    ready_ns_.assign(op_types.size(), 0);
+    for (size_t i = 0; i < op_types.size(); ++i) {
+      stats_[i].op_type = op_types[i];
+    }
+  }
+
+  void MarkReady(size_t instr_id) { ready_ns_[instr_id] = NowNs(); }
+
+  uint64_t ReadyTime(size_t instr_id) const { return ready_ns_[instr_id]; }
+
+  void AddRun(size_t instr_id, const InstructionRecord& record) {
+    auto& stats = stats_[instr_id];
+    stats.run_count += 1;
+    stats.queue_ns += record.start - std::min(record.ready, record.start);
+    stats.dependency_ns += record.event_done - record.start;
+    stats.kernel_ns += record.end - record.event_done;
+    stats.output_bytes += record.output_bytes;
+
+    InstructionStats::TraceEvent event{
+        record.start, record.end,
+        std::hash<std::thread::id>()(std::this_thread::get_id())};
+    if (stats.trace.size() < kTraceRunsPerInstruction) {
+      stats.trace.push_back(event);
+    } else {
+      stats.trace[stats.trace_next] = event;
+    }
+    stats.trace_next = (stats.trace_next + 1) % kTraceRunsPerInstruction;
+  }
+
+  void AddGC(size_t instr_id, uint64_t gc_ns) {
+    stats_[instr_id].gc_ns += gc_ns;
+  }
+
+  const std::vector<InstructionStats>& Stats() const { return stats_; }
+
+  // per op type, sorted by kernel time
+  std::string Summary() const {
+    std::map<std::string, InstructionStats> by_type;
+    uint64_t total_kernel = 0;
+    uint64_t total_overhead = 0;
+    for (auto& stats : stats_) {
+      auto& merged = by_type[stats.op_type];
+      merged.run_count += stats.run_count;
+      merged.kernel_ns += stats.kernel_ns;
+      merged.queue_ns += stats.queue_ns;
+      merged.dependency_ns += stats.dependency_ns;
+      merged.gc_ns += stats.gc_ns;
+      merged.output_bytes += stats.output_bytes;
+      total_kernel += stats.kernel_ns;
+      total_overhead += stats.queue_ns + stats.dependency_ns + stats.gc_ns;
+    }
+    std::vector<std::pair<std::string, InstructionStats>> sorted(
+        by_type.begin(), by_type.end());
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<std::string, InstructionStats>& a,
+                 const std::pair<std::string, InstructionStats>& b) {
+                return a.second.kernel_ns > b.second.kernel_ns;
+              });
+
+    std::ostringstream os;
+    os << "kernel " << total_kernel / 1000 << " us, queue + dependency + gc "
+       << total_overhead / 1000 << " us\n";
+    os << std::left << std::setw(32) << "op" << std::right << std::setw(10)
+       << "calls" << std::setw(14) << "kernel(us)" << std::setw(14)
+       << "queue(us)" << std::setw(14) << "dep(us)" << std::setw(12)
+       << "gc(us)" << std::setw(16) << "out_bytes/call"
+       << "\n";
+    for (auto& item : sorted) {
+      auto& stats = item.second;
+      if (stats.run_count == 0) {
+        continue;
+      }
+      os << std::left << std::setw(32) << item.first << std::right
+         << std::setw(10) << stats.run_count << std::setw(14)
+         << stats.kernel_ns / 1000 << std::setw(14) << stats.queue_ns / 1000
+         << std::setw(14) << stats.dependency_ns / 1000 << std::setw(12)
+         << stats.gc_ns / 1000 << std::setw(16)
+         << stats.output_bytes / stats.run_count << "\n";
+    }
+    return os.str();
+  }
+
+  // chrome://tracing json of the last runs of every instruction
+  void SaveChromeTrace(const std::string& path) const {
+    std::ofstream out(path);
+    PADDLE_ENFORCE_EQ(out.is_open(), true,
+                      platform::errors::Unavailable(
+                          "Cannot open %s to save the chrome trace.", path));
+    uint64_t base = UINT64_MAX;
+    for (auto& stats : stats_) {
+      for (auto& event : stats.trace) {
+        base = std::min(base, event.start);
+      }
+    }
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    for (size_t i = 0; i < stats_.size(); ++i) {
+      for (auto& event : stats_[i].trace) {
+        out << (first ? "" : ",") << "\n{\"name\":\"" << stats_[i].op_type
+            << "\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+            << event.thread_id % 100000 << ",\"ts\":"
+            << (event.start - base) / 1000.0
+            << ",\"dur\":" << (event.end - event.start) / 1000.0
+            << ",\"args\":{\"instruction\":" << i << "}}";
+        first = false;
+      }
+    }
+    out << "\n]}\n";
+  }
+
+ private:
+  std::vector<InstructionStats> stats_;
+  std::vector<uint64_t> ready_ns_;
+};
 }  // namespace framework
 }  // namespace paddle
@@ -74,6 +74,8 @@ class WorkQueueGroupImpl : public WorkQueueGroup {
 
   size_t QueueGroupNumThreads() const override;
 
+  bool QueueHasIdleThreads(size_t queue_idx) const override;
+
   void Cancel() override;
 
  private:
@@ -143,6 +145,11 @@ size_t WorkQueueGroupImpl::QueueGroupNumThreads() const {
   return total_num;
 }
 
+bool WorkQueueGroupImpl::QueueHasIdleThreads(size_t queue_idx) const {
+  assert(queue_idx < queues_.size());
+  return queues_.at(queue_idx)->HasIdleThreads();
+}
+
 void WorkQueueGroupImpl::Cancel() {
   for (auto queue : queues_) {
     queue->Cancel();
@@ -91,6 +91,9 @@ class WorkQueueGroup {
 
   virtual size_t QueueGroupNumThreads() const = 0;
 
+  // Whether a task added to the queue now would run without waiting
+  virtual bool QueueHasIdleThreads(size_t queue_idx) const = 0;
+
   virtual void Cancel() = 0;
 
  protected:
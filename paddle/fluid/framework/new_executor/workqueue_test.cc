@@ -107,6 +107,9 @@ TEST(WorkQueue, TestWorkQueueGroup) {
   EXPECT_EQ(queue_group->QueueNumThreads(0), 1u);
   EXPECT_EQ(queue_group->QueueNumThreads(1), 10u);
   EXPECT_EQ(queue_group->QueueGroupNumThreads(), 11u);
+  // QueueHasIdleThreads
+  EXPECT_TRUE(queue_group->QueueHasIdleThreads(0));
+  EXPECT_TRUE(queue_group->QueueHasIdleThreads(1));
   // AddTask
   EXPECT_EQ(counter.load(), 0u);
   for (unsigned i = 0; i < kExternalLoopNum; ++i) {
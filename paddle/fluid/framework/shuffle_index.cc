@@ -0,0 +1,145 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/shuffle_index.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <thread>  // NOLINT
+
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle {
+namespace framework {
+
+namespace {
+
+// below this a single std::shuffle is faster than starting threads
+constexpr size_t kMinParallelShuffleSize = 1 << 16;
+// about 4MB of positions per bucket, so that shuffling one stays in cache
+constexpr size_t kShuffleBucketShift = 20;
+constexpr size_t kMaxShuffleBuckets = 4096;
+
+// the bucket of each value, drawn again with the same engine in both passes
+inline size_t RandomBucket(std::mt19937_64* engine, size_t bucket_num) {
+  return static_cast<size_t>(((*engine)() >> 32) * bucket_num >> 32);
+}
+
+template <typename Func>
+void RunThreads(int thread_num, Func func) {
+  std::vector<std::thread> threads;
+  threads.reserve(thread_num);
+  for (int i = 0; i < thread_num; ++i) {
+    threads.emplace_back(func, i);
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+}  // namespace
+
+void ParallelShuffle(std::vector<uint32_t>* values, int thread_num,
+                     uint64_t seed) {
+  size_t n = values->size();
+  if (thread_num <= 1 || n < kMinParallelShuffleSize) {
+    std::mt19937_64 engine(seed);
+    std::shuffle(values->begin(), values->end(), engine);
+    return;
+  }
+  size_t bucket_num = std::min(
+      kMaxShuffleBuckets,
+      std::max(static_cast<size_t>(thread_num), n >> kShuffleBucketShift));
+  auto chunk_begin = [n, thread_num](int t) { return n * t / thread_num; };
+  auto chunk_seed = [seed](int t) {
+    return seed + 0x9e3779b97f4a7c15ULL * (t + 1);
+  };
+
+  // counts[t][b]: values of the chunk of thread t sent to bucket b
+  std::vector<std::vector<size_t>> counts(thread_num,
+                                          std::vector<size_t>(bucket_num, 0));
+  RunThreads(thread_num, [&](int t) {
+    std::mt19937_64 engine(chunk_seed(t));
+    auto& count = counts[t];
+    for (size_t i = chunk_begin(t); i < chunk_begin(t + 1); ++i) {
+      ++count[RandomBucket(&engine, bucket_num)];
+    }
+  });
+
+  // buckets are contiguous in the output, each filled by the threads in order
+  std::vector<size_t> bucket_begin(bucket_num + 1, 0);
+  for (size_t b = 0; b < bucket_num; ++b) {
+    size_t offset = bucket_begin[b];
+    for (int t = 0; t < thread_num; ++t) {
+      size_t count = counts[t][b];
+      counts[t][b] = offset;
+      offset += count;
+    }
+    bucket_begin[b + 1] = offset;
+  }
+
+  std::vector<uint32_t> output(n);
+  RunThreads(thread_num, [&](int t) {
+    std::mt19937_64 engine(chunk_seed(t));
+    auto& offset = counts[t];
+    for (size_t i = chunk_begin(t); i < chunk_begin(t + 1); ++i) {
+      output[offset[RandomBucket(&engine, bucket_num)]++] = (*values)[i];
+    }
+  });
+
+  std::atomic<size_t> next_bucket{0};
+  RunThreads(thread_num, [&](int) {
+    for (size_t b = next_bucket++; b < bucket_num; b = next_bucket++) {
+      std::mt19937_64 engine(seed ^ (0xbf58476d1ce4e5b9ULL * (b + 1)));
+      std::shuffle(output.begin() + bucket_begin[b],
+                   output.begin() + bucket_begin[b + 1], engine);
+    }
+  });
+  values->swap(output);
+}
+
+void ShuffleIndex::Build(size_t ins_num, bool shuffle, int thread_num,
+                         uint64_t seed) {
+  PADDLE_ENFORCE_LE(
+      ins_num, static_cast<size_t>(std::numeric_limits<uint32_t>::max()),
+      platform::errors::InvalidArgument(
+          "Shuffle by index supports at most %u instances per dataset, but "
+          "received %d.",
+          std::numeric_limits<uint32_t>::max(), ins_num));
+  positions_.resize(ins_num);
+  std::iota(positions_.begin(), positions_.end(), 0);
+  if (shuffle) {
+    ParallelShuffle(&positions_, thread_num, seed);
+  }
+  Rewind();
+}
+
+void ShuffleIndex::Clear() {
+  std::vector<uint32_t>().swap(positions_);
+  Rewind();
+}
+
+size_t ShuffleIndex::Next(size_t max_num, const uint32_t** positions) {
+  size_t begin = cursor_.fetch_add(max_num);
+  if (begin >= positions_.size()) {
+    return 0;
+  }
+  *positions = positions_.data() + begin;
+  return std::min(max_num, positions_.size() - begin);
+}
+
+}  // namespace framework
+}  // namespace paddle
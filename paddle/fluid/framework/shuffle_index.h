@@ -0,0 +1,60 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace paddle {
+namespace framework {
+
+// Shuffles values uniformly at random with thread_num threads. Every value
+// is sent to a random bucket, then each bucket is shuffled on its own, which
+// gives a uniform permutation while the buckets fit in the caches. The same
+// seed and thread_num give the same order.
+void ParallelShuffle(std::vector<uint32_t>* values, int thread_num,
+                     uint64_t seed);
+
+// Order of the in memory instances of a dataset for one pass. The records
+// stay where they were loaded and only their 4 byte positions are shuffled;
+// the readers claim batches of positions in Next() and gather the records
+// themselves.
+class ShuffleIndex {
+ public:
+  ShuffleIndex() {}
+
+  // positions 0 .. ins_num - 1, in a uniformly random order when shuffle
+  void Build(size_t ins_num, bool shuffle, int thread_num, uint64_t seed);
+  void Clear();
+
+  size_t size() const { return positions_.size(); }
+  const std::vector<uint32_t>& positions() const { return positions_; }
+
+  // restarts the pass
+  void Rewind() { cursor_.store(0); }
+
+  // Claims the next at most max_num positions of the pass and returns their
+  // number, 0 once the pass is over. Can be called by all readers at once.
+  size_t Next(size_t max_num, const uint32_t** positions);
+
+ private:
+  std::vector<uint32_t> positions_;
+  std::atomic<size_t> cursor_{0};
+};
+
+}  // namespace framework
+}  // namespace paddle
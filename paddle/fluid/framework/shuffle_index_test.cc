@@ -0,0 +1,134 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/shuffle_index.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <numeric>
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace paddle {
+namespace framework {
+
+static void CheckPermutation(const std::vector<uint32_t>& positions) {
+  std::vector<uint32_t> sorted(positions);
+  std::sort(sorted.begin(), sorted.end());
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    ASSERT_EQ(sorted[i], i);
+  }
+}
+
+TEST(ShuffleIndex, build) {
+  ShuffleIndex index;
+  index.Build(1000, false, 4, 0);
+  for (size_t i = 0; i < index.size(); ++i) {
+    ASSERT_EQ(index.positions()[i], i);
+  }
+
+  for (size_t ins_num : {0, 1, 1000, 1 << 20}) {
+    for (int thread_num : {1, 3, 8}) {
+      index.Build(ins_num, true, thread_num, 7);
+      ASSERT_EQ(index.size(), ins_num);
+      CheckPermutation(index.positions());
+
+      auto first = index.positions();
+      index.Build(ins_num, true, thread_num, 7);
+      ASSERT_EQ(index.positions(), first);
+    }
+  }
+  index.Clear();
+  ASSERT_EQ(index.size(), 0UL);
+}
+
+// every range of the output takes about the same number of values from every
+// range of the input
+TEST(ShuffleIndex, uniform) {
+  const size_t ins_num = 1 << 21;
+  const size_t range_num = 8;
+  const size_t range_size = ins_num / range_num;
+  ShuffleIndex index;
+  index.Build(ins_num, true, 8, 1);
+  std::vector<size_t> counts(range_num * range_num, 0);
+  for (size_t i = 0; i < ins_num; ++i) {
+    ++counts[i / range_size * range_num + index.positions()[i] / range_size];
+  }
+  double expected = static_cast<double>(ins_num) / (range_num * range_num);
+  for (auto count : counts) {
+    ASSERT_NEAR(count, expected, expected * 0.02);
+  }
+}
+
+TEST(ShuffleIndex, next) {
+  ShuffleIndex index;
+  index.Build(100003, true, 4, 3);
+  for (int pass = 0; pass < 2; ++pass) {
+    index.Rewind();
+    std::vector<std::vector<uint32_t>> claimed(8);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < claimed.size(); ++t) {
+      threads.emplace_back([&index, &claimed, t] {
+        const uint32_t* positions = nullptr;
+        size_t num = 0;
+        while ((num = index.Next(64, &positions)) != 0) {
+          ASSERT_LE(num, 64UL);
+          claimed[t].insert(claimed[t].end(), positions, positions + num);
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    std::vector<uint32_t> all;
+    for (auto& c : claimed) {
+      all.insert(all.end(), c.begin(), c.end());
+    }
+    ASSERT_EQ(all.size(), index.size());
+    CheckPermutation(all);
+  }
+}
+
+// Shuffling the positions against shuffling the records the readers would
+// otherwise move, 128 bytes each. Not a pass / fail test,
+// run it by --gtest_also_run_disabled_tests.
+TEST(ShuffleIndex, DISABLED_benchmark) {
+  struct FakeRecord {
+    uint64_t data[16];
+  };
+  const size_t ins_num = 1 << 22;
+  std::vector<FakeRecord> records(ins_num);
+  std::mt19937_64 engine(0);
+
+  auto start = std::chrono::steady_clock::now();
+  std::shuffle(records.begin(), records.end(), engine);
+  auto middle = std::chrono::steady_clock::now();
+  ShuffleIndex index;
+  index.Build(ins_num, true, 8, 0);
+  auto end = std::chrono::steady_clock::now();
+
+  auto ms = [](std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+  LOG(INFO) << "shuffle " << ins_num << " records " << ms(middle - start)
+            << " ms, shuffle index with 8 threads " << ms(end - middle)
+            << " ms";
+}
+
+}  // namespace framework
+}  // namespace paddle
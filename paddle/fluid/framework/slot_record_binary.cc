@@ -0,0 +1,392 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/slot_record_binary.h"
+
+#include <cstring>
+
+#include "paddle/fluid/framework/io/fs.h"
+#include "paddle/fluid/framework/slot_tokenizer.h"
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle {
+namespace framework {
+
+constexpr uint32_t SlotRecordBinaryFormat::kVersion;
+constexpr uint32_t SlotRecordBinaryFormat::kWithInsId;
+constexpr uint32_t SlotRecordBinaryFormat::kBlockMagic;
+constexpr size_t SlotRecordBinaryFormat::kDefaultBlockInsNum;
+
+namespace {
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint32_t slot_num;
+  uint32_t reserved;
+};
+
+struct SlotHeader {
+  uint32_t type;
+  uint32_t name_len;
+};
+
+struct BlockHeader {
+  uint32_t magic;
+  uint32_t ins_num;
+  uint64_t body_bytes;
+};
+
+size_t ValueSize(char type) { return type == 'u' ? sizeof(uint64_t) : 4; }
+
+}  // namespace
+
+SlotRecordBinaryWriter::SlotRecordBinaryWriter(
+    FILE* fp, const std::vector<BinarySlotDesc>& slots, bool with_ins_id,
+    size_t block_ins_num)
+    : fp_(fp),
+      slots_(slots),
+      with_ins_id_(with_ins_id),
+      block_ins_num_(block_ins_num),
+      offsets_(slots.size(), std::vector<uint32_t>(1, 0)),
+      values_(slots.size()) {
+  PADDLE_ENFORCE_NOT_NULL(fp_, platform::errors::InvalidArgument(
+                                   "The output file of SlotRecordBinaryWriter "
+                                   "is NULL."));
+  PADDLE_ENFORCE_GT(block_ins_num_, 0,
+                    platform::errors::InvalidArgument(
+                        "The number of instances per block must be positive."));
+  ins_id_offsets_.push_back(0);
+
+  FileHeader header;
+  memcpy(header.magic, SlotRecordBinaryFormat::Magic(), sizeof(header.magic));
+  header.version = SlotRecordBinaryFormat::kVersion;
+  header.flags = with_ins_id ? SlotRecordBinaryFormat::kWithInsId : 0;
+  header.slot_num = static_cast<uint32_t>(slots.size());
+  header.reserved = 0;
+  Write(&header, sizeof(header));
+  for (auto& slot : slots_) {
+    PADDLE_ENFORCE_EQ(slot.type == 'u' || slot.type == 'f', true,
+                      platform::errors::InvalidArgument(
+                          "The type of slot %s must be uint64 or float.",
+                          slot.name));
+    SlotHeader slot_header;
+    slot_header.type = static_cast<uint32_t>(slot.type);
+    slot_header.name_len = static_cast<uint32_t>(slot.name.size());
+    Write(&slot_header, sizeof(slot_header));
+    Write(slot.name.data(), slot.name.size());
+    WritePadding(slot.name.size());
+  }
+}
+
+SlotRecordBinaryWriter::~SlotRecordBinaryWriter() {
+  if (closed_) {
+    return;
+  }
+  // call Close() to see the errors, the destructor only logs them
+  try {
+    Close();
+  } catch (std::exception& ex) {
+    LOG(ERROR) << "Failed to write the last block of slot records: "
+               << ex.what();
+  }
+}
+
+void SlotRecordBinaryWriter::AddTextLine(const char* line, size_t len) {
+  SlotTokenizer tokenizer(line, line + len);
+  int num = 0;
+  if (with_ins_id_) {
+    const char* token = nullptr;
+    size_t token_len = 0;
+    tokenizer.ParseInt(&num);
+    PADDLE_ENFORCE_EQ(num, 1, platform::errors::InvalidArgument(
+                                  "The ins id must be one token, please "
+                                  "check this line: %s",
+                                  line));
+    tokenizer.ParseToken(&token, &token_len);
+    ins_ids_.append(token, token_len);
+  }
+  ins_id_offsets_.push_back(static_cast<uint32_t>(ins_ids_.size()));
+
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    num = 0;
+    tokenizer.ParseInt(&num);
+    PADDLE_ENFORCE_NE(
+        num, 0,
+        platform::errors::InvalidArgument(
+            "The number of ids can not be zero, you need padding "
+            "it in data generator; or if there is something wrong with "
+            "the data, please check if the data contains unresolvable "
+            "characters.\nplease check this error line: %s, \n Specifically, "
+            "something wrong happened when we parse the %d th slots.",
+            line, i));
+    auto& values = values_[i];
+    if (slots_[i].type == 'u') {
+      for (int j = 0; j < num; ++j) {
+        uint64_t value = 0;
+        tokenizer.ParseUint64(&value);
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        values.insert(values.end(), bytes, bytes + sizeof(value));
+      }
+    } else {
+      for (int j = 0; j < num; ++j) {
+        float value = 0;
+        tokenizer.ParseFloat(&value);
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        values.insert(values.end(), bytes, bytes + sizeof(value));
+      }
+    }
+    offsets_[i].push_back(
+        static_cast<uint32_t>(values.size() / ValueSize(slots_[i].type)));
+  }
+
+  ++total_ins_num_;
+  if (++ins_num_ == block_ins_num_) {
+    WriteBlock();
+  }
+}
+
+void SlotRecordBinaryWriter::Close() {
+  if (ins_num_ > 0) {
+    WriteBlock();
+  }
+  fflush(fp_);
+  closed_ = true;
+}
+
+void SlotRecordBinaryWriter::WriteBlock() {
+  size_t body_bytes = 0;
+  if (with_ins_id_) {
+    body_bytes += SlotRecordBinaryFormat::Align(ins_id_offsets_.size() *
+                                                sizeof(uint32_t));
+    body_bytes += SlotRecordBinaryFormat::Align(ins_ids_.size());
+  }
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    body_bytes +=
+        SlotRecordBinaryFormat::Align(offsets_[i].size() * sizeof(uint32_t));
+    body_bytes += SlotRecordBinaryFormat::Align(values_[i].size());
+  }
+
+  BlockHeader header;
+  header.magic = SlotRecordBinaryFormat::kBlockMagic;
+  header.ins_num = ins_num_;
+  header.body_bytes = body_bytes;
+  Write(&header, sizeof(header));
+
+  if (with_ins_id_) {
+    size_t size = ins_id_offsets_.size() * sizeof(uint32_t);
+    Write(ins_id_offsets_.data(), size);
+    WritePadding(size);
+    Write(ins_ids_.data(), ins_ids_.size());
+    WritePadding(ins_ids_.size());
+  }
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    size_t size = offsets_[i].size() * sizeof(uint32_t);
+    Write(offsets_[i].data(), size);
+    WritePadding(size);
+    Write(values_[i].data(), values_[i].size());
+    WritePadding(values_[i].size());
+    offsets_[i].resize(1);
+    values_[i].clear();
+  }
+  ins_id_offsets_.resize(1);
+  ins_ids_.clear();
+  ins_num_ = 0;
+}
+
+void SlotRecordBinaryWriter::Write(const void* data, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  PADDLE_ENFORCE_EQ(fwrite(data, 1, size, fp_), size,
+                    platform::errors::Unavailable(
+                        "Fail to write %d bytes of a slot record binary file.",
+                        size));
+}
+
+void SlotRecordBinaryWriter::WritePadding(size_t size) {
+  static const char kZeros[8] = {0};
+  Write(kZeros, SlotRecordBinaryFormat::Align(size) - size);
+}
+
+SlotRecordBinaryReader::SlotRecordBinaryReader(FILE* fp) : fp_(fp) {
+  PADDLE_ENFORCE_NOT_NULL(fp_, platform::errors::InvalidArgument(
+                                   "The input file of SlotRecordBinaryReader "
+                                   "is NULL."));
+  ReadHeader();
+}
+
+SlotRecordBinaryReader::SlotRecordBinaryReader(const char* data, size_t size)
+    : data_(data), size_(size) {
+  ReadHeader();
+}
+
+const char* SlotRecordBinaryReader::Read(size_t size) {
+  if (data_ != nullptr) {
+    if (pos_ + size > size_) {
+      return nullptr;
+    }
+    const char* ptr = data_ + pos_;
+    pos_ += size;
+    return ptr;
+  }
+  buffer_.resize((size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+  char* ptr = reinterpret_cast<char*>(buffer_.data());
+  if (fread(ptr, 1, size, fp_) != size) {
+    return nullptr;
+  }
+  return ptr;
+}
+
+void SlotRecordBinaryReader::ReadHeader() {
+  const char* ptr = Read(sizeof(FileHeader));
+  PADDLE_ENFORCE_NOT_NULL(
+      ptr, platform::errors::InvalidArgument(
+               "The slot record binary file is too short for its header."));
+  FileHeader header;
+  memcpy(&header, ptr, sizeof(header));
+  PADDLE_ENFORCE_EQ(
+      memcmp(header.magic, SlotRecordBinaryFormat::Magic(),
+             sizeof(header.magic)),
+      0, platform::errors::InvalidArgument(
+             "The file is not a slot record binary file, convert the text "
+             "files with ConvertSlotTextToBinary first."));
+  PADDLE_ENFORCE_EQ(header.version, SlotRecordBinaryFormat::kVersion,
+                    platform::errors::InvalidArgument(
+                        "Unsupported slot record binary version %d.",
+                        header.version));
+  with_ins_id_ = (header.flags & SlotRecordBinaryFormat::kWithInsId) != 0;
+
+  slots_.resize(header.slot_num);
+  for (auto& slot : slots_) {
+    ptr = Read(sizeof(SlotHeader));
+    PADDLE_ENFORCE_NOT_NULL(ptr, platform::errors::InvalidArgument(
+                                     "The slot record binary file is "
+                                     "truncated in its header."));
+    SlotHeader slot_header;
+    memcpy(&slot_header, ptr, sizeof(slot_header));
+    ptr = Read(SlotRecordBinaryFormat::Align(slot_header.name_len));
+    PADDLE_ENFORCE_NOT_NULL(ptr, platform::errors::InvalidArgument(
+                                     "The slot record binary file is "
+                                     "truncated in its header."));
+    slot.name.assign(ptr, slot_header.name_len);
+    slot.type = static_cast<char>(slot_header.type);
+  }
+}
+
+bool SlotRecordBinaryReader::NextBlock(SlotRecordBinaryBlock* block) {
+  const char* ptr = Read(sizeof(BlockHeader));
+  if (ptr == nullptr) {
+    return false;
+  }
+  BlockHeader header;
+  memcpy(&header, ptr, sizeof(header));
+  PADDLE_ENFORCE_EQ(header.magic, SlotRecordBinaryFormat::kBlockMagic,
+                    platform::errors::InvalidArgument(
+                        "The slot record binary file is corrupted, a block "
+                        "does not start with the block magic."));
+  const char* body = Read(header.body_bytes);
+  PADDLE_ENFORCE_NOT_NULL(body, platform::errors::InvalidArgument(
+                                    "The slot record binary file is "
+                                    "truncated in a block."));
+  block->ins_num = header.ins_num;
+  ParseBody(body, header.body_bytes, block);
+  return true;
+}
+
+void SlotRecordBinaryReader::ParseBody(const char* body, size_t body_bytes,
+                                       SlotRecordBinaryBlock* block) {
+  size_t pos = 0;
+  // the next column, of bytes padded to the alignment
+  auto column = [&](size_t bytes) {
+    size_t aligned = SlotRecordBinaryFormat::Align(bytes);
+    PADDLE_ENFORCE_LE(aligned, body_bytes - pos,
+                      platform::errors::InvalidArgument(
+                          "The slot record binary file is corrupted, a "
+                          "column is out of its block."));
+    const char* ptr = body + pos;
+    pos += aligned;
+    return ptr;
+  };
+  // the offsets of the instances into a column, which must be sorted, the
+  // end of the last one gives the size of the column
+  auto offsets = [&](const char* name) {
+    auto* ptr = reinterpret_cast<const uint32_t*>(
+        column((block->ins_num + 1) * sizeof(uint32_t)));
+    for (uint32_t k = 0; k < block->ins_num; ++k) {
+      PADDLE_ENFORCE_LE(ptr[k], ptr[k + 1],
+                        platform::errors::InvalidArgument(
+                            "The slot record binary file is corrupted, the "
+                            "offsets of %s are not sorted.",
+                            name));
+    }
+    return ptr;
+  };
+
+  if (with_ins_id_) {
+    block->ins_id_offsets = offsets("the ins ids");
+    block->ins_ids = column(block->ins_id_offsets[block->ins_num]);
+  }
+  block->offsets.resize(slots_.size());
+  block->values.resize(slots_.size());
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    block->offsets[i] = offsets(slots_[i].name.c_str());
+    block->values[i] = column(
+        static_cast<size_t>(block->offsets[i][block->ins_num]) *
+        ValueSize(slots_[i].type));
+  }
+}
+
+size_t ConvertSlotTextToBinary(const std::string& text_path,
+                               const std::string& binary_path,
+                               const std::vector<std::string>& slot_names,
+                               const std::vector<std::string>& slot_types,
+                               bool with_ins_id) {
+  PADDLE_ENFORCE_EQ(slot_names.size(), slot_types.size(),
+                    platform::errors::InvalidArgument(
+                        "The number of slot names (%d) and slot types (%d) "
+                        "must be the same.",
+                        slot_names.size(), slot_types.size()));
+  std::vector<BinarySlotDesc> slots(slot_names.size());
+  for (size_t i = 0; i < slots.size(); ++i) {
+    slots[i].name = slot_names[i];
+    slots[i].type = slot_types[i].empty() ? ' ' : slot_types[i][0];
+  }
+
+  int err_no = 0;
+  std::shared_ptr<FILE> input = fs_open_read(text_path, &err_no, "");
+  PADDLE_ENFORCE_EQ(err_no, 0, platform::errors::Unavailable(
+                                   "Fail to open %s for reading.", text_path));
+  std::shared_ptr<FILE> output = fs_open_write(binary_path, &err_no, "");
+  PADDLE_ENFORCE_EQ(err_no, 0,
+                    platform::errors::Unavailable(
+                        "Fail to open %s for writing.", binary_path));
+
+  SlotRecordBinaryWriter writer(output.get(), slots, with_ins_id);
+  string::LineFileReader reader;
+  while (reader.getline(input.get())) {
+    if (reader.length() == 0) {
+      continue;
+    }
+    writer.AddTextLine(reader.get(), reader.length());
+  }
+  writer.Close();
+  VLOG(3) << "Convert " << text_path << " to " << binary_path << ", "
+          << writer.ins_num() << " instances";
+  return writer.ins_num();
+}
+
+}  // namespace framework
+}  // namespace paddle
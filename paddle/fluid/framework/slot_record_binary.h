@@ -0,0 +1,158 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace paddle {
+namespace framework {
+
+// Binary columnar file of MultiSlot instances, written once by
+// ConvertSlotTextToBinary and then loaded every pass without tokenizing.
+//
+// All integers are little endian and every section starts at a multiple of
+// 8 bytes, so the file can be read through a stream or used in place from a
+// mmap. The layout is
+//
+//   header: magic "PDSLOTBN", uint32 version, uint32 flags, uint32 slot_num,
+//           uint32 reserved, then per slot: uint32 type ('u' or 'f'),
+//           uint32 name_len, name bytes padded to 8
+//   blocks until the end of the file, each of
+//           uint32 kBlockMagic, uint32 ins_num, uint64 body_bytes, and a body
+//           of columns, each padded to 8:
+//             ins ids, when kWithInsId: uint32 offsets[ins_num + 1], bytes
+//             per slot: uint32 offsets[ins_num + 1], values (uint64 / float)
+//
+// Offsets of a column start from 0 in every block. Values are stored as
+// they appear in the text, zero feasigns included, the reader applies the
+// same filtering as the text parser.
+struct SlotRecordBinaryFormat {
+  static constexpr uint32_t kVersion = 1;
+  static constexpr uint32_t kWithInsId = 1;
+  static constexpr uint32_t kBlockMagic = 0x4b4c4253;  // "SBLK"
+  static constexpr size_t kDefaultBlockInsNum = 4096;
+
+  static const char* Magic() { return "PDSLOTBN"; }
+  static size_t Align(size_t size) { return (size + 7) & ~size_t(7); }
+};
+
+struct BinarySlotDesc {
+  std::string name;
+  char type;  // 'u' for uint64, 'f' for float
+};
+
+// One block of instances, the pointers are valid until the next
+// SlotRecordBinaryReader::NextBlock.
+struct SlotRecordBinaryBlock {
+  uint32_t ins_num{0};
+  const uint32_t* ins_id_offsets{nullptr};
+  const char* ins_ids{nullptr};
+  // per slot of the file
+  std::vector<const uint32_t*> offsets;
+  std::vector<const char*> values;
+
+  const uint64_t* Uint64Values(size_t slot) const {
+    return reinterpret_cast<const uint64_t*>(values[slot]);
+  }
+  const float* FloatValues(size_t slot) const {
+    return reinterpret_cast<const float*>(values[slot]);
+  }
+};
+
+class SlotRecordBinaryWriter {
+ public:
+  // fp stays owned by the caller
+  SlotRecordBinaryWriter(
+      FILE* fp, const std::vector<BinarySlotDesc>& slots, bool with_ins_id,
+      size_t block_ins_num = SlotRecordBinaryFormat::kDefaultBlockInsNum);
+
+  ~SlotRecordBinaryWriter();
+
+  // Adds one instance in the MultiSlot text format, "1 ins_id" first when
+  // the file has ins ids, then "num v1 ... vnum" for every slot.
+  void AddTextLine(const char* line, size_t len);
+
+  // writes the pending instances, the writer can not be used afterwards.
+  // The destructor closes an open writer too, but only logs its errors.
+  void Close();
+
+  size_t ins_num() const { return total_ins_num_; }
+
+ private:
+  void WriteBlock();
+  void Write(const void* data, size_t size);
+  void WritePadding(size_t size);
+
+  FILE* fp_;
+  std::vector<BinarySlotDesc> slots_;
+  bool with_ins_id_;
+  size_t block_ins_num_;
+  bool closed_{false};
+
+  uint32_t ins_num_{0};
+  size_t total_ins_num_{0};
+  std::vector<uint32_t> ins_id_offsets_;
+  std::string ins_ids_;
+  std::vector<std::vector<uint32_t>> offsets_;
+  std::vector<std::vector<char>> values_;
+};
+
+class SlotRecordBinaryReader {
+ public:
+  // reads the blocks from the stream fp, owned by the caller
+  explicit SlotRecordBinaryReader(FILE* fp);
+
+  // uses the whole file in memory, e.g. mmap-ed, in place
+  SlotRecordBinaryReader(const char* data, size_t size);
+
+  const std::vector<BinarySlotDesc>& slots() const { return slots_; }
+  bool with_ins_id() const { return with_ins_id_; }
+
+  // false at the end of the file
+  bool NextBlock(SlotRecordBinaryBlock* block);
+
+ private:
+  // the next size bytes of the file, nullptr at the end
+  const char* Read(size_t size);
+  void ReadHeader();
+  void ParseBody(const char* body, size_t body_bytes,
+                 SlotRecordBinaryBlock* block);
+
+  FILE* fp_{nullptr};
+  const char* data_{nullptr};
+  size_t size_{0};
+  size_t pos_{0};
+  // holds the last read section of a stream, 8 byte aligned
+  std::vector<uint64_t> buffer_;
+
+  std::vector<BinarySlotDesc> slots_;
+  bool with_ins_id_{false};
+};
+
+// Converts the MultiSlot text file text_path to the binary file binary_path,
+// slot_types are "uint64" or "float" as in the DataFeedDesc. Paths may be on
+// any file system supported by fs_open_read / fs_open_write. Returns the
+// number of instances.
+size_t ConvertSlotTextToBinary(const std::string& text_path,
+                               const std::string& binary_path,
+                               const std::vector<std::string>& slot_names,
+                               const std::vector<std::string>& slot_types,
+                               bool with_ins_id);
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,278 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/slot_record_binary.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>  // NOLINT
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/framework/channel.h"
+#include "paddle/fluid/framework/data_feed.h"
+#include "paddle/fluid/framework/data_feed_factory.h"
+
+namespace paddle {
+namespace framework {
+
+struct TextInstance {
+  std::string ins_id;
+  std::vector<uint64_t> ids;
+  std::vector<float> values;
+};
+
+static void CheckBlocks(SlotRecordBinaryReader* reader,
+                        const std::vector<TextInstance>& instances) {
+  ASSERT_TRUE(reader->with_ins_id());
+  ASSERT_EQ(reader->slots().size(), 2UL);
+  ASSERT_EQ(reader->slots()[0].name, "click_ids");
+  ASSERT_EQ(reader->slots()[0].type, 'u');
+  ASSERT_EQ(reader->slots()[1].name, "ctr");
+  ASSERT_EQ(reader->slots()[1].type, 'f');
+
+  size_t index = 0;
+  SlotRecordBinaryBlock block;
+  while (reader->NextBlock(&block)) {
+    for (uint32_t k = 0; k < block.ins_num; ++k, ++index) {
+      ASSERT_LT(index, instances.size());
+      auto& ins = instances[index];
+      ASSERT_EQ(std::string(block.ins_ids + block.ins_id_offsets[k],
+                            block.ins_ids + block.ins_id_offsets[k + 1]),
+                ins.ins_id);
+      std::vector<uint64_t> ids(
+          block.Uint64Values(0) + block.offsets[0][k],
+          block.Uint64Values(0) + block.offsets[0][k + 1]);
+      ASSERT_EQ(ids, ins.ids);
+      std::vector<float> values(block.FloatValues(1) + block.offsets[1][k],
+                                block.FloatValues(1) + block.offsets[1][k + 1]);
+      ASSERT_EQ(values, ins.values);
+    }
+  }
+  ASSERT_EQ(index, instances.size());
+}
+
+TEST(SlotRecordBinary, convert_and_read) {
+  std::mt19937_64 rng(0);
+  std::vector<TextInstance> instances(10000);
+  std::string text_path = "slot_record_binary_test.txt";
+  std::string binary_path = "slot_record_binary_test.bin";
+  {
+    std::ofstream text(text_path);
+    for (size_t i = 0; i < instances.size(); ++i) {
+      auto& ins = instances[i];
+      ins.ins_id = "ins_" + std::to_string(i);
+      ins.ids.resize(1 + rng() % 10);
+      for (auto& id : ins.ids) {
+        id = rng() % 3 == 0 ? 0 : rng();
+      }
+      ins.values.resize(1 + rng() % 3);
+      for (auto& value : ins.values) {
+        value = static_cast<float>(rng() % 1000) / 8.0f;
+      }
+
+      text << "1 " << ins.ins_id << " " << ins.ids.size();
+      for (auto id : ins.ids) {
+        text << " " << id;
+      }
+      text << " " << ins.values.size();
+      for (auto value : ins.values) {
+        text << " " << value;
+      }
+      text << "\n";
+    }
+  }
+
+  ASSERT_EQ(ConvertSlotTextToBinary(text_path, binary_path,
+                                    {"click_ids", "ctr"}, {"uint64", "float"},
+                                    true),
+            instances.size());
+
+  // streamed
+  {
+    FILE* fp = fopen(binary_path.c_str(), "rb");
+    ASSERT_NE(fp, nullptr);
+    SlotRecordBinaryReader reader(fp);
+    CheckBlocks(&reader, instances);
+    fclose(fp);
+  }
+
+  // in place, as from a mmap
+  {
+    std::ifstream binary(binary_path, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(binary)),
+                            std::istreambuf_iterator<char>());
+    std::vector<uint64_t> aligned((bytes.size() + 7) / 8);
+    memcpy(aligned.data(), bytes.data(), bytes.size());
+    const char* data = reinterpret_cast<const char*>(aligned.data());
+    SlotRecordBinaryReader reader(data, bytes.size());
+    CheckBlocks(&reader, instances);
+  }
+
+  remove(text_path.c_str());
+  remove(binary_path.c_str());
+}
+
+TEST(SlotRecordBinary, bad_magic) {
+  std::string data(64, 'x');
+  ASSERT_ANY_THROW(SlotRecordBinaryReader(data.data(), data.size()));
+}
+
+// offsets that are not sorted or end out of their block are rejected
+TEST(SlotRecordBinary, bad_offsets) {
+  std::string text_path = "slot_record_binary_offsets_test.txt";
+  std::string binary_path = "slot_record_binary_offsets_test.bin";
+  {
+    std::ofstream text(text_path);
+    text << "1 ins_0 2 5 7 1 0.5\n";
+    text << "1 ins_1 1 9 1 0.25\n";
+  }
+  ASSERT_EQ(ConvertSlotTextToBinary(text_path, binary_path,
+                                    {"click_ids", "ctr"}, {"uint64", "float"},
+                                    true),
+            2UL);
+  std::ifstream binary(binary_path, std::ios::binary);
+  std::vector<char> bytes((std::istreambuf_iterator<char>(binary)),
+                          std::istreambuf_iterator<char>());
+  remove(text_path.c_str());
+  remove(binary_path.c_str());
+
+  // file header, slot headers, block header
+  size_t body = 24 + 8 + SlotRecordBinaryFormat::Align(strlen("click_ids")) +
+                8 + SlotRecordBinaryFormat::Align(strlen("ctr")) + 16;
+  uint32_t ins_id_offsets[3];
+  memcpy(ins_id_offsets, bytes.data() + body, sizeof(ins_id_offsets));
+  ASSERT_EQ(ins_id_offsets[2], strlen("ins_0ins_1"));
+  size_t click_ids =
+      body + SlotRecordBinaryFormat::Align(sizeof(ins_id_offsets)) +
+      SlotRecordBinaryFormat::Align(ins_id_offsets[2]);
+
+  // reads the block with the offset at pos set to value
+  auto read = [&bytes](size_t pos, uint32_t value) {
+    std::vector<uint64_t> aligned((bytes.size() + 7) / 8);
+    memcpy(aligned.data(), bytes.data(), bytes.size());
+    char* data = reinterpret_cast<char*>(aligned.data());
+    memcpy(data + pos, &value, sizeof(value));
+    SlotRecordBinaryReader reader(data, bytes.size());
+    SlotRecordBinaryBlock block;
+    reader.NextBlock(&block);
+  };
+  read(click_ids + 4, 2);
+  ASSERT_ANY_THROW(read(body + 4, 11));
+  ASSERT_ANY_THROW(read(body + 8, 1 << 20));
+  ASSERT_ANY_THROW(read(click_ids + 4, 4));
+  ASSERT_ANY_THROW(read(click_ids + 8, 1 << 20));
+}
+
+#ifdef _LINUX
+// loads the file through SlotRecordBinaryInMemoryDataFeed with pipe_command,
+// from the prefetcher if any
+static std::vector<SlotRecord> LoadWithDataFeed(
+    const std::string& binary_path, const std::string& pipe_command,
+    FilePrefetcher* prefetcher = nullptr) {
+  DataFeedDesc desc;
+  desc.set_name("SlotRecordBinaryInMemoryDataFeed");
+  desc.set_batch_size(2);
+  desc.set_pipe_command(pipe_command);
+  auto* multi_slot_desc = desc.mutable_multi_slot_desc();
+  // in another order than the file, and without its unused slot
+  for (auto name_type : {std::make_pair("ctr", "float"),
+                         std::make_pair("click_ids", "uint64")}) {
+    auto* slot = multi_slot_desc->add_slots();
+    slot->set_name(name_type.first);
+    slot->set_type(name_type.second);
+    slot->set_is_used(true);
+    slot->set_is_dense(false);
+  }
+
+  auto channel = MakeChannel<SlotRecord>();
+  std::mutex file_mutex;
+  size_t file_index = 0;
+  auto reader = DataFeedFactory::CreateDataFeed(desc.name());
+  reader->Init(desc);
+  reader->SetThreadId(0);
+  reader->SetThreadNum(1);
+  reader->SetParseInsId(true);
+  reader->SetFileListMutex(&file_mutex);
+  reader->SetFileListIndex(&file_index);
+  reader->SetFileList({binary_path});
+  reader->SetInputChannel(channel.get());
+  if (prefetcher != nullptr) {
+    prefetcher->Start();
+    reader->SetFilePrefetcher(prefetcher);
+  }
+  reader->LoadIntoMemory();
+
+  channel->Close();
+  std::vector<SlotRecord> records;
+  channel->ReadAll(records);
+  return records;
+}
+
+TEST(SlotRecordBinary, data_feed) {
+  std::string text_path = "slot_record_binary_feed_test.txt";
+  std::string binary_path = "slot_record_binary_feed_test.bin";
+  {
+    std::ofstream text(text_path);
+    text << "1 ins_0 3 5 0 7 1 0.5 2 11 12\n";
+    // no click id but 0, dropped
+    text << "1 ins_1 1 0 1 0.25 1 13\n";
+    text << "1 ins_2 2 9 10 2 0 1.5 1 14\n";
+  }
+  ASSERT_EQ(ConvertSlotTextToBinary(text_path, binary_path,
+                                    {"click_ids", "ctr", "unused"},
+                                    {"uint64", "float", "uint64"}, true),
+            3UL);
+
+  // mmap-ed, streamed through a pipe, then prefetched into memory
+  for (auto pipe_command : {"cat", "cat | cat", "prefetch"}) {
+    std::vector<SlotRecord> records;
+    if (std::string(pipe_command) == "prefetch") {
+      auto prefetcher = std::make_shared<FilePrefetcher>(
+          std::vector<std::string>{binary_path}, "cat", 1, 1 << 20);
+      records = LoadWithDataFeed(binary_path, "cat", prefetcher.get());
+      EXPECT_EQ(prefetcher->BufferedBytes(), 0UL);
+    } else {
+      records = LoadWithDataFeed(binary_path, pipe_command);
+    }
+    ASSERT_EQ(records.size(), 2UL) << pipe_command;
+    EXPECT_EQ(records[0]->ins_id_, "ins_0");
+    EXPECT_EQ(records[0]->slot_uint64_feasigns_.slot_values,
+              std::vector<uint64_t>({5, 7}));
+    EXPECT_EQ(records[0]->slot_uint64_feasigns_.slot_offsets,
+              std::vector<uint32_t>({0, 2}));
+    EXPECT_EQ(records[0]->slot_float_feasigns_.slot_values,
+              std::vector<float>({0.5}));
+    EXPECT_EQ(records[0]->slot_float_feasigns_.slot_offsets,
+              std::vector<uint32_t>({0, 1}));
+    // zero feasigns of the sparse slots are dropped
+    EXPECT_EQ(records[1]->ins_id_, "ins_2");
+    EXPECT_EQ(records[1]->slot_uint64_feasigns_.slot_values,
+              std::vector<uint64_t>({9, 10}));
+    EXPECT_EQ(records[1]->slot_float_feasigns_.slot_values,
+              std::vector<float>({1.5}));
+    SlotRecordPool().put(&records);
+  }
+
+  remove(text_path.c_str());
+  remove(binary_path.c_str());
+}
+#endif
+
+}  // namespace framework
+}  // namespace paddle
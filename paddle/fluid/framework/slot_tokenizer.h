@@ -0,0 +1,229 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+namespace paddle {
+namespace framework {
+
+// Tokenizer of the MultiSlot text format, "num v1 v2 ... num v1 ...". It
+// reads the line in place and gives the same values as strtol / strtoull /
+// strtof, which it falls back to for rare inputs (signs, exponents,
+// overflows, ...). Runs of digits are converted 16 at a time with SSSE3
+// when available (any AVX build), so a feasign costs a few instructions.
+//
+// The byte at end must be readable and must not continue a number, which
+// holds for std::string::c_str() and the buffer of LineFileReader. Nothing is
+// read past end.
+class SlotTokenizer {
+ public:
+  SlotTokenizer(const char* begin, const char* end) : pos_(begin), end_(end) {}
+
+  const char* pos() const { return pos_; }
+
+  bool Done() {
+    SkipSpaces();
+    return pos_ >= end_;
+  }
+
+  // Each Parse* returns false, leaving the position unchanged, when the next
+  // token is not a number.
+  bool ParseInt(int* value) {
+    uint64_t v = 0;
+    if (!ParseUint64(&v) || v > INT32_MAX) {
+      return false;
+    }
+    *value = static_cast<int>(v);
+    return true;
+  }
+
+  bool ParseUint64(uint64_t* value) {
+    SkipSpaces();
+    size_t len = ParseDigits(pos_, value);
+    // the digits are summed modulo 2^64, which is exact unless a 20 digit
+    // number is above the maximum
+    if (len == 0 || len > 20 ||
+        (len == 20 && memcmp(pos_, "18446744073709551615", 20) > 0)) {
+      // sign, overflow or not a number
+      char* endptr = nullptr;
+      *value = strtoull(pos_, &endptr, 10);
+      if (endptr == pos_) {
+        return false;
+      }
+      pos_ = endptr;
+      return true;
+    }
+    pos_ += len;
+    return true;
+  }
+
+  bool ParseFloat(float* value) {
+    SkipSpaces();
+    // m / 10^k is exact as strtof when m < 2^24 and k <= 10, since both are
+    // exact floats and the division rounds once
+    const char* p = pos_;
+    bool negative = (*p == '-');
+    if (negative) {
+      ++p;
+    }
+    uint64_t int_part = 0;
+    size_t int_len = ParseDigits(p, &int_part);
+    p += int_len;
+    uint64_t frac_part = 0;
+    size_t frac_len = 0;
+    if (*p == '.') {
+      frac_len = ParseDigits(p + 1, &frac_part);
+      p += frac_len + 1;
+    }
+    if ((int_len > 0 || frac_len > 0) && int_len <= 8 && frac_len <= 10 &&
+        *p != 'e' && *p != 'E' && *p != 'x' && *p != 'X') {
+      uint64_t mantissa = int_part * Pow10(frac_len) + frac_part;
+      if (mantissa < (1U << 24)) {
+        float v = static_cast<float>(mantissa) /
+                  static_cast<float>(Pow10(frac_len));
+        *value = negative ? -v : v;
+        pos_ = p;
+        return true;
+      }
+    }
+    char* endptr = nullptr;
+    *value = strtof(pos_, &endptr);
+    if (endptr == pos_) {
+      return false;
+    }
+    pos_ = endptr;
+    return true;
+  }
+
+  // the next token, without its value
+  bool SkipToken() {
+    SkipSpaces();
+    if (pos_ >= end_) {
+      return false;
+    }
+    const char* space =
+        reinterpret_cast<const char*>(memchr(pos_, ' ', end_ - pos_));
+    pos_ = space == nullptr ? end_ : space;
+    return true;
+  }
+
+  bool ParseToken(const char** token, size_t* len) {
+    SkipSpaces();
+    const char* begin = pos_;
+    if (!SkipToken()) {
+      return false;
+    }
+    *token = begin;
+    *len = pos_ - begin;
+    return true;
+  }
+
+  // Reads the decimal digits at p into value, modulo 2^64, and returns their
+  // number.
+  size_t ParseDigits(const char* p, uint64_t* value) const {
+    size_t len = 0;
+    uint64_t v = 0;
+#ifdef __SSSE3__
+    if (end_ - p >= 16) {
+      len = CountLeadingDigits(p);
+      if (len >= 2) {
+        v = ConvertDigits(p, len);
+      } else {
+        len = 0;
+      }
+    }
+#endif
+    for (; static_cast<unsigned>(p[len] - '0') < 10; ++len) {
+      v = v * 10 + static_cast<unsigned>(p[len] - '0');
+    }
+    *value = v;
+    return len;
+  }
+
+ private:
+  static uint64_t Pow10(size_t k) {
+    static constexpr uint64_t kPow10[] = {
+        1,         10,         100,         1000,       10000, 100000,
+        1000000,   10000000,   100000000,   1000000000, 10000000000};
+    return kPow10[k];
+  }
+
+  void SkipSpaces() {
+    while (pos_ < end_ && (*pos_ == ' ' || *pos_ == '\t' || *pos_ == '\r' ||
+                           *pos_ == '\n')) {
+      ++pos_;
+    }
+  }
+
+#ifdef __SSSE3__
+  // number of digits in the 16 bytes at p, which must be readable
+  static size_t CountLeadingDigits(const char* p) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i digits = _mm_sub_epi8(chunk, _mm_set1_epi8('0'));
+    __m128i nine = _mm_set1_epi8(9);
+    __m128i is_digit = _mm_cmpeq_epi8(_mm_max_epu8(digits, nine), nine);
+    unsigned not_digit =
+        ~static_cast<unsigned>(_mm_movemask_epi8(is_digit)) & 0x1FFFFU;
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(not_digit);
+#else
+    size_t n = 0;
+    while ((not_digit & 1) == 0) {
+      not_digit >>= 1;
+      ++n;
+    }
+    return n;
+#endif
+  }
+
+  // value of the len (2..16) digits at p, the 16 bytes at p must be readable
+  static uint64_t ConvertDigits(const char* p, size_t len) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i digits = _mm_sub_epi8(chunk, _mm_set1_epi8('0'));
+    // move the digits to the high bytes, indices with the sign bit set
+    // shuffle in zeros
+    __m128i index = _mm_add_epi8(
+        _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+        _mm_set1_epi8(static_cast<char>(len - 16)));
+    digits = _mm_shuffle_epi8(digits, index);
+    // pairs, then groups of 4 and of 8 digits
+    __m128i v2 = _mm_maddubs_epi16(
+        digits,
+        _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+    __m128i v4 =
+        _mm_madd_epi16(v2, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+    __m128i v8 = _mm_madd_epi16(
+        _mm_packs_epi32(v4, v4),
+        _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+    uint64_t high = static_cast<uint32_t>(_mm_cvtsi128_si32(v8));
+    uint64_t low =
+        static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(v8, 4)));
+    return high * 100000000 + low;
+  }
+#endif
+
+  const char* pos_;
+  const char* end_;
+};
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,68 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/static_memory_plan.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+namespace paddle {
+namespace framework {
+
+static size_t AlignUp(size_t size, size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+size_t PlanMemoryOffsets(std::vector<MemoryBlock>* blocks, size_t alignment) {
+  auto& b = *blocks;
+  std::vector<size_t> order(b.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&b](size_t x, size_t y) {
+    return b[x].size > b[y].size;
+  });
+
+  const size_t none = std::numeric_limits<size_t>::max();
+  size_t arena_size = 0;
+  std::vector<size_t> placed;
+  // [begin, end) of the placed blocks alive with the current one
+  std::vector<std::pair<size_t, size_t>> busy;
+  for (size_t i : order) {
+    size_t size = AlignUp(b[i].size, alignment);
+    busy.clear();
+    for (size_t j : placed) {
+      if (b[j].first_op <= b[i].last_op && b[i].first_op <= b[j].last_op) {
+        busy.emplace_back(b[j].offset,
+                          b[j].offset + AlignUp(b[j].size, alignment));
+      }
+    }
+    std::sort(busy.begin(), busy.end());
+    size_t best = none, best_gap = none, top = 0;
+    for (auto& range : busy) {
+      if (range.first >= top + size && range.first - top < best_gap) {
+        best = top;
+        best_gap = range.first - top;
+      }
+      top = std::max(top, range.second);
+    }
+    b[i].offset = best == none ? top : best;
+    arena_size = std::max(arena_size, b[i].offset + size);
+    placed.push_back(i);
+  }
+  return arena_size;
+}
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,40 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace paddle {
+namespace framework {
+
+// The memory of a tensor, alive from the op writing it first to the op
+// using it last.
+struct MemoryBlock {
+  size_t size;
+  size_t first_op;
+  size_t last_op;
+  size_t offset{0};
+};
+
+// Assigns every block an offset in one arena, so that the blocks alive at the
+// same op never overlap. From the largest block down, each block takes the
+// smallest gap, between the placed blocks alive with it, that it fits in, or
+// goes above all of them. The offsets are multiples of alignment. Returns the
+// size of the arena.
+size_t PlanMemoryOffsets(std::vector<MemoryBlock>* blocks, size_t alignment);
+
+}  // namespace framework
+}  // namespace paddle
@@ -0,0 +1,88 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/framework/static_memory_plan.h"
+
+#include <random>
+
+#include "gtest/gtest.h"
+
+namespace paddle {
+namespace framework {
+
+static void CheckNoOverlap(const std::vector<MemoryBlock>& blocks,
+                           size_t arena_size) {
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    EXPECT_LE(blocks[i].offset + blocks[i].size, arena_size);
+    for (size_t j = i + 1; j < blocks.size(); ++j) {
+      bool alive = blocks[i].first_op <= blocks[j].last_op &&
+                   blocks[j].first_op <= blocks[i].last_op;
+      bool overlap = blocks[i].offset < blocks[j].offset + blocks[j].size &&
+                     blocks[j].offset < blocks[i].offset + blocks[i].size;
+      EXPECT_FALSE(alive && overlap) << "block " << i << " and " << j;
+    }
+  }
+}
+
+TEST(StaticMemoryPlan, ReuseDeadBlocks) {
+  // a -> b -> c -> d, every block dies after read by the next op
+  std::vector<MemoryBlock> blocks = {
+      {100, 0, 1}, {100, 1, 2}, {100, 2, 3}, {100, 3, 4}};
+  size_t arena_size = PlanMemoryOffsets(&blocks, 1);
+  EXPECT_EQ(arena_size, 200UL);
+  EXPECT_EQ(blocks[0].offset, blocks[2].offset);
+  EXPECT_EQ(blocks[1].offset, blocks[3].offset);
+  CheckNoOverlap(blocks, arena_size);
+}
+
+TEST(StaticMemoryPlan, FillGap) {
+  std::vector<MemoryBlock> blocks = {
+      {300, 0, 1}, {100, 0, 3}, {200, 2, 3}, {64, 2, 3}};
+  size_t arena_size = PlanMemoryOffsets(&blocks, 1);
+  // the last two blocks take the memory of the first one, dead by then
+  EXPECT_EQ(arena_size, 400UL);
+  EXPECT_EQ(blocks[2].offset, 0UL);
+  EXPECT_EQ(blocks[3].offset, 200UL);
+  CheckNoOverlap(blocks, arena_size);
+}
+
+TEST(StaticMemoryPlan, Alignment) {
+  std::vector<MemoryBlock> blocks = {{10, 0, 1}, {300, 0, 1}, {1, 0, 1}};
+  size_t arena_size = PlanMemoryOffsets(&blocks, 256);
+  EXPECT_EQ(arena_size, 1024UL);
+  for (auto& block : blocks) {
+    EXPECT_EQ(block.offset % 256, 0UL);
+  }
+  CheckNoOverlap(blocks, arena_size);
+}
+
+TEST(StaticMemoryPlan, Random) {
+  std::mt19937 rng(0);
+  for (int round = 0; round < 20; ++round) {
+    std::vector<MemoryBlock> blocks(100);
+    size_t total = 0;
+    for (auto& block : blocks) {
+      block.size = rng() % 4096 + 1;
+      block.first_op = rng() % 50;
+      block.last_op = block.first_op + rng() % 10;
+      total += (block.size + 63) / 64 * 64;
+    }
+    size_t arena_size = PlanMemoryOffsets(&blocks, 64);
+    EXPECT_LE(arena_size, total);
+    CheckNoOverlap(blocks, arena_size);
+  }
+}
+
+}  // namespace framework
+}  // namespace paddle
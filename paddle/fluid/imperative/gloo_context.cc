@@ -53,13 +53,14 @@ void GLOOParallelContext::InitWithRingID(int ring_id) {
       platform::errors::OutOfRange("Still not implement InitWithRingID"));
 }
 
-#define GLOO_CASE(type, T, gw)                                  \
-  case type: {                                                  \
-    std::vector<T> send_vector##T;                              \
-    framework::TensorToVector<T>(src_tensor, &send_vector##T);  \
-    auto recv_vector##T = gw->AllReduce<T>(send_vector##T);     \
-    framework::TensorFromVector<T>(recv_vector##T, dst_tensor); \
-    break;                                                      \
+#define GLOO_CASE(type, T, gw)                                              \
+  case type: {                                                              \
+    const auto *src_tensor_ptr = src_tensor.data<T>();                      \
+    auto *dst_tensor_ptr =                                                  \
+        dst_tensor->mutable_data<T>(src_tensor.place());                    \
+    gw->AllReduceVector<T>(const_cast<T *>(src_tensor_ptr), dst_tensor_ptr, \
+                           src_tensor.numel());                             \
+    break;                                                                  \
   }
 
 void GLOOParallelContext::AllReduceByStream(const framework::Variable &src,
@@ -108,7 +109,6 @@ void GLOOParallelContext::AllReduce(const framework::Tensor &src_tensor,
           platform::errors::InvalidArgument("Invalid datatype for allreduce"));
     }
   }
-  gloo_wrapper->Barrier();
 }
 
 #define GLOO_ALL_GATHER_CASE(type, T, gw)                         \
@@ -24,6 +24,10 @@
 
 #include "paddle/fluid/imperative/parallel_context.h"
 
+#ifdef PADDLE_WITH_GLOO
+DECLARE_bool(dygraph_gloo_async_allreduce);
+#endif
+
 namespace paddle {
 namespace imperative {
 
@@ -307,6 +311,15 @@ Reducer::Reducer(const std::vector<std::shared_ptr<imperative::VarBase>> &vars,
 #ifdef PADDLE_WITH_XPU_BKCL
   comm_pool_.reset(new ::ThreadPool(1));
   comm_op_count_ = 0;
+#endif
+#ifdef PADDLE_WITH_GLOO
+  // On CPU the allreduce of gloo blocks the calling thread, so it is moved to
+  // comm_pool_ to let the backward of the following groups go on meanwhile.
+  if (comm_pool_ == nullptr && FLAGS_dygraph_gloo_async_allreduce &&
+      !vars_.empty() && platform::is_cpu_place(vars_.front()->Place())) {
+    VLOG(3) << "Allreduce the gradient groups on a communication thread";
+    comm_pool_.reset(new ::ThreadPool(1));
+  }
 #endif
   // initialize groups
   InitializeGroups(group_indices);
@@ -791,26 +804,41 @@ void Reducer::MarkGroupReady(size_t group_index) {
     // so we expose WaitCompute() interface and call
     // it here.
     parallel_ctx_->WaitCompute(run_order);
-#ifdef PADDLE_WITH_XPU_BKCL
-    {
-      std::lock_guard<std::mutex> lock(mutex_);
-      comm_op_count_ += 1;  // lock
-    }
-    // TODO(liuyuhui): Add try catch to deal with exception later,
-    // otherwise the main thread will continue to run when an exception is
-    // thrown in comm_pool_.
-    auto next_group = next_group_;
-    comm_pool_->enqueue([this, run_order, next_group, &group] {
-      auto dev_id = BOOST_GET_CONST(platform::XPUPlace, place_).device;
-      platform::SetXPUDeviceId(dev_id);
-      FusedAllReduceSchedule(run_order, group, next_group);
+#if defined(PADDLE_WITH_XPU_BKCL) || defined(PADDLE_WITH_GLOO)
+    if (comm_pool_ != nullptr) {
       {
         std::lock_guard<std::mutex> lock(mutex_);
-        comm_op_count_ -= 1;  // lock
-        cv_.notify_all();
+        comm_op_count_ += 1;  // lock
       }
-    });
-#elif defined(PADDLE_WITH_RCCL) || defined(PADDLE_WITH_NCCL) || \
+      // The exception thrown in comm_pool_ is kept and rethrown by the main
+      // thread in FinalizeBackward.
+      auto next_group = next_group_;
+      comm_pool_->enqueue([this, run_order, next_group, &group] {
+        std::exception_ptr exception = nullptr;
+        try {
+#ifdef PADDLE_WITH_XPU_BKCL
+          if (platform::is_xpu_place(place_)) {
+            auto dev_id = BOOST_GET_CONST(platform::XPUPlace, place_).device;
+            platform::SetXPUDeviceId(dev_id);
+          }
+#endif
+          FusedAllReduceSchedule(run_order, group, next_group);
+        } catch (...) {
+          exception = std::current_exception();
+        }
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          if (exception != nullptr && comm_exception_ == nullptr) {
+            comm_exception_ = exception;
+          }
+          comm_op_count_ -= 1;  // lock
+          cv_.notify_all();
+        }
+      });
+      continue;
+    }
+#endif
+#if defined(PADDLE_WITH_RCCL) || defined(PADDLE_WITH_NCCL) || \
     defined(PADDLE_WITH_GLOO)
     FusedAllReduceSchedule(run_order, group, next_group_);
 #else
@@ -972,10 +1000,17 @@ bool Reducer::HasGrad(size_t var_index) {
 void Reducer::FinalizeBackward() {
   groups_need_finalize_ = false;
   grad_need_hooks_ = false;
-#ifdef PADDLE_WITH_XPU_BKCL
-  {
-    std::unique_lock<std::mutex> lock(mutex_);
-    cv_.wait(lock, [&] { return comm_op_count_ == 0; });
+#if defined(PADDLE_WITH_XPU_BKCL) || defined(PADDLE_WITH_GLOO)
+  if (comm_pool_ != nullptr) {
+    std::exception_ptr exception = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [&] { return comm_op_count_ == 0; });
+      std::swap(exception, comm_exception_);
+    }
+    if (exception != nullptr) {
+      std::rethrow_exception(exception);
+    }
   }
 #endif
 
@@ -151,6 +151,7 @@ AnalysisConfig::AnalysisConfig(const AnalysisConfig &other) {
   CP_MEMBER(opt_cache_dir_);
   CP_MEMBER(prog_file_);
   CP_MEMBER(params_file_);
+  CP_MEMBER(model_bundle_);
 
   CP_MEMBER(use_fc_padding_);
   // GPU related.
@@ -160,6 +161,7 @@ AnalysisConfig::AnalysisConfig(const AnalysisConfig &other) {
   CP_MEMBER(memory_pool_init_size_mb_);
 
   CP_MEMBER(enable_memory_optim_);
+  CP_MEMBER(enable_static_memory_plan_);
   // TensorRT related.
   CP_MEMBER(use_tensorrt_);
   CP_MEMBER(tensorrt_workspace_size_);
@@ -583,6 +585,7 @@ std::string AnalysisConfig::SerializeInfoCache() {
   ss << model_dir_;
   ss << prog_file_;
   ss << params_file_;
+  ss << model_bundle_;
 
   ss << use_gpu_;
   ss << use_fc_padding_;
@@ -605,6 +608,7 @@ std::string AnalysisConfig::SerializeInfoCache() {
   ss << trt_dla_core_;
 
   ss << enable_memory_optim_;
+  ss << enable_static_memory_plan_;
 
   ss << use_mkldnn_;
   ss << mkldnn_cache_capacity_;
@@ -681,6 +685,10 @@ bool AnalysisConfig::enable_memory_optim() const {
   return enable_memory_optim_;
 }
 
+void AnalysisConfig::EnableStaticMemoryPlan(bool x) {
+  enable_static_memory_plan_ = x;
+}
+
 void AnalysisConfig::SetModelBuffer(const char *prog_buffer,
                                     size_t prog_buffer_size,
                                     const char *param_buffer,
@@ -754,6 +762,9 @@ std::string AnalysisConfig::Summary() {
   if (model_from_memory_) {
     os.InsertRow({"model_from_memory", params_file_});
   }
+  if (!model_bundle_.empty()) {
+    os.InsertRow({"model_bundle", model_bundle_});
+  }
   os.InsetDivider();
 
   // cpu info
@@ -849,6 +860,8 @@ std::string AnalysisConfig::Summary() {
   os.InsertRow({"ir_optim", enable_ir_optim_ ? "true" : "false"});
   os.InsertRow({"ir_debug", ir_debug_ ? "true" : "false"});
   os.InsertRow({"memory_optim", enable_memory_optim_ ? "true" : "false"});
+  os.InsertRow({"static_memory_plan",
+                enable_static_memory_plan_ ? "true" : "false"});
   os.InsertRow({"enable_profile", with_profile_ ? "true" : "false"});
   os.InsertRow({"enable_log", with_glog_info_ ? "true" : "false"});
   os.InsertRow({"collect_shape_range_info",
@@ -31,14 +31,17 @@
 #include "paddle/fluid/framework/ir/pass.h"
 #include "paddle/fluid/framework/naive_executor.h"
 #include "paddle/fluid/framework/scope.h"
+#include "paddle/fluid/framework/tensor_util.h"
 #include "paddle/fluid/framework/var_type_traits.h"
 #include "paddle/fluid/framework/version.h"
 #include "paddle/fluid/inference/analysis/helper.h"
 #include "paddle/fluid/inference/analysis/passes/memory_optimize_pass.h"
+#include "paddle/fluid/inference/api/details/external_allocation.h"
 #include "paddle/fluid/inference/api/helper.h"
 #include "paddle/fluid/inference/api/paddle_inference_api.h"
 #include "paddle/fluid/inference/api/paddle_inference_pass.h"
 #include "paddle/fluid/inference/utils/io_utils.h"
+#include "paddle/fluid/inference/utils/model_bundle.h"
 #include "paddle/fluid/inference/utils/singleton.h"
 #include "paddle/fluid/memory/memcpy.h"
 #include "paddle/fluid/platform/cpu_helper.h"
@@ -206,7 +209,10 @@ bool AnalysisPredictor::PrepareScope(
 }
 bool AnalysisPredictor::PrepareProgram(
     const std::shared_ptr<framework::ProgramDesc> &program) {
-  if (!program) {
+  if (!program && !config_.model_bundle().empty()) {
+    // The program in the bundle is optimized already.
+    if (!LoadModelBundle()) return false;
+  } else if (!program) {
     if (!LoadProgramDesc()) return false;
     // If not cloned, the parameters should be loaded.
     // If config_.ir_optim() is True, parameters is loaded in
@@ -344,6 +350,7 @@ bool AnalysisPredictor::PrepareExecutor() {
 
   executor_->Prepare(sub_scope_, *inference_program_, 0,
                      config_.use_feed_fetch_ops_);
+  executor_->EnableMemoryPlan(config_.enable_static_memory_plan());
 
   PADDLE_ENFORCE_NOT_NULL(sub_scope_,
                           platform::errors::PreconditionNotMet(
@@ -863,6 +870,12 @@ void AnalysisPredictor::PrepareFeedFetch() {
       idx2fetches_[idx] = op->Input("X")[0];
     }
   }
+  // Without the fetch ops, the planner sees no op reading the outputs.
+  std::vector<std::string> fetch_names;
+  for (auto &item : idx2fetches_) {
+    fetch_names.push_back(item.second);
+  }
+  executor_->SetFetchTargets(fetch_names);
 }
 
 void AnalysisPredictor::CreateFeedFetchVar(framework::Scope *scope) {
@@ -987,8 +1000,43 @@ bool AnalysisPredictor::ZeroCopyRun() {
   }
 #endif
 
+  // The outputs sharing the memory of the caller, see
+  // Tensor::ShareExternalData.
+  std::vector<std::pair<std::string, std::shared_ptr<memory::Allocation>>>
+      external_outputs;
+  for (auto &item : idx2fetches_) {
+    auto *var = executor_->scope()->FindVar(item.second);
+    if (var == nullptr || !var->IsType<framework::LoDTensor>()) continue;
+    auto *tensor = var->GetMutable<framework::LoDTensor>();
+    if (dynamic_cast<details::ExternalAllocation *>(tensor->Holder().get())) {
+      external_outputs.emplace_back(item.second, tensor->Holder());
+    }
+  }
+
   executor_->Run();
 
+  for (auto &output : external_outputs) {
+    auto *tensor = executor_->scope()
+                       ->FindVar(output.first)
+                       ->GetMutable<framework::LoDTensor>();
+    auto &holder = output.second;
+    if (tensor->Holder() == holder) continue;
+    // The output was not written in place, copy it to the caller.
+    size_t size = tensor->numel() * framework::SizeOfType(tensor->type());
+    PADDLE_ENFORCE_LE(
+        size, holder->size(),
+        platform::errors::OutOfRange(
+            "The output [%s] needs %d bytes, but the memory shared with it "
+            "has only %d bytes.",
+            output.first, size, holder->size()));
+    framework::Tensor dst;
+    dst.ResetHolderWithType(holder, tensor->type());
+    dst.Resize(tensor->dims());
+    framework::TensorCopySync(*tensor, holder->place(), &dst);
+    tensor->clear();
+    tensor->ResetHolderWithType(holder, dst.type());
+  }
+
   if (config_.shape_range_info_collected()) {
     CollectShapeRangeInfo();
   }
@@ -1131,6 +1179,21 @@ bool AnalysisPredictor::LoadProgramDesc() {
   return true;
 }
 
+bool AnalysisPredictor::LoadModelBundle() {
+  auto bundle = inference::ModelBundle::Open(config_.model_bundle());
+  framework::proto::ProgramDesc proto;
+  PADDLE_ENFORCE_EQ(proto.ParseFromString(bundle->program()), true,
+                    platform::errors::InvalidArgument(
+                        "Failed to parse the program in the model bundle %s.",
+                        config_.model_bundle()));
+  inference_program_.reset(new framework::ProgramDesc(proto));
+  executor_->CreateVariables(*inference_program_, 0, true, sub_scope_);
+  bundle->LoadParameters(scope_.get(), place_);
+  VLOG(3) << "get " << bundle->params().size()
+          << " parameters from the model bundle " << config_.model_bundle();
+  return true;
+}
+
 bool AnalysisPredictor::LoadParameters() {
   PADDLE_ENFORCE_NOT_NULL(inference_program_.get(),
                           platform::errors::PreconditionNotMet(
@@ -1347,6 +1410,10 @@ void AnalysisPredictor::SaveOptimModel(const std::string &dir) {
   exe.Run(save_program, scope(), 0, true, true);
 }
 
+void AnalysisPredictor::SaveModelBundle(const std::string &path) {
+  inference::SaveModelBundle(path, program(), *scope());
+}
+
 template <>
 std::unique_ptr<PaddlePredictor> CreatePaddlePredictor<AnalysisConfig>(
     const AnalysisConfig &config) {
@@ -258,6 +258,14 @@ class AnalysisPredictor : public PaddlePredictor {
   ///
   void SaveOptimModel(const std::string &dir);
 
+  ///
+  /// \brief save the optimized program and the parameters in one model
+  /// bundle, to be loaded by AnalysisConfig::SetModelBundle
+  ///
+  /// \param[in] path path to save the model bundle
+  ///
+  void SaveModelBundle(const std::string &path);
+
  protected:
   ///
   /// \brief Prepare predictor's required programs, including loading model
@@ -293,6 +301,14 @@ class AnalysisPredictor : public PaddlePredictor {
   /// \return Whether the function executed successfully
   ///
   bool LoadProgramDesc();
+
+  ///
+  /// \brief Load the optimized program and the parameters from the model
+  /// bundle.
+  ///
+  /// \return Whether the function executed successfully
+  ///
+  bool LoadModelBundle();
   ///
   /// \brief Load model parameters.
   ///
@@ -15,6 +15,8 @@
 #include "paddle/fluid/inference/api/analysis_predictor.h"
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <functional>
+#include <numeric>
 #include <thread>  // NOLINT
 #include "paddle/fluid/framework/ir/pass.h"
 #include "paddle/fluid/framework/tensor.h"
@@ -159,6 +161,81 @@ TEST(AnalysisPredictor, ZeroCopy) {
   predictor->TryShrinkMemory();
 }
 
+TEST(AnalysisPredictor, StaticMemoryPlan) {
+  auto run = [](bool memory_plan, int batch) {
+    AnalysisConfig config;
+    config.SetModel(FLAGS_dirname);
+    config.SwitchUseFeedFetchOps(false);
+    config.EnableStaticMemoryPlan(memory_plan);
+    auto predictor = CreatePaddlePredictor<AnalysisConfig>(config);
+    std::vector<float> out_data;
+    // the third run of each shape runs with the plan
+    for (int run = 0; run < 3; ++run) {
+      for (auto& name : predictor->GetInputNames()) {
+        auto input = predictor->GetInputTensor(name);
+        input->Reshape({batch, 1});
+        auto* data = input->mutable_data<int64_t>(PaddlePlace::kCPU);
+        for (int i = 0; i < batch; i++) {
+          data[i] = i;
+        }
+      }
+      predictor->ZeroCopyRun();
+      auto out = predictor->GetOutputTensor("fc_1.tmp_2");
+      auto shape = out->shape();
+      out_data.resize(std::accumulate(shape.begin(), shape.end(), 1,
+                                      std::multiplies<int>()));
+      out->copy_to_cpu(out_data.data());
+    }
+    return out_data;
+  };
+  for (int batch : {4, 2}) {
+    auto expected = run(false, batch);
+    auto out_data = run(true, batch);
+    ASSERT_EQ(out_data.size(), expected.size());
+    for (size_t i = 0; i < out_data.size(); ++i) {
+      EXPECT_NEAR(out_data[i], expected[i], 1e-6);
+    }
+  }
+}
+
+TEST(AnalysisPredictor, ModelBundle) {
+  auto run = [](const AnalysisConfig& config) {
+    auto predictor = CreatePaddlePredictor<AnalysisConfig>(config);
+    for (auto& name : predictor->GetInputNames()) {
+      auto input = predictor->GetInputTensor(name);
+      input->Reshape({4, 1});
+      auto* data = input->mutable_data<int64_t>(PaddlePlace::kCPU);
+      for (int i = 0; i < 4; i++) {
+        data[i] = i;
+      }
+    }
+    predictor->ZeroCopyRun();
+    auto out = predictor->GetOutputTensor("fc_1.tmp_2");
+    auto shape = out->shape();
+    std::vector<float> out_data(std::accumulate(
+        shape.begin(), shape.end(), 1, std::multiplies<int>()));
+    out->copy_to_cpu(out_data.data());
+    return std::make_pair(std::move(predictor), out_data);
+  };
+
+  AnalysisConfig config;
+  config.SetModel(FLAGS_dirname);
+  config.SwitchUseFeedFetchOps(false);
+  auto expected = run(config);
+  static_cast<AnalysisPredictor*>(expected.first.get())
+      ->SaveModelBundle("./word2vec.pdbundle");
+
+  AnalysisConfig bundle_config;
+  bundle_config.SetModelBundle("./word2vec.pdbundle");
+  bundle_config.SwitchUseFeedFetchOps(false);
+  LOG(INFO) << bundle_config.Summary();
+  auto out = run(bundle_config);
+  ASSERT_EQ(out.second.size(), expected.second.size());
+  for (size_t i = 0; i < out.second.size(); ++i) {
+    EXPECT_NEAR(out.second[i], expected.second[i], 1e-6);
+  }
+}
+
 TEST(AnalysisPredictor, CollectShapeRangeInfo) {
   AnalysisConfig config;
   config.SetModel(FLAGS_dirname);
@@ -405,4 +482,52 @@ TEST(Predictor, Run) {
   predictor->TryShrinkMemory();
 }
 
+TEST(Predictor, ShareExternalData) {
+  Config config;
+  config.SetModel(FLAGS_dirname);
+  auto predictor = CreatePredictor(config);
+
+  std::vector<int> shape({4, 1});
+  std::vector<int64_t> words({1, 2, 3, 4});
+  for (auto& name : predictor->GetInputNames()) {
+    auto input = predictor->GetInputHandle(name);
+    input->Reshape(shape);
+    input->CopyFromCpu(words.data());
+  }
+  predictor->Run();
+  auto out = predictor->GetOutputHandle("fc_1.tmp_2");
+  auto out_shape = out->shape();
+  std::vector<float> expected(std::accumulate(
+      out_shape.begin(), out_shape.end(), 1, std::multiplies<int>()));
+  out->CopyToCpu(expected.data());
+
+  std::vector<float> out_data(expected.size(), -1);
+  for (auto& name : predictor->GetInputNames()) {
+    predictor->GetInputHandle(name)->ShareExternalData(words.data(), shape,
+                                                       PlaceType::kCPU);
+  }
+  out->ShareExternalData(out_data.data(), out_shape, PlaceType::kCPU);
+  predictor->Run();
+
+  PlaceType place;
+  int size = 0;
+  ASSERT_EQ(out->data<float>(&place, &size), out_data.data());
+  ASSERT_EQ(static_cast<size_t>(size), expected.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_NEAR(out_data[i], expected[i], 1e-6);
+  }
+
+  EXPECT_THROW(out->ShareExternalData(out_data.data(), {-1, 2},
+                                      PlaceType::kCPU),
+               paddle::platform::EnforceNotMet);
+  // the copy goes to the memory of the tensor, not to the shared one
+  std::vector<int64_t> other_words({4, 3, 2, 1});
+  for (auto& name : predictor->GetInputNames()) {
+    auto input = predictor->GetInputHandle(name);
+    input->Reshape(shape);
+    input->CopyFromCpu(other_words.data());
+  }
+  EXPECT_EQ(words, std::vector<int64_t>({1, 2, 3, 4}));
+}
+
 }  // namespace paddle_infer
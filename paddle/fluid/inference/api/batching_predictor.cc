@@ -0,0 +1,468 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstring>
+#include <deque>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "paddle/fluid/inference/api/paddle_inference_api.h"
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle_infer {
+namespace services {
+
+namespace {
+
+size_t ElementSize(DataType dtype) {
+  switch (dtype) {
+    case DataType::FLOAT32:
+      return sizeof(float);
+    case DataType::INT64:
+      return sizeof(int64_t);
+    case DataType::INT32:
+      return sizeof(int32_t);
+    case DataType::UINT8:
+      return sizeof(uint8_t);
+    case DataType::INT8:
+      return sizeof(int8_t);
+    default:
+      return 0;
+  }
+}
+
+void CopyFromCpu(Tensor* tensor, DataType dtype, const void* data) {
+  switch (dtype) {
+    case DataType::FLOAT32:
+      tensor->CopyFromCpu(static_cast<const float*>(data));
+      break;
+    case DataType::INT64:
+      tensor->CopyFromCpu(static_cast<const int64_t*>(data));
+      break;
+    case DataType::INT32:
+      tensor->CopyFromCpu(static_cast<const int32_t*>(data));
+      break;
+    case DataType::UINT8:
+      tensor->CopyFromCpu(static_cast<const uint8_t*>(data));
+      break;
+    case DataType::INT8:
+      tensor->CopyFromCpu(static_cast<const int8_t*>(data));
+      break;
+    default:
+      PADDLE_THROW(paddle::platform::errors::Unimplemented(
+          "The batching predictor does not support the data type of input "
+          "(%s).",
+          tensor->name()));
+  }
+}
+
+void CopyToCpu(const Tensor& tensor, DataType dtype, void* data) {
+  switch (dtype) {
+    case DataType::FLOAT32:
+      tensor.CopyToCpu(static_cast<float*>(data));
+      break;
+    case DataType::INT64:
+      tensor.CopyToCpu(static_cast<int64_t*>(data));
+      break;
+    case DataType::INT32:
+      tensor.CopyToCpu(static_cast<int32_t*>(data));
+      break;
+    case DataType::UINT8:
+      tensor.CopyToCpu(static_cast<uint8_t*>(data));
+      break;
+    case DataType::INT8:
+      tensor.CopyToCpu(static_cast<int8_t*>(data));
+      break;
+    default:
+      PADDLE_THROW(paddle::platform::errors::Unimplemented(
+          "The batching predictor does not support the data type of output "
+          "(%s).",
+          tensor.name()));
+  }
+}
+
+size_t Numel(const std::vector<int>& shape, size_t begin) {
+  size_t numel = 1;
+  for (size_t i = begin; i < shape.size(); ++i) {
+    numel *= shape[i];
+  }
+  return numel;
+}
+
+// The sequences of the first LoD level, or the rows without LoD.
+size_t NumSamples(const paddle::PaddleTensor& tensor) {
+  if (!tensor.lod.empty()) {
+    return tensor.lod[0].empty() ? 0 : tensor.lod[0].size() - 1;
+  }
+  return tensor.shape.empty() ? 0 : tensor.shape[0];
+}
+
+bool CheckInput(const paddle::PaddleTensor& tensor) {
+  if (tensor.shape.empty() || tensor.shape[0] < 0) {
+    LOG(ERROR) << "The input (" << tensor.name
+               << ") of the batching predictor should have a batch dim.";
+    return false;
+  }
+  size_t element_size = ElementSize(tensor.dtype);
+  if (element_size == 0) {
+    LOG(ERROR) << "The batching predictor does not support the data type of "
+                  "input ("
+               << tensor.name << ").";
+    return false;
+  }
+  if (tensor.data.length() < Numel(tensor.shape, 0) * element_size) {
+    LOG(ERROR) << "The data of input (" << tensor.name
+               << ") is smaller than its shape.";
+    return false;
+  }
+  for (const auto& level : tensor.lod) {
+    if (level.empty()) {
+      LOG(ERROR) << "The input (" << tensor.name << ") has an empty LoD level.";
+      return false;
+    }
+  }
+  if (!tensor.lod.empty() &&
+      tensor.lod.back().back() - tensor.lod.back().front() !=
+          static_cast<size_t>(tensor.shape[0])) {
+    LOG(ERROR) << "The LoD of input (" << tensor.name
+               << ") does not match its rows.";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+struct BatchingPredictor::Impl {
+  struct Request {
+    const std::vector<paddle::PaddleTensor>* inputs;
+    std::vector<paddle::PaddleTensor>* outputs;
+    size_t samples;
+    // false if the inputs do not agree on the samples
+    bool batchable;
+    std::chrono::steady_clock::time_point deadline;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool finished{false};
+    bool success{false};
+  };
+
+  Impl(const Config& config, size_t pool_size, size_t max_batch_size,
+       int batch_timeout_us)
+      : pool(config, pool_size),
+        max_batch_size(max_batch_size),
+        batch_timeout(batch_timeout_us) {
+    for (size_t i = 0; i < pool_size; ++i) {
+      workers.emplace_back(&Impl::Work, this, pool.Retrive(i));
+    }
+  }
+
+  ~Impl() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    cv.notify_all();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  bool Compatible(const Request& a, const Request& b) const {
+    if (!batching || !a.batchable || !b.batchable ||
+        a.inputs->size() != b.inputs->size()) {
+      return false;
+    }
+    for (size_t i = 0; i < a.inputs->size(); ++i) {
+      const auto& x = (*a.inputs)[i];
+      const auto& y = (*b.inputs)[i];
+      if (x.name != y.name || x.dtype != y.dtype ||
+          x.shape.size() != y.shape.size() || x.lod.size() != y.lod.size() ||
+          !std::equal(x.shape.begin() + 1, x.shape.end(),
+                      y.shape.begin() + 1)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // The samples the head of the queue would run with if taken now.
+  size_t CollectableSamples() const {
+    const Request& head = *queue.front();
+    if (!batching || !head.batchable) {
+      return max_batch_size;
+    }
+    size_t samples = head.samples;
+    for (size_t i = 1; i < queue.size() && samples < max_batch_size; ++i) {
+      if (Compatible(head, *queue[i]) &&
+          samples + queue[i]->samples <= max_batch_size) {
+        samples += queue[i]->samples;
+      }
+    }
+    return samples;
+  }
+
+  std::vector<Request*> TakeBatch() {
+    std::vector<Request*> batch{queue.front()};
+    queue.pop_front();
+    size_t samples = batch[0]->samples;
+    for (auto it = queue.begin();
+         it != queue.end() && samples < max_batch_size;) {
+      if (Compatible(*batch[0], **it) &&
+          samples + (*it)->samples <= max_batch_size) {
+        samples += (*it)->samples;
+        batch.push_back(*it);
+        it = queue.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    return batch;
+  }
+
+  void Work(Predictor* predictor) {
+    while (true) {
+      std::vector<Request*> batch;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+          if (queue.empty()) {
+            if (stop) {
+              return;
+            }
+            cv.wait(lock);
+            continue;
+          }
+          auto deadline = queue.front()->deadline;
+          if (stop || CollectableSamples() >= max_batch_size ||
+              std::chrono::steady_clock::now() >= deadline) {
+            break;
+          }
+          cv.wait_until(lock, deadline);
+        }
+        batch = TakeBatch();
+      }
+      Execute(predictor, batch);
+    }
+  }
+
+  static void Finish(Request* request, bool success) {
+    std::lock_guard<std::mutex> lock(request->mutex);
+    request->finished = true;
+    request->success = success;
+    // notified under the lock, the caller frees the request once woken
+    request->cv.notify_one();
+  }
+
+  void Execute(Predictor* predictor, const std::vector<Request*>& batch) {
+    if (batch.size() > 1) {
+      try {
+        if (RunBatch(predictor, batch)) {
+          for (auto* request : batch) {
+            Finish(request, true);
+          }
+          return;
+        }
+        if (batching.exchange(false)) {
+          LOG(WARNING) << "The outputs of the model can not be split by the "
+                          "requests, the batching is disabled.";
+        }
+      } catch (const std::exception& e) {
+        LOG(ERROR) << "Failed to run a batch of " << batch.size()
+                   << " requests, run them one by one. " << e.what();
+      }
+    }
+    // a single request always takes the whole outputs
+    for (auto* request : batch) {
+      bool success = false;
+      try {
+        success = RunBatch(predictor, {request});
+      } catch (const std::exception& e) {
+        LOG(ERROR) << e.what();
+      }
+      Finish(request, success);
+    }
+  }
+
+  // Returns false if the outputs can not be split by the requests.
+  bool RunBatch(Predictor* predictor, const std::vector<Request*>& batch) {
+    thread_local std::vector<char> buffer;
+    const auto& head = *batch.front()->inputs;
+    for (size_t i = 0; i < head.size(); ++i) {
+      std::vector<int> shape = head[i].shape;
+      shape[0] = 0;
+      std::vector<std::vector<size_t>> lod(head[i].lod.size(),
+                                           std::vector<size_t>(1, 0));
+      for (auto* request : batch) {
+        const auto& tensor = (*request->inputs)[i];
+        shape[0] += tensor.shape[0];
+        for (size_t l = 0; l < lod.size(); ++l) {
+          size_t base = lod[l].back();
+          for (size_t k = 1; k < tensor.lod[l].size(); ++k) {
+            lod[l].push_back(base + tensor.lod[l][k] - tensor.lod[l][0]);
+          }
+        }
+      }
+      const void* data = head[i].data.data();
+      if (batch.size() > 1) {
+        size_t row_bytes = Numel(shape, 1) * ElementSize(head[i].dtype);
+        buffer.resize(shape[0] * row_bytes);
+        char* dst = buffer.data();
+        for (auto* request : batch) {
+          const auto& tensor = (*request->inputs)[i];
+          memcpy(dst, tensor.data.data(), tensor.shape[0] * row_bytes);
+          dst += tensor.shape[0] * row_bytes;
+        }
+        data = buffer.data();
+      }
+      auto input = predictor->GetInputHandle(head[i].name);
+      input->Reshape(shape);
+      CopyFromCpu(input.get(), head[i].dtype, data);
+      if (!lod.empty()) {
+        input->SetLoD(lod);
+      }
+    }
+
+    PADDLE_ENFORCE_EQ(predictor->Run(), true,
+                      paddle::platform::errors::PreconditionNotMet(
+                          "Failed to run the predictor."));
+
+    size_t total = 0;
+    for (auto* request : batch) {
+      total += request->samples;
+      request->outputs->clear();
+    }
+    for (const auto& name : predictor->GetOutputNames()) {
+      auto output = predictor->GetOutputHandle(name);
+      std::vector<int> shape = output->shape();
+      auto lod = output->lod();
+      DataType dtype = output->type();
+      size_t element_size = ElementSize(dtype);
+      size_t rows = shape.empty() ? 1 : shape[0];
+      size_t row_bytes = Numel(shape, 1) * element_size;
+      buffer.resize(rows * row_bytes);
+      CopyToCpu(*output, dtype, buffer.data());
+      if (batch.size() > 1 &&
+          (lod.empty() ? shape.empty() || rows != total
+                       : lod[0].size() != total + 1)) {
+        return false;
+      }
+
+      size_t sample = 0;
+      for (auto* request : batch) {
+        paddle::PaddleTensor tensor;
+        tensor.name = name;
+        tensor.dtype = dtype;
+        tensor.shape = shape;
+        size_t begin = 0, end = rows;
+        if (batch.size() == 1) {
+          tensor.lod = lod;
+        } else if (!lod.empty()) {
+          // narrow the sequences of the request level by level to its rows
+          begin = sample;
+          end = sample + request->samples;
+          tensor.lod.resize(lod.size());
+          for (size_t l = 0; l < lod.size(); ++l) {
+            for (size_t k = begin; k <= end; ++k) {
+              tensor.lod[l].push_back(lod[l][k] - lod[l][begin]);
+            }
+            begin = lod[l][begin];
+            end = lod[l][end];
+          }
+        } else {
+          begin = sample;
+          end = sample + request->samples;
+        }
+        if (!shape.empty()) {
+          tensor.shape[0] = end - begin;
+        }
+        tensor.data.Resize((end - begin) * row_bytes);
+        memcpy(tensor.data.data(), buffer.data() + begin * row_bytes,
+               (end - begin) * row_bytes);
+        request->outputs->push_back(std::move(tensor));
+        sample += request->samples;
+      }
+    }
+    return true;
+  }
+
+  PredictorPool pool;
+  size_t max_batch_size;
+  std::chrono::microseconds batch_timeout;
+  std::atomic<bool> batching{true};
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<Request*> queue;
+  bool stop{false};
+  std::vector<std::thread> workers;
+};
+
+BatchingPredictor::BatchingPredictor(const Config& config, size_t pool_size,
+                                     size_t max_batch_size,
+                                     int batch_timeout_us) {
+  PADDLE_ENFORCE_GE(max_batch_size, 1UL,
+                    paddle::platform::errors::InvalidArgument(
+                        "The max batch size should be greater than 0, but "
+                        "it's (%d)",
+                        max_batch_size));
+  PADDLE_ENFORCE_GE(batch_timeout_us, 0,
+                    paddle::platform::errors::InvalidArgument(
+                        "The batch timeout should not be negative, but it's "
+                        "(%d)",
+                        batch_timeout_us));
+  impl_.reset(new Impl(config, pool_size, max_batch_size, batch_timeout_us));
+}
+
+BatchingPredictor::~BatchingPredictor() = default;
+
+bool BatchingPredictor::Run(const std::vector<paddle::PaddleTensor>& inputs,
+                            std::vector<paddle::PaddleTensor>* outputs) {
+  if (inputs.empty()) {
+    LOG(ERROR) << "The batching predictor got a request without inputs.";
+    return false;
+  }
+  Impl::Request request;
+  request.inputs = &inputs;
+  request.outputs = outputs;
+  request.samples = NumSamples(inputs[0]);
+  request.batchable = true;
+  for (const auto& tensor : inputs) {
+    if (!CheckInput(tensor)) {
+      return false;
+    }
+    request.batchable &= NumSamples(tensor) == request.samples;
+  }
+  request.deadline = std::chrono::steady_clock::now() + impl_->batch_timeout;
+  {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->queue.push_back(&request);
+  }
+  impl_->cv.notify_all();
+  std::unique_lock<std::mutex> lock(request.mutex);
+  request.cv.wait(lock, [&request] { return request.finished; });
+  return request.success;
+}
+
+}  // namespace services
+}  // namespace paddle_infer
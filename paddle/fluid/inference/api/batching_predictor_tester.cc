@@ -0,0 +1,255 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <fstream>
+#include <functional>
+#include <numeric>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+#include "paddle/fluid/framework/program_desc.h"
+#include "paddle/fluid/inference/analysis/helper.h"
+#include "paddle/fluid/inference/api/paddle_inference_api.h"
+
+DEFINE_string(dirname, "", "dirname to tests.");
+
+namespace paddle_infer {
+
+// The word2vec inputs of a request, every row is a sequence if with_lod.
+static std::vector<paddle::PaddleTensor> MakeInputs(int id, int rows,
+                                                    bool with_lod) {
+  std::vector<paddle::PaddleTensor> inputs;
+  std::vector<size_t> lod(rows + 1);
+  for (int i = 0; i <= rows; i++) {
+    lod[i] = i;
+  }
+  for (const char* name : {"firstw", "secondw", "thirdw", "forthw"}) {
+    paddle::PaddleTensor tensor;
+    tensor.name = name;
+    tensor.shape = {rows, 1};
+    tensor.dtype = DataType::INT64;
+    tensor.data.Resize(rows * sizeof(int64_t));
+    auto* data = static_cast<int64_t*>(tensor.data.data());
+    for (int i = 0; i < rows; i++) {
+      data[i] = (id * 31 + i * 7 + inputs.size()) % 1000;
+    }
+    if (with_lod) {
+      tensor.lod.push_back(lod);
+    }
+    inputs.push_back(std::move(tensor));
+  }
+  return inputs;
+}
+
+static std::vector<float> RunAlone(
+    Predictor* predictor, const std::vector<paddle::PaddleTensor>& inputs) {
+  for (const auto& tensor : inputs) {
+    auto input = predictor->GetInputHandle(tensor.name);
+    input->Reshape(tensor.shape);
+    input->CopyFromCpu(static_cast<const int64_t*>(tensor.data.data()));
+  }
+  predictor->Run();
+  auto output = predictor->GetOutputHandle("fc_1.tmp_2");
+  auto shape = output->shape();
+  std::vector<float> out(std::accumulate(shape.begin(), shape.end(), 1,
+                                         std::multiplies<int>()));
+  output->CopyToCpu(out.data());
+  return out;
+}
+
+TEST(BatchingPredictor, word2vec) {
+  Config config;
+  config.SetModel(FLAGS_dirname);
+  auto predictor = CreatePredictor(config);
+
+  const int num_threads = 8, num_requests = 20;
+  std::vector<std::vector<std::vector<float>>> expected(num_threads);
+  for (int t = 0; t < num_threads; t++) {
+    for (int r = 0; r < num_requests; r++) {
+      int id = t * num_requests + r;
+      expected[t].push_back(
+          RunAlone(predictor.get(), MakeInputs(id, 1 + id % 4, id % 2)));
+    }
+  }
+
+  services::BatchingPredictor batching(config, 2, 8, 2000);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t] {
+      for (int r = 0; r < num_requests; r++) {
+        int id = t * num_requests + r;
+        auto inputs = MakeInputs(id, 1 + id % 4, id % 2);
+        std::vector<paddle::PaddleTensor> outputs;
+        ASSERT_TRUE(batching.Run(inputs, &outputs));
+        ASSERT_EQ(outputs.size(), 1UL);
+        ASSERT_EQ(outputs[0].shape[0], 1 + id % 4);
+        const auto& out = expected[t][r];
+        ASSERT_EQ(outputs[0].data.length(), out.size() * sizeof(float));
+        auto* data = static_cast<const float*>(outputs[0].data.data());
+        for (size_t i = 0; i < out.size(); i++) {
+          EXPECT_NEAR(data[i], out[i], 1e-5);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+// Saves out = x * 2, where x has 2 LoD levels which out keeps.
+static std::string SaveLoDModel() {
+  paddle::framework::ProgramDesc program;
+  auto* block = program.MutableBlock(0);
+  using paddle::framework::proto::VarType;
+  block->Var("feed")->SetType(VarType::FEED_MINIBATCH);
+  block->Var("fetch")->SetType(VarType::FETCH_LIST);
+  for (auto name : {"x", "out"}) {
+    auto* var = block->Var(name);
+    var->SetType(VarType::LOD_TENSOR);
+    var->SetDataType(VarType::FP32);
+    var->SetShape({-1, 2});
+    var->SetLoDLevel(2);
+  }
+  auto* feed = block->AppendOp();
+  feed->SetType("feed");
+  feed->SetInput("X", {"feed"});
+  feed->SetOutput("Out", {"x"});
+  feed->SetAttr("col", 0);
+  auto* scale = block->AppendOp();
+  scale->SetType("scale");
+  scale->SetInput("X", {"x"});
+  scale->SetOutput("Out", {"out"});
+  scale->SetAttr("scale", 2.f);
+  scale->SetAttr("bias", 0.f);
+  scale->SetAttr("bias_after_scale", true);
+  auto* fetch = block->AppendOp();
+  fetch->SetType("fetch");
+  fetch->SetInput("X", {"out"});
+  fetch->SetOutput("Out", {"fetch"});
+  fetch->SetAttr("col", 0);
+
+  std::string dirname = "./batching_predictor_lod_model";
+  MKDIR(dirname.c_str());
+  std::ofstream fout(dirname + "/__model__", std::ios::binary);
+  fout << program.Proto()->SerializeAsString();
+  return dirname;
+}
+
+// A request of 1 to 3 sequences, of 1 or 2 sub-sequences of 1 to 3 rows each.
+static paddle::PaddleTensor MakeLoDInput(int id) {
+  std::vector<size_t> lod0{0}, lod1{0};
+  for (int i = 0; i < 1 + id % 3; i++) {
+    for (int j = 0; j < 1 + (id + i) % 2; j++) {
+      lod1.push_back(lod1.back() + 1 + (id + i + j) % 3);
+    }
+    lod0.push_back(lod1.size() - 1);
+  }
+  int rows = static_cast<int>(lod1.back());
+  paddle::PaddleTensor tensor;
+  tensor.name = "x";
+  tensor.shape = {rows, 2};
+  tensor.dtype = DataType::FLOAT32;
+  tensor.lod = {lod0, lod1};
+  tensor.data.Resize(rows * 2 * sizeof(float));
+  auto* data = static_cast<float*>(tensor.data.data());
+  for (int i = 0; i < rows * 2; i++) {
+    data[i] = id * 100 + i;
+  }
+  return tensor;
+}
+
+// The LoD output of a batch is split by the sequences of the requests.
+TEST(BatchingPredictor, lod_output) {
+  Config config;
+  config.SetModel(SaveLoDModel());
+
+  const int num_threads = 8, num_requests = 20;
+  // one predictor, so that the requests queue up behind the running batch
+  services::BatchingPredictor batching(config, 1, 8, 2000);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t] {
+      for (int r = 0; r < num_requests; r++) {
+        std::vector<paddle::PaddleTensor> inputs{
+            MakeLoDInput(t * num_requests + r)};
+        std::vector<paddle::PaddleTensor> outputs;
+        ASSERT_TRUE(batching.Run(inputs, &outputs));
+        ASSERT_EQ(outputs.size(), 1UL);
+        const auto& x = inputs[0];
+        const auto& out = outputs[0];
+        EXPECT_EQ(out.lod, x.lod);
+        ASSERT_EQ(out.shape, x.shape);
+        ASSERT_EQ(out.data.length(), x.data.length());
+        auto* x_data = static_cast<const float*>(x.data.data());
+        auto* out_data = static_cast<const float*>(out.data.data());
+        for (int i = 0; i < x.shape[0] * 2; i++) {
+          EXPECT_NEAR(out_data[i], x_data[i] * 2, 1e-5);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+// Not a pass / fail test, run it by --gtest_also_run_disabled_tests.
+TEST(BatchingPredictor, DISABLED_benchmark) {
+  Config config;
+  config.SetModel(FLAGS_dirname);
+  config.SetCpuMathLibraryNumThreads(1);
+  const int num_clients = 16, num_requests = 200;
+  for (size_t max_batch_size : {1, 8, 32}) {
+    services::BatchingPredictor batching(config, 2, max_batch_size, 500);
+    std::vector<std::vector<double>> latencies(num_clients);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_clients; t++) {
+      threads.emplace_back([&, t] {
+        for (int r = 0; r < num_requests; r++) {
+          auto inputs = MakeInputs(t * num_requests + r, 1, false);
+          std::vector<paddle::PaddleTensor> outputs;
+          auto begin = std::chrono::steady_clock::now();
+          batching.Run(inputs, &outputs);
+          latencies[t].push_back(std::chrono::duration<double, std::milli>(
+                                     std::chrono::steady_clock::now() - begin)
+                                     .count());
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    std::vector<double> all;
+    for (auto& latency : latencies) {
+      all.insert(all.end(), latency.begin(), latency.end());
+    }
+    std::sort(all.begin(), all.end());
+    LOG(INFO) << "max batch size " << max_batch_size << ": "
+              << all.size() / seconds << " requests/s, p50 "
+              << all[all.size() / 2] << " ms, p99 "
+              << all[all.size() * 99 / 100] << " ms";
+  }
+}
+
+}  // namespace paddle_infer
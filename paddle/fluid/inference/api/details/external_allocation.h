@@ -0,0 +1,31 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "paddle/fluid/memory/allocation/allocator.h"
+
+namespace paddle {
+namespace details {
+
+// The memory of the caller shared with a feed or fetch tensor by
+// Tensor::ShareExternalData. It is never freed by the predictor.
+class ExternalAllocation : public memory::Allocation {
+ public:
+  ExternalAllocation(void* ptr, size_t size, const platform::Place& place)
+      : memory::Allocation(ptr, size, place) {}
+};
+
+}  // namespace details
+}  // namespace paddle
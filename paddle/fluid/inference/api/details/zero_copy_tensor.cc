@@ -15,6 +15,7 @@
 #include "paddle/fluid/framework/data_layout_transform.h"
 #include "paddle/fluid/framework/lod_tensor.h"
 #include "paddle/fluid/framework/scope.h"
+#include "paddle/fluid/inference/api/details/external_allocation.h"
 #include "paddle/fluid/inference/api/paddle_inference_api.h"
 #include "paddle/fluid/inference/api/paddle_tensor.h"
 #include "paddle/fluid/memory/memcpy.h"
@@ -25,6 +26,15 @@ namespace paddle_infer {
 
 using float16 = paddle::platform::float16;
 
+// Stops sharing the memory of the caller, so that the tensor allocates its
+// own memory instead of writing the caller's.
+static void ReleaseExternalData(paddle::framework::LoDTensor *tensor) {
+  if (dynamic_cast<paddle::details::ExternalAllocation *>(
+          tensor->Holder().get())) {
+    tensor->clear();
+  }
+}
+
 void Tensor::Reshape(const std::vector<int> &shape) {
   PADDLE_ENFORCE_EQ(
       name_.empty(), false,
@@ -40,6 +50,7 @@ void Tensor::Reshape(const std::vector<int> &shape) {
       var, paddle::platform::errors::PreconditionNotMet(
                "No tensor called [%s] in the runtime scope", name_));
   auto *tensor = var->GetMutable<paddle::framework::LoDTensor>();
+  ReleaseExternalData(tensor);
   tensor->Resize(paddle::framework::make_ddim(shape));
 }
 
@@ -149,6 +160,7 @@ void Tensor::CopyFromCpu(const T *data) {
                         "You should call Tensor::Reshape(const "
                         "std::vector<int> &shape)"
                         "function before copying data from cpu."));
+  ReleaseExternalData(tensor);
   size_t ele_size = tensor->numel() * sizeof(T);
 
   if (place_ == PlaceType::kCPU) {
@@ -204,6 +216,59 @@ void Tensor::CopyFromCpu(const T *data) {
   }
 }
 
+template <typename T>
+void Tensor::ShareExternalData(T *data, const std::vector<int> &shape,
+                               PlaceType place) {
+  EAGER_GET_TENSOR(paddle::framework::LoDTensor);
+  PADDLE_ENFORCE_NOT_NULL(data,
+                          paddle::platform::errors::InvalidArgument(
+                              "The data shared with tensor [%s] should not be "
+                              "nullptr.",
+                              name_));
+  PADDLE_ENFORCE_EQ(
+      place, place_,
+      paddle::platform::errors::InvalidArgument(
+          "The data shared with tensor [%s] should be in the place of the "
+          "predictor.",
+          name_));
+  for (auto dim : shape) {
+    PADDLE_ENFORCE_GE(
+        dim, 0,
+        paddle::platform::errors::InvalidArgument(
+            "The shape of the data shared with tensor [%s] should not have "
+            "negative dims, but got %d.",
+            name_, dim));
+  }
+  paddle::platform::Place data_place;
+  switch (static_cast<int>(place)) {
+    case static_cast<int>(PlaceType::kCPU):
+      data_place = paddle::platform::CPUPlace();
+      break;
+    case static_cast<int>(PlaceType::kGPU):
+      data_place = paddle::platform::CUDAPlace(device_);
+      break;
+    case static_cast<int>(PlaceType::kXPU):
+      data_place = paddle::platform::XPUPlace(device_);
+      break;
+    case static_cast<int>(PlaceType::kNPU):
+      data_place = paddle::platform::NPUPlace(device_);
+      break;
+    default:
+      PADDLE_THROW(paddle::platform::errors::Unavailable(
+          "Only CPU / CUDA / XPU / NPU places is supported. The place `%d` is "
+          "not supported.",
+          static_cast<int>(place)));
+  }
+  auto dims = paddle::framework::make_ddim(shape);
+  auto holder = std::make_shared<paddle::details::ExternalAllocation>(
+      data, paddle::framework::product(dims) * sizeof(T),
+      data_place);
+  tensor->clear();
+  tensor->Resize(dims);
+  tensor->ResetHolderWithType(
+      holder, paddle::framework::DataTypeTrait<T>::DataType());
+}
+
 void Tensor::CopyStringsFromCpu(const paddle_infer::Strings *data) {
   EAGER_GET_TENSOR(paddle_infer::Strings);
   PADDLE_ENFORCE_GE(tensor->size(), 0,
@@ -324,6 +389,19 @@ template PD_INFER_DECL void Tensor::CopyFromCpu<uint8_t>(const uint8_t *data);
 template PD_INFER_DECL void Tensor::CopyFromCpu<int8_t>(const int8_t *data);
 template PD_INFER_DECL void Tensor::CopyFromCpu<float16>(const float16 *data);
 
+template PD_INFER_DECL void Tensor::ShareExternalData<float>(
+    float *data, const std::vector<int> &shape, PlaceType place);
+template PD_INFER_DECL void Tensor::ShareExternalData<int64_t>(
+    int64_t *data, const std::vector<int> &shape, PlaceType place);
+template PD_INFER_DECL void Tensor::ShareExternalData<int32_t>(
+    int32_t *data, const std::vector<int> &shape, PlaceType place);
+template PD_INFER_DECL void Tensor::ShareExternalData<uint8_t>(
+    uint8_t *data, const std::vector<int> &shape, PlaceType place);
+template PD_INFER_DECL void Tensor::ShareExternalData<int8_t>(
+    int8_t *data, const std::vector<int> &shape, PlaceType place);
+template PD_INFER_DECL void Tensor::ShareExternalData<float16>(
+    float16 *data, const std::vector<int> &shape, PlaceType place);
+
 template PD_INFER_DECL void Tensor::CopyToCpu<float>(float *data) const;
 template PD_INFER_DECL void Tensor::CopyToCpu<int64_t>(int64_t *data) const;
 template PD_INFER_DECL void Tensor::CopyToCpu<int32_t>(int32_t *data) const;
@@ -149,6 +149,14 @@ struct PD_INFER_DECL AnalysisConfig {
   /// \param x params file path.
   ///
   void SetParamsFile(const std::string& x) { params_file_ = x; }
+  ///
+  /// \brief Set the model bundle saved by AnalysisPredictor::SaveModelBundle.
+  /// The bundle holds the optimized program, so the analysis passes do not
+  /// run again, and its parameters are used in place from the mapped file.
+  ///
+  /// \param x model bundle file path.
+  ///
+  void SetModelBundle(const std::string& x) { model_bundle_ = x; }
 
   ///
   /// \brief Set the path of optimization cache directory.
@@ -176,6 +184,12 @@ struct PD_INFER_DECL AnalysisConfig {
   /// \return const std::string& The combined parameters file.
   ///
   const std::string& params_file() const { return params_file_; }
+  ///
+  /// \brief Get the model bundle file path.
+  ///
+  /// \return const std::string& The model bundle file path.
+  ///
+  const std::string& model_bundle() const { return model_bundle_; }
 
   // Padding related.
 
@@ -661,6 +675,22 @@ struct PD_INFER_DECL AnalysisConfig {
   /// \return bool Whether the memory optimization is activated.
   ///
   bool enable_memory_optim() const;
+  ///
+  /// \brief Turn on the static memory plan of the executor. The temporary
+  /// tensors are packed into one arena, planned in the first run of each
+  /// input shape, so that the later runs of that shape allocate no memory
+  /// for them.
+  ///
+  /// \param x Whether to enable the static memory plan.
+  ///
+  void EnableStaticMemoryPlan(bool x = true);
+  ///
+  /// \brief A boolean state telling whether the static memory plan is
+  /// activated.
+  ///
+  /// \return bool Whether the static memory plan is activated.
+  ///
+  bool enable_static_memory_plan() const { return enable_static_memory_plan_; }
 
   ///
   /// \brief Turn on profiling report.
@@ -733,6 +763,7 @@ struct PD_INFER_DECL AnalysisConfig {
   std::string model_dir_;
   mutable std::string prog_file_;
   mutable std::string params_file_;
+  std::string model_bundle_;
 
   // GPU related.
   bool use_gpu_{false};
@@ -791,6 +822,7 @@ struct PD_INFER_DECL AnalysisConfig {
 
   // memory reuse related.
   bool enable_memory_optim_{false};
+  bool enable_static_memory_plan_{false};
 
   bool use_mkldnn_{false};
   std::unordered_set<std::string> mkldnn_enabled_op_types_;
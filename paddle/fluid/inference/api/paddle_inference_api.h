@@ -198,6 +198,53 @@ class PD_INFER_DECL PredictorPool {
   std::shared_ptr<Predictor> main_pred_;
   std::vector<std::unique_ptr<Predictor>> preds_;
 };
+
+///
+/// \class BatchingPredictor
+///
+/// \brief BatchingPredictor serves requests from many threads with a
+/// PredictorPool, and merges the small requests into larger batches.
+///
+/// A request waits at most \param batch_timeout_us for others to join it. The
+/// requests with the same input names, data types, trailing dims and LoD
+/// levels are concatenated along the first dim, up to \param max_batch_size
+/// samples, and run once on an idle predictor of the pool. The outputs are
+/// split back by the samples of every request. A sample is a sequence of the
+/// first LoD level for the inputs with LoD, and a row of the first dim
+/// otherwise.
+///
+/// \code{cpp}
+///   services::BatchingPredictor predictor(config, 2, 32, 2000);
+///   // in every serving thread
+///   std::vector<paddle::PaddleTensor> inputs, outputs;
+///   predictor.Run(inputs, &outputs);
+/// \endcode
+///
+class PD_INFER_DECL BatchingPredictor {
+ public:
+  BatchingPredictor() = delete;
+  BatchingPredictor(const BatchingPredictor&) = delete;
+  BatchingPredictor& operator=(const BatchingPredictor&) = delete;
+
+  /// \brief Construct with \param pool_size predictors, each of them run by
+  /// one worker thread.
+  explicit BatchingPredictor(const Config& config, size_t pool_size = 1,
+                             size_t max_batch_size = 32,
+                             int batch_timeout_us = 1000);
+  ~BatchingPredictor();
+
+  /// \brief Run one request, blocks until its outputs are ready. Thread safe.
+  ///
+  /// \param inputs the CPU input tensors, matched to the model by name.
+  /// \param outputs the output tensors of this request.
+  /// \return Whether the run is successful.
+  bool Run(const std::vector<paddle::PaddleTensor>& inputs,
+           std::vector<paddle::PaddleTensor>* outputs);
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
 }  // namespace services
 
 }  // namespace paddle_infer
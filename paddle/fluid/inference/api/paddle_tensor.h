@@ -92,6 +92,21 @@ class PD_INFER_DECL Tensor {
   template <typename T>
   void CopyFromCpu(const T* data);
 
+  /// \brief Use the memory of the caller as the tensor data, without copying.
+  /// For an input, the model reads the data in place. For an output, the
+  /// predictor leaves the result in the memory after Run, so \param shape
+  /// should hold the largest output expected. The memory is still owned by
+  /// the caller and should outlive the runs until the tensor is shared with
+  /// another memory, or the predictor is destroyed. Reshape and CopyFromCpu
+  /// stop sharing it, and never write to it.
+  /// \param data The pointer of the data, in the place of the predictor. The
+  /// predictor may write to it, e.g. the result of an output.
+  /// \param shape The shape of the data, without negative dims.
+  /// \param place The place of the data.
+  template <typename T>
+  void ShareExternalData(T* data, const std::vector<int>& shape,
+                         PlaceType place);
+
   /// \brief Experimental interface.
   /// It's usually used to set the input tensor data with Strings data type.
   /// \param data The pointer of the data, from which the tensor will copy.
@@ -246,6 +246,76 @@ PADDLE_CAPI_EXPORT extern void PD_TensorCopyToCpuUint8(
 PADDLE_CAPI_EXPORT extern void PD_TensorCopyToCpuInt8(
     __pd_keep PD_Tensor* pd_tensor, int8_t* data);
 ///
+/// \brief Use the memory of the caller as the tensor data, without copying.
+/// The memory is still owned by the caller, and should outlive the runs until
+/// the tensor is shared with another memory or the predictor is destroyed.
+/// For an output tensor, the result is left in the memory after the run.
+/// \param[in] pd_tensor tensor.
+/// \param[in] data The pointer of the data, in the place of the predictor.
+/// \param[in] shape_size The size of shape.
+/// \param[in] shape The shape of the data.
+/// \param[in] place The place of the data.
+///
+PADDLE_CAPI_EXPORT extern void PD_TensorShareExternalDataFloat(
+    __pd_keep PD_Tensor* pd_tensor, float* data, size_t shape_size,
+    int32_t* shape, PD_PlaceType place);
+///
+/// \brief Use the memory of the caller as the tensor data, without copying.
+/// The memory is still owned by the caller, and should outlive the runs until
+/// the tensor is shared with another memory or the predictor is destroyed.
+/// For an output tensor, the result is left in the memory after the run.
+/// \param[in] pd_tensor tensor.
+/// \param[in] data The pointer of the data, in the place of the predictor.
+/// \param[in] shape_size The size of shape.
+/// \param[in] shape The shape of the data.
+/// \param[in] place The place of the data.
+///
+PADDLE_CAPI_EXPORT extern void PD_TensorShareExternalDataInt64(
+    __pd_keep PD_Tensor* pd_tensor, int64_t* data, size_t shape_size,
+    int32_t* shape, PD_PlaceType place);
+///
+/// \brief Use the memory of the caller as the tensor data, without copying.
+/// The memory is still owned by the caller, and should outlive the runs until
+/// the tensor is shared with another memory or the predictor is destroyed.
+/// For an output tensor, the result is left in the memory after the run.
+/// \param[in] pd_tensor tensor.
+/// \param[in] data The pointer of the data, in the place of the predictor.
+/// \param[in] shape_size The size of shape.
+/// \param[in] shape The shape of the data.
+/// \param[in] place The place of the data.
+///
+PADDLE_CAPI_EXPORT extern void PD_TensorShareExternalDataInt32(
+    __pd_keep PD_Tensor* pd_tensor, int32_t* data, size_t shape_size,
+    int32_t* shape, PD_PlaceType place);
+///
+/// \brief Use the memory of the caller as the tensor data, without copying.
+/// The memory is still owned by the caller, and should outlive the runs until
+/// the tensor is shared with another memory or the predictor is destroyed.
+/// For an output tensor, the result is left in the memory after the run.
+/// \param[in] pd_tensor tensor.
+/// \param[in] data The pointer of the data, in the place of the predictor.
+/// \param[in] shape_size The size of shape.
+/// \param[in] shape The shape of the data.
+/// \param[in] place The place of the data.
+///
+PADDLE_CAPI_EXPORT extern void PD_TensorShareExternalDataUint8(
+    __pd_keep PD_Tensor* pd_tensor, uint8_t* data, size_t shape_size,
+    int32_t* shape, PD_PlaceType place);
+///
+/// \brief Use the memory of the caller as the tensor data, without copying.
+/// The memory is still owned by the caller, and should outlive the runs until
+/// the tensor is shared with another memory or the predictor is destroyed.
+/// For an output tensor, the result is left in the memory after the run.
+/// \param[in] pd_tensor tensor.
+/// \param[in] data The pointer of the data, in the place of the predictor.
+/// \param[in] shape_size The size of shape.
+/// \param[in] shape The shape of the data.
+/// \param[in] place The place of the data.
+///
+PADDLE_CAPI_EXPORT extern void PD_TensorShareExternalDataInt8(
+    __pd_keep PD_Tensor* pd_tensor, int8_t* data, size_t shape_size,
+    int32_t* shape, PD_PlaceType place);
+///
 /// \brief Get the tensor shape
 /// \param[in] pd_tensor tensor.
 /// \return The tensor shape.
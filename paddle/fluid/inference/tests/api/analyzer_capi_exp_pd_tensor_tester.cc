@@ -175,6 +175,57 @@ std::string read_file(std::string filename) {
                      std::istreambuf_iterator<char>());
 }
 
+TEST(PD_Tensor, share_external_data) {
+  auto model_dir = FLAGS_infer_model;
+  PD_Config* config = PD_ConfigCreate();
+  PD_ConfigSetModel(config, (model_dir + "/__model__").c_str(),
+                    (model_dir + "/__params__").c_str());
+  PD_Predictor* predictor = PD_PredictorCreate(config);
+  PD_OneDimArrayCstr* input_names = PD_PredictorGetInputNames(predictor);
+  PD_OneDimArrayCstr* output_names = PD_PredictorGetOutputNames(predictor);
+  PD_Tensor* input =
+      PD_PredictorGetInputHandle(predictor, input_names->data[0]);
+  PD_Tensor* output =
+      PD_PredictorGetOutputHandle(predictor, output_names->data[0]);
+
+  int32_t shapes[4] = {1, 3, 300, 300};
+  std::vector<float> input_data(1 * 3 * 300 * 300);
+  for (size_t i = 0; i < input_data.size(); ++i) {
+    input_data[i] = (i % 255) / 255.f;
+  }
+  PD_TensorReshape(input, 4, shapes);
+  PD_TensorCopyFromCpuFloat(input, input_data.data());
+  PD_PredictorRun(predictor);
+  PD_OneDimArrayInt32* output_shape = PD_TensorGetShape(output);
+  int32_t out_num = std::accumulate(output_shape->data,
+                                    output_shape->data + output_shape->size, 1,
+                                    std::multiplies<int32_t>());
+  std::vector<float> expected(out_num);
+  PD_TensorCopyToCpuFloat(output, expected.data());
+
+  std::vector<float> out_data(out_num, -1);
+  PD_TensorShareExternalDataFloat(input, input_data.data(), 4, shapes,
+                                  PD_PLACE_CPU);
+  PD_TensorShareExternalDataFloat(output, out_data.data(), output_shape->size,
+                                  output_shape->data, PD_PLACE_CPU);
+  int32_t size;
+  PD_PlaceType place;
+  EXPECT_EQ(PD_TensorDataFloat(input, &place, &size), input_data.data());
+  PD_PredictorRun(predictor);
+  EXPECT_EQ(PD_TensorDataFloat(output, &place, &size), out_data.data());
+  EXPECT_EQ(size, out_num);
+  for (int32_t i = 0; i < out_num; ++i) {
+    EXPECT_NEAR(out_data[i], expected[i], 1e-5);
+  }
+
+  PD_OneDimArrayInt32Destroy(output_shape);
+  PD_TensorDestroy(output);
+  PD_TensorDestroy(input);
+  PD_OneDimArrayCstrDestroy(output_names);
+  PD_OneDimArrayCstrDestroy(input_names);
+  PD_PredictorDestroy(predictor);
+}
+
 TEST(PD_Tensor, from_buffer) {
   PD_Config* config = PD_ConfigCreate();
   std::string prog_file = FLAGS_infer_model + "/__model__";
@@ -0,0 +1,358 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/inference/utils/model_bundle.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#include "paddle/fluid/framework/tensor_util.h"
+#include "paddle/fluid/memory/allocation/allocator.h"
+
+namespace paddle {
+namespace inference {
+
+// "PDBUNDLE" read as a little endian integer.
+constexpr uint64_t kModelBundleMagic = 0x454C444E55424450ULL;
+// The data of the parameters are aligned to the largest common page size.
+constexpr uint64_t kModelBundleAlignment = 64 * 1024;
+
+// =========================================================
+//       Item        |        Type       |      Bytes
+// ---------------------------------------------------------
+//       Magic       |      uint64_t     |        8
+//      Version      |      uint32_t     |        4
+// ---------------------------------------------------------
+// Bytes of `Program`|      uint64_t     |        8
+//      Program      |        char       | Bytes of `Program`
+// ---------------------------------------------------------
+//   Number of Params|      uint64_t     |        8
+//    Param[0] Meta  |         -         |        -
+//        ...        |         ...       |       ...
+// ---------------------------------------------------------
+//      Padding      |        char       |   to alignment
+//    Param[0] Data  |        Dtype      | Bytes of `Data`
+//      Padding      |        char       |   to alignment
+//        ...        |         ...       |       ...
+// =========================================================
+// The meta of a param is
+// =========================================================
+//   Bytes of `Name` |      uint64_t     |        8
+//        Name       |        char       |  Bytes of `Name`
+//       Dtype       |       int32_t     |        4
+//   Dims of `Shape` |      uint64_t     |        8
+//       Shape       |       int64_t     |    Dims * 8
+//      LoD Level    |      uint64_t     |        8
+//  Size of `LoD[0]` |      uint64_t     |        8
+//       LoD[0]      |      uint64_t     | Size of `LoD[0]` * 8
+//        ...        |         ...       |       ...
+//  Offset of `Data` |      uint64_t     |        8
+//   Bytes of `Data` |      uint64_t     |        8
+// =========================================================
+
+template <typename T>
+static void WritePod(std::ostream* os, const T& value) {
+  os->write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void WriteParamMeta(std::ostream* os, const ModelBundleParam& param) {
+  WritePod(os, static_cast<uint64_t>(param.name.size()));
+  os->write(param.name.data(), param.name.size());
+  WritePod(os, static_cast<int32_t>(param.dtype));
+  WritePod(os, static_cast<uint64_t>(param.dims.size()));
+  for (int64_t dim : param.dims) {
+    WritePod(os, dim);
+  }
+  WritePod(os, static_cast<uint64_t>(param.lod.size()));
+  for (auto& level : param.lod) {
+    WritePod(os, static_cast<uint64_t>(level.size()));
+    for (size_t offset : level) {
+      WritePod(os, static_cast<uint64_t>(offset));
+    }
+  }
+  WritePod(os, param.offset);
+  WritePod(os, param.size);
+}
+
+static uint64_t AlignUp(uint64_t size) {
+  return (size + kModelBundleAlignment - 1) / kModelBundleAlignment *
+         kModelBundleAlignment;
+}
+
+void SaveModelBundle(const std::string& path,
+                     const framework::ProgramDesc& program,
+                     const framework::Scope& scope) {
+  std::vector<std::string> names;
+  for (auto* var : program.Block(0).AllVars()) {
+    if (var->Persistable() &&
+        var->GetType() == framework::proto::VarType::LOD_TENSOR) {
+      names.push_back(var->Name());
+    }
+  }
+  std::sort(names.begin(), names.end());
+
+  std::vector<ModelBundleParam> params;
+  std::vector<framework::LoDTensor> tensors;
+  for (auto& name : names) {
+    auto* var = scope.FindVar(name);
+    PADDLE_ENFORCE_NOT_NULL(
+        var, platform::errors::NotFound("The parameter %s is not in scope.",
+                                        name));
+    auto& tensor = var->Get<framework::LoDTensor>();
+    if (!tensor.IsInitialized()) {
+      VLOG(3) << "Skip the parameter " << name << " not initialized.";
+      continue;
+    }
+    framework::LoDTensor cpu_tensor;
+    if (platform::is_cpu_place(tensor.place())) {
+      cpu_tensor.ShareDataWith(tensor);
+    } else {
+      framework::TensorCopySync(tensor, platform::CPUPlace(), &cpu_tensor);
+    }
+    cpu_tensor.set_lod(tensor.lod());
+    uint64_t size = tensor.numel() * framework::SizeOfType(tensor.type());
+    params.push_back({name, tensor.type(), framework::vectorize(tensor.dims()),
+                      tensor.lod(), 0, size});
+    tensors.push_back(std::move(cpu_tensor));
+  }
+
+  std::string program_str = program.Proto()->SerializeAsString();
+  std::ostringstream meta;
+  WritePod(&meta, kModelBundleMagic);
+  WritePod(&meta, kCurModelBundleVersion);
+  WritePod(&meta, static_cast<uint64_t>(program_str.size()));
+  meta.write(program_str.data(), program_str.size());
+  WritePod(&meta, static_cast<uint64_t>(params.size()));
+  // the meta has the same size whatever the offsets are
+  std::ostringstream params_meta;
+  for (auto& param : params) {
+    WriteParamMeta(&params_meta, param);
+  }
+  uint64_t offset = AlignUp(meta.str().size() + params_meta.str().size());
+  for (auto& param : params) {
+    param.offset = offset;
+    offset = AlignUp(offset + param.size);
+  }
+  for (auto& param : params) {
+    WriteParamMeta(&meta, param);
+  }
+
+  std::ofstream fout(path, std::ios::out | std::ios::binary);
+  PADDLE_ENFORCE_EQ(
+      static_cast<bool>(fout.is_open()), true,
+      platform::errors::Unavailable("Cannot open %s to save the bundle.", path));
+  std::string header = meta.str();
+  fout.write(header.data(), header.size());
+  uint64_t written = header.size();
+  std::string padding;
+  for (size_t i = 0; i < params.size(); ++i) {
+    padding.assign(params[i].offset - written, '\0');
+    fout.write(padding.data(), padding.size());
+    fout.write(static_cast<const char*>(tensors[i].data<void>()),
+               params[i].size);
+    written = params[i].offset + params[i].size;
+  }
+  // the last page is complete, so that every param is mapped whole
+  padding.assign(AlignUp(written) - written, '\0');
+  fout.write(padding.data(), padding.size());
+  fout.close();
+  PADDLE_ENFORCE_EQ(
+      static_cast<bool>(fout), true,
+      platform::errors::Unavailable("Failed to write the bundle %s.", path));
+  VLOG(3) << "Saved " << params.size() << " parameters in the bundle " << path;
+}
+
+namespace {
+
+// Reads the meta of a bundle with the bounds checked.
+class BundleReader {
+ public:
+  BundleReader(const char* data, size_t size, const std::string& path)
+      : data_(data), size_(size), path_(path) {}
+
+  template <typename T>
+  T Read() {
+    T value;
+    Read(&value, sizeof(value));
+    return value;
+  }
+
+  void Read(void* dst, size_t n) {
+    CheckRemaining(n);
+    std::memcpy(dst, data_ + pos_, n);
+    pos_ += n;
+  }
+
+  std::string ReadString() {
+    uint64_t n = Read<uint64_t>();
+    CheckRemaining(n);
+    std::string str(data_ + pos_, n);
+    pos_ += n;
+    return str;
+  }
+
+  // The number of the items of elem_size bytes following.
+  uint64_t ReadCount(size_t elem_size) {
+    uint64_t n = Read<uint64_t>();
+    CheckRemaining(n, elem_size);
+    return n;
+  }
+
+ private:
+  void CheckRemaining(uint64_t n, size_t elem_size = 1) const {
+    PADDLE_ENFORCE_LE(
+        n, (size_ - pos_) / elem_size,
+        platform::errors::InvalidArgument(
+            "The model bundle %s is truncated, at byte %d.", path_, pos_));
+  }
+
+  const char* data_;
+  size_t size_;
+  size_t pos_{0};
+  const std::string& path_;
+};
+
+// The data of a parameter in the mapped bundle, keeps the bundle mapped.
+class BundleAllocation : public memory::Allocation {
+ public:
+  BundleAllocation(void* ptr, size_t size,
+                   std::shared_ptr<const ModelBundle> bundle)
+      : memory::Allocation(ptr, size, platform::CPUPlace()),
+        bundle_(std::move(bundle)) {}
+
+ private:
+  std::shared_ptr<const ModelBundle> bundle_;
+};
+
+}  // namespace
+
+std::shared_ptr<ModelBundle> ModelBundle::Open(const std::string& path) {
+#ifdef _WIN32
+  PADDLE_THROW(platform::errors::Unimplemented(
+      "The model bundle is not supported on Windows."));
+#else
+  std::shared_ptr<ModelBundle> bundle(new ModelBundle);
+  bundle->path_ = path;
+  int fd = open(path.c_str(), O_RDONLY);
+  PADDLE_ENFORCE_NE(fd, -1, platform::errors::NotFound(
+                                "Cannot open the model bundle %s.", path));
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    PADDLE_THROW(platform::errors::InvalidArgument(
+        "The model bundle %s is empty or cannot be read.", path));
+  }
+  bundle->size_ = st.st_size;
+  // private, so that an op writing a parameter changes only its own copy
+  void* data = mmap(nullptr, bundle->size_, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE, fd, 0);
+  close(fd);
+  PADDLE_ENFORCE_NE(data, MAP_FAILED,
+                    platform::errors::ResourceExhausted(
+                        "Failed to map the model bundle %s.", path));
+  bundle->data_ = data;
+
+  BundleReader reader(static_cast<const char*>(data), bundle->size_, path);
+  PADDLE_ENFORCE_EQ(reader.Read<uint64_t>(), kModelBundleMagic,
+                    platform::errors::InvalidArgument(
+                        "The file %s is not a model bundle.", path));
+  uint32_t version = reader.Read<uint32_t>();
+  PADDLE_ENFORCE_EQ(version, kCurModelBundleVersion,
+                    platform::errors::InvalidArgument(
+                        "The version of the model bundle %s is %d, only "
+                        "version %d is supported.",
+                        path, version, kCurModelBundleVersion));
+  bundle->program_ = reader.ReadString();
+  uint64_t num_params = reader.Read<uint64_t>();
+  for (uint64_t i = 0; i < num_params; ++i) {
+    ModelBundleParam param;
+    param.name = reader.ReadString();
+    param.dtype =
+        static_cast<framework::proto::VarType::Type>(reader.Read<int32_t>());
+    param.dims.resize(reader.ReadCount(sizeof(int64_t)));
+    for (auto& dim : param.dims) {
+      dim = reader.Read<int64_t>();
+    }
+    param.lod.resize(reader.ReadCount(sizeof(uint64_t)));
+    for (auto& level : param.lod) {
+      level.resize(reader.ReadCount(sizeof(uint64_t)));
+      for (auto& offset : level) {
+        offset = reader.Read<uint64_t>();
+      }
+    }
+    param.offset = reader.Read<uint64_t>();
+    param.size = reader.Read<uint64_t>();
+    PADDLE_ENFORCE_LE(
+        param.offset + param.size, bundle->size_,
+        platform::errors::InvalidArgument(
+            "The data of the parameter %s is out of the model bundle %s.",
+            param.name, path));
+    bundle->params_.push_back(std::move(param));
+  }
+  VLOG(3) << "Mapped the model bundle " << path << " of "
+          << bundle->params_.size() << " parameters, " << bundle->size_
+          << " bytes";
+  return bundle;
+#endif
+}
+
+ModelBundle::~ModelBundle() {
+#ifndef _WIN32
+  if (data_ != nullptr && munmap(data_, size_) != 0) {
+    LOG(WARNING) << "Failed to unmap the model bundle " << path_;
+  }
+#endif
+}
+
+void ModelBundle::LoadParameters(framework::Scope* scope,
+                                 const platform::Place& place) {
+  for (auto& param : params_) {
+    auto* tensor = scope->Var(param.name)->GetMutable<framework::LoDTensor>();
+    framework::LoDTensor mapped;
+    mapped.Resize(framework::make_ddim(param.dims));
+    PADDLE_ENFORCE_EQ(
+        static_cast<uint64_t>(mapped.numel() *
+                              framework::SizeOfType(param.dtype)),
+        param.size,
+        platform::errors::InvalidArgument(
+            "The size of the parameter %s in the model bundle %s does not "
+            "match its shape.",
+            param.name, path_));
+    mapped.ResetHolderWithType(
+        std::make_shared<BundleAllocation>(
+            static_cast<char*>(data_) + param.offset, param.size,
+            shared_from_this()),
+        param.dtype);
+    mapped.set_lod(param.lod);
+    if (platform::is_cpu_place(place)) {
+      *tensor = mapped;
+    } else {
+      framework::TensorCopySync(mapped, place, tensor);
+      tensor->set_lod(param.lod);
+    }
+  }
+}
+
+}  // namespace inference
+}  // namespace paddle
@@ -0,0 +1,76 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "paddle/fluid/framework/lod_tensor.h"
+#include "paddle/fluid/framework/program_desc.h"
+#include "paddle/fluid/framework/scope.h"
+#include "paddle/fluid/platform/place.h"
+
+namespace paddle {
+namespace inference {
+
+constexpr uint32_t kCurModelBundleVersion = 0;
+
+// A parameter in the bundle, its data is at offset of the file.
+struct ModelBundleParam {
+  std::string name;
+  framework::proto::VarType::Type dtype;
+  std::vector<int64_t> dims;
+  framework::LoD lod;
+  uint64_t offset;
+  uint64_t size;
+};
+
+// Saves the program and the parameters of its persistable LoDTensors, found
+// in scope, in one file. The data of every parameter starts at a page, so
+// that it can be used in place from the mapped file.
+void SaveModelBundle(const std::string& path,
+                     const framework::ProgramDesc& program,
+                     const framework::Scope& scope);
+
+// A bundle mapped copy-on-write. The pages of the parameters are shared by
+// all the processes mapping the same file, until one of them writes a page
+// and gets its own copy.
+class ModelBundle : public std::enable_shared_from_this<ModelBundle> {
+ public:
+  static std::shared_ptr<ModelBundle> Open(const std::string& path);
+
+  ~ModelBundle();
+
+  const std::string& program() const { return program_; }
+  const std::vector<ModelBundleParam>& params() const { return params_; }
+
+  // Creates the parameters in scope. On CPU they share the memory of the
+  // mapped file, which lives as long as any of them, on the other places
+  // they are copied from it.
+  void LoadParameters(framework::Scope* scope, const platform::Place& place);
+
+ private:
+  ModelBundle() = default;
+
+  std::string path_;
+  void* data_{nullptr};
+  size_t size_{0};
+  std::string program_;
+  std::vector<ModelBundleParam> params_;
+};
+
+}  // namespace inference
+}  // namespace paddle
@@ -0,0 +1,99 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/inference/utils/model_bundle.h"
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+#include <fstream>
+
+namespace paddle {
+namespace inference {
+namespace {
+
+void AddParam(framework::ProgramDesc* program, framework::Scope* scope,
+              const std::string& name, const std::vector<int64_t>& dims,
+              float start) {
+  auto* var = program->MutableBlock(0)->Var(name);
+  var->SetType(framework::proto::VarType::LOD_TENSOR);
+  var->SetPersistable(true);
+  auto* tensor = scope->Var(name)->GetMutable<framework::LoDTensor>();
+  tensor->Resize(framework::make_ddim(dims));
+  auto* data = tensor->mutable_data<float>(platform::CPUPlace());
+  for (int64_t i = 0; i < tensor->numel(); ++i) {
+    data[i] = start + i;
+  }
+}
+
+}  // namespace
+
+TEST(ModelBundle, save_and_open) {
+  framework::ProgramDesc program;
+  framework::Scope scope;
+  AddParam(&program, &scope, "fc_w", {16, 8}, 0);
+  AddParam(&program, &scope, "fc_b", {8}, 100);
+  // the temporary variables are not saved
+  program.MutableBlock(0)->Var("fc_out")->SetType(
+      framework::proto::VarType::LOD_TENSOR);
+  auto* op = program.MutableBlock(0)->AppendOp();
+  op->SetType("fc");
+  op->SetOutput("Out", {"fc_out"});
+
+  std::string path = "./model_bundle_test.pdbundle";
+  SaveModelBundle(path, program, scope);
+
+  framework::Scope load_scope;
+  {
+    auto bundle = ModelBundle::Open(path);
+    framework::proto::ProgramDesc proto;
+    ASSERT_TRUE(proto.ParseFromString(bundle->program()));
+    framework::ProgramDesc loaded(proto);
+    ASSERT_EQ(loaded.Block(0).OpSize(), 1UL);
+    EXPECT_EQ(loaded.Block(0).Op(0)->Type(), "fc");
+    ASSERT_EQ(bundle->params().size(), 2UL);
+    EXPECT_EQ(bundle->params()[0].name, "fc_b");
+    EXPECT_EQ(bundle->params()[1].name, "fc_w");
+    bundle->LoadParameters(&load_scope, platform::CPUPlace());
+  }
+  // the parameters keep the bundle mapped
+  for (auto name : {"fc_w", "fc_b"}) {
+    auto& expected = scope.FindVar(name)->Get<framework::LoDTensor>();
+    auto& tensor = load_scope.FindVar(name)->Get<framework::LoDTensor>();
+    ASSERT_EQ(tensor.dims(), expected.dims());
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(tensor.data<float>()) % 4096, 0UL);
+    for (int64_t i = 0; i < tensor.numel(); ++i) {
+      EXPECT_EQ(tensor.data<float>()[i], expected.data<float>()[i]);
+    }
+  }
+
+  // a parameter written changes only the copy of this process
+  auto* fc_b = load_scope.FindVar("fc_b")->GetMutable<framework::LoDTensor>();
+  fc_b->data<float>()[0] = -1;
+  framework::Scope reload_scope;
+  ModelBundle::Open(path)->LoadParameters(&reload_scope, platform::CPUPlace());
+  EXPECT_EQ(reload_scope.FindVar("fc_b")
+                ->Get<framework::LoDTensor>()
+                .data<float>()[0],
+            100);
+}
+
+TEST(ModelBundle, not_a_bundle) {
+  std::string path = "./model_bundle_test.txt";
+  std::ofstream fout(path);
+  fout << "not a model bundle";
+  fout.close();
+  EXPECT_ANY_THROW(ModelBundle::Open(path));
+}
+
+}  // namespace inference
+}  // namespace paddle
@@ -20,6 +20,8 @@
 #include "paddle/fluid/memory/allocation/auto_growth_best_fit_allocator.h"
 #include "paddle/fluid/memory/allocation/cpu_allocator.h"
 #include "paddle/fluid/memory/allocation/naive_best_fit_allocator.h"
+#include "paddle/fluid/memory/allocation/segregated_fit_allocator.h"
+#include "paddle/fluid/memory/allocation/thread_caching_cpu_allocator.h"
 #ifdef PADDLE_WITH_ASCEND_CL
 #include "paddle/fluid/memory/allocation/npu_pinned_allocator.h"
 #endif
@@ -51,6 +53,15 @@ PADDLE_DEFINE_EXPORTED_bool(
     "Whether to use system allocator to allocate CPU and GPU memory. "
     "Only used for unittests.");
 
+PADDLE_DEFINE_EXPORTED_bool(
+    use_segregated_fit_allocator, false,
+    "Whether to use the segregated fit allocator instead of the best fit "
+    "allocator for the CUDA memory under "
+    "FLAGS_allocator_strategy=\"auto_growth\". Both grow and release chunks "
+    "the same way, the segregated fit allocator finds free blocks through "
+    "size bins. The CPU and CUDA pinned memory do not grow by chunks under "
+    "either strategy, so are not affected.");
+
 DECLARE_string(allocator_strategy);
 
 namespace paddle {
@@ -167,6 +178,24 @@ class AllocatorFacadePrivate {
         break;
       }
 
+      case AllocatorStrategy::kThreadCaching: {
+        InitThreadCachingCPUAllocator();
+#ifdef PADDLE_WITH_XPU
+        for (int dev_id = 0; dev_id < platform::GetXPUDeviceCount(); ++dev_id) {
+          InitNaiveBestFitXPUAllocator(platform::XPUPlace(dev_id));
+        }
+#endif
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
+        for (int dev_id = 0; dev_id < platform::GetCUDADeviceCount();
+             ++dev_id) {
+          InitAutoGrowthCUDAAllocator(platform::CUDAPlace(dev_id),
+                                      allow_free_idle_chunk);
+        }
+        InitNaiveBestFitCUDAPinnedAllocator();
+#endif
+        break;
+      }
+
       default: {
         PADDLE_THROW(platform::errors::InvalidArgument(
             "Unsupported allocator strategy: %d", static_cast<int>(strategy_)));
@@ -242,6 +271,14 @@ class AllocatorFacadePrivate {
         std::make_shared<NaiveBestFitAllocator>(platform::CPUPlace());
   }
 
+  // small blocks are cached per thread, large ones come from the buddy
+  // allocator as in naive_best_fit
+  void InitThreadCachingCPUAllocator() {
+    allocators_[platform::CPUPlace()] =
+        std::make_shared<ThreadCachingCPUAllocator>(
+            std::make_shared<NaiveBestFitAllocator>(platform::CPUPlace()));
+  }
+
 #if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
   void InitNaiveBestFitCUDAPinnedAllocator() {
     allocators_[platform::CUDAPinnedPlace()] =
@@ -290,8 +327,13 @@ class AllocatorFacadePrivate {
       VLOG(10) << "not use AlignedAllocator with alignment: " << alignment;
       underlying_allocator = cuda_allocator;
     }
-    allocators_[p] = std::make_shared<AutoGrowthBestFitAllocator>(
-        underlying_allocator, alignment, 0, allow_free_idle_chunk);
+    if (FLAGS_use_segregated_fit_allocator) {
+      allocators_[p] = std::make_shared<SegregatedFitAllocator>(
+          underlying_allocator, alignment, 0, allow_free_idle_chunk);
+    } else {
+      allocators_[p] = std::make_shared<AutoGrowthBestFitAllocator>(
+          underlying_allocator, alignment, 0, allow_free_idle_chunk);
+    }
   }
 #endif
 
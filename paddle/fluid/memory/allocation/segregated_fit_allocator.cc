@@ -0,0 +1,298 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/memory/allocation/segregated_fit_allocator.h"
+
+#include <algorithm>
+
+#include "gflags/gflags.h"
+
+DECLARE_bool(free_idle_chunk);
+DECLARE_bool(free_when_no_cache_hit);
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+constexpr size_t SegregatedFitAllocator::kSubBinBits;
+constexpr size_t SegregatedFitAllocator::kSubBinNum;
+constexpr size_t SegregatedFitAllocator::kBinLevelNum;
+
+static inline size_t HighestBit(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return 63 - __builtin_clzll(x);
+#else
+  size_t bit = 0;
+  while (x >>= 1) {
+    ++bit;
+  }
+  return bit;
+#endif
+}
+
+static inline size_t LowestBit(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctzll(x);
+#else
+  size_t bit = 0;
+  while ((x & 1) == 0) {
+    x >>= 1;
+    ++bit;
+  }
+  return bit;
+#endif
+}
+
+SegregatedFitAllocator::SegregatedFitAllocator(
+    const std::shared_ptr<Allocator> &underlying_allocator, size_t alignment,
+    size_t chunk_size, bool allow_free_idle_chunk)
+    : underlying_allocator_(underlying_allocator),
+      alignment_(alignment),
+      chunk_size_(std::max(AlignedSize(chunk_size, alignment), alignment)),
+      allow_free_idle_chunk_(allow_free_idle_chunk) {}
+
+SegregatedFitAllocator::~SegregatedFitAllocator() {
+  // chunks go back to the underlying allocator, the block pool just goes
+  chunks_.clear();
+}
+
+// level is the highest bit of size, the sub bin the kSubBinBits bits below
+size_t SegregatedFitAllocator::BinIndex(size_t size) {
+  size_t level = HighestBit(size);
+  size_t sub = level < kSubBinBits
+                   ? 0
+                   : (size >> (level - kSubBinBits)) & (kSubBinNum - 1);
+  return level * kSubBinNum + sub;
+}
+
+SegregatedFitAllocator::Block *SegregatedFitAllocator::NewBlock(
+    void *ptr, size_t size, bool is_free, Chunk *chunk) {
+  if (free_headers_ == nullptr) {
+    constexpr size_t kHeadersPerSlab = 256;
+    block_pool_.emplace_back(new Block[kHeadersPerSlab]);
+    auto *headers = block_pool_.back().get();
+    for (size_t i = 0; i < kHeadersPerSlab; ++i) {
+      headers[i].next_free_ = free_headers_;
+      free_headers_ = &headers[i];
+    }
+  }
+  Block *block = free_headers_;
+  free_headers_ = block->next_free_;
+  block->ptr_ = ptr;
+  block->size_ = size;
+  block->is_free_ = is_free;
+  block->chunk_ = chunk;
+  block->prev_ = nullptr;
+  block->next_ = nullptr;
+  block->prev_free_ = nullptr;
+  block->next_free_ = nullptr;
+  return block;
+}
+
+void SegregatedFitAllocator::DeleteBlock(Block *block) {
+  block->next_free_ = free_headers_;
+  free_headers_ = block;
+}
+
+void SegregatedFitAllocator::InsertFreeBlock(Block *block) {
+  size_t bin = BinIndex(block->size_);
+  block->prev_free_ = nullptr;
+  block->next_free_ = bins_[bin];
+  if (bins_[bin] != nullptr) {
+    bins_[bin]->prev_free_ = block;
+  }
+  bins_[bin] = block;
+  level_map_ |= uint64_t(1) << (bin / kSubBinNum);
+  bin_map_[bin / kSubBinNum] |= 1U << (bin % kSubBinNum);
+}
+
+void SegregatedFitAllocator::RemoveFreeBlock(Block *block) {
+  size_t bin = BinIndex(block->size_);
+  if (block->prev_free_ != nullptr) {
+    block->prev_free_->next_free_ = block->next_free_;
+  } else {
+    bins_[bin] = block->next_free_;
+  }
+  if (block->next_free_ != nullptr) {
+    block->next_free_->prev_free_ = block->prev_free_;
+  }
+  if (bins_[bin] == nullptr) {
+    size_t level = bin / kSubBinNum;
+    bin_map_[level] &= ~(1U << (bin % kSubBinNum));
+    if (bin_map_[level] == 0) {
+      level_map_ &= ~(uint64_t(1) << level);
+    }
+  }
+}
+
+SegregatedFitAllocator::Block *SegregatedFitAllocator::FindFreeBlock(
+    size_t size) {
+  // blocks in the bin of size may still be smaller than size, look for the
+  // smallest one that fits so any free block large enough is a cache hit,
+  // as in the best fit allocator
+  size_t bin = BinIndex(size);
+  Block *best = nullptr;
+  for (Block *block = bins_[bin]; block != nullptr; block = block->next_free_) {
+    if (block->size_ >= size &&
+        (best == nullptr || block->size_ < best->size_)) {
+      best = block;
+      if (best->size_ == size) {
+        break;
+      }
+    }
+  }
+  if (best != nullptr) {
+    return best;
+  }
+
+  // every block of a later bin fits
+  size_t level = bin / kSubBinNum;
+  uint32_t sub_map =
+      bin_map_[level] & ~((2U << (bin % kSubBinNum)) - 1);
+  if (sub_map == 0) {
+    uint64_t level_map =
+        level + 1 < kBinLevelNum ? level_map_ & ~((uint64_t(2) << level) - 1)
+                                 : 0;
+    if (level_map == 0) {
+      return nullptr;
+    }
+    level = LowestBit(level_map);
+    sub_map = bin_map_[level];
+  }
+  return bins_[level * kSubBinNum + LowestBit(sub_map)];
+}
+
+Allocation *SegregatedFitAllocator::AllocateImpl(size_t unaligned_size) {
+  size_t size = AlignedSize(unaligned_size, alignment_);
+  VLOG(10) << "Allocate " << unaligned_size << " bytes, aligned to " << size;
+
+  std::lock_guard<SpinLock> guard(spinlock_);
+  Block *block = FindFreeBlock(size);
+  if (block != nullptr) {
+    RemoveFreeBlock(block);
+    size_t remaining_size = block->size_ - size;
+    VLOG(10) << "Allocate " << size << " bytes from chunk size "
+             << block->size_ << ", remaining " << remaining_size;
+    if (remaining_size > 0) {
+      // the head stays free, the tail is handed out
+      Block *used = NewBlock(reinterpret_cast<uint8_t *>(block->ptr_) +
+                                 remaining_size,
+                             size, false, block->chunk_);
+      used->prev_ = block;
+      used->next_ = block->next_;
+      if (block->next_ != nullptr) {
+        block->next_->prev_ = used;
+      }
+      block->next_ = used;
+      block->size_ = remaining_size;
+      InsertFreeBlock(block);
+      block = used;
+    } else {
+      block->is_free_ = false;
+    }
+  } else {
+    if (FLAGS_free_when_no_cache_hit) {
+      FreeIdleChunks();
+    }
+    size_t realloc_size = std::max(size, chunk_size_);
+
+    try {
+      chunks_.emplace_back(underlying_allocator_->Allocate(realloc_size));
+    } catch (BadAlloc &ex) {
+      if (FLAGS_free_when_no_cache_hit) throw ex;
+      FreeIdleChunks();
+      chunks_.emplace_back(underlying_allocator_->Allocate(realloc_size));
+    }
+
+    auto *chunk = &(*chunks_.rbegin());
+    realloc_size = chunk->allocation_->size();
+    uint8_t *p = reinterpret_cast<uint8_t *>(chunk->allocation_->ptr());
+
+    size_t remaining_size = realloc_size - size;
+    block = NewBlock(p + remaining_size, size, false, chunk);
+    chunk->first_ = block;
+    if (remaining_size > 0) {
+      Block *remaining = NewBlock(p, remaining_size, true, chunk);
+      remaining->next_ = block;
+      block->prev_ = remaining;
+      chunk->first_ = remaining;
+      InsertFreeBlock(remaining);
+    }
+    VLOG(2) << "Not found and reallocate " << realloc_size << "("
+            << static_cast<void *>(p) << "), and remaining " << remaining_size;
+  }
+  return new BlockAllocation(block);
+}
+
+void SegregatedFitAllocator::FreeImpl(Allocation *allocation) {
+  VLOG(10) << "Free " << allocation->size() << " bytes";
+  std::lock_guard<SpinLock> guard(spinlock_);
+  Block *block = static_cast<BlockAllocation *>(allocation)->block_;
+  block->is_free_ = true;
+
+  Block *prev = block->prev_;
+  if (prev != nullptr && prev->is_free_) {
+    RemoveFreeBlock(prev);
+    prev->size_ += block->size_;
+    prev->next_ = block->next_;
+    if (block->next_ != nullptr) {
+      block->next_->prev_ = prev;
+    }
+    DeleteBlock(block);
+    block = prev;
+  }
+
+  Block *next = block->next_;
+  if (next != nullptr && next->is_free_) {
+    RemoveFreeBlock(next);
+    block->size_ += next->size_;
+    block->next_ = next->next_;
+    if (next->next_ != nullptr) {
+      next->next_->prev_ = block;
+    }
+    DeleteBlock(next);
+  }
+
+  InsertFreeBlock(block);
+
+  delete allocation;
+
+  if (FLAGS_free_idle_chunk) {
+    FreeIdleChunks();
+  }
+}
+
+uint64_t SegregatedFitAllocator::FreeIdleChunks() {
+  if (!allow_free_idle_chunk_) {
+    return 0;
+  }
+  uint64_t bytes = 0;
+  for (auto chunk_it = chunks_.begin(); chunk_it != chunks_.end();) {
+    Block *block = chunk_it->first_;
+    if (block->is_free_ && block->next_ == nullptr) {
+      VLOG(2) << "Free chunk with size " << block->size_;
+      bytes += block->size_;
+      RemoveFreeBlock(block);
+      DeleteBlock(block);
+      chunk_it = chunks_.erase(chunk_it);
+    } else {
+      ++chunk_it;
+    }
+  }
+  return bytes;
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -0,0 +1,132 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "paddle/fluid/memory/allocation/allocator.h"
+#include "paddle/fluid/memory/allocation/spin_lock.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+// SegregatedFitAllocator grows and releases chunks exactly like
+// AutoGrowthBestFitAllocator (same chunk size, same FLAGS_free_idle_chunk and
+// FLAGS_free_when_no_cache_hit behavior), but keeps its bookkeeping cheaper:
+//
+//  - the blocks of a chunk form an intrusive list in address order, and the
+//    block headers are recycled from a pool, so splitting and merging never
+//    call the system allocator;
+//  - free blocks are kept in segregated lists, 4 size bins per power of two,
+//    and a two level bitmap of non-empty bins finds a large enough bin in
+//    O(1) instead of walking a std::map.
+//
+// The headers live on the host, the managed memory may be device memory.
+class SegregatedFitAllocator : public Allocator {
+ public:
+  SegregatedFitAllocator(
+      const std::shared_ptr<Allocator> &underlying_allocator, size_t alignment,
+      size_t chunk_size = 0, bool allow_free_idle_chunk = true);
+
+  ~SegregatedFitAllocator();
+
+  bool IsAllocThreadSafe() const override { return true; }
+
+ protected:
+  Allocation *AllocateImpl(size_t size) override;
+
+  void FreeImpl(Allocation *allocation) override;
+
+  // Release the memory block which is not used in pool.
+  uint64_t ReleaseImpl(const platform::Place &place) override {
+    std::lock_guard<SpinLock> guard(spinlock_);
+    return FreeIdleChunks();
+  }
+
+ private:
+  static constexpr size_t kSubBinBits = 2;
+  static constexpr size_t kSubBinNum = 1 << kSubBinBits;
+  static constexpr size_t kBinLevelNum = 64;
+
+  struct Chunk;
+
+  struct Block {
+    void *ptr_;
+    size_t size_;
+    bool is_free_;
+    Chunk *chunk_;
+    // neighbours in the chunk, in address order
+    Block *prev_;
+    Block *next_;
+    // neighbours in the free list of the bin, valid when is_free_
+    Block *prev_free_;
+    Block *next_free_;
+  };
+
+  struct Chunk {
+    explicit Chunk(AllocationPtr allocation)
+        : allocation_(std::move(allocation)) {}
+
+    AllocationPtr allocation_;
+    Block *first_{nullptr};
+  };
+
+  struct BlockAllocation : public Allocation {
+    explicit BlockAllocation(Block *block)
+        : Allocation(block->ptr_, block->size_,
+                     block->chunk_->allocation_->place()),
+          block_(block) {}
+
+    Block *block_;
+  };
+
+  static size_t BinIndex(size_t size);
+
+  Block *NewBlock(void *ptr, size_t size, bool is_free, Chunk *chunk);
+  void DeleteBlock(Block *block);
+
+  void InsertFreeBlock(Block *block);
+  void RemoveFreeBlock(Block *block);
+  // a free block of at least size bytes, or nullptr
+  Block *FindFreeBlock(size_t size);
+
+  uint64_t FreeIdleChunks();
+
+  std::shared_ptr<Allocator> underlying_allocator_;
+  std::list<Chunk> chunks_;
+  size_t alignment_;
+  size_t chunk_size_;
+  bool allow_free_idle_chunk_;
+
+  // bit l of level_map_ is set when any bin of level l is non-empty, bit s of
+  // bin_map_[l] when bin (l, s) is non-empty
+  uint64_t level_map_{0};
+  uint32_t bin_map_[kBinLevelNum] = {0};
+  Block *bins_[kBinLevelNum * kSubBinNum] = {nullptr};
+
+  std::vector<std::unique_ptr<Block[]>> block_pool_;
+  Block *free_headers_{nullptr};
+
+  SpinLock spinlock_;
+};
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -0,0 +1,124 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/memory/allocation/segregated_fit_allocator.h"
+
+#include <chrono>  // NOLINT
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/memory/allocation/auto_growth_best_fit_allocator.h"
+#include "paddle/fluid/memory/allocation/auto_growth_best_fit_allocator_tester_helper.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+// The workloads of auto_growth_best_fit_allocator_test, as the two allocators
+// grow and release chunks identically.
+TEST(test_segregated_fit_allocator, test_free_idle_chunk) {
+  for (auto free_idle_chunk : {false, true}) {
+    for (auto free_when_no_cache_hit : {false, true}) {
+      TestFreeIdleChunk<SegregatedFitAllocator>(free_idle_chunk,
+                                                free_when_no_cache_hit);
+    }
+  }
+}
+
+TEST(test_segregated_fit_allocator, test_free_when_no_cache_hit) {
+  for (auto free_when_no_cache_hit : {false, true}) {
+    TestFreeWhenNoCacheHit<SegregatedFitAllocator>(free_when_no_cache_hit);
+  }
+}
+
+TEST(test_segregated_fit_allocator, test_split_and_merge) {
+  FLAGS_free_idle_chunk = false;
+  FLAGS_free_when_no_cache_hit = false;
+  auto recorded_allocator = std::make_shared<RecordedAllocator>();
+  size_t alignment = 256;
+  size_t chunk_size = 1 << 20;
+  auto allocator = std::make_shared<SegregatedFitAllocator>(
+      recorded_allocator, alignment, chunk_size);
+
+  std::mt19937 rng(0);
+  std::vector<AllocationPtr> live;
+  for (int i = 0; i < 10000; ++i) {
+    if (live.empty() || (live.size() < 256 && rng() % 2 == 0)) {
+      size_t size = 1 + rng() % 65536;
+      auto allocation = allocator->Allocate(size);
+      ASSERT_EQ(allocation->size() % alignment, 0UL);
+      ASSERT_GE(allocation->size(), size);
+      memset(allocation->ptr(), i & 0xff, allocation->size());
+      live.emplace_back(std::move(allocation));
+    } else {
+      size_t k = rng() % live.size();
+      live[k] = std::move(live.back());
+      live.pop_back();
+    }
+  }
+  size_t peak = recorded_allocator->AllocatedSize();
+  live.clear();
+  // everything merges back into whole chunks
+  ASSERT_EQ(allocator->Release(platform::CPUPlace()), peak);
+  ASSERT_EQ(recorded_allocator->AllocatedSize(), 0UL);
+}
+
+// Random allocate / free with sizes spread over several bins, as seen by the
+// auto growth allocator during training.
+template <typename AllocatorType>
+static double BenchmarkRandomAllocFree(size_t live_num, size_t max_size) {
+  FLAGS_free_idle_chunk = false;
+  FLAGS_free_when_no_cache_hit = false;
+  auto recorded_allocator = std::make_shared<RecordedAllocator>();
+  auto allocator = std::make_shared<AllocatorType>(recorded_allocator, 256,
+                                                   64 << 20);
+
+  std::mt19937 rng(0);
+  std::vector<AllocationPtr> live(live_num);
+  const size_t op_num = 200000;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < op_num; ++i) {
+    size_t k = rng() % live_num;
+    // a reset followed by an allocate, so every step is a free and an alloc
+    live[k].reset();
+    live[k] = allocator->Allocate(1 + rng() % max_size);
+  }
+  auto end = std::chrono::steady_clock::now();
+  live.clear();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         op_num;
+}
+
+// Not a pass / fail test, it logs the cost per operation of both allocators,
+// run it by --gtest_also_run_disabled_tests.
+TEST(test_segregated_fit_allocator, DISABLED_benchmark) {
+  for (size_t live_num : {64, 1024, 4096}) {
+    const size_t max_size = 1 << 14;
+    double best_fit = BenchmarkRandomAllocFree<AutoGrowthBestFitAllocator>(
+        live_num, max_size);
+    double segregated_fit =
+        BenchmarkRandomAllocFree<SegregatedFitAllocator>(live_num, max_size);
+    LOG(INFO) << "live blocks " << live_num
+              << ": AutoGrowthBestFitAllocator " << best_fit
+              << " ns/op, SegregatedFitAllocator " << segregated_fit
+              << " ns/op";
+  }
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
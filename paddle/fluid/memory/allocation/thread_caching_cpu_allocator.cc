@@ -0,0 +1,329 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/memory/allocation/thread_caching_cpu_allocator.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <mutex>  // NOLINT
+#include <utility>
+
+#include "paddle/fluid/memory/allocation/cpu_allocator.h"
+#include "paddle/fluid/platform/enforce.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+constexpr size_t SizeClassMap::kAlignment;
+constexpr size_t SizeClassMap::kMaxCachedSize;
+constexpr size_t SizeClassMap::kSizeClassNum;
+
+size_t SizeClassMap::ClassIndex(size_t size) {
+  if (size <= 1024) {
+    return (size + kAlignment - 1) / kAlignment - 1;
+  }
+  // 4 classes in (2^p, 2^(p+1)], picked by the 2 bits after the leading one
+  size_t p = 10;
+  while (((size - 1) >> (p + 1)) != 0) {
+    ++p;
+  }
+  size_t x = (size - 1) >> (p - 2);
+  return 16 + (p - 10) * 4 + x - 4;
+}
+
+size_t SizeClassMap::ClassSize(size_t index) {
+  if (index < 16) {
+    return (index + 1) * kAlignment;
+  }
+  size_t j = index - 16;
+  size_t p = 10 + j / 4;
+  size_t x = 4 + j % 4;
+  return (x + 1) << (p - 2);
+}
+
+size_t SizeClassMap::BatchSize(size_t index) {
+  return std::min<size_t>(
+      32, std::max<size_t>(2, (64 << 10) / ClassSize(index)));
+}
+
+// A batch is a list of blocks chained through their first word, its head
+// block also records the number of blocks in the second word.
+static inline void*& NextBlock(void* block) {
+  return *reinterpret_cast<void**>(block);
+}
+
+static inline size_t& BatchCount(void* head) {
+  return reinterpret_cast<size_t*>(head)[1];
+}
+
+void CentralFreeList::Init(size_t index) {
+  block_size_ = SizeClassMap::ClassSize(index);
+  batch_size_ = SizeClassMap::BatchSize(index);
+  for (auto& slot : slots_) {
+    slot.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+CentralFreeList::~CentralFreeList() {
+  for (auto* span : spans_) {
+#ifdef _WIN32
+    _aligned_free(span);
+#else
+    free(span);
+#endif
+  }
+}
+
+void* CentralFreeList::PopBatch() {
+  for (auto& slot : slots_) {
+    if (slot.load(std::memory_order_relaxed) != nullptr) {
+      void* batch = slot.exchange(nullptr, std::memory_order_acquire);
+      if (batch != nullptr) {
+        return batch;
+      }
+    }
+  }
+  {
+    std::lock_guard<SpinLock> guard(mtx_);
+    if (!overflow_.empty()) {
+      void* batch = overflow_.back();
+      overflow_.pop_back();
+      return batch;
+    }
+  }
+  return NewSpanBatch();
+}
+
+void CentralFreeList::PushBatch(void* batch) {
+  for (auto& slot : slots_) {
+    void* expected = nullptr;
+    if (slot.load(std::memory_order_relaxed) == nullptr &&
+        slot.compare_exchange_strong(expected, batch,
+                                     std::memory_order_release,
+                                     std::memory_order_relaxed)) {
+      return;
+    }
+  }
+  std::lock_guard<SpinLock> guard(mtx_);
+  overflow_.push_back(batch);
+}
+
+void* CentralFreeList::NewSpanBatch() {
+  void* span = nullptr;
+  size_t span_size = block_size_ * batch_size_;
+  int error = posix_memalign(&span, CPUAllocator::kAlignment, span_size);
+  if (UNLIKELY(error != 0)) {
+    PADDLE_THROW_BAD_ALLOC(platform::errors::ResourceExhausted(
+        "Fail to alloc memory of %ld size, error code is %d.", span_size,
+        error));
+  }
+  {
+    std::lock_guard<SpinLock> guard(mtx_);
+    spans_.push_back(span);
+  }
+
+  char* block = reinterpret_cast<char*>(span);
+  for (size_t i = 0; i + 1 < batch_size_; ++i) {
+    NextBlock(block + i * block_size_) = block + (i + 1) * block_size_;
+  }
+  NextBlock(block + (batch_size_ - 1) * block_size_) = nullptr;
+  BatchCount(span) = batch_size_;
+  return span;
+}
+
+namespace {
+
+using CentralCache = ThreadCachingCPUAllocator::CentralCache;
+
+class ThreadCache {
+ public:
+  explicit ThreadCache(std::shared_ptr<CentralCache> central)
+      : central_(std::move(central)) {}
+
+  ~ThreadCache() {
+    for (size_t index = 0; index < lists_.size(); ++index) {
+      while (lists_[index].count > 0) {
+        ReleaseBatch(index);
+      }
+    }
+  }
+
+  const CentralCache* central() const { return central_.get(); }
+
+  void* Allocate(size_t index) {
+    auto& list = lists_[index];
+    if (UNLIKELY(list.head == nullptr)) {
+      list.head = central_->lists[index].PopBatch();
+      list.count = BatchCount(list.head);
+    }
+    void* block = list.head;
+    list.head = NextBlock(block);
+    --list.count;
+    return block;
+  }
+
+  void Free(size_t index, void* block) {
+    auto& list = lists_[index];
+    NextBlock(block) = list.head;
+    list.head = block;
+    ++list.count;
+    // keep up to two batches, so alternating allocate / free around a batch
+    // boundary does not bounce batches to the central cache
+    if (UNLIKELY(list.count > 2 * SizeClassMap::BatchSize(index))) {
+      ReleaseBatch(index);
+    }
+  }
+
+ private:
+  void ReleaseBatch(size_t index) {
+    auto& list = lists_[index];
+    size_t count = std::min(list.count, SizeClassMap::BatchSize(index));
+    void* head = list.head;
+    void* tail = head;
+    for (size_t i = 1; i < count; ++i) {
+      tail = NextBlock(tail);
+    }
+    list.head = NextBlock(tail);
+    list.count -= count;
+    NextBlock(tail) = nullptr;
+    BatchCount(head) = count;
+    central_->lists[index].PushBatch(head);
+  }
+
+  struct FreeList {
+    void* head{nullptr};
+    size_t count{0};
+  };
+
+  std::shared_ptr<CentralCache> central_;
+  std::array<FreeList, SizeClassMap::kSizeClassNum> lists_;
+};
+
+struct ThreadCacheRegistry {
+  ~ThreadCacheRegistry();
+
+  std::vector<std::unique_ptr<ThreadCache>> caches;
+  ThreadCache* last{nullptr};
+};
+
+// set once the caches of the thread are gone, thread_local objects destroyed
+// later may still free memory
+static thread_local bool thread_caches_destroyed = false;
+
+ThreadCacheRegistry::~ThreadCacheRegistry() {
+  thread_caches_destroyed = true;
+  last = nullptr;
+  caches.clear();
+}
+
+// returns nullptr when the thread is exiting
+ThreadCache* GetThreadCache(const std::shared_ptr<CentralCache>& central) {
+  if (UNLIKELY(thread_caches_destroyed)) {
+    return nullptr;
+  }
+  // a process usually has one such allocator, remember the last lookup
+  static thread_local ThreadCacheRegistry registry;
+  if (LIKELY(registry.last != nullptr &&
+             registry.last->central() == central.get())) {
+    return registry.last;
+  }
+  for (auto& cache : registry.caches) {
+    if (cache->central() == central.get()) {
+      registry.last = cache.get();
+      return registry.last;
+    }
+  }
+  registry.caches.emplace_back(new ThreadCache(central));
+  registry.last = registry.caches.back().get();
+  return registry.last;
+}
+
+class ThreadCachingAllocation : public Allocation {
+ public:
+  ThreadCachingAllocation(void* ptr, size_t size, size_t class_index)
+      : Allocation(ptr, size, platform::CPUPlace()),
+        class_index_(class_index) {}
+
+  size_t ClassIndex() const { return class_index_; }
+
+ private:
+  size_t class_index_;
+};
+
+}  // namespace
+
+ThreadCachingCPUAllocator::ThreadCachingCPUAllocator(
+    std::shared_ptr<Allocator> underlying_allocator)
+    : underlying_allocator_(std::move(underlying_allocator)),
+      central_cache_(std::make_shared<CentralCache>()) {
+  PADDLE_ENFORCE_NOT_NULL(
+      underlying_allocator_,
+      platform::errors::InvalidArgument(
+          "Underlying allocator of ThreadCachingCPUAllocator is NULL"));
+  PADDLE_ENFORCE_EQ(
+      underlying_allocator_->IsAllocThreadSafe(), true,
+      platform::errors::InvalidArgument(
+          "Underlying allocator of ThreadCachingCPUAllocator must be thread "
+          "safe"));
+  for (size_t index = 0; index < SizeClassMap::kSizeClassNum; ++index) {
+    central_cache_->lists[index].Init(index);
+  }
+}
+
+Allocation* ThreadCachingCPUAllocator::AllocateImpl(size_t size) {
+  if (size > SizeClassMap::kMaxCachedSize) {
+    return underlying_allocator_->Allocate(size).release();
+  }
+  size_t index = SizeClassMap::ClassIndex(size);
+  void* ptr = nullptr;
+  auto* cache = GetThreadCache(central_cache_);
+  if (LIKELY(cache != nullptr)) {
+    ptr = cache->Allocate(index);
+  } else {
+    // take one block of a batch and give the rest back
+    auto& list = central_cache_->lists[index];
+    ptr = list.PopBatch();
+    if (BatchCount(ptr) > 1) {
+      void* rest = NextBlock(ptr);
+      BatchCount(rest) = BatchCount(ptr) - 1;
+      list.PushBatch(rest);
+    }
+  }
+  return new ThreadCachingAllocation(ptr, size, index);
+}
+
+void ThreadCachingCPUAllocator::FreeImpl(Allocation* allocation) {
+  if (allocation->size() > SizeClassMap::kMaxCachedSize) {
+    underlying_allocator_->Free(allocation);
+    return;
+  }
+  auto* cached = static_cast<ThreadCachingAllocation*>(allocation);
+  void* ptr = cached->ptr();
+  size_t index = cached->ClassIndex();
+  delete cached;
+  auto* cache = GetThreadCache(central_cache_);
+  if (LIKELY(cache != nullptr)) {
+    cache->Free(index, ptr);
+  } else {
+    NextBlock(ptr) = nullptr;
+    BatchCount(ptr) = 1;
+    central_cache_->lists[index].PushBatch(ptr);
+  }
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
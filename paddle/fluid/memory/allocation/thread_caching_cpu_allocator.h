@@ -0,0 +1,109 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "paddle/fluid/memory/allocation/allocator.h"
+#include "paddle/fluid/memory/allocation/spin_lock.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+// Small CPU allocations are rounded up to one of kSizeClassNum size classes:
+// multiples of 64 bytes up to 1KB, then 4 classes per power of two up to
+// kMaxCachedSize. Every class size is a multiple of kAlignment.
+class SizeClassMap {
+ public:
+  static constexpr size_t kAlignment = 64;
+  static constexpr size_t kMaxCachedSize = 256 << 10;
+  static constexpr size_t kSizeClassNum = 16 + 8 * 4;
+
+  // size must be in [1, kMaxCachedSize]
+  static size_t ClassIndex(size_t size);
+
+  static size_t ClassSize(size_t index);
+
+  // number of blocks moved at once between a thread cache and the central
+  // cache
+  static size_t BatchSize(size_t index);
+};
+
+// Blocks of one size class which are not cached by any thread. Full batches
+// (a linked list of BatchSize blocks, chained through their first word) are
+// handed over through a fixed array of slots with atomic exchange, so threads
+// trading batches never take a lock. Only an overflowing slot array and
+// carving new spans go through the spin lock.
+class CentralFreeList {
+ public:
+  static constexpr size_t kTransferSlotNum = 64;
+
+  CentralFreeList() = default;
+
+  void Init(size_t index);
+
+  ~CentralFreeList();
+
+  // returns a full batch
+  void* PopBatch();
+
+  void PushBatch(void* batch);
+
+ private:
+  void* NewSpanBatch();
+
+  size_t block_size_{0};
+  size_t batch_size_{0};
+  std::array<std::atomic<void*>, kTransferSlotNum> slots_{};
+
+  SpinLock mtx_;
+  std::vector<void*> overflow_;
+  std::vector<void*> spans_;
+};
+
+// A size class allocator for CPU memory. Each thread keeps a free list
+// per size class and only talks to the central free lists for a batch at a
+// time, so most Allocate/Free calls touch no shared state. A block freed by
+// another thread goes to the cache of that thread. Requests larger than
+// kMaxCachedSize go to the underlying allocator.
+class ThreadCachingCPUAllocator : public Allocator {
+ public:
+  explicit ThreadCachingCPUAllocator(
+      std::shared_ptr<Allocator> underlying_allocator);
+
+  bool IsAllocThreadSafe() const override { return true; }
+
+  struct CentralCache {
+    std::array<CentralFreeList, SizeClassMap::kSizeClassNum> lists;
+  };
+
+ protected:
+  Allocation* AllocateImpl(size_t size) override;
+  void FreeImpl(Allocation* allocation) override;
+
+ private:
+  std::shared_ptr<Allocator> underlying_allocator_;
+  // shared with the thread caches, which return their blocks when the
+  // threads exit
+  std::shared_ptr<CentralCache> central_cache_;
+};
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -0,0 +1,107 @@
+// Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "paddle/fluid/memory/allocation/thread_caching_cpu_allocator.h"
+
+#include <cstring>
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "paddle/fluid/memory/allocation/cpu_allocator.h"
+
+namespace paddle {
+namespace memory {
+namespace allocation {
+
+TEST(ThreadCachingCPUAllocator, size_class) {
+  for (size_t size = 1; size <= SizeClassMap::kMaxCachedSize; ++size) {
+    size_t index = SizeClassMap::ClassIndex(size);
+    ASSERT_LT(index, SizeClassMap::kSizeClassNum);
+    ASSERT_GE(SizeClassMap::ClassSize(index), size);
+    ASSERT_EQ(SizeClassMap::ClassSize(index) % SizeClassMap::kAlignment, 0UL);
+    if (index > 0) {
+      ASSERT_LT(SizeClassMap::ClassSize(index - 1), size);
+    }
+  }
+  ASSERT_EQ(SizeClassMap::ClassSize(SizeClassMap::kSizeClassNum - 1),
+            SizeClassMap::kMaxCachedSize);
+}
+
+TEST(ThreadCachingCPUAllocator, reuse) {
+  auto allocator = std::make_shared<ThreadCachingCPUAllocator>(
+      std::make_shared<CPUAllocator>());
+
+  void* ptr = nullptr;
+  {
+    auto allocation = allocator->Allocate(1000);
+    ASSERT_EQ(allocation->size(), 1000UL);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(allocation->ptr()) %
+                  SizeClassMap::kAlignment,
+              0UL);
+    ptr = allocation->ptr();
+  }
+  // the block just freed is on top of the thread cache
+  auto allocation = allocator->Allocate(960);
+  ASSERT_EQ(allocation->ptr(), ptr);
+
+  auto large = allocator->Allocate(SizeClassMap::kMaxCachedSize + 1);
+  ASSERT_EQ(large->size(), SizeClassMap::kMaxCachedSize + 1);
+  memset(large->ptr(), 0, large->size());
+}
+
+TEST(ThreadCachingCPUAllocator, multi_thread) {
+  auto allocator = std::make_shared<ThreadCachingCPUAllocator>(
+      std::make_shared<CPUAllocator>());
+
+  const int thread_num = 8;
+  std::vector<std::vector<AllocationPtr>> left(thread_num);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_num; ++t) {
+    threads.emplace_back([&, t] {
+      std::mt19937 rng(t);
+      std::vector<AllocationPtr> live;
+      for (int i = 0; i < 20000; ++i) {
+        size_t size = 1 + rng() % 8192;
+        auto allocation = allocator->Allocate(size);
+        memset(allocation->ptr(), t, size);
+        live.emplace_back(std::move(allocation));
+        if (live.size() > 64) {
+          size_t k = rng() % live.size();
+          auto* data = reinterpret_cast<unsigned char*>(live[k]->ptr());
+          ASSERT_EQ(data[0], t);
+          ASSERT_EQ(data[live[k]->size() - 1], t);
+          live[k] = std::move(live.back());
+          live.pop_back();
+        }
+      }
+      left[t] = std::move(live);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // blocks freed by another thread go to the cache of that thread
+  std::thread([&] {
+    for (auto& allocations : left) {
+      allocations.clear();
+    }
+  }).join();
+}
+
+}  // namespace allocation
+}  // namespace memory
+}  // namespace paddle
@@ -91,13 +91,21 @@ framework::OpDesc* CreateFusionGroupOp(
 }
 
 void PrepareDeviceCode(platform::Place place, std::string func_name,
-                       std::string cuda_kernel_str) {
+                       std::string kernel_str) {
   paddle::platform::DeviceCodePool& pool =
       paddle::platform::DeviceCodePool::Init({place});
 
-  std::unique_ptr<paddle::platform::DeviceCode> code(
-      new paddle::platform::CUDADeviceCode(place, func_name, cuda_kernel_str));
-  code->Compile();
+  std::unique_ptr<paddle::platform::DeviceCode> code;
+  if (platform::is_cpu_place(place)) {
+    code.reset(
+        new paddle::platform::CPUDeviceCode(place, func_name, kernel_str));
+  } else {
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
+    code.reset(
+        new paddle::platform::CUDADeviceCode(place, func_name, kernel_str));
+#endif
+  }
+  EXPECT_EQ(code->Compile(), true);
   pool.Set(std::move(code));
 }
 
@@ -137,12 +145,11 @@ void CheckOutputs(framework::Scope* scope,
 void TestMain(const std::vector<std::string>& input_names,
               const std::vector<std::vector<int64_t>>& input_shapes,
               const std::vector<std::string>& output_names, int type,
-              std::string func_name, std::string cuda_kernel_str,
-              CPUKernelFunc cpu_kernel_func) {
+              std::string func_name, std::string kernel_str,
+              CPUKernelFunc cpu_kernel_func, platform::Place place) {
   // Compile the device code
   paddle::framework::InitDevices({0});
-  platform::CUDAPlace place = platform::CUDAPlace(0);
-  PrepareDeviceCode(place, func_name, cuda_kernel_str);
+  PrepareDeviceCode(place, func_name, kernel_str);
 
   // Create a ProgramDesc that has a fusion_group_op.
   framework::ProgramDesc program;
@@ -177,6 +184,20 @@ void TestMain(const std::vector<std::string>& input_names,
                cpu_kernel_func);
 }
 
+void elementwise_cpu_kernel_0(size_t n, std::vector<void*> args) {
+  float* x = static_cast<float*>(args[0]);
+  float* y = static_cast<float*>(args[1]);
+  float* z = static_cast<float*>(args[2]);
+  for (size_t i = 0; i < n; ++i) {
+    float tmp_0 = x[i];
+    float tmp_1 = y[i];
+    float tmp_2 = tmp_0 + tmp_1;
+    float tmp_3 = tmp_2 > 0 ? tmp_2 : 0;
+    z[i] = tmp_3;
+  }
+}
+
+#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
 TEST(FusionGroupOp, elementwise) {
   if (!platform::dynload::HasNVRTC() || !platform::dynload::HasCUDADriver()) {
     return;
@@ -203,25 +224,48 @@ void elementwise_cuda_kernel_0(size_t n, float *x, float* y, float* z) {
   }
 })";
 
-  auto elementwise_cpu_kernel_0 = [](size_t n,
-                                     std::vector<void*> args) -> void {
-    float* x = static_cast<float*>(args[0]);
-    float* y = static_cast<float*>(args[1]);
-    float* z = static_cast<float*>(args[2]);
-    for (size_t i = 0; i < n; ++i) {
-      float tmp_0 = x[i];
-      float tmp_1 = y[i];
-      float tmp_2 = tmp_0 + tmp_1;
-      float tmp_3 = tmp_2 > 0 ? tmp_2 : 0;
-      z[i] = tmp_3;
-    }
-  };
+  TestMain(input_names, input_shapes, output_names, 0,
+           "elementwise_cuda_kernel_0", kernel, elementwise_cpu_kernel_0,
+           platform::CUDAPlace(0));
+}
+#endif
+
+TEST(FusionGroupOp, elementwise_cpu) {
+  if (!platform::CPUDeviceCode::IsAvailable()) {
+    return;
+  }
+
+  // z = relu(x + y)
+  std::vector<std::string> input_names = {"x", "y"};
+  std::vector<std::string> output_names = {"z"};
+  std::vector<std::vector<int64_t>> input_shapes = {{256, 256}, {256, 256}};
+  constexpr auto kernel = R"(
+#include <cstddef>
+
+static inline float relu(float x) {
+  return x * (x > 0);
+}
+
+extern "C" void elementwise_cpu_kernel_0(size_t begin, size_t end,
+                                         void** args) {
+  float* x = *static_cast<float**>(args[1]);
+  float* y = *static_cast<float**>(args[2]);
+  float* z = *static_cast<float**>(args[3]);
+  for (size_t i = begin; i < end; ++i) {
+    float tmp_0 = x[i];
+    float tmp_1 = y[i];
+    float tmp_2 = tmp_0 + tmp_1;
+    float tmp_3 = relu(tmp_2);
+    z[i] = tmp_3;
+  }
+})";
 
   TestMain(input_names, input_shapes, output_names, 0,
-           "elementwise_cuda_kernel_0", kernel, elementwise_cpu_kernel_0);
+           "elementwise_cpu_kernel_0", kernel, elementwise_cpu_kernel_0,
+           platform::CPUPlace());
 }
 
 }  // namespace operators
 }  // namespace paddle
 
-USE_CUDA_ONLY_OP(fusion_group);
+USE_OP(fusion_group);
@@ -361,6 +361,58 @@ void BenchKernelSgd() {
   }
 }
 
+template <typename KernelTuple, typename PlaceType>
+void BenchKernelAdam() {
+  using T = typename KernelTuple::data_type;
+  const T lr = 0.1;
+  const T eps = 1e-8;
+  const jit::adam_attr_t attr(0.9, 0.999);
+  for (int numel : {512, 4096, 65536}) {
+    // only benchmark inplace
+    Tensor grad, mom1, mom2, param;
+    grad.Resize({numel});
+    mom1.Resize({numel});
+    mom2.Resize({numel});
+    param.Resize({numel});
+    T* grad_data = grad.mutable_data<T>(PlaceType());
+    T* mom1_data = mom1.mutable_data<T>(PlaceType());
+    T* mom2_data = mom2.mutable_data<T>(PlaceType());
+    T* param_data = param.mutable_data<T>(PlaceType());
+    RandomVec<T>(numel, grad_data, -2.f, 2.f);
+    RandomVec<T>(numel, mom1_data, -2.f, 2.f);
+    RandomVec<T>(numel, mom2_data, 0.5f, 2.f);
+    RandomVec<T>(numel, param_data, -2.f, 2.f);
+    BenchAllImpls<KernelTuple, PlaceType>(
+        attr, lr, eps, static_cast<int64_t>(numel), grad_data, mom1_data,
+        mom2_data, param_data, mom1_data, mom2_data, param_data, &attr);
+  }
+}
+
+template <typename KernelTuple, typename PlaceType>
+void BenchKernelMomentum() {
+  using T = typename KernelTuple::data_type;
+  const T lr = 0.1;
+  for (bool use_nesterov : {false, true}) {
+    const jit::momentum_attr_t attr(0.9, use_nesterov);
+    for (int numel : {512, 4096, 65536}) {
+      // only benchmark inplace
+      Tensor grad, velocity, param;
+      grad.Resize({numel});
+      velocity.Resize({numel});
+      param.Resize({numel});
+      T* grad_data = grad.mutable_data<T>(PlaceType());
+      T* velocity_data = velocity.mutable_data<T>(PlaceType());
+      T* param_data = param.mutable_data<T>(PlaceType());
+      RandomVec<T>(numel, grad_data, -2.f, 2.f);
+      RandomVec<T>(numel, velocity_data, -2.f, 2.f);
+      RandomVec<T>(numel, param_data, -2.f, 2.f);
+      BenchAllImpls<KernelTuple, PlaceType>(
+          attr, lr, static_cast<int64_t>(numel), grad_data, velocity_data,
+          param_data, velocity_data, param_data, &attr);
+    }
+  }
+}
+
 template <typename KernelTuple, typename PlaceType>
 void BenchKernelMatMul() {
   using T = typename KernelTuple::data_type;
@@ -558,6 +610,8 @@ BENCH_FP32_CPU(EmbSeqPool);
 BENCH_FP32_CPU(MatMul);
 BENCH_FP32_CPU(Softmax);
 BENCH_FP32_CPU(Sgd);
+BENCH_FP32_CPU(Adam);
+BENCH_FP32_CPU(Momentum);
 BENCH_FP32_CPU(VBroadcast);
 
 // Benchmark all jit kernels including jitcode, mkl and refer.
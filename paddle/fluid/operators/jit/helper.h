@@ -283,6 +283,18 @@ inline std::ostream& operator<<(std::ostream& os, const sgd_attr_t& attr) {
   return os;
 }
 
+inline std::ostream& operator<<(std::ostream& os, const adam_attr_t& attr) {
+  os << "beta1[" << attr.beta1 << "],beta2[" << attr.beta2 << "]";
+  return os;
+}
+
+inline std::ostream& operator<<(std::ostream& os,
+                                const momentum_attr_t& attr) {
+  os << "mu[" << attr.mu << "],use_nesterov["
+     << (attr.use_nesterov ? "True" : "False") << "]";
+  return os;
+}
+
 inline std::ostream& operator<<(std::ostream& os, const matmul_attr_t& attr) {
   os << "M[" << attr.m << "],N[" << attr.n << "],K[" << attr.k << "]";
   return os;
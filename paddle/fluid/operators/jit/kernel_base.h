@@ -55,6 +55,9 @@ typedef enum {
   kVSquare,
   kVSub,
   kVTanh,
+  // appended, so that the values above are kept
+  kAdam,
+  kMomentum,
 } KernelType;
 
 typedef enum {
@@ -269,6 +272,43 @@ struct SgdTuple {
                             const sgd_attr_t*);
 };
 
+typedef struct adam_attr_s {
+  float beta1, beta2;
+  adam_attr_s() = default;
+  explicit adam_attr_s(float beta1, float beta2)
+      : beta1(beta1), beta2(beta2) {}
+} adam_attr_t;
+
+// lr, eps, numel, grad, mom1, mom2, param, mom1_out, mom2_out, param_out
+// lr and eps are the ones of the step, already corrected by the bias of the
+// moments
+template <typename T>
+struct AdamTuple {
+  static constexpr KernelType kernel_type = kAdam;
+  typedef T data_type;
+  typedef adam_attr_t attr_type;
+  typedef void (*func_type)(T, T, int64_t, const T*, const T*, const T*,
+                            const T*, T*, T*, T*, const adam_attr_t*);
+};
+
+typedef struct momentum_attr_s {
+  float mu;
+  bool use_nesterov;
+  momentum_attr_s() = default;
+  explicit momentum_attr_s(float mu, bool use_nesterov)
+      : mu(mu), use_nesterov(use_nesterov) {}
+} momentum_attr_t;
+
+// lr, numel, grad, velocity, param, velocity_out, param_out
+template <typename T>
+struct MomentumTuple {
+  static constexpr KernelType kernel_type = kMomentum;
+  typedef T data_type;
+  typedef momentum_attr_t attr_type;
+  typedef void (*func_type)(T, int64_t, const T*, const T*, const T*, T*, T*,
+                            const momentum_attr_t*);
+};
+
 typedef struct matmul_attr_s {
   int m, n, k;
   void* packed_weight{nullptr};
@@ -63,6 +63,17 @@ int64_t JitCodeKey<sgd_attr_t>(const sgd_attr_t& attr) {
   return attr.grad_width;
 }
 
+template <>
+int64_t JitCodeKey<adam_attr_t>(const adam_attr_t& attr) {
+  return XXH64(&attr, sizeof(float) * 2, 0);  // beta1, beta2
+}
+
+template <>
+int64_t JitCodeKey<momentum_attr_t>(const momentum_attr_t& attr) {
+  float keys[2] = {attr.mu, attr.use_nesterov ? 1.f : 0.f};
+  return XXH64(keys, sizeof(float) * 2, 0);
+}
+
 }  // namespace jit
 }  // namespace operators
 }  // namespace paddle
@@ -0,0 +1,79 @@
+/* Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include "paddle/fluid/operators/jit/more/intrinsic/adam.h"
+#include <cmath>
+#include "paddle/fluid/operators/jit/registry.h"
+#include "paddle/fluid/platform/cpu_info.h"
+
+namespace paddle {
+namespace operators {
+namespace jit {
+namespace more {
+namespace intrinsic {
+
+void Adam(float lr, float eps, int64_t numel, const float* grad,
+          const float* mom1, const float* mom2, const float* param,
+          float* mom1_out, float* mom2_out, float* param_out,
+          const adam_attr_t* attr) {
+  const float beta1 = attr->beta1;
+  const float beta2 = attr->beta2;
+  const int64_t end = numel - numel % YMM_FLOAT_BLOCK;
+
+  // every element is read and written once, in one pass over the buffers
+  __m256 beta1_vec = _mm256_set1_ps(beta1);
+  __m256 beta2_vec = _mm256_set1_ps(beta2);
+  __m256 one_sub_beta1_vec = _mm256_set1_ps(1.f - beta1);
+  __m256 one_sub_beta2_vec = _mm256_set1_ps(1.f - beta2);
+  __m256 lr_vec = _mm256_set1_ps(lr);
+  __m256 eps_vec = _mm256_set1_ps(eps);
+  for (int64_t i = 0; i < end; i += YMM_FLOAT_BLOCK) {
+    __m256 g = _mm256_loadu_ps(grad + i);
+    __m256 m1 =
+        _mm256_add_ps(_mm256_mul_ps(beta1_vec, _mm256_loadu_ps(mom1 + i)),
+                      _mm256_mul_ps(one_sub_beta1_vec, g));
+    __m256 m2 =
+        _mm256_add_ps(_mm256_mul_ps(beta2_vec, _mm256_loadu_ps(mom2 + i)),
+                      _mm256_mul_ps(_mm256_mul_ps(one_sub_beta2_vec, g), g));
+    _mm256_storeu_ps(mom1_out + i, m1);
+    _mm256_storeu_ps(mom2_out + i, m2);
+    __m256 step =
+        _mm256_div_ps(m1, _mm256_add_ps(_mm256_sqrt_ps(m2), eps_vec));
+    _mm256_storeu_ps(param_out + i,
+                     _mm256_sub_ps(_mm256_loadu_ps(param + i),
+                                   _mm256_mul_ps(lr_vec, step)));
+  }
+  for (int64_t i = end; i < numel; ++i) {
+    const float g = grad[i];
+    const float m1 = beta1 * mom1[i] + (1.f - beta1) * g;
+    const float m2 = beta2 * mom2[i] + (1.f - beta2) * g * g;
+    mom1_out[i] = m1;
+    mom2_out[i] = m2;
+    param_out[i] = param[i] - lr * (m1 / (std::sqrt(m2) + eps));
+  }
+}
+
+bool AdamKernel::CanBeUsed(const adam_attr_t& attr) const {
+  return platform::MayIUse(platform::avx);
+}
+
+}  // namespace intrinsic
+}  // namespace more
+}  // namespace jit
+}  // namespace operators
+}  // namespace paddle
+
+namespace intrinsic = paddle::operators::jit::more::intrinsic;
+
+REGISTER_JITKERNEL_MORE(kAdam, intrinsic, intrinsic::AdamKernel);
@@ -0,0 +1,75 @@
+/* Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License. */
+
+#include "paddle/fluid/operators/jit/more/intrinsic/momentum.h"
+#include "paddle/fluid/operators/jit/registry.h"
+#include "paddle/fluid/platform/cpu_info.h"
+
+namespace paddle {
+namespace operators {
+namespace jit {
+namespace more {
+namespace intrinsic {
+
+void Momentum(float lr, int64_t numel, const float* grad, const float* velocity,
+              const float* param, float* velocity_out, float* param_out,
+              const momentum_attr_t* attr) {
+  const float mu = attr->mu;
+  const int64_t end = numel - numel % YMM_FLOAT_BLOCK;
+
+  __m256 mu_vec = _mm256_set1_ps(mu);
+  __m256 lr_vec = _mm256_set1_ps(lr);
+  if (attr->use_nesterov) {
+    for (int64_t i = 0; i < end; i += YMM_FLOAT_BLOCK) {
+      __m256 g = _mm256_loadu_ps(grad + i);
+      __m256 v = _mm256_add_ps(
+          _mm256_mul_ps(_mm256_loadu_ps(velocity + i), mu_vec), g);
+      _mm256_storeu_ps(velocity_out + i, v);
+      __m256 step = _mm256_mul_ps(_mm256_add_ps(g, _mm256_mul_ps(v, mu_vec)),
+                                  lr_vec);
+      _mm256_storeu_ps(param_out + i,
+                       _mm256_sub_ps(_mm256_loadu_ps(param + i), step));
+    }
+  } else {
+    for (int64_t i = 0; i < end; i += YMM_FLOAT_BLOCK) {
+      __m256 v =
+          _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(velocity + i), mu_vec),
+                        _mm256_loadu_ps(grad + i));
+      _mm256_storeu_ps(velocity_out + i, v);
+      _mm256_storeu_ps(param_out + i,
+                       _mm256_sub_ps(_mm256_loadu_ps(param + i),
+                                     _mm256_mul_ps(lr_vec, v)));
+    }
+  }
+  for (int64_t i = end; i < numel; ++i) {
+    const float v = velocity[i] * mu + grad[i];
+    velocity_out[i] = v;
+    param_out[i] = attr->use_nesterov ? param[i] - (grad[i] + v * mu) * lr
+                                      : param[i] - lr * v;
+  }
+}
+
+bool MomentumKernel::CanBeUsed(const momentum_attr_t& attr) const {
+  return platform::MayIUse(platform::avx);
+}
+
+}  // namespace intrinsic
+}  // namespace more
+}  // namespace jit
+}  // namespace operators
+}  // namespace paddle
+
+namespace intrinsic = paddle::operators::jit::more::intrinsic;
+
+REGISTER_JITKERNEL_MORE(kMomentum, intrinsic, intrinsic::MomentumKernel);
@@ -552,6 +552,51 @@ void Sgd(const T* lr, const T* param, const T* grad, const int64_t* rows,
   }
 }
 
+// Adam algorithm, on numel elements:
+// mom1_out = beta1 * mom1 + (1 - beta1) * grad
+// mom2_out = beta2 * mom2 + (1 - beta2) * grad * grad
+// param_out = param - lr * mom1_out / (sqrt(mom2_out) + eps)
+// where lr and eps already carry the bias correction of the step
+template <typename T>
+void Adam(T lr, T eps, int64_t numel, const T* grad, const T* mom1,
+          const T* mom2, const T* param, T* mom1_out, T* mom2_out,
+          T* param_out, const adam_attr_t* attr) {
+  const T beta1 = static_cast<T>(attr->beta1);
+  const T beta2 = static_cast<T>(attr->beta2);
+  for (int64_t i = 0; i < numel; ++i) {
+    const T g = grad[i];
+    const T m1 = beta1 * mom1[i] + (1 - beta1) * g;
+    const T m2 = beta2 * mom2[i] + (1 - beta2) * g * g;
+    mom1_out[i] = m1;
+    mom2_out[i] = m2;
+    param_out[i] = param[i] - lr * (m1 / (std::sqrt(m2) + eps));
+  }
+}
+
+// Momentum algorithm, on numel elements:
+// velocity_out = mu * velocity + grad
+// param_out = param - lr * (grad + mu * velocity_out), with use_nesterov
+// param_out = param - lr * velocity_out, otherwise
+template <typename T>
+void Momentum(T lr, int64_t numel, const T* grad, const T* velocity,
+              const T* param, T* velocity_out, T* param_out,
+              const momentum_attr_t* attr) {
+  const T mu = static_cast<T>(attr->mu);
+  if (attr->use_nesterov) {
+    for (int64_t i = 0; i < numel; ++i) {
+      const T v = velocity[i] * mu + grad[i];
+      velocity_out[i] = v;
+      param_out[i] = param[i] - (grad[i] + v * mu) * lr;
+    }
+  } else {
+    for (int64_t i = 0; i < numel; ++i) {
+      const T v = velocity[i] * mu + grad[i];
+      velocity_out[i] = v;
+      param_out[i] = param[i] - lr * v;
+    }
+  }
+}
+
 #define DECLARE_REFER_KERNEL(name)                          \
   template <typename T>                                     \
   class name##Kernel : public ReferKernel<name##Tuple<T>> { \
@@ -604,6 +649,8 @@ DECLARE_REFER_KERNEL(MatMul);
 DECLARE_REFER_KERNEL(Softmax);
 DECLARE_REFER_KERNEL(EmbSeqPool);
 DECLARE_REFER_KERNEL(Sgd);
+DECLARE_REFER_KERNEL(Adam);
+DECLARE_REFER_KERNEL(Momentum);
 DECLARE_REFER_KERNEL(VBroadcast);
 
 #undef DECLARE_REFER_KERNEL
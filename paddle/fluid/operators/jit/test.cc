@@ -939,6 +939,107 @@ void TestKernelSgd() {
   }
 }
 
+template <typename KernelTuple, typename PlaceType>
+void TestKernelAdam() {
+  using T = typename KernelTuple::data_type;
+  VLOG(10) << "Test JITKernel: " << jit::to_string(KernelTuple::kernel_type);
+  const T lr = 0.1;
+  const T eps = 1e-8;
+  jit::adam_attr_t attr(0.9, 0.999);
+  for (int numel : TestSizes()) {
+    std::vector<T> grad(numel), mom1(numel), mom2(numel), param(numel);
+    RandomVec<T>(numel, grad.data());
+    RandomVec<T>(numel, mom1.data());
+    RandomVec<T>(numel, mom2.data(), static_cast<T>(0.5f));
+    RandomVec<T>(numel, param.data());
+
+    std::vector<T> mom1_ref(numel), mom2_ref(numel), param_ref(numel);
+    auto ref = jit::GetReferFunc<KernelTuple>();
+    EXPECT_TRUE(ref != nullptr);
+    ref(lr, eps, numel, grad.data(), mom1.data(), mom2.data(), param.data(),
+        mom1_ref.data(), mom2_ref.data(), param_ref.data(), &attr);
+
+    auto verifier = [](
+        const typename KernelTuple::func_type tgt, const T lr, const T eps,
+        const std::vector<T>& grad, const std::vector<T>& mom1,
+        const std::vector<T>& mom2, const std::vector<T>& param,
+        const std::vector<T>& mom1_ref, const std::vector<T>& mom2_ref,
+        const std::vector<T>& param_ref,
+        const typename KernelTuple::attr_type& attr) {
+      EXPECT_TRUE(tgt != nullptr);
+      int64_t numel = grad.size();
+      std::vector<T> mom1_out(numel), mom2_out(numel), param_out(numel);
+      tgt(lr, eps, numel, grad.data(), mom1.data(), mom2.data(), param.data(),
+          mom1_out.data(), mom2_out.data(), param_out.data(), &attr);
+      ExpectEQ<T>(mom1_out.data(), mom1_ref.data(), numel);
+      ExpectEQ<T>(mom2_out.data(), mom2_ref.data(), numel);
+      ExpectEQ<T>(param_out.data(), param_ref.data(), numel);
+
+      // inplace
+      std::copy(mom1.begin(), mom1.end(), mom1_out.begin());
+      std::copy(mom2.begin(), mom2.end(), mom2_out.begin());
+      std::copy(param.begin(), param.end(), param_out.begin());
+      tgt(lr, eps, numel, grad.data(), mom1_out.data(), mom2_out.data(),
+          param_out.data(), mom1_out.data(), mom2_out.data(),
+          param_out.data(), &attr);
+      ExpectEQ<T>(mom1_out.data(), mom1_ref.data(), numel);
+      ExpectEQ<T>(mom2_out.data(), mom2_ref.data(), numel);
+      ExpectEQ<T>(param_out.data(), param_ref.data(), numel);
+    };
+    TestAllImpls<KernelTuple, PlaceType>(attr, verifier, lr, eps, grad, mom1,
+                                         mom2, param, mom1_ref, mom2_ref,
+                                         param_ref, attr);
+  }
+}
+
+template <typename KernelTuple, typename PlaceType>
+void TestKernelMomentum() {
+  using T = typename KernelTuple::data_type;
+  VLOG(10) << "Test JITKernel: " << jit::to_string(KernelTuple::kernel_type);
+  const T lr = 0.1;
+  for (bool use_nesterov : {false, true}) {
+    jit::momentum_attr_t attr(0.9, use_nesterov);
+    for (int numel : TestSizes()) {
+      std::vector<T> grad(numel), velocity(numel), param(numel);
+      RandomVec<T>(numel, grad.data());
+      RandomVec<T>(numel, velocity.data());
+      RandomVec<T>(numel, param.data());
+
+      std::vector<T> velocity_ref(numel), param_ref(numel);
+      auto ref = jit::GetReferFunc<KernelTuple>();
+      EXPECT_TRUE(ref != nullptr);
+      ref(lr, numel, grad.data(), velocity.data(), param.data(),
+          velocity_ref.data(), param_ref.data(), &attr);
+
+      auto verifier = [](
+          const typename KernelTuple::func_type tgt, const T lr,
+          const std::vector<T>& grad, const std::vector<T>& velocity,
+          const std::vector<T>& param, const std::vector<T>& velocity_ref,
+          const std::vector<T>& param_ref,
+          const typename KernelTuple::attr_type& attr) {
+        EXPECT_TRUE(tgt != nullptr);
+        int64_t numel = grad.size();
+        std::vector<T> velocity_out(numel), param_out(numel);
+        tgt(lr, numel, grad.data(), velocity.data(), param.data(),
+            velocity_out.data(), param_out.data(), &attr);
+        ExpectEQ<T>(velocity_out.data(), velocity_ref.data(), numel);
+        ExpectEQ<T>(param_out.data(), param_ref.data(), numel);
+
+        // inplace
+        std::copy(velocity.begin(), velocity.end(), velocity_out.begin());
+        std::copy(param.begin(), param.end(), param_out.begin());
+        tgt(lr, numel, grad.data(), velocity_out.data(), param_out.data(),
+            velocity_out.data(), param_out.data(), &attr);
+        ExpectEQ<T>(velocity_out.data(), velocity_ref.data(), numel);
+        ExpectEQ<T>(param_out.data(), param_ref.data(), numel);
+      };
+      TestAllImpls<KernelTuple, PlaceType>(attr, verifier, lr, grad, velocity,
+                                           param, velocity_ref, param_ref,
+                                           attr);
+    }
+  }
+}
+
 template <typename KernelTuple, typename PlaceType>
 void TestKernelVBroadcast() {
   using T = typename KernelTuple::data_type;
@@ -1134,12 +1235,14 @@ TEST(JITKernel_helper, pack_weights) {
 TEST(JITKernel_helper, attr) {
   std::ostringstream out;
   // KernelTypes
-  out << jit::to_string(jit::kNone) << jit::to_string(jit::kCRFDecoding)
+  out << jit::to_string(jit::kNone) << jit::to_string(jit::kAdam)
+      << jit::to_string(jit::kCRFDecoding)
       << jit::to_string(jit::kEmbSeqPool) << jit::to_string(jit::kGRUH1)
       << jit::to_string(jit::kGRUHtPart1) << jit::to_string(jit::kGRUHtPart2)
       << jit::to_string(jit::kHSum) << jit::to_string(jit::kHMax)
       << jit::to_string(jit::kLSTMCtHt) << jit::to_string(jit::kLSTMC1H1)
       << jit::to_string(jit::kLayerNorm) << jit::to_string(jit::kMatMul)
+      << jit::to_string(jit::kMomentum)
       << jit::to_string(jit::kNCHW16CMulNC) << jit::to_string(jit::kSeqPool)
       << jit::to_string(jit::kSoftmax) << jit::to_string(jit::kVAdd)
       << jit::to_string(jit::kVAddBias) << jit::to_string(jit::kVAddRelu)
@@ -1149,7 +1252,7 @@ TEST(JITKernel_helper, attr) {
       << jit::to_string(jit::kVScal) << jit::to_string(jit::kSgd)
       << jit::to_string(jit::kVSigmoid) << jit::to_string(jit::kVSquare)
       << jit::to_string(jit::kVSub) << jit::to_string(jit::kVTanh);
-  EXPECT_EQ(out.str().size(), 234UL);
+  EXPECT_EQ(out.str().size(), 248UL);
 
   // SeqPoolTypes
   out.str("");
@@ -1183,6 +1286,14 @@ TEST(JITKernel_helper, attr) {
   out << jit::sgd_attr_t(1, 2, 3, 4, 5);
   EXPECT_EQ(out.str().size(), 81UL);
 
+  out.str("");
+  out << jit::adam_attr_t(0.5, 0.25);
+  EXPECT_EQ(out.str().size(), 23UL);
+
+  out.str("");
+  out << jit::momentum_attr_t(0.5, true);
+  EXPECT_EQ(out.str().size(), 26UL);
+
   out.str("");
   out << jit::matmul_attr_t(1, 2, 3);
   EXPECT_EQ(out.str().size(), 14UL);
@@ -1316,6 +1427,40 @@ TEST(JITKernel_key, sgd) {
   EXPECT_TRUE(key4 != key5);
 }
 
+TEST(JITKernel_key, adam) {
+  jit::adam_attr_t attr1(0.9, 0.999);
+  jit::adam_attr_t attr2(0.9, 0.999);
+  jit::adam_attr_t attr3(0.9, 0.99);
+  jit::adam_attr_t attr4(0.8, 0.999);
+
+  auto key1 = jit::JitCodeKey<jit::adam_attr_t>(attr1);
+  auto key2 = jit::JitCodeKey<jit::adam_attr_t>(attr2);
+  auto key3 = jit::JitCodeKey<jit::adam_attr_t>(attr3);
+  auto key4 = jit::JitCodeKey<jit::adam_attr_t>(attr4);
+
+  EXPECT_TRUE(key1 == key2);
+  EXPECT_TRUE(key2 != key3);
+  EXPECT_TRUE(key2 != key4);
+  EXPECT_TRUE(key3 != key4);
+}
+
+TEST(JITKernel_key, momentum) {
+  jit::momentum_attr_t attr1(0.9, false);
+  jit::momentum_attr_t attr2(0.9, false);
+  jit::momentum_attr_t attr3(0.9, true);
+  jit::momentum_attr_t attr4(0.8, false);
+
+  auto key1 = jit::JitCodeKey<jit::momentum_attr_t>(attr1);
+  auto key2 = jit::JitCodeKey<jit::momentum_attr_t>(attr2);
+  auto key3 = jit::JitCodeKey<jit::momentum_attr_t>(attr3);
+  auto key4 = jit::JitCodeKey<jit::momentum_attr_t>(attr4);
+
+  EXPECT_TRUE(key1 == key2);
+  EXPECT_TRUE(key2 != key3);
+  EXPECT_TRUE(key2 != key4);
+  EXPECT_TRUE(key3 != key4);
+}
+
 // test kernerls
 #define TestKernelVMul TestKernelXYZN
 #define TestKernelVAdd TestKernelXYZN
@@ -1384,6 +1529,8 @@ TEST_CPU_KERNEL(EmbSeqPool);
 TEST_CPU_KERNEL(MatMul);
 TEST_CPU_KERNEL(Softmax);
 TEST_CPU_KERNEL(Sgd);
+TEST_CPU_KERNEL(Adam);
+TEST_CPU_KERNEL(Momentum);
 TEST_CPU_KERNEL(VBroadcast);
 
 TEST_CPU_KERNEL(StrideASum);
@@ -15,11 +15,13 @@ limitations under the License. */
 #pragma once
 #include <math.h>  // for sqrt in CPU and CUDA
 #include <Eigen/Dense>
+#include <algorithm>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include "paddle/fluid/framework/op_registry.h"
 #include "paddle/fluid/framework/threadpool.h"
+#include "paddle/fluid/operators/jit/kernels.h"
 #include "paddle/fluid/operators/math/algorithm.h"
 #include "paddle/fluid/operators/math/selected_rows_functor.h"
 #include "paddle/fluid/platform/for_range.h"
@@ -122,75 +124,6 @@ class AdamFunctor<T, GPUAdam> {
   }
 };
 
-template <typename T>
-class AdamFunctor<T, CPUAdam> {
- private:
-  T beta1_;
-  T beta2_;
-  T epsilon_;
-
-  const T* beta1_pow_;
-  const T* beta2_pow_;
-  const T* moment1_;
-  T* moment1_out_;
-  const T* moment2_;
-  T* moment2_out_;
-  const T* lr_;
-  const T* grad_;
-  const T* param_;
-  T* param_out_;
-
- public:
-  AdamFunctor(T beta1, T beta2, T epsilon, const T* beta1_pow,
-              const T* beta2_pow, const T* mom1, T* mom1_out, const T* mom2,
-              T* mom2_out, const T* lr, const T* grad, const T* param,
-              T* param_out)
-      : beta1_(beta1),
-        beta2_(beta2),
-        epsilon_(epsilon),
-        beta1_pow_(beta1_pow),
-        beta2_pow_(beta2_pow),
-        moment1_(mom1),
-        moment1_out_(mom1_out),
-        moment2_(mom2),
-        moment2_out_(mom2_out),
-        lr_(lr),
-        grad_(grad),
-        param_(param),
-        param_out_(param_out) {}
-
-  void operator()(size_t numel) const {
-    Eigen::Map<const Eigen::Array<T, 1, Eigen::Dynamic>> g{
-        grad_, static_cast<Eigen::Index>(numel)};
-    Eigen::Map<const Eigen::Array<T, 1, Eigen::Dynamic>> mom1{
-        moment1_, static_cast<Eigen::Index>(numel)};
-    Eigen::Map<const Eigen::Array<T, 1, Eigen::Dynamic>> mom2{
-        moment2_, static_cast<Eigen::Index>(numel)};
-    Eigen::Map<const Eigen::Array<T, 1, Eigen::Dynamic>> param{
-        param_, static_cast<Eigen::Index>(numel)};
-
-    Eigen::Map<Eigen::Array<T, 1, Eigen::Dynamic>> param_out{
-        param_out_, static_cast<Eigen::Index>(numel)};
-    Eigen::Map<Eigen::Array<T, 1, Eigen::Dynamic>> moment1_out{
-        moment1_out_, static_cast<Eigen::Index>(numel)};
-    Eigen::Map<Eigen::Array<T, 1, Eigen::Dynamic>> moment2_out{
-        moment2_out_, static_cast<Eigen::Index>(numel)};
-
-    T lr = *lr_;
-    T beta1_pow = *beta1_pow_;
-    T beta2_pow = *beta2_pow_;
-
-    // Calculation
-    lr *= sqrt(1 - beta2_pow) / (1 - beta1_pow);
-
-    moment1_out = beta1_ * mom1 + (1 - beta1_) * g;
-    moment2_out = beta2_ * mom2 + (1 - beta2_) * g * g;
-    param_out = param -
-                lr * (moment1_out /
-                      (moment2_out.sqrt() + epsilon_ * sqrt(1 - beta2_pow)));
-  }
-};
-
 template <typename T, typename Flavour, typename MT = T>
 class SparseAdamFunctor;
 
@@ -506,13 +439,38 @@ class AdamOpKernel : public framework::OpKernel<T> {
     if (grad_var->IsType<framework::LoDTensor>()) {
       auto* grad = ctx.Input<LoDTensor>("Grad");
 
-      AdamFunctor<T, CPUAdam> functor(
-          beta1, beta2, epsilon, beta1_pow->data<T>(), beta2_pow->data<T>(),
-          mom1->data<T>(), mom1_out->mutable_data<T>(ctx.GetPlace()),
-          mom2->data<T>(), mom2_out->mutable_data<T>(ctx.GetPlace()),
-          lr->data<T>(), grad->data<T>(), param->data<T>(),
-          param_out->mutable_data<T>(ctx.GetPlace()));
-      functor(param->numel());
+      T beta1_p = beta1_pow->data<T>()[0];
+      T beta2_p = beta2_pow->data<T>()[0];
+      T lr_t = lr->data<T>()[0] * sqrt(1 - beta2_p) / (1 - beta1_p);
+      T eps_t = epsilon * sqrt(1 - beta2_p);
+
+      const T* grad_ptr = grad->data<T>();
+      const T* mom1_ptr = mom1->data<T>();
+      const T* mom2_ptr = mom2->data<T>();
+      const T* param_ptr = param->data<T>();
+      T* mom1_out_ptr = mom1_out->mutable_data<T>(ctx.GetPlace());
+      T* mom2_out_ptr = mom2_out->mutable_data<T>(ctx.GetPlace());
+      T* param_out_ptr = param_out->mutable_data<T>(ctx.GetPlace());
+
+      // After fuse_adam_op_pass, Param holds all the parameters of the
+      // program in one buffer, which is updated by chunks in parallel.
+      jit::adam_attr_t attr(beta1, beta2);
+      auto adam =
+          jit::KernelFuncs<jit::AdamTuple<T>, platform::CPUPlace>::Cache().At(
+              attr);
+      const int64_t chunk_size = 4096;
+      int64_t numel = param->numel();
+      int64_t chunk_num = (numel + chunk_size - 1) / chunk_size;
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for
+#endif
+      for (int64_t i = 0; i < chunk_num; ++i) {
+        int64_t offset = i * chunk_size;
+        int64_t size = std::min(chunk_size, numel - offset);
+        adam(lr_t, eps_t, size, grad_ptr + offset, mom1_ptr + offset,
+             mom2_ptr + offset, param_ptr + offset, mom1_out_ptr + offset,
+             mom2_out_ptr + offset, param_out_ptr + offset, &attr);
+      }
       if (!use_global_beta_pow) {
         beta1_pow_out->mutable_data<T>(ctx.GetPlace())[0] =
             beta1 * beta1_pow->data<T>()[0];
@@ -13,11 +13,13 @@ See the License for the specific language governing permissions and
 limitations under the License. */
 
 #pragma once
+#include <algorithm>
 #include <memory>
 #include <string>
 #include "paddle/fluid/framework/eigen.h"
 #include "paddle/fluid/framework/op_registry.h"
 #include "paddle/fluid/operators/amp/fp16_type_traits.h"
+#include "paddle/fluid/operators/jit/kernels.h"
 #include "paddle/fluid/operators/math/algorithm.h"
 #include "paddle/fluid/operators/math/selected_rows_functor.h"
 #include "paddle/fluid/platform/float16.h"
@@ -157,18 +159,42 @@ class CPUDenseMomentumFunctor {
                   const RegularizationType regularization_flag,
                   const T regularization_coeff, Tensor* param_out,
                   Tensor* velocity_out) {
-    auto grad_vec = framework::EigenVector<T>::Flatten(*grad);
     auto* lr = learning_rate->data<MultiPrecisionType<T>>();
 
-    details::CPUDenseUpdater<T> updater;
     if (regularization_flag == RegularizationType::kL2DECAY) {
+      details::CPUDenseUpdater<T> updater;
+      auto grad_vec = framework::EigenVector<T>::Flatten(*grad);
       auto param_vec = framework::EigenVector<T>::Flatten(*param);
       updater(*param, *velocity, mu, static_cast<T>(lr[0]), use_nesterov,
               param_vec * regularization_coeff + grad_vec, param_out,
               velocity_out);
-    } else {
-      updater(*param, *velocity, mu, static_cast<T>(lr[0]), use_nesterov,
-              grad_vec, param_out, velocity_out);
+      return;
+    }
+
+    // After fuse_momentum_op_pass, Param holds all the parameters of the
+    // program in one buffer, which is updated by chunks in parallel.
+    jit::momentum_attr_t attr(mu, use_nesterov);
+    auto momentum =
+        jit::KernelFuncs<jit::MomentumTuple<T>, platform::CPUPlace>::Cache().At(
+            attr);
+    const T lr_t = static_cast<T>(lr[0]);
+    const T* grad_ptr = grad->data<T>();
+    const T* velocity_ptr = velocity->data<T>();
+    const T* param_ptr = param->data<T>();
+    T* velocity_out_ptr = velocity_out->data<T>();
+    T* param_out_ptr = param_out->data<T>();
+    const int64_t chunk_size = 4096;
+    int64_t numel = param->numel();
+    int64_t chunk_num = (numel + chunk_size - 1) / chunk_size;
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for
+#endif
+    for (int64_t i = 0; i < chunk_num; ++i) {
+      int64_t offset = i * chunk_size;
+      int64_t size = std::min(chunk_size, numel - offset);
+      momentum(lr_t, size, grad_ptr + offset, velocity_ptr + offset,
+               param_ptr + offset, velocity_out_ptr + offset,
+               param_out_ptr + offset, &attr);
     }
   }
 };
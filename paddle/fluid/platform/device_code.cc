@@ -13,14 +13,23 @@ See the License for the specific language governing permissions and
 limitations under the License. */
 
 #include <sys/stat.h>
+#ifndef _WIN32
+#include <dlfcn.h>
+#include <unistd.h>
+#endif
 #include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <set>
+#include <sstream>
 #include <utility>
 
 #include "paddle/fluid/platform/device_code.h"
 #include "paddle/fluid/platform/enforce.h"
 
 DECLARE_string(cuda_dir);
+DECLARE_string(jit_cxx);
 
 namespace paddle {
 namespace platform {
@@ -65,27 +74,140 @@ DeviceCodePool::DeviceCodePool(const std::vector<platform::Place>& places) {
                     errors::InvalidArgument(
                         "Expected the number of places >= 1. But received %d.",
                         places.size()));
+  AddPlaces(places);
+}
+
+void DeviceCodePool::AddPlaces(const std::vector<platform::Place>& places) {
   // Remove the duplicated places
   std::set<Place> set;
   for (auto& p : places) {
-    set.insert(p);
+    if (device_codes_.find(p) == device_codes_.end()) {
+      set.insert(p);
+    }
   }
   for (auto& p : set) {
     if (is_gpu_place(p)) {
 #if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
       device_codes_.emplace(p, DeviceCodeMap());
+      CUDADeviceCode::CheckAvailableStatus();
 #else
       PADDLE_THROW(platform::errors::PreconditionNotMet(
           "CUDAPlace or HIPPlace is not supported, please re-compile with "
           "WITH_GPU=ON or WITH_ROCM=ON."));
+#endif
+    } else if (is_cpu_place(p)) {
+#ifndef _WIN32
+      device_codes_.emplace(p, DeviceCodeMap());
 #endif
     }
   }
+}
 
-#if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
-  CUDADeviceCode::CheckAvailableStatus();
+#ifndef _WIN32
+bool CPUDeviceCode::IsAvailable() {
+  static bool available = [] {
+    std::string command = FLAGS_jit_cxx + " --version > /dev/null 2>&1";
+    if (std::system(command.c_str()) != 0) {
+      LOG(WARNING) << "The host compiler " << FLAGS_jit_cxx
+                   << " is needed for JIT compiling of CPU code, please "
+                      "specify it by export FLAGS_jit_cxx=xxx.";
+      return false;
+    }
+    return true;
+  }();
+  return available;
+}
+
+CPUDeviceCode::CPUDeviceCode(const Place& place, const std::string& name,
+                             const std::string& kernel) {
+  if (!is_cpu_place(place)) {
+    PADDLE_THROW(platform::errors::PermissionDenied(
+        "CPUDeviceCode can only launch on CPU place."));
+  }
+
+  place_ = place;
+  name_ = name;
+  kernel_ = kernel;
+}
+
+CPUDeviceCode::~CPUDeviceCode() {
+  if (handle_ != nullptr) {
+    dlclose(handle_);
+  }
+}
+
+bool CPUDeviceCode::Compile(bool include_path) {
+  is_compiled_ = false;
+  if (!IsAvailable()) {
+    return false;
+  }
+
+  const char* tmp_dir = std::getenv("TMPDIR");
+  std::string dir = std::string(tmp_dir && *tmp_dir ? tmp_dir : "/tmp") +
+                    "/paddle_jit_XXXXXX";
+  if (mkdtemp(&dir[0]) == nullptr) {
+    LOG(WARNING) << "Cannot create the directory to compile " << name_;
+    return false;
+  }
+  std::string source = dir + "/" + name_ + ".cc";
+  std::string library = dir + "/" + name_ + ".so";
+  std::string log = dir + "/" + name_ + ".log";
+  std::ofstream(source) << kernel_;
+
+  // The kernel is compiled for the host running it, and the math functions
+  // are vectorized when they do not set errno.
+  std::string command = FLAGS_jit_cxx +
+                        " -std=c++11 -O3 -march=native -fno-math-errno "
+                        "-fopenmp-simd -fPIC -shared -o '" +
+                        library + "' '" + source + "' > '" + log + "' 2>&1";
+  if (std::system(command.c_str()) != 0) {
+    std::stringstream compile_log;
+    compile_log << std::ifstream(log).rdbuf();
+    LOG(WARNING) << "JIT compiling of CPU code failed:"
+                 << "\n  Kernel name: " << name_ << "\n  Kernel body:\n"
+                 << kernel_ << "\n  Compiling log: " << compile_log.str();
+  } else {
+    handle_ = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (handle_ == nullptr) {
+      LOG(WARNING) << "Cannot load the compiled code of " << name_ << ": "
+                   << dlerror();
+    } else {
+      function_ = reinterpret_cast<KernelFunc>(dlsym(handle_, name_.c_str()));
+      if (function_ == nullptr) {
+        LOG(WARNING) << "Cannot find the kernel " << name_
+                     << " in the compiled code: " << dlerror();
+      } else {
+        is_compiled_ = true;
+      }
+    }
+  }
+
+  // The library stays mapped after removed.
+  for (auto& file : {source, library, log}) {
+    std::remove(file.c_str());
+  }
+  rmdir(dir.c_str());
+  return is_compiled_;
+}
+
+void CPUDeviceCode::Launch(const size_t n, std::vector<void*>* args) const {
+  PADDLE_ENFORCE_EQ(
+      is_compiled_, true,
+      errors::PreconditionNotMet(
+          "Please compile the code before launching the kernel."));
+
+  void** kernel_args = args->data();
+  size_t workload = std::max(workload_per_thread_, 1);
+  int64_t num_parts = (n + workload - 1) / workload;
+#ifdef PADDLE_WITH_MKLML
+#pragma omp parallel for
 #endif
+  for (int64_t i = 0; i < num_parts; ++i) {
+    size_t begin = i * workload;
+    function_(begin, std::min(n, begin + workload), kernel_args);
+  }
 }
+#endif
 
 #if defined(PADDLE_WITH_CUDA) || defined(PADDLE_WITH_HIP)
 #ifdef PADDLE_WITH_HIP
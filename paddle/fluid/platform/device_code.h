@@ -88,6 +88,36 @@ class CUDADeviceCode : public DeviceCode {
 };
 #endif
 
+#ifndef _WIN32
+// Compiles the code by the host compiler into a shared library. The kernel
+// is called as
+//   extern "C" void name(size_t begin, size_t end, void** args);
+// for the parts of [0, n), in parallel when launched.
+class CPUDeviceCode : public DeviceCode {
+ public:
+  explicit CPUDeviceCode(const Place& place, const std::string& name,
+                         const std::string& kernel);
+  ~CPUDeviceCode();
+  bool Compile(bool include_path = false) override;
+  void Launch(const size_t n, std::vector<void*>* args) const override;
+
+  void SetWorkloadPerThread(int workload_per_thread) {
+    workload_per_thread_ = workload_per_thread;
+  }
+
+  static bool IsAvailable();
+
+ private:
+  using KernelFunc = void (*)(size_t, size_t, void**);
+
+  bool is_compiled_{false};
+  // The elements computed by a call of the kernel.
+  int workload_per_thread_{16384};
+  void* handle_{nullptr};
+  KernelFunc function_{nullptr};
+};
+#endif
+
 class DeviceCodePool {
  public:
   using DeviceCodeMap =
@@ -106,6 +136,8 @@ class DeviceCodePool {
   static DeviceCodePool& Init(const std::vector<platform::Place>& places) {
     if (pool == nullptr) {
       pool = new DeviceCodePool(places);
+    } else {
+      pool->AddPlaces(places);
     }
     return *pool;
   }
@@ -124,6 +156,8 @@ class DeviceCodePool {
   }
 
  private:
+  void AddPlaces(const std::vector<platform::Place>& places);
+
   static DeviceCodePool* pool;
   std::map<Place, DeviceCodeMap> device_codes_;
   DISABLE_COPY_AND_ASSIGN(DeviceCodePool);
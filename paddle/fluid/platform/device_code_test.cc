@@ -123,3 +123,79 @@ TEST(DeviceCodePool, cuda) {
   LOG(INFO) << "get ptr: " << code_get;
 }
 #endif
+
+#ifndef _WIN32
+constexpr auto cpu_saxpy_code = R"(
+#include <cstddef>
+extern "C" void saxpy_kernel(size_t begin, size_t end, void** args) {
+  float a = *static_cast<float*>(args[0]);
+  float* x = *static_cast<float**>(args[1]);
+  float* y = *static_cast<float**>(args[2]);
+  float* z = *static_cast<float**>(args[3]);
+  for (size_t i = begin; i < end; ++i) {
+    z[i] = a * x[i] + y[i];
+  }
+}
+)";
+
+TEST(DeviceCode, cpu) {
+  if (!paddle::platform::CPUDeviceCode::IsAvailable()) {
+    return;
+  }
+
+  paddle::platform::CPUPlace place;
+  paddle::platform::CPUDeviceCode code(place, "saxpy_kernel", cpu_saxpy_code);
+
+  paddle::framework::Tensor x;
+  paddle::framework::Tensor y;
+  paddle::framework::Tensor z;
+
+  float scale = 2;
+  auto dims = paddle::framework::make_ddim({100, 1000});
+  float* x_data = x.mutable_data<float>(dims, place);
+  float* y_data = y.mutable_data<float>(dims, place);
+  float* z_data = z.mutable_data<float>(dims, place);
+
+  size_t n = x.numel();
+  for (size_t i = 0; i < n; ++i) {
+    x_data[i] = static_cast<float>(i);
+    y_data[i] = static_cast<float>(0.5);
+  }
+
+  EXPECT_EQ(code.Compile(), true);
+
+  std::vector<void*> args = {&scale, &x_data, &y_data, &z_data};
+  code.SetWorkloadPerThread(1000);
+  code.Launch(n, &args);
+
+  for (size_t i = 0; i < n; i++) {
+    EXPECT_EQ(z_data[i], static_cast<float>(i) * scale + 0.5);
+  }
+}
+
+TEST(DeviceCode, cpu_compile_error) {
+  if (!paddle::platform::CPUDeviceCode::IsAvailable()) {
+    return;
+  }
+
+  paddle::platform::CPUDeviceCode code(paddle::platform::CPUPlace(),
+                                       "bad_kernel", "not c++ code");
+  EXPECT_EQ(code.Compile(), false);
+  std::vector<void*> args;
+  EXPECT_ANY_THROW(code.Launch(1, &args));
+}
+
+TEST(DeviceCodePool, cpu) {
+  paddle::platform::CPUPlace place;
+  paddle::platform::DeviceCodePool& pool =
+      paddle::platform::DeviceCodePool::Init({place});
+  size_t num_device_codes_before = pool.size(place);
+
+  std::unique_ptr<paddle::platform::DeviceCode> code(
+      new paddle::platform::CPUDeviceCode(place, "saxpy_kernel",
+                                          cpu_saxpy_code));
+  pool.Set(std::move(code));
+  EXPECT_EQ(pool.size(place), num_device_codes_before + 1);
+  EXPECT_NE(pool.Get(place, "saxpy_kernel"), nullptr);
+}
+#endif
@@ -356,7 +356,8 @@ PADDLE_DEFINE_EXPORTED_double(
  * Allocator related FLAG
  * Name: FLAGS_allocator_strategy
  * Since Version: 1.2
- * Value Range: string, {naive_best_fit, auto_growth, thread_local},
+ * Value Range: string, {naive_best_fit, auto_growth, thread_local,
+ *              thread_caching},
  * default=auto_growth
  * Example:
  * Note: For selecting allocator policy of PaddlePaddle.
@@ -378,7 +379,9 @@ PADDLE_DEFINE_EXPORTED_string(
     "size of models may be larger). auto_growth strategy would allocate "
     "GPU memory on demand, which allows users to start several Paddle jobs "
     "on the same GPU card but may lead to more memory fragmentation "
-    "(i.e., maximum batch size of models may be smaller).");
+    "(i.e., maximum batch size of models may be smaller). "
+    "thread_caching serves small CPU allocations from per-thread size "
+    "class caches, for processes running many CPU predictors in parallel.");
 
 /**
  * Memory related FLAG
@@ -589,6 +592,20 @@ PADDLE_DEFINE_EXPORTED_bool(sort_sum_gradient, false,
                             "Sum gradients by the reverse order of "
                             "the forward execution sequence.");
 
+/**
+ * Distributed related FLAG
+ * Name: dygraph_gloo_async_allreduce
+ * Since Version: 2.2.0
+ * Value Range: bool, default=true
+ * Example:
+ * Note: If True, the gradient groups of dygraph DataParallel on CPU are
+ * allreduced with gloo on a communication thread while backward goes on,
+ * otherwise each group is allreduced by the backward thread once it is ready.
+ */
+PADDLE_DEFINE_EXPORTED_bool(dygraph_gloo_async_allreduce, true,
+                            "Allreduce the gradient groups of dygraph "
+                            "DataParallel on CPU asynchronously.");
+
 /**
  * Performance related FLAG
  * Name: max_inplace_grad_add
@@ -731,3 +748,17 @@ DEFINE_bool(enable_slotrecord_reset_shrink, false,
             "enable slotrecord obejct reset shrink memory, default false");
 DEFINE_bool(enable_ins_parser_file, false,
             "enable parser ins file , default false");
+
+/**
+ * Operator related FLAG
+ * Name: FLAGS_jit_cxx
+ * Since Version: 2.3.0
+ * Value Range: string, default=c++
+ * Example: FLAGS_jit_cxx=clang++ compiles the fused elementwise kernels of
+ *          fusion_group on CPU by clang++.
+ * Note: The host compiler to compile the code generated at runtime for CPU.
+ */
+PADDLE_DEFINE_EXPORTED_string(
+    jit_cxx, "c++",
+    "The host compiler to compile the code generated at runtime for CPU, "
+    "such as the fused elementwise kernels of fusion_group.");
@@ -31,6 +31,7 @@ limitations under the License. */
 #include "paddle/fluid/framework/data_feed.pb.h"
 #include "paddle/fluid/framework/data_set.h"
 #include "paddle/fluid/framework/dataset_factory.h"
+#include "paddle/fluid/framework/slot_record_binary.h"
 #include "paddle/fluid/framework/scope.h"
 #include "paddle/fluid/inference/io.h"
 #include "paddle/fluid/platform/place.h"
@@ -89,6 +90,7 @@ class IterableDatasetWrapper {
     PADDLE_ENFORCE_EQ(
         is_started_, false,
         platform::errors::AlreadyExists("Reader has been started already"));
+    dataset_->PrepareShuffleIndex();
     data_feeds_ = dataset_->GetReaders();
     PADDLE_ENFORCE_EQ(data_feeds_.size(), places_.size(),
                       platform::errors::InvalidArgument(
@@ -247,6 +249,10 @@ void BindDataset(py::module *m) {
            py::call_guard<py::gil_scoped_release>())
       .def("wait_preload_done", &framework::Dataset::WaitPreLoadDone,
            py::call_guard<py::gil_scoped_release>())
+      .def("set_file_prefetch", &framework::Dataset::SetFilePrefetch,
+           py::call_guard<py::gil_scoped_release>())
+      .def("prefetch_files", &framework::Dataset::PrefetchFiles,
+           py::call_guard<py::gil_scoped_release>())
       .def("release_memory", &framework::Dataset::ReleaseMemory,
            py::call_guard<py::gil_scoped_release>())
       .def("local_shuffle", &framework::Dataset::LocalShuffle,
@@ -292,6 +298,10 @@ void BindDataset(py::module *m) {
            py::call_guard<py::gil_scoped_release>())
       .def("set_fea_eval", &framework::Dataset::SetFeaEval,
            py::call_guard<py::gil_scoped_release>())
+      .def("set_shuffle_by_index", &framework::Dataset::SetShuffleByIndex,
+           py::call_guard<py::gil_scoped_release>())
+      .def("set_channel_shard_num", &framework::Dataset::SetChannelShardNum,
+           py::call_guard<py::gil_scoped_release>())
       .def("set_preload_thread_num", &framework::Dataset::SetPreLoadThreadNum,
            py::call_guard<py::gil_scoped_release>())
       .def("create_preload_readers", &framework::Dataset::CreatePreLoadReaders,
@@ -311,6 +321,11 @@ void BindDataset(py::module *m) {
       .def("enable_pv_merge", &framework::Dataset::EnablePvMerge,
            py::call_guard<py::gil_scoped_release>());
 
+  m->def("convert_slot_text_to_binary", &framework::ConvertSlotTextToBinary,
+         py::arg("text_path"), py::arg("binary_path"), py::arg("slot_names"),
+         py::arg("slot_types"), py::arg("with_ins_id") = false,
+         py::call_guard<py::gil_scoped_release>());
+
   py::class_<IterableDatasetWrapper>(*m, "IterableDatasetWrapper")
       .def(py::init<framework::Dataset *, const std::vector<std::string> &,
                     const std::vector<platform::Place> &, size_t, bool>())
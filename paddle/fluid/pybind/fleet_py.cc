@@ -29,6 +29,7 @@ limitations under the License. */
 #include <vector>
 
 #include "paddle/fluid/distributed/common/sparse_sharding_merge.h"
+#include "paddle/fluid/distributed/common/sparse_snapshot_merge.h"
 #include "paddle/fluid/distributed/communicator_common.h"
 #include "paddle/fluid/distributed/fleet.h"
 #include "paddle/fluid/distributed/index_dataset/index_sampler.h"
@@ -50,6 +51,7 @@ using paddle::distributed::GraphPyServer;
 using paddle::distributed::GraphPyClient;
 using paddle::distributed::FeatureNode;
 using paddle::distributed::ShardingMerge;
+using paddle::distributed::SnapshotMerge;
 
 namespace paddle {
 namespace pybind {
@@ -93,6 +95,11 @@ void BindSparseShardingTools(py::module* m) {
   py::class_<ShardingMerge>(*m, "ShardingMerge")
       .def(py::init<>())
       .def("merge", &ShardingMerge::Merge);
+
+  py::class_<SnapshotMerge>(*m, "SparseSnapshotMerge")
+      .def(py::init<>())
+      .def("merge", &SnapshotMerge::Merge)
+      .def("merge_dirs", &SnapshotMerge::MergeDirs);
 }
 
 void BindCommunicatorContext(py::module* m) {
@@ -206,6 +213,8 @@ void BindGraphPyClient(py::module* m) {
       .def("pull_graph_list", &GraphPyClient::pull_graph_list)
       .def("start_client", &GraphPyClient::start_client)
       .def("batch_sample_neighboors", &GraphPyClient::batch_sample_neighboors)
+      .def("batch_sample_multi_hop_neighboors",
+           &GraphPyClient::batch_sample_multi_hop_neighboors)
       .def("remove_graph_node", &GraphPyClient::remove_graph_node)
       .def("random_sample_nodes", &GraphPyClient::random_sample_nodes)
       .def("stop_server", &GraphPyClient::stop_server)
@@ -369,6 +369,15 @@ class InMemoryDataset(DatasetBase):
             fea_eval(bool): Set if Dataset need to do feature importance evaluation using slots shuffle.
                             default is False.
             candidate_size(int): if fea_eval is set True, set the candidate size used in slots shuffle.
+            shuffle_by_index(bool): Set if local and global shuffle permute an index of the instances
+                                    instead of the instances. default is False.
+            channel_shard_num(int): Set the number of locked queues the loaded instances are split
+                                    over, more queues lower the lock contention of many threads.
+                                    default is 1.
+            prefetch_thread_num(int): Set the number of threads fetching the files into memory ahead of
+                                      the parsing, 0 turns prefetching off. default is 0.
+            prefetch_memory_mb(int): if prefetch_thread_num > 0, set about how many MB the fetching may
+                                     be ahead of the parsing. default is 1024.
 
         Examples:
             .. code-block:: python
@@ -412,6 +421,19 @@ class InMemoryDataset(DatasetBase):
             candidate_size = kwargs.get("candidate_size", 10000)
             self._set_fea_eval(candidate_size, True)
 
+        shuffle_by_index = kwargs.get("shuffle_by_index", False)
+        if shuffle_by_index:
+            self._set_shuffle_by_index(True)
+
+        channel_shard_num = kwargs.get("channel_shard_num", 1)
+        if channel_shard_num > 1:
+            self._set_channel_shard_num(channel_shard_num)
+
+        prefetch_thread_num = kwargs.get("prefetch_thread_num", 0)
+        if prefetch_thread_num > 0:
+            prefetch_memory_mb = kwargs.get("prefetch_memory_mb", 1024)
+            self._set_file_prefetch(prefetch_thread_num, prefetch_memory_mb)
+
     def update_settings(self, **kwargs):
         """
         :api_attr: Static Graph
@@ -896,6 +918,38 @@ class InMemoryDataset(DatasetBase):
         self.dataset.wait_preload_done()
         self.dataset.destroy_preload_readers()
 
+    def prefetch_files(self):
+        """
+        :api_attr: Static Graph
+
+        Start fetching the files into memory in async mode, e.g. those of
+        the next pass while training on this one. The next load_into_memory
+        or preload_into_memory parses the fetched files. File prefetch
+        should be set in _init_distributed_settings.
+
+        Examples:
+            .. code-block:: python
+
+                import paddle
+                paddle.enable_static()
+
+                dataset = paddle.distributed.InMemoryDataset()
+                dataset.init(
+                    batch_size=1,
+                    thread_num=2,
+                    input_type=1,
+                    pipe_command="cat",
+                    use_var=[])
+                dataset._init_distributed_settings(prefetch_thread_num=4)
+                filelist = ["a.txt", "b.txt"]
+                dataset.set_filelist(filelist)
+                dataset.prefetch_files()
+                # train on the data loaded before
+                dataset.load_into_memory()
+        """
+        self.dataset.set_data_feed_desc(self._desc())
+        self.dataset.prefetch_files()
+
     def local_shuffle(self):
         """
         :api_attr: Static Graph
@@ -1156,6 +1210,72 @@ class InMemoryDataset(DatasetBase):
             self.dataset.set_fea_eval(fea_eval, record_candidate_size)
         self.fea_eval = fea_eval
 
+    def _set_shuffle_by_index(self, shuffle_by_index=True):
+        """
+        Set if local_shuffle and global_shuffle permute an index of the
+        instances in memory instead of moving the instances. The readers
+        gather each batch through the index when training, so shuffling does
+        not copy the data. It can not be used with slots_shuffle or merge by
+        line id.
+
+        Args:
+            shuffle_by_index(bool): whether to shuffle by index. default is True.
+
+        Examples:
+            .. code-block:: python
+
+            import paddle
+            paddle.enable_static()
+            dataset = paddle.distributed.InMemoryDataset()
+            dataset._set_shuffle_by_index(True)
+
+        """
+        self.dataset.set_shuffle_by_index(shuffle_by_index)
+
+    def _set_channel_shard_num(self, channel_shard_num):
+        """
+        Set the number of locked queues the instances loaded into memory are
+        split over. Each loading and reading thread takes the queue of its
+        own first, so many threads seldom wait for each other. The order of
+        the instances is not kept across threads. It should be called before
+        load_into_memory and can not be used with PSGPU.
+
+        Args:
+            channel_shard_num(int): shard num, 1 is a single queue.
+
+        Examples:
+            .. code-block:: python
+
+            import paddle
+            paddle.enable_static()
+            dataset = paddle.distributed.InMemoryDataset()
+            dataset._set_channel_shard_num(16)
+
+        """
+        self.dataset.set_channel_shard_num(channel_shard_num)
+
+    def _set_file_prefetch(self, thread_num, memory_budget_mb=1024):
+        """
+        Set load_into_memory and preload_into_memory to fetch the files into
+        memory through the pipe command on threads of their own, ahead of
+        the threads parsing them. The fetching stops while about
+        memory_budget_mb MB of files are fetched and not parsed yet.
+
+        Args:
+            thread_num(int): fetch thread num, 0 turns prefetching off.
+            memory_budget_mb(int): memory budget in MB. default is 1024.
+
+        Examples:
+            .. code-block:: python
+
+            import paddle
+            paddle.enable_static()
+            dataset = paddle.distributed.InMemoryDataset()
+            dataset._set_file_prefetch(4, 2048)
+
+        """
+        self.dataset.set_file_prefetch(thread_num, memory_budget_mb)
+
     def slots_shuffle(self, slots):
         """
         Slots Shuffle 
@@ -396,7 +396,8 @@ class InMemoryDataset(DatasetBase):
         Set data_feed_desc
         """
         self.proto_desc.name = data_feed_type
-        if (self.proto_desc.name == "SlotRecordInMemoryDataFeed"):
+        if (self.proto_desc.name == "SlotRecordInMemoryDataFeed" or
+                self.proto_desc.name == "SlotRecordBinaryInMemoryDataFeed"):
             self.dataset = core.Dataset("SlotRecordDataset")
 
     @deprecated(
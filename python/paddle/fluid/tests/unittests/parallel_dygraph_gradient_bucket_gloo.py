@@ -0,0 +1,104 @@
+# Copyright (c) 2021 PaddlePaddle Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from __future__ import division
+from __future__ import print_function
+
+import unittest
+import time
+
+import paddle
+import numpy as np
+import paddle.distributed as dist
+import paddle.fluid as fluid
+from paddle.fluid.dygraph.nn import Linear
+
+paddle.seed(1024)
+np.random.seed(2021)
+
+batch = 32
+hidden = 512
+layer_num = 8
+steps = 10
+
+
+class DeepNet(fluid.Layer):
+    def __init__(self):
+        super(DeepNet, self).__init__()
+        self.layers = paddle.nn.LayerList(
+            [Linear(hidden, hidden, act='relu') for _ in range(layer_num)])
+
+    def forward(self, x):
+        for layer in self.layers:
+            x = layer(x)
+        return x
+
+
+class TestGradientBucketGloo(unittest.TestCase):
+    def test_async_allreduce(self):
+        dist.init_parallel_env()
+        self.trainer_id = dist.get_rank()
+
+        paddle.set_flags({'FLAGS_dygraph_gloo_async_allreduce': False})
+        model_sync = DeepNet()
+        state_dict = model_sync.state_dict()
+        # 1MB buckets, so that several groups are allreduced in one backward
+        model_sync = paddle.DataParallel(
+            model_sync, comm_buffer_size=1, last_comm_buffer_size=1)
+
+        paddle.set_flags({'FLAGS_dygraph_gloo_async_allreduce': True})
+        model_async = DeepNet()
+        model_async.set_state_dict(state_dict)
+        model_async = paddle.DataParallel(
+            model_async, comm_buffer_size=1, last_comm_buffer_size=1)
+
+        inputs = [
+            paddle.to_tensor(
+                np.random.rand(batch, hidden).astype('float32') +
+                self.trainer_id) for _ in range(steps)
+        ]
+
+        sync_cost = self.run_steps(model_sync, inputs)
+        async_cost = self.run_steps(model_async, inputs)
+
+        for param_sync, param_async in zip(model_sync.parameters(),
+                                           model_async.parameters()):
+            np.testing.assert_allclose(
+                param_sync.grad.numpy(), param_async.grad.numpy(), rtol=1e-6)
+        self.check_gradient(model_async.parameters())
+
+        if self.trainer_id == 0:
+            print("{} steps of {} ranks: sync allreduce {:.3f}s, async "
+                  "allreduce {:.3f}s".format(steps,
+                                              dist.get_world_size(),
+                                              sync_cost, async_cost))
+
+    def run_steps(self, model, inputs):
+        start = time.time()
+        for x in inputs:
+            model.clear_gradients()
+            model(x).mean().backward()
+        return time.time() - start
+
+    def check_gradient(self, params):
+        for param in params:
+            grad = param._grad_ivar()
+            other_grad = grad.clone()
+            paddle.distributed.broadcast(other_grad, 1)
+            if self.trainer_id == 0:
+                np.testing.assert_allclose(other_grad.numpy(), grad.numpy())
+
+
+if __name__ == '__main__':
+    unittest.main()
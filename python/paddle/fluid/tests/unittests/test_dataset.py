@@ -267,6 +267,120 @@ class TestDataset(unittest.TestCase):
         os.remove("./test_in_memory_dataset_run_a.txt")
         os.remove("./test_in_memory_dataset_run_b.txt")
 
+    def test_in_memory_dataset_shuffle_by_index(self):
+        """
+        Testcase for InMemoryDataset shuffled by index.
+        """
+        with open("test_in_memory_dataset_shuffle_by_index_a.txt", "w") as f:
+            data = "1 1 2 3 3 4 5 5 5 5 1 1\n"
+            data += "1 2 2 3 4 4 6 6 6 6 1 2\n"
+            data += "1 3 2 3 5 4 7 7 7 7 1 3\n"
+            f.write(data)
+        with open("test_in_memory_dataset_shuffle_by_index_b.txt", "w") as f:
+            data = "1 4 2 3 3 4 5 5 5 5 1 4\n"
+            data += "1 5 2 3 4 4 6 6 6 6 1 5\n"
+            data += "1 6 2 3 5 4 7 7 7 7 1 6\n"
+            data += "1 7 2 3 6 4 8 8 8 8 1 7\n"
+            f.write(data)
+
+        slots = ["slot1", "slot2", "slot3", "slot4"]
+        slots_vars = []
+        for slot in slots:
+            var = fluid.layers.data(
+                name=slot, shape=[1], dtype="int64", lod_level=1)
+            slots_vars.append(var)
+
+        dataset = paddle.distributed.InMemoryDataset()
+        dataset.init(
+            batch_size=2, thread_num=3, pipe_command="cat", use_var=slots_vars)
+        dataset._init_distributed_settings(shuffle_by_index=True)
+        dataset.set_filelist([
+            "test_in_memory_dataset_shuffle_by_index_a.txt",
+            "test_in_memory_dataset_shuffle_by_index_b.txt"
+        ])
+        dataset.load_into_memory()
+        dataset.local_shuffle()
+        self.assertEqual(dataset.get_memory_data_size(), 7)
+        exe = fluid.Executor(fluid.CPUPlace())
+        exe.run(fluid.default_startup_program())
+        if self.use_data_loader:
+            data_loader = fluid.io.DataLoader.from_dataset(dataset,
+                                                           fluid.cpu_places(),
+                                                           self.drop_last)
+            for i in range(self.epoch_num):
+                for data in data_loader():
+                    exe.run(fluid.default_main_program(), feed=data)
+        else:
+            for i in range(self.epoch_num):
+                try:
+                    exe.train_from_dataset(fluid.default_main_program(),
+                                           dataset)
+                except Exception as e:
+                    self.assertTrue(False)
+        self.assertEqual(dataset.get_memory_data_size(), 7)
+
+        os.remove("./test_in_memory_dataset_shuffle_by_index_a.txt")
+        os.remove("./test_in_memory_dataset_shuffle_by_index_b.txt")
+
+    def test_in_memory_dataset_prefetch_files(self):
+        """
+        Testcase for InMemoryDataset loading prefetched files.
+        """
+        with open("test_in_memory_dataset_prefetch_files_a.txt", "w") as f:
+            data = "1 1 2 3 3 4 5 5 5 5 1 1\n"
+            data += "1 2 2 3 4 4 6 6 6 6 1 2\n"
+            data += "1 3 2 3 5 4 7 7 7 7 1 3\n"
+            f.write(data)
+        with open("test_in_memory_dataset_prefetch_files_b.txt", "w") as f:
+            data = "1 4 2 3 3 4 5 5 5 5 1 4\n"
+            data += "1 5 2 3 4 4 6 6 6 6 1 5\n"
+            data += "1 6 2 3 5 4 7 7 7 7 1 6\n"
+            data += "1 7 2 3 6 4 8 8 8 8 1 7\n"
+            f.write(data)
+
+        slots = ["slot1", "slot2", "slot3", "slot4"]
+        slots_vars = []
+        for slot in slots:
+            var = fluid.layers.data(
+                name=slot, shape=[1], dtype="int64", lod_level=1)
+            slots_vars.append(var)
+
+        dataset = paddle.distributed.InMemoryDataset()
+        dataset.init(
+            batch_size=2, thread_num=3, pipe_command="cat", use_var=slots_vars)
+        dataset._init_distributed_settings(
+            prefetch_thread_num=2, prefetch_memory_mb=1)
+        dataset.set_filelist([
+            "test_in_memory_dataset_prefetch_files_a.txt",
+            "test_in_memory_dataset_prefetch_files_b.txt"
+        ])
+        dataset.prefetch_files()
+        dataset.load_into_memory()
+        self.assertEqual(dataset.get_memory_data_size(), 7)
+
+        # without prefetch_files, loading starts the fetching itself
+        dataset2 = paddle.distributed.InMemoryDataset()
+        dataset2.init(
+            batch_size=2, thread_num=3, pipe_command="cat", use_var=slots_vars)
+        dataset2._init_distributed_settings(prefetch_thread_num=2)
+        dataset2.set_filelist([
+            "test_in_memory_dataset_prefetch_files_a.txt",
+            "test_in_memory_dataset_prefetch_files_b.txt"
+        ])
+        dataset2.preload_into_memory()
+        dataset2.wait_preload_done()
+        self.assertEqual(dataset2.get_memory_data_size(), 7)
+        exe = fluid.Executor(fluid.CPUPlace())
+        exe.run(fluid.default_startup_program())
+        for i in range(self.epoch_num):
+            try:
+                exe.train_from_dataset(fluid.default_main_program(), dataset)
+            except Exception as e:
+                self.assertTrue(False)
+
+        os.remove("./test_in_memory_dataset_prefetch_files_a.txt")
+        os.remove("./test_in_memory_dataset_prefetch_files_b.txt")
+
     def test_in_memory_dataset_masterpatch(self):
         """
         Testcase for InMemoryDataset from create to run.
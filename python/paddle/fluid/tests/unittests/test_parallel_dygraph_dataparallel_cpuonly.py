@@ -130,5 +130,10 @@ class TestDataParallelGradientCheck(TestMultipleGpus):
         self.run_mnist_2gpu('parallel_dygraph_gradient_check.py')
 
 
+class TestDataParallelGradientBucketGloo(TestMultipleGpus):
+    def test_multiple_gpus_dynamic(self):
+        self.run_mnist_2gpu('parallel_dygraph_gradient_bucket_gloo.py')
+
+
 if __name__ == "__main__":
     unittest.main()